@@ -12,6 +12,28 @@ Options:
     -t (hlsl)       Set the compilation target. Only HLSL for now
     -o <out.ext>    Output filename
     -m <out.json>   Parameter metadata output filename, used by the ChameleonRT runtime
+    -O<0-3>         Set the optimization level, defaults to -O2
+    -ffast-math     Apply fast math rewrites to all functions, not only [fast_math] ones
+    -fpack-payloads Pack the ray payloads into the fewest 32-bit words, using the encodings
+                    selected by the payload member attributes
+    -fpayload-access-qualifiers
+                    Declare the stages reading and writing each ray payload field, requires
+                    shader model 6.7 or -enable-payload-qualifiers
+    -fshader-record-budget=<bytes>
+                    Move constants of entry point parameters out of shader records larger
+                    than <bytes> into a constant buffer referenced by the record
+    -D<name>=<val>  Set the value of the specialization constant <name>
+    -fconsteval-budget=<n>
+                    Set the step budget for evaluating calls at compile time
+    -fprofile-instrument
+                    Insert profile counters into the shader, listed in the metadata output
+    --profile-use <file.crtlprof>
+                    Guide the optimizations with a profile collected from an instrumented build
+    -Rpass[=<regex>]
+                    Report optimization remarks for the passes matching <regex>, or all
+                    passes if no regex is given
+    --remarks-output <out.json>
+                    Write the optimization remarks to a JSON file
     -h              Print this information
 )";
 
@@ -35,6 +57,8 @@ int main(int argc, char **argv)
     const std::string source_file = args[0];
     std::string output_file;
     std::string param_data_output_file;
+    std::string remarks_output_file;
+    crtl::CompileOptions options;
     for (size_t i = 1; i < args.size(); ++i) {
         if (args[i] == "-t") {
             if (args[++i] != "hlsl") {
@@ -44,18 +68,62 @@ int main(int argc, char **argv)
             output_file = args[++i];
         } else if (args[i] == "-m") {
             param_data_output_file = args[++i];
+        } else if (args[i] == "-ffast-math") {
+            options.fast_math = true;
+        } else if (args[i] == "-fpack-payloads") {
+            options.pack_payloads = true;
+        } else if (args[i] == "-fpayload-access-qualifiers") {
+            options.payload_access_qualifiers = true;
+        } else if (args[i] == "-Rpass") {
+            options.remarks_filter = ".*";
+        } else if (args[i].starts_with("-Rpass=")) {
+            options.remarks_filter = args[i].substr(std::string("-Rpass=").size());
+        } else if (args[i] == "--remarks-output") {
+            remarks_output_file = args[++i];
+        } else if (args[i] == "-fprofile-instrument") {
+            options.profile_instrument = true;
+        } else if (args[i] == "--profile-use") {
+            options.profile_use = args[++i];
+        } else if (args[i].starts_with("-fconsteval-budget=")) {
+            options.compile_time_evaluation_budget =
+                std::stoul(args[i].substr(std::string("-fconsteval-budget=").size()));
+        } else if (args[i].starts_with("-fshader-record-budget=")) {
+            options.shader_record_budget =
+                std::stoul(args[i].substr(std::string("-fshader-record-budget=").size()));
+        } else if (args[i].starts_with("-D") && args[i].find('=') != std::string::npos) {
+            const size_t eq = args[i].find('=');
+            options.specialization_values[args[i].substr(2, eq - 2)] = args[i].substr(eq + 1);
+        } else if (args[i].size() == 3 && args[i].starts_with("-O") && args[i][2] >= '0' &&
+                   args[i][2] <= char('0' + crtl::MAX_OPTIMIZATION_LEVEL)) {
+            options.optimization_level = args[i][2] - '0';
         } else {
             std::cerr << "Unhandled argument ;" << args[i] << "'\n";
         }
     }
 
+    // Writing the remarks to a file reports all of them unless a filter was given
+    if (!remarks_output_file.empty() && options.remarks_filter.empty()) {
+        options.remarks_filter = ".*";
+    }
+
     const std::string shader_text = get_file_content(source_file);
     if (shader_text.empty()) {
         std::cout << "Failed to read shader or file was empty\n";
         return 1;
     }
 
-    auto result = crtl::hlsl::compile_crtl(shader_text);
+    std::shared_ptr<crtl::hlsl::ShaderCompilationResult> result;
+    try {
+        result = crtl::hlsl::compile_crtl(shader_text, options);
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << "\n" << USAGE << "\n";
+        return 1;
+    }
+
+    if (!remarks_output_file.empty()) {
+        std::ofstream remarks_output(remarks_output_file);
+        remarks_output << nlohmann::json(result->remarks).dump(4) << "\n";
+    }
 
     return 0;
 }
@@ -0,0 +1,13 @@
+#include "attribute.h"
+
+namespace crtl {
+namespace ast {
+
+Attribute::Attribute(const std::string &name,
+                     antlr4::Token *token,
+                     const std::vector<std::string> &args)
+    : name(name), token(token), args(args)
+{
+}
+}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "antlr4-common.h"
+
+namespace crtl {
+namespace ast {
+
+/* An attribute attached to a declaration or statement in the source code, e.g.
+ * [inline] or [unroll(4)]. Attribute arguments are kept as the source text, it's up to the
+ * pass consuming the attribute to interpret them
+ */
+struct Attribute {
+    std::string name;
+    antlr4::Token *token = nullptr;
+    std::vector<std::string> args;
+
+    Attribute(const std::string &name,
+              antlr4::Token *token,
+              const std::vector<std::string> &args = std::vector<std::string>());
+};
+}
+}
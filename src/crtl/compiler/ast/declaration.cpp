@@ -92,6 +92,11 @@ bool Function::is_builtin() const
     return token == nullptr;
 }
 
+bool Function::is_generic() const
+{
+    return !type_parameters.empty();
+}
+
 std::shared_ptr<ty::Type> make_entry_point_type(
     const std::vector<std::shared_ptr<Variable>> &parameters,
     const ty::EntryPointType entry_pt_type)
@@ -53,6 +53,10 @@ public:
     std::vector<std::shared_ptr<Variable>> parameters;
     std::shared_ptr<stmt::Block> block;
 
+    // The names of the type parameters of a generic function, uses of the type parameters
+    // in the function are struct types with the parameter's name
+    std::vector<std::string> type_parameters;
+
     // Create a declaration for a user/source code declared function
     Function(const std::string &name,
              antlr4::Token *token,
@@ -70,6 +74,9 @@ public:
     // If the function declaration is for a built-in "intrinsic" function,
     // or a user-declared function
     bool is_builtin() const;
+
+    // If the function is generic, and is instantiated for the types it's called with
+    bool is_generic() const;
 };
 
 class EntryPoint : public Declaration {
@@ -20,6 +20,10 @@ std::string operator_to_string(const NodeType nt)
         return "+";
     case NodeType::EXPR_SUB:
         return "-";
+    case NodeType::EXPR_SHIFT_LEFT:
+        return "<<";
+    case NodeType::EXPR_SHIFT_RIGHT:
+        return ">>";
     case NodeType::EXPR_CMP_LESS:
         return "<";
     case NodeType::EXPR_CMP_LESS_EQUAL:
@@ -112,6 +116,20 @@ std::shared_ptr<Binary> Binary::subtract(antlr4::Token *op,
     return std::make_shared<Binary>(op, NodeType::EXPR_SUB, left, right);
 }
 
+std::shared_ptr<Binary> Binary::shift_left(antlr4::Token *op,
+                                           const std::shared_ptr<Expression> &left,
+                                           const std::shared_ptr<Expression> &right)
+{
+    return std::make_shared<Binary>(op, NodeType::EXPR_SHIFT_LEFT, left, right);
+}
+
+std::shared_ptr<Binary> Binary::shift_right(antlr4::Token *op,
+                                            const std::shared_ptr<Expression> &left,
+                                            const std::shared_ptr<Expression> &right)
+{
+    return std::make_shared<Binary>(op, NodeType::EXPR_SHIFT_RIGHT, left, right);
+}
+
 std::shared_ptr<Binary> Binary::cmp_less(antlr4::Token *op,
                                          const std::shared_ptr<Expression> &left,
                                          const std::shared_ptr<Expression> &right)
@@ -240,9 +258,14 @@ StructMemberAccessFragment::StructMemberAccessFragment(antlr4::Token *member) :
 {
 }
 
+StructMemberAccessFragment::StructMemberAccessFragment(const std::string &member_name)
+    : member_name(member_name)
+{
+}
+
 std::string StructMemberAccessFragment::name() const
 {
-    return member->getText();
+    return member ? member->getText() : member_name;
 }
 
 ArrayAccessFragment::ArrayAccessFragment(const std::shared_ptr<Expression> &index)
@@ -252,10 +275,21 @@ ArrayAccessFragment::ArrayAccessFragment(const std::shared_ptr<Expression> &inde
 
 FunctionCall::FunctionCall(antlr4::Token *callee,
                            const std::vector<std::shared_ptr<Expression>> &args)
-    : Expression(callee, NodeType::EXPR_FCN_CALL), args(args)
+    : Expression(callee, NodeType::EXPR_FCN_CALL), callee_name(callee->getText()), args(args)
+{
+}
+
+FunctionCall::FunctionCall(const std::string &callee,
+                           const std::vector<std::shared_ptr<Expression>> &args)
+    : Expression(nullptr, NodeType::EXPR_FCN_CALL), callee_name(callee), args(args)
 {
 }
 
+std::string FunctionCall::get_text() const
+{
+    return callee_name;
+}
+
 StructArrayAccess::StructArrayAccess(
     const std::shared_ptr<Variable> &var,
     const std::vector<std::shared_ptr<StructArrayAccessFragment>> &struct_array_access)
@@ -269,6 +303,13 @@ std::vector<std::shared_ptr<Node>> StructArrayAccess::get_children()
 {
     std::vector<std::shared_ptr<Node>> children;
     children.push_back(variable);
+    // The index expressions of any array accesses are also children of the expression
+    for (auto &f : struct_array_access) {
+        auto array_access = std::dynamic_pointer_cast<ArrayAccessFragment>(f);
+        if (array_access) {
+            children.push_back(array_access->index);
+        }
+    }
     return children;
 }
 
@@ -63,6 +63,14 @@ public:
                                             const std::shared_ptr<Expression> &left,
                                             const std::shared_ptr<Expression> &right);
 
+    static std::shared_ptr<Binary> shift_left(antlr4::Token *op,
+                                              const std::shared_ptr<Expression> &left,
+                                              const std::shared_ptr<Expression> &right);
+
+    static std::shared_ptr<Binary> shift_right(antlr4::Token *op,
+                                               const std::shared_ptr<Expression> &left,
+                                               const std::shared_ptr<Expression> &right);
+
     static std::shared_ptr<Binary> cmp_less(antlr4::Token *op,
                                             const std::shared_ptr<Expression> &left,
                                             const std::shared_ptr<Expression> &right);
@@ -138,10 +146,16 @@ public:
 
 class StructMemberAccessFragment : public StructArrayAccessFragment {
 public:
-    antlr4::Token *member;
+    antlr4::Token *member = nullptr;
+
+    // The name of the member accessed by generated fragments, which have no token
+    std::string member_name;
 
     StructMemberAccessFragment(antlr4::Token *member);
 
+    // Constructor for generated member accesses
+    StructMemberAccessFragment(const std::string &member_name);
+
     std::string name() const;
 };
 
@@ -154,12 +168,20 @@ public:
 
 class FunctionCall : public Expression {
 public:
+    std::string callee_name;
     std::vector<std::shared_ptr<Expression>> args;
     // Any struct member or array accesses performed on the return value of the call
     std::vector<std::shared_ptr<StructArrayAccessFragment>> struct_array_access;
 
     FunctionCall(antlr4::Token *callee, const std::vector<std::shared_ptr<Expression>> &args);
 
+    // Constructor for generated calls
+    FunctionCall(const std::string &callee,
+                 const std::vector<std::shared_ptr<Expression>> &args);
+
+    // Get the name of the function being called
+    std::string get_text() const override;
+
     std::vector<std::shared_ptr<Node>> get_children() override;
 };
 
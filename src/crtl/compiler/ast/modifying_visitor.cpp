@@ -5,14 +5,22 @@ namespace ast {
 
 std::any ModifyingVisitor::visit_ast(const std::shared_ptr<AST> &ast)
 {
-    std::vector<std::shared_ptr<decl::Declaration>> decls;
-    for (auto &n : ast->top_level_decls) {
-        collect_results(visit(n), decls);
-    }
-
     auto ast_out = std::make_shared<AST>();
-    for (auto &d : decls) {
-        ast_out->top_level_decls.push_back(d);
+    for (auto &n : ast->top_level_decls) {
+        auto result = visit(n);
+        // Global variable declarations are statements, so visiting them returns a statement
+        // instead of a declaration
+        if (result.has_value() && result.type() == typeid(std::shared_ptr<stmt::Statement>)) {
+            ast_out->top_level_decls.push_back(
+                std::any_cast<std::shared_ptr<stmt::Statement>>(result));
+            continue;
+        }
+
+        std::vector<std::shared_ptr<decl::Declaration>> decls;
+        collect_results(result, decls);
+        for (auto &d : decls) {
+            ast_out->top_level_decls.push_back(d);
+        }
     }
 
     return ast_out;
@@ -79,7 +87,9 @@ std::any ModifyingVisitor::visit_decl_struct_member(
 
 std::any ModifyingVisitor::visit_decl_variable(const std::shared_ptr<decl::Variable> &d)
 {
-    d->expression = std::any_cast<std::shared_ptr<expr::Expression>>(d->expression);
+    if (d->expression) {
+        d->expression = result_or_nullptr<expr::Expression>(visit(d->expression));
+    }
     return std::dynamic_pointer_cast<decl::Declaration>(d);
 }
 
@@ -222,7 +232,15 @@ std::any ModifyingVisitor::visit_expr_function_call(
 std::any ModifyingVisitor::visit_struct_array_access(
     const std::shared_ptr<expr::StructArrayAccess> &e)
 {
-    // Note: can't really visit the sub "fragments" of the struct/array access separately
+    // Note: can't really visit the sub "fragments" of the struct/array access separately,
+    // but we can visit the index expressions of any array accesses
+    for (auto &f : e->struct_array_access) {
+        auto array_access = std::dynamic_pointer_cast<expr::ArrayAccessFragment>(f);
+        if (array_access) {
+            array_access->index =
+                std::any_cast<std::shared_ptr<expr::Expression>>(visit(array_access->index));
+        }
+    }
     return std::dynamic_pointer_cast<expr::Expression>(e);
 }
 
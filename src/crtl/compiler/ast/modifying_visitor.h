@@ -73,7 +73,7 @@ public:
     virtual std::any visit_expr_assignment(
         const std::shared_ptr<expr::Assignment> &e) override;
 
-private:
+protected:
     /* Utility for nodes that can accept zero, one, or multiple values returned by visiting the
      * child node passed. Results will be appended to results
      */
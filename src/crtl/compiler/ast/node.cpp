@@ -1,4 +1,5 @@
 #include "node.h"
+#include <algorithm>
 
 namespace crtl {
 namespace ast {
@@ -46,6 +47,10 @@ std::string to_string(const NodeType &nt)
         return "EXPR_ADD";
     case NodeType::EXPR_SUB:
         return "EXPR_SUB";
+    case NodeType::EXPR_SHIFT_LEFT:
+        return "EXPR_SHIFT_LEFT";
+    case NodeType::EXPR_SHIFT_RIGHT:
+        return "EXPR_SHIFT_RIGHT";
     case NodeType::EXPR_CMP_LESS:
         return "EXPR_CMP_LESS";
     case NodeType::EXPR_CMP_LESS_EQUAL:
@@ -103,5 +108,30 @@ std::string Node::get_text() const
 {
     return token->getText();
 }
+
+std::shared_ptr<Attribute> Node::get_attribute(const std::string &name) const
+{
+    for (const auto &a : attributes) {
+        if (a->name == name) {
+            return a;
+        }
+    }
+    return nullptr;
+}
+
+bool Node::has_attribute(const std::string &name) const
+{
+    return get_attribute(name) != nullptr;
+}
+
+void Node::remove_attribute(const std::string &name)
+{
+    attributes.erase(std::remove_if(attributes.begin(),
+                                    attributes.end(),
+                                    [&](const std::shared_ptr<Attribute> &a) {
+                                        return a->name == name;
+                                    }),
+                     attributes.end());
+}
 }
 }
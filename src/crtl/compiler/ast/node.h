@@ -2,6 +2,7 @@
 
 #include "ChameleonRTParser.h"
 #include "antlr4-common.h"
+#include "attribute.h"
 #include "json.hpp"
 
 namespace crtl {
@@ -39,6 +40,9 @@ enum class NodeType {
     EXPR_DIV,
     EXPR_ADD,
     EXPR_SUB,
+    // Shifts are not in the source language, but are produced by strength reduction
+    EXPR_SHIFT_LEFT,
+    EXPR_SHIFT_RIGHT,
     EXPR_CMP_LESS,
     EXPR_CMP_LESS_EQUAL,
     EXPR_CMP_GREATER,
@@ -68,6 +72,9 @@ protected:
     NodeType node_type = NodeType::INVALID;
 
 public:
+    // Attributes specified on the node in the source code, e.g. [inline]
+    std::vector<std::shared_ptr<Attribute>> attributes;
+
     Node() = default;
 
     Node(antlr4::Token *token, NodeType type);
@@ -88,6 +95,14 @@ public:
 
     virtual std::string get_text() const;
 
+    // Get the attribute with the given name, or nullptr if the node doesn't have it
+    std::shared_ptr<Attribute> get_attribute(const std::string &name) const;
+
+    bool has_attribute(const std::string &name) const;
+
+    // Remove the attribute with the given name, e.g. once a pass has applied it
+    void remove_attribute(const std::string &name);
+
     virtual std::vector<std::shared_ptr<Node>> get_children() = 0;
 };
 
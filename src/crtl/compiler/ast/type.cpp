@@ -1,5 +1,7 @@
 #include "type.h"
 #include <algorithm>
+#include <cctype>
+#include <stdexcept>
 
 namespace crtl {
 namespace ast {
@@ -28,6 +30,8 @@ std::string to_string(const BaseType &bt)
         return "ACCELERATION_STRUCTURE";
     case BaseType::RAY:
         return "RAY";
+    case BaseType::QUANTIZED:
+        return "QUANTIZED";
     default:
         return "INVALID";
     }
@@ -59,10 +63,16 @@ std::string to_string(const PrimitiveType &pt)
     switch (pt) {
     case PrimitiveType::BOOL:
         return "BOOL";
+    case PrimitiveType::INT16:
+        return "INT16";
+    case PrimitiveType::UINT16:
+        return "UINT16";
     case PrimitiveType::INT:
         return "INT";
     case PrimitiveType::UINT:
         return "UINT";
+    case PrimitiveType::HALF:
+        return "HALF";
     case PrimitiveType::FLOAT:
         return "FLOAT";
     case PrimitiveType::DOUBLE:
@@ -84,6 +94,24 @@ std::string to_string(const Modifier &m)
         return "OUT";
     case Modifier::IN_OUT:
         return "IN_OUT";
+    case Modifier::PRECISE:
+        return "PRECISE";
+    case Modifier::SPECIALIZE:
+        return "SPECIALIZE";
+    default:
+        return "INVALID";
+    }
+}
+
+std::string to_string(const QuantizedFormat &qf)
+{
+    switch (qf) {
+    case QuantizedFormat::OCT32:
+        return "OCT32";
+    case QuantizedFormat::UNORM16_2:
+        return "UNORM16_2";
+    case QuantizedFormat::SNORM16_3:
+        return "SNORM16_3";
     default:
         return "INVALID";
     }
@@ -148,9 +176,16 @@ Vector::Vector(const std::shared_ptr<Primitive> &element_type,
 {
 }
 
+// The 16-bit int type names end in a digit, so their dimensions are separated by an underscore
+std::string dimensions_prefix(const std::shared_ptr<Primitive> &element_type)
+{
+    const std::string str = element_type->to_string();
+    return std::isdigit(str.back()) ? str + "_" : str;
+}
+
 const std::string Vector::to_string() const
 {
-    return element_type->to_string() + std::to_string(dimensionality);
+    return dimensions_prefix(element_type) + std::to_string(dimensionality);
 }
 
 Matrix::Matrix(const std::shared_ptr<Primitive> &element_type,
@@ -173,7 +208,7 @@ Matrix::Matrix(const std::shared_ptr<Primitive> &element_type,
 
 const std::string Matrix::to_string() const
 {
-    return element_type->to_string() + std::to_string(dim_0) + "X" +
+    return dimensions_prefix(element_type) + std::to_string(dim_0) + "X" +
            std::to_string(dim_1);
 }
 
@@ -327,6 +362,54 @@ const std::string Ray::to_string() const
 {
     return "RAY";
 }
+
+Quantized::Quantized(const QuantizedFormat format) : Type(BaseType::QUANTIZED), format(format)
+{
+}
+
+std::shared_ptr<Vector> Quantized::decoded_type() const
+{
+    auto float_type = std::make_shared<Primitive>(PrimitiveType::FLOAT);
+    return std::make_shared<Vector>(float_type, format == QuantizedFormat::UNORM16_2 ? 2 : 3);
+}
+
+const std::string Quantized::to_string() const
+{
+    return ty::to_string(format);
+}
+
+std::shared_ptr<Type> copy_type(const std::shared_ptr<Type> &type)
+{
+    switch (type->base_type) {
+    case BaseType::PRIMITIVE:
+        return std::make_shared<Primitive>(*std::dynamic_pointer_cast<Primitive>(type));
+    case BaseType::VECTOR:
+        return std::make_shared<Vector>(*std::dynamic_pointer_cast<Vector>(type));
+    case BaseType::MATRIX:
+        return std::make_shared<Matrix>(*std::dynamic_pointer_cast<Matrix>(type));
+    case BaseType::STRUCT:
+        return std::make_shared<Struct>(*std::dynamic_pointer_cast<Struct>(type));
+    case BaseType::FUNCTION:
+        return std::make_shared<Function>(*std::dynamic_pointer_cast<Function>(type));
+    case BaseType::ENTRY_POINT:
+        return std::make_shared<EntryPoint>(*std::dynamic_pointer_cast<EntryPoint>(type));
+    case BaseType::BUFFER:
+        return std::make_shared<Buffer>(*std::dynamic_pointer_cast<Buffer>(type));
+    case BaseType::TEXTURE:
+        return std::make_shared<Texture>(*std::dynamic_pointer_cast<Texture>(type));
+    case BaseType::ACCELERATION_STRUCTURE:
+        return std::make_shared<AccelerationStructure>(
+            *std::dynamic_pointer_cast<AccelerationStructure>(type));
+    case BaseType::RAY:
+        return std::make_shared<Ray>(*std::dynamic_pointer_cast<Ray>(type));
+    case BaseType::QUANTIZED:
+        return std::make_shared<Quantized>(*std::dynamic_pointer_cast<Quantized>(type));
+    default:
+        break;
+    }
+    throw std::runtime_error("Invalid type passed to copy_type: '" + type->to_string() + "'");
+    return nullptr;
+}
 }
 }
 }
@@ -21,6 +21,7 @@ enum class BaseType {
     TEXTURE,
     ACCELERATION_STRUCTURE,
     RAY,
+    QUANTIZED,
     INVALID,
 };
 
@@ -39,10 +40,15 @@ enum class EntryPointType {
 
 std::string to_string(const EntryPointType &et);
 
+// The primitive types are ordered from the smallest to the largest type, which is the type
+// binary operations on mixed types are promoted to
 enum class PrimitiveType {
     BOOL,
+    INT16,
+    UINT16,
     INT,
     UINT,
+    HALF,
     FLOAT,
     DOUBLE,
     VOID,
@@ -60,11 +66,26 @@ enum class Modifier {
     IN,
     OUT,
     IN_OUT,
+    PRECISE,
+    SPECIALIZE,
     INVALID,
 };
 
 std::string to_string(const Modifier &m);
 
+// The quantized formats read only buffers can store their elements in
+enum class QuantizedFormat {
+    // A unit vector octahedral encoded in two 16-bit unorms, decoded to a float3
+    OCT32,
+    // Two 16-bit unorms, decoded to a float2
+    UNORM16_2,
+    // Three 16-bit snorms, decoded to a float3 with the scale and bias stored at the start
+    // of the buffer
+    SNORM16_3,
+};
+
+std::string to_string(const QuantizedFormat &qf);
+
 class Type {
 public:
     BaseType base_type = BaseType::INVALID;
@@ -166,7 +187,8 @@ public:
 
 class Template : public Type {
 public:
-    // Currently template parameters can only be Primitive or Vector types
+    // Currently template parameters can only be Primitive or Vector types, or Structs for
+    // Buffers
     std::vector<std::shared_ptr<Type>> template_parameters;
 
     Template();
@@ -224,6 +246,27 @@ public:
     const std::string to_string() const override;
 };
 
+/* A quantized element type, which can only be the element type of read only Buffers.
+ * Indexing the buffer decodes the element, so accessing an element produces its decoded type
+ */
+class Quantized : public Type {
+public:
+    QuantizedFormat format;
+
+    Quantized(const QuantizedFormat format);
+
+    // Get the float vector type the elements are decoded to
+    std::shared_ptr<Vector> decoded_type() const;
+
+    const std::string to_string() const override;
+};
+
+/* Make a shallow copy of the type, e.g. to change the modifiers of the copy without affecting
+ * other declarations sharing the type. Element and template parameter types are shared with
+ * the original
+ */
+std::shared_ptr<Type> copy_type(const std::shared_ptr<Type> &type);
+
 }
 }
 }
@@ -78,6 +78,8 @@ std::any Visitor::visit(const std::shared_ptr<Node> &n)
     case NodeType::EXPR_DIV:
     case NodeType::EXPR_ADD:
     case NodeType::EXPR_SUB:
+    case NodeType::EXPR_SHIFT_LEFT:
+    case NodeType::EXPR_SHIFT_RIGHT:
     case NodeType::EXPR_CMP_LESS:
     case NodeType::EXPR_CMP_LESS_EQUAL:
     case NodeType::EXPR_CMP_GREATER:
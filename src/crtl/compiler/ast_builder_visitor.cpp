@@ -1,4 +1,5 @@
 #include "ast_builder_visitor.h"
+#include <algorithm>
 #include "ast/declaration.h"
 #include "ast/expression.h"
 #include "ast/statement.h"
@@ -57,6 +58,7 @@ std::any ASTBuilderVisitor::visitFunctionDecl(
     }
 
     auto block = std::any_cast<std::shared_ptr<stmt::Block>>(visit(ctx->block()));
+    auto attributes = parse_attributes(ctx->attribute());
 
     // Shader entry points just have the entry point type and no return value
     if (ctx->entryPointType()) {
@@ -79,14 +81,33 @@ std::any ASTBuilderVisitor::visitFunctionDecl(
                          "Invalid entry point type " + entry_pt_type_ctx->getText());
             return std::any();
         }
-        return std::make_shared<decl::EntryPoint>(
-            name, token, params, entry_pt_type, block);
+        if (ctx->typeParameters()) {
+            report_error(ctx->typeParameters()->getStart(),
+                         "Entry point '" + name + "' cannot be generic");
+        }
+        auto entry_pt =
+            std::make_shared<decl::EntryPoint>(name, token, params, entry_pt_type, block);
+        entry_pt->attributes = attributes;
+        return entry_pt;
     }
 
     // Regular functions have a return type
     auto return_type =
         std::any_cast<std::shared_ptr<ty::Type>>(visitTypeName(ctx->typeName()));
-    return std::make_shared<decl::Function>(name, token, params, block, return_type);
+    auto fn = std::make_shared<decl::Function>(name, token, params, block, return_type);
+    fn->attributes = attributes;
+    if (ctx->typeParameters()) {
+        auto &type_params = fn->type_parameters;
+        for (auto *t : ctx->typeParameters()->IDENTIFIER()) {
+            const std::string type_param = t->getText();
+            if (std::find(type_params.begin(), type_params.end(), type_param) !=
+                type_params.end()) {
+                report_error(t->getSymbol(), "Duplicate type parameter '" + type_param + "'");
+            }
+            type_params.push_back(type_param);
+        }
+    }
+    return fn;
 }
 
 std::any ASTBuilderVisitor::visitStructDecl(
@@ -110,8 +131,10 @@ std::any ASTBuilderVisitor::visitStructMember(
     const std::string name = ctx->IDENTIFIER()->getText();
     auto type = std::any_cast<std::shared_ptr<ty::Type>>(visitTypeName(ctx->typeName()));
 
-    return std::make_shared<decl::StructMember>(
-        name, ctx->IDENTIFIER()->getSymbol(), type);
+    auto member =
+        std::make_shared<decl::StructMember>(name, ctx->IDENTIFIER()->getSymbol(), type);
+    member->attributes = parse_attributes(ctx->attribute());
+    return member;
 }
 
 std::any ASTBuilderVisitor::visitParameterList(
@@ -142,33 +165,12 @@ std::any ASTBuilderVisitor::visitBlock(crtg::ChameleonRTParser::BlockContext *ct
     std::vector<std::shared_ptr<stmt::Statement>> statements;
     auto ctx_stmts = ctx->statement();
     for (auto &s : ctx_stmts) {
-        auto res = visit(s);
-        if (!res.has_value()) {
+        auto stmt = visit_statement(s);
+        if (!stmt) {
             report_warning(s->getStart(),
                            "TODO WILL: Unimplemented statement -> AST mapping");
         } else {
-            if (res.type() == typeid(std::shared_ptr<stmt::VariableDeclaration>)) {
-                // varDeclStmt can be in top level and blocks, so it returns itself as its
-                // child type, not the parent Statement class
-                auto var_decl_stmt =
-                    std::any_cast<std::shared_ptr<stmt::VariableDeclaration>>(res);
-                statements.push_back(
-                    std::dynamic_pointer_cast<stmt::Statement>(var_decl_stmt));
-            } else if (res.type() == typeid(std::shared_ptr<stmt::Block>)) {
-                // Similar case for block, where it returns as a block instead of a
-                // statement to make some other code a bit easier
-                auto block_stmt = std::any_cast<std::shared_ptr<stmt::Block>>(res);
-                statements.push_back(
-                    std::dynamic_pointer_cast<stmt::Statement>(block_stmt));
-            } else {
-                if (res.type() != typeid(std::shared_ptr<stmt::Statement>)) {
-                    report_error(s->getStart(),
-                                 "Expecting statement for block statements but got "
-                                 "non-statement!");
-                }
-                statements.push_back(
-                    std::any_cast<std::shared_ptr<stmt::Statement>>(res));
-            }
+            statements.push_back(stmt);
         }
     }
     return std::make_shared<stmt::Block>(ctx->getStart(), statements);
@@ -182,6 +184,9 @@ std::any ASTBuilderVisitor::visitVarDecl(crtg::ChameleonRTParser::VarDeclContext
     if (ctx->CONST()) {
         type->modifiers.insert(ty::Modifier::CONST);
     }
+    if (ctx->PRECISE()) {
+        type->modifiers.insert(ty::Modifier::PRECISE);
+    }
     std::shared_ptr<expr::Expression> initializer;
     if (ctx->expr()) {
         // Temporarily filter out unimplemented parts of the AST visitor
@@ -213,7 +218,28 @@ std::any ASTBuilderVisitor::visitGlobalParamDecl(
     if (ctx->CONST()) {
         type->modifiers.insert(ty::Modifier::CONST);
     }
-    return std::make_shared<decl::GlobalParam>(name, token, type);
+    auto param = std::make_shared<decl::GlobalParam>(name, token, type);
+    param->attributes = parse_attributes(ctx->attribute());
+    return param;
+}
+
+std::any ASTBuilderVisitor::visitSpecializationConstantDecl(
+    crtg::ChameleonRTParser::SpecializationConstantDeclContext *ctx)
+{
+    // Specialization constants are global const variables marked with the specialize
+    // modifier, their reads are replaced by the specialized value by the SpecializationVisitor
+    antlr4::Token *token = ctx->IDENTIFIER()->getSymbol();
+    const std::string name = ctx->IDENTIFIER()->getText();
+    auto type = std::any_cast<std::shared_ptr<ty::Type>>(visitTypeName(ctx->typeName()));
+    type->modifiers.insert(ty::Modifier::CONST);
+    type->modifiers.insert(ty::Modifier::SPECIALIZE);
+
+    std::shared_ptr<expr::Expression> default_value;
+    if (ctx->expr()) {
+        default_value = std::any_cast<std::shared_ptr<expr::Expression>>(visit(ctx->expr()));
+    }
+    auto decl = std::make_shared<decl::Variable>(name, token, type, default_value);
+    return std::make_shared<stmt::VariableDeclaration>(ctx->getStart(), decl);
 }
 
 std::any ASTBuilderVisitor::visitIfStmt(crtg::ChameleonRTParser::IfStmtContext *ctx)
@@ -221,29 +247,76 @@ std::any ASTBuilderVisitor::visitIfStmt(crtg::ChameleonRTParser::IfStmtContext *
     auto condition = std::any_cast<std::shared_ptr<expr::Expression>>(visit(ctx->expr()));
     auto branches = ctx->statement();
     // There will always at least be an if branch
-    auto if_branch = std::any_cast<std::shared_ptr<stmt::Statement>>(visit(branches[0]));
+    auto if_branch = visit_statement(branches[0]);
     std::shared_ptr<stmt::Statement> else_branch;
     if (branches.size() == 2) {
-        else_branch = std::any_cast<std::shared_ptr<stmt::Statement>>(visit(branches[1]));
+        else_branch = visit_statement(branches[1]);
     }
-    return std::dynamic_pointer_cast<stmt::Statement>(std::make_shared<stmt::IfElse>(
-        ctx->getStart(), condition, if_branch, else_branch));
+    auto if_else = std::make_shared<stmt::IfElse>(
+        ctx->IF()->getSymbol(), condition, if_branch, else_branch);
+    if_else->attributes = parse_attributes(ctx->attribute());
+    return std::dynamic_pointer_cast<stmt::Statement>(if_else);
 }
 
 std::any ASTBuilderVisitor::visitWhileStmt(crtg::ChameleonRTParser::WhileStmtContext *ctx)
 {
-    return std::any();
+    auto condition = std::any_cast<std::shared_ptr<expr::Expression>>(visit(ctx->expr()));
+    // The body is null for loops with an empty body, e.g. while (x);
+    std::shared_ptr<stmt::Statement> body;
+    if (ctx->statement()) {
+        body = visit_statement(ctx->statement());
+    }
+    auto while_stmt =
+        std::make_shared<stmt::While>(ctx->WHILE()->getSymbol(), condition, body);
+    while_stmt->attributes = parse_attributes(ctx->attribute());
+    return std::dynamic_pointer_cast<stmt::Statement>(while_stmt);
 }
 
 std::any ASTBuilderVisitor::visitForStmt(crtg::ChameleonRTParser::ForStmtContext *ctx)
 {
-    return std::any();
+    std::shared_ptr<stmt::Statement> init;
+    if (ctx->varDecl()) {
+        auto decl =
+            std::any_cast<std::shared_ptr<decl::Variable>>(visitVarDecl(ctx->varDecl()));
+        init = std::make_shared<stmt::VariableDeclaration>(ctx->varDecl()->getStart(), decl);
+    } else if (ctx->forInit()) {
+        auto expr =
+            std::any_cast<std::shared_ptr<expr::Expression>>(visit(ctx->forInit()->expr()));
+        init = std::make_shared<stmt::Expression>(ctx->forInit()->getStart(), expr);
+    }
+
+    std::shared_ptr<expr::Expression> condition;
+    if (ctx->forCond()) {
+        condition =
+            std::any_cast<std::shared_ptr<expr::Expression>>(visit(ctx->forCond()->expr()));
+    }
+
+    std::shared_ptr<expr::Expression> advance;
+    if (ctx->forAdvance()) {
+        advance = std::any_cast<std::shared_ptr<expr::Expression>>(
+            visit(ctx->forAdvance()->expr()));
+    }
+
+    std::shared_ptr<stmt::Statement> body;
+    if (ctx->statement()) {
+        body = visit_statement(ctx->statement());
+    }
+
+    auto for_stmt =
+        std::make_shared<stmt::For>(ctx->FOR()->getSymbol(), init, condition, advance, body);
+    for_stmt->attributes = parse_attributes(ctx->attribute());
+    return std::dynamic_pointer_cast<stmt::Statement>(for_stmt);
 }
 
 std::any ASTBuilderVisitor::visitReturnStmt(
     crtg::ChameleonRTParser::ReturnStmtContext *ctx)
 {
-    return std::any();
+    std::shared_ptr<expr::Expression> expr;
+    if (ctx->expr()) {
+        expr = std::any_cast<std::shared_ptr<expr::Expression>>(visit(ctx->expr()));
+    }
+    return std::dynamic_pointer_cast<stmt::Statement>(
+        std::make_shared<stmt::Return>(ctx->getStart(), expr));
 }
 
 std::any ASTBuilderVisitor::visitExprStmt(crtg::ChameleonRTParser::ExprStmtContext *ctx)
@@ -329,6 +402,29 @@ std::any ASTBuilderVisitor::visitTypeName(crtg::ChameleonRTParser::TypeNameConte
             std::make_shared<ty::Buffer>(template_parameters[0], ty::Access::READ_WRITE));
     }
 
+    if (ctx->QUANTIZED_FORMAT()) {
+        // Quantized elements are decoded when loaded, so they can't be written and can only
+        // be the element type of read only Buffers
+        using Parser = crtg::ChameleonRTParser;
+        auto template_params = dynamic_cast<Parser::TemplateParametersContext *>(ctx->parent);
+        auto template_type =
+            template_params ? dynamic_cast<Parser::TypeNameContext *>(template_params->parent)
+                            : nullptr;
+        if (!template_type || !template_type->BUFFER()) {
+            report_error(ctx->QUANTIZED_FORMAT()->getSymbol(),
+                         "Quantized format '" + ctx->getText() +
+                             "' can only be the element type of a read only Buffer");
+        }
+        const std::string format_str = ctx->getText();
+        auto format = ty::QuantizedFormat::OCT32;
+        if (format_str == "unorm16_2") {
+            format = ty::QuantizedFormat::UNORM16_2;
+        } else if (format_str == "snorm16_3") {
+            format = ty::QuantizedFormat::SNORM16_3;
+        }
+        return std::dynamic_pointer_cast<ty::Type>(std::make_shared<ty::Quantized>(format));
+    }
+
     if (ctx->ACCELERATION_STRUCTURE()) {
         return std::dynamic_pointer_cast<ty::Type>(
             std::make_shared<ty::AccelerationStructure>());
@@ -345,6 +441,39 @@ std::any ASTBuilderVisitor::visitTypeName(crtg::ChameleonRTParser::TypeNameConte
     }
 
     const std::string type_str = ctx->getText();
+
+    // The 16-bit types are a single token for each primitive type, with the vector and matrix
+    // dimensions following the primitive type name. They're handled first since int16 and
+    // uint16 also start with int and uint
+    std::shared_ptr<ty::Primitive> primitive_16bit;
+    size_t name_length = 0;
+    if (ctx->HALF()) {
+        primitive_16bit = std::make_shared<ty::Primitive>(ty::PrimitiveType::HALF);
+        name_length = 4;
+    } else if (ctx->INT16()) {
+        primitive_16bit = std::make_shared<ty::Primitive>(ty::PrimitiveType::INT16);
+        name_length = 6;
+    } else if (ctx->UINT16()) {
+        primitive_16bit = std::make_shared<ty::Primitive>(ty::PrimitiveType::UINT16);
+        name_length = 7;
+    }
+    if (primitive_16bit) {
+        // Skip the underscore separating the int types' dimensions
+        const std::string dims = name_length < type_str.size() ? type_str.substr(name_length)
+                                                               : "";
+        if (dims.empty()) {
+            return std::dynamic_pointer_cast<ty::Type>(primitive_16bit);
+        }
+        const uint32_t dimension_0 = dims[0] - '0';
+        if (dims.size() == 1) {
+            return std::dynamic_pointer_cast<ty::Type>(
+                std::make_shared<ty::Vector>(primitive_16bit, dimension_0));
+        }
+        const uint32_t dimension_1 = dims[2] - '0';
+        return std::dynamic_pointer_cast<ty::Type>(
+            std::make_shared<ty::Matrix>(primitive_16bit, dimension_0, dimension_1));
+    }
+
     if (type_str.starts_with("bool")) {
         auto primitive_type = std::make_shared<ty::Primitive>(ty::PrimitiveType::BOOL);
         if (ctx->BOOL()) {
@@ -446,6 +575,28 @@ std::any ASTBuilderVisitor::visitTemplateParameters(
     return template_params;
 }
 
+std::vector<std::shared_ptr<Attribute>> ASTBuilderVisitor::parse_attributes(
+    const std::vector<crtg::ChameleonRTParser::AttributeContext *> &attribute_list)
+{
+    std::vector<std::shared_ptr<Attribute>> attributes;
+    for (auto *a : attribute_list) {
+        std::vector<std::string> args;
+        auto arg_list = a->attributeArg();
+        for (auto *arg : arg_list) {
+            args.push_back(arg->getText());
+        }
+        const std::string name = a->attributeName()->getText();
+        antlr4::Token *token = a->attributeName()->getStart();
+        for (const auto &prev : attributes) {
+            if (prev->name == name) {
+                report_error(token, "Redundant attribute '" + name + "'");
+            }
+        }
+        attributes.push_back(std::make_shared<Attribute>(name, token, args));
+    }
+    return attributes;
+}
+
 std::set<ty::Modifier> ASTBuilderVisitor::parse_modifiers(
     antlr4::Token *token,
     const std::vector<crtg::ChameleonRTParser::ModifierContext *> &modifier_list)
@@ -479,6 +630,30 @@ std::set<ty::Modifier> ASTBuilderVisitor::parse_modifiers(
     return modifiers;
 }
 
+std::shared_ptr<stmt::Statement> ASTBuilderVisitor::visit_statement(
+    crtg::ChameleonRTParser::StatementContext *ctx)
+{
+    auto res = visit(ctx);
+    if (!res.has_value()) {
+        return nullptr;
+    }
+    // varDeclStmt can be in top level and blocks, so it returns itself as its child type, not
+    // the parent Statement class
+    if (res.type() == typeid(std::shared_ptr<stmt::VariableDeclaration>)) {
+        return std::any_cast<std::shared_ptr<stmt::VariableDeclaration>>(res);
+    }
+    // Similar case for block, where it returns as a block instead of a statement to make some
+    // other code a bit easier
+    if (res.type() == typeid(std::shared_ptr<stmt::Block>)) {
+        return std::any_cast<std::shared_ptr<stmt::Block>>(res);
+    }
+    if (res.type() != typeid(std::shared_ptr<stmt::Statement>)) {
+        report_error(ctx->getStart(), "Expecting statement but got non-statement!");
+        return nullptr;
+    }
+    return std::any_cast<std::shared_ptr<stmt::Statement>>(res);
+}
+
 std::any ASTBuilderVisitor::visitUnary(crtg::ChameleonRTParser::UnaryContext *ctx)
 {
     return visit_expr(ctx);
@@ -40,6 +40,9 @@ public:
     virtual std::any visitGlobalParamDecl(
         crtg::ChameleonRTParser::GlobalParamDeclContext *ctx) override;
 
+    virtual std::any visitSpecializationConstantDecl(
+        crtg::ChameleonRTParser::SpecializationConstantDeclContext *ctx) override;
+
     virtual std::any visitIfStmt(crtg::ChameleonRTParser::IfStmtContext *ctx) override;
 
     virtual std::any visitWhileStmt(crtg::ChameleonRTParser::WhileStmtContext *ctx) override;
@@ -55,10 +58,19 @@ public:
     virtual std::any visitTemplateParameters(
         crtg::ChameleonRTParser::TemplateParametersContext *ctx) override;
 
+    std::vector<std::shared_ptr<ast::Attribute>> parse_attributes(
+        const std::vector<crtg::ChameleonRTParser::AttributeContext *> &attribute_list);
+
     std::set<ast::ty::Modifier> parse_modifiers(
         antlr4::Token *token,
         const std::vector<crtg::ChameleonRTParser::ModifierContext *> &modifier_list);
 
+    /* Visit the statement and return it as a stmt::Statement. Returns nullptr if the
+     * statement couldn't be mapped to the AST
+     */
+    std::shared_ptr<ast::stmt::Statement> visit_statement(
+        crtg::ChameleonRTParser::StatementContext *ctx);
+
     // Expression visitors are overriden for convenience, but all forward on to the
     // ASTExprBuilderVisitor
     virtual std::any visitUnary(crtg::ChameleonRTParser::UnaryContext *ctx) override;
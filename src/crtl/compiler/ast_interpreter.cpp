@@ -0,0 +1,399 @@
+#include "ast_interpreter.h"
+#include <cmath>
+#include "ast_utils.h"
+#include "constant_folding_visitor.h"
+
+namespace crtl {
+
+using namespace ast;
+
+// The maximum depth of calls made while evaluating a function
+const size_t MAX_CALL_DEPTH = 64;
+
+ASTInterpreter::ASTInterpreter(const std::shared_ptr<ResolverPassResult> &resolver_result,
+                               const size_t step_budget)
+    : resolver_result(resolver_result), step_budget(step_budget)
+{
+}
+
+std::optional<ASTInterpreter::Value> ASTInterpreter::call(
+    const std::shared_ptr<decl::Function> &fn, const std::vector<Value> &args)
+{
+    steps = 0;
+    budget_exceeded = false;
+    frames.clear();
+    return call_function(fn, args);
+}
+
+std::optional<ASTInterpreter::Value> ASTInterpreter::call_function(
+    const std::shared_ptr<decl::Function> &fn, const std::vector<Value> &args)
+{
+    if (fn->is_builtin() || fn->is_generic() || frames.size() >= MAX_CALL_DEPTH ||
+        args.size() != fn->parameters.size()) {
+        return std::nullopt;
+    }
+    auto fn_ty = std::dynamic_pointer_cast<ty::Function>(fn->get_type());
+    const auto return_type = interpreted_type(fn_ty->return_type);
+    if (!return_type) {
+        return std::nullopt;
+    }
+
+    phmap::flat_hash_map<std::shared_ptr<decl::Variable>, Value> frame;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const auto &param = fn->parameters[i];
+        const auto param_type = interpreted_type(param->get_type());
+        if (!param_type || is_output_param(param)) {
+            return std::nullopt;
+        }
+        auto arg = convert_value(args[i], *param_type);
+        if (!arg) {
+            return std::nullopt;
+        }
+        frame[param] = *arg;
+    }
+
+    frames.push_back(std::move(frame));
+    const auto flow = execute(fn->block);
+    frames.pop_back();
+
+    // Functions which fall off the end without returning can't be evaluated
+    std::optional<Value> result;
+    if (flow && *flow == Flow::RETURN && return_value) {
+        result = convert_value(*return_value, *return_type);
+    }
+    return_value.reset();
+    return result;
+}
+
+std::optional<ASTInterpreter::Flow> ASTInterpreter::execute(
+    const std::shared_ptr<stmt::Statement> &s)
+{
+    if (!step()) {
+        return std::nullopt;
+    }
+    switch (s->get_node_type()) {
+    case NodeType::STMT_BLOCK: {
+        auto block = std::dynamic_pointer_cast<stmt::Block>(s);
+        for (const auto &st : block->statements) {
+            const auto flow = execute(st);
+            if (!flow || *flow == Flow::RETURN) {
+                return flow;
+            }
+        }
+        return Flow::NEXT;
+    }
+    case NodeType::STMT_IF_ELSE: {
+        auto if_else = std::dynamic_pointer_cast<stmt::IfElse>(s);
+        const auto condition = evaluate_condition(if_else->condition);
+        if (!condition) {
+            return std::nullopt;
+        }
+        return execute_nested(*condition ? if_else->if_branch : if_else->else_branch);
+    }
+    case NodeType::STMT_WHILE: {
+        auto loop = std::dynamic_pointer_cast<stmt::While>(s);
+        while (true) {
+            const auto condition = evaluate_condition(loop->condition);
+            if (!condition) {
+                return std::nullopt;
+            }
+            if (!*condition) {
+                return Flow::NEXT;
+            }
+            const auto flow = execute_nested(loop->body);
+            if (!flow || *flow == Flow::RETURN) {
+                return flow;
+            }
+        }
+    }
+    case NodeType::STMT_FOR: {
+        auto loop = std::dynamic_pointer_cast<stmt::For>(s);
+        if (loop->init && !execute(loop->init)) {
+            return std::nullopt;
+        }
+        while (true) {
+            if (loop->condition) {
+                const auto condition = evaluate_condition(loop->condition);
+                if (!condition) {
+                    return std::nullopt;
+                }
+                if (!*condition) {
+                    return Flow::NEXT;
+                }
+            }
+            const auto flow = execute_nested(loop->body);
+            if (!flow || *flow == Flow::RETURN) {
+                return flow;
+            }
+            if (loop->advance && !evaluate(loop->advance)) {
+                return std::nullopt;
+            }
+        }
+    }
+    case NodeType::STMT_RETURN: {
+        auto ret = std::dynamic_pointer_cast<stmt::Return>(s);
+        if (!ret->expression) {
+            return std::nullopt;
+        }
+        return_value = evaluate(ret->expression);
+        if (!return_value) {
+            return std::nullopt;
+        }
+        return Flow::RETURN;
+    }
+    case NodeType::STMT_VAR_DECL: {
+        const auto &var = std::dynamic_pointer_cast<stmt::VariableDeclaration>(s)->var_decl;
+        const auto type = interpreted_type(var->get_type());
+        if (!type) {
+            return std::nullopt;
+        }
+        Value value{*type, std::any()};
+        if (var->expression) {
+            auto init = evaluate(var->expression);
+            if (!init) {
+                return std::nullopt;
+            }
+            auto converted = convert_value(*init, *type);
+            if (!converted) {
+                return std::nullopt;
+            }
+            value = *converted;
+        }
+        frames.back()[var] = value;
+        return Flow::NEXT;
+    }
+    case NodeType::STMT_EXPR: {
+        auto expr_stmt = std::dynamic_pointer_cast<stmt::Expression>(s);
+        if (!evaluate(expr_stmt->expr)) {
+            return std::nullopt;
+        }
+        return Flow::NEXT;
+    }
+    default:
+        return std::nullopt;
+    }
+}
+
+std::optional<ASTInterpreter::Flow> ASTInterpreter::execute_nested(
+    const std::shared_ptr<stmt::Statement> &s)
+{
+    if (!s) {
+        return Flow::NEXT;
+    }
+    return execute(s);
+}
+
+std::optional<ASTInterpreter::Value> ASTInterpreter::evaluate(
+    const std::shared_ptr<expr::Expression> &e)
+{
+    if (!step()) {
+        return std::nullopt;
+    }
+    switch (e->get_node_type()) {
+    case NodeType::EXPR_LITERAL_CONSTANT: {
+        auto constant = std::dynamic_pointer_cast<expr::Constant>(e);
+        return Value{constant->constant_type, constant->value};
+    }
+    case NodeType::EXPR_LITERAL_VAR:
+        return evaluate_variable(std::dynamic_pointer_cast<expr::Variable>(e));
+    case NodeType::EXPR_NEGATE:
+    case NodeType::EXPR_LOGIC_NOT: {
+        auto operand = evaluate(std::dynamic_pointer_cast<expr::Unary>(e)->expr);
+        if (!operand) {
+            return std::nullopt;
+        }
+        const std::any result =
+            fold_scalar_operation(e->get_node_type(), operand->type, {operand->value});
+        if (!result.has_value()) {
+            return std::nullopt;
+        }
+        return Value{operand->type, result};
+    }
+    case NodeType::EXPR_FCN_CALL:
+        return evaluate_call(std::dynamic_pointer_cast<expr::FunctionCall>(e));
+    case NodeType::EXPR_ASSIGN: {
+        auto assign = std::dynamic_pointer_cast<expr::Assignment>(e);
+        if (assign->lhs->get_node_type() != NodeType::EXPR_LITERAL_VAR) {
+            return std::nullopt;
+        }
+        auto fnd = resolver_result->var_expr.find(
+            std::dynamic_pointer_cast<expr::Variable>(assign->lhs));
+        if (fnd == resolver_result->var_expr.end()) {
+            return std::nullopt;
+        }
+        // Only the function's own parameters and locals can be written
+        auto var = frames.back().find(fnd->second);
+        if (var == frames.back().end()) {
+            return std::nullopt;
+        }
+        auto value = evaluate(assign->value);
+        if (!value) {
+            return std::nullopt;
+        }
+        auto converted = convert_value(*value, var->second.type);
+        if (!converted) {
+            return std::nullopt;
+        }
+        var->second = *converted;
+        return converted;
+    }
+    default:
+        break;
+    }
+
+    auto binary = std::dynamic_pointer_cast<expr::Binary>(e);
+    if (!binary) {
+        return std::nullopt;
+    }
+    auto left = evaluate(binary->left);
+    if (!left) {
+        return std::nullopt;
+    }
+    auto right = evaluate(binary->right);
+    if (!right) {
+        return std::nullopt;
+    }
+
+    // Mixed int and float operands are computed as floats
+    const auto type = left->type == right->type ? left->type : ty::PrimitiveType::FLOAT;
+    left = convert_value(*left, type);
+    right = convert_value(*right, type);
+    if (!left || !right) {
+        return std::nullopt;
+    }
+    const std::any result =
+        fold_scalar_operation(e->get_node_type(), type, {left->value, right->value});
+    if (!result.has_value()) {
+        return std::nullopt;
+    }
+    return Value{result.type() == typeid(bool) ? ty::PrimitiveType::BOOL : type, result};
+}
+
+std::optional<bool> ASTInterpreter::evaluate_condition(
+    const std::shared_ptr<expr::Expression> &e)
+{
+    auto value = evaluate(e);
+    if (!value || value->type != ty::PrimitiveType::BOOL) {
+        return std::nullopt;
+    }
+    return std::any_cast<bool>(value->value);
+}
+
+std::optional<ASTInterpreter::Value> ASTInterpreter::evaluate_variable(
+    const std::shared_ptr<expr::Variable> &e)
+{
+    auto fnd = resolver_result->var_expr.find(e);
+    if (fnd == resolver_result->var_expr.end()) {
+        return std::nullopt;
+    }
+    const auto &var = fnd->second;
+
+    auto local = frames.back().find(var);
+    if (local != frames.back().end()) {
+        // Reads of variables which haven't been assigned have an undefined value
+        if (!local->second.value.has_value()) {
+            return std::nullopt;
+        }
+        return local->second;
+    }
+
+    // Global constants initialized with a literal can be read
+    auto constant = std::dynamic_pointer_cast<expr::Constant>(var->expression);
+    const auto type = interpreted_type(var->get_type());
+    if (!constant || !type || !var->get_type()->modifiers.contains(ty::Modifier::CONST)) {
+        return std::nullopt;
+    }
+    return convert_value(Value{constant->constant_type, constant->value}, *type);
+}
+
+std::optional<ASTInterpreter::Value> ASTInterpreter::evaluate_call(
+    const std::shared_ptr<expr::FunctionCall> &e)
+{
+    auto fnd = resolver_result->call_expr.find(e);
+    if (fnd == resolver_result->call_expr.end() || !e->struct_array_access.empty()) {
+        return std::nullopt;
+    }
+
+    std::vector<Value> args;
+    for (const auto &a : e->args) {
+        auto arg = evaluate(a);
+        if (!arg) {
+            return std::nullopt;
+        }
+        args.push_back(*arg);
+    }
+
+    if (fnd->second->is_builtin()) {
+        return evaluate_builtin(fnd->second->get_text(), args);
+    }
+    return call_function(fnd->second, args);
+}
+
+std::optional<ASTInterpreter::Value> ASTInterpreter::evaluate_builtin(
+    const std::string &name, const std::vector<Value> &args)
+{
+    std::vector<float> values;
+    for (const auto &a : args) {
+        auto converted = convert_value(a, ty::PrimitiveType::FLOAT);
+        if (!converted) {
+            return std::nullopt;
+        }
+        values.push_back(std::any_cast<float>(converted->value));
+    }
+
+    // Only the float forms of the builtins are evaluated, the builtins taking vectors are
+    // identity or reduction operations when applied to scalars
+    float result = 0.f;
+    if (name == "sqrt" && values.size() == 1) {
+        result = std::sqrt(values[0]);
+    } else if (name == "rsqrt" && values.size() == 1) {
+        result = 1.f / std::sqrt(values[0]);
+    } else if (name == "mad" && values.size() == 3) {
+        result = values[0] * values[1] + values[2];
+    } else {
+        return std::nullopt;
+    }
+    return Value{ty::PrimitiveType::FLOAT, result};
+}
+
+bool ASTInterpreter::step()
+{
+    if (steps >= step_budget) {
+        budget_exceeded = true;
+        return false;
+    }
+    ++steps;
+    return true;
+}
+
+std::optional<ty::PrimitiveType> interpreted_type(const std::shared_ptr<ty::Type> &type)
+{
+    auto primitive = std::dynamic_pointer_cast<ty::Primitive>(type);
+    if (!primitive || (primitive->type_id != ty::PrimitiveType::BOOL &&
+                       primitive->type_id != ty::PrimitiveType::INT &&
+                       primitive->type_id != ty::PrimitiveType::FLOAT)) {
+        return std::nullopt;
+    }
+    return primitive->type_id;
+}
+
+std::optional<ASTInterpreter::Value> convert_value(const ASTInterpreter::Value &v,
+                                                   const ty::PrimitiveType type)
+{
+    if (v.type == type) {
+        return v;
+    }
+    if (v.type == ty::PrimitiveType::INT && type == ty::PrimitiveType::FLOAT) {
+        return ASTInterpreter::Value{type, float(std::any_cast<int>(v.value))};
+    }
+    if (v.type == ty::PrimitiveType::FLOAT && type == ty::PrimitiveType::INT) {
+        const float f = std::any_cast<float>(v.value);
+        // Out of range conversions are undefined
+        if (!(f > -2147483648.f && f < 2147483648.f)) {
+            return std::nullopt;
+        }
+        return ASTInterpreter::Value{type, int(f)};
+    }
+    return std::nullopt;
+}
+}
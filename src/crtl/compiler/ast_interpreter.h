@@ -0,0 +1,90 @@
+#pragma once
+
+#include <optional>
+#include "ast/statement.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* The ASTInterpreter evaluates calls to user functions at compile time. Functions are
+ * evaluated if they compute a bool, int or float from bool, int or float arguments without
+ * side effects: evaluation fails if the function reads global parameters or non-constant
+ * globals, has out parameters, accesses structs, arrays, buffers or textures, or calls
+ * builtins other than the scalar math builtins. Calls made by the function are evaluated
+ * recursively under the same rules.
+ *
+ * Each evaluation is limited to a budget of steps, counting the statements and expressions
+ * executed, so that functions with long running or non-terminating loops can't hang the
+ * compiler.
+ */
+class ASTInterpreter {
+public:
+    // A bool, int or float value
+    struct Value {
+        ast::ty::PrimitiveType type;
+        // The value, empty for variables which haven't been assigned
+        std::any value;
+    };
+
+private:
+    // How execution continues after a statement
+    enum class Flow { NEXT, RETURN };
+
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+    size_t step_budget;
+
+    size_t steps = 0;
+
+    // The values of the parameters and local variables of each function being evaluated
+    std::vector<phmap::flat_hash_map<std::shared_ptr<ast::decl::Variable>, Value>> frames;
+
+    // The value returned by the innermost function being evaluated
+    std::optional<Value> return_value;
+
+public:
+    // If the last evaluation failed because it ran out of steps
+    bool budget_exceeded = false;
+
+    ASTInterpreter(const std::shared_ptr<ResolverPassResult> &resolver_result,
+                   const size_t step_budget);
+
+    /* Evaluate a call to the function with the arguments, returning the value returned or
+     * nullopt if the call can't be evaluated at compile time
+     */
+    std::optional<Value> call(const std::shared_ptr<ast::decl::Function> &fn,
+                              const std::vector<Value> &args);
+
+private:
+    std::optional<Value> call_function(const std::shared_ptr<ast::decl::Function> &fn,
+                                       const std::vector<Value> &args);
+
+    // Execute the statement, returning nullopt if it can't be evaluated
+    std::optional<Flow> execute(const std::shared_ptr<ast::stmt::Statement> &s);
+
+    // Execute a nested statement, which may be null for empty loop bodies or branches
+    std::optional<Flow> execute_nested(const std::shared_ptr<ast::stmt::Statement> &s);
+
+    std::optional<Value> evaluate(const std::shared_ptr<ast::expr::Expression> &e);
+
+    std::optional<bool> evaluate_condition(const std::shared_ptr<ast::expr::Expression> &e);
+
+    std::optional<Value> evaluate_variable(const std::shared_ptr<ast::expr::Variable> &e);
+
+    std::optional<Value> evaluate_call(const std::shared_ptr<ast::expr::FunctionCall> &e);
+
+    std::optional<Value> evaluate_builtin(const std::string &name,
+                                          const std::vector<Value> &args);
+
+    // Take a step of the evaluation, returns false if the step budget is used up
+    bool step();
+};
+
+// Get the type of the value of the interpreted type, or nullopt if it's not interpreted
+std::optional<ast::ty::PrimitiveType> interpreted_type(
+    const std::shared_ptr<ast::ty::Type> &type);
+
+// Convert the value to the type, following HLSL's implicit conversions between int and float
+std::optional<ASTInterpreter::Value> convert_value(const ASTInterpreter::Value &v,
+                                                   const ast::ty::PrimitiveType type);
+}
@@ -0,0 +1,380 @@
+#include "ast_utils.h"
+#include <algorithm>
+
+namespace crtl {
+
+using namespace ast;
+
+size_t count_nodes(const std::shared_ptr<Node> &n)
+{
+    size_t count = 1;
+    for (const auto &c : n->get_children()) {
+        count += count_nodes(c);
+    }
+    return count;
+}
+
+size_t count_returns(const std::shared_ptr<Node> &n)
+{
+    size_t count = n->get_node_type() == NodeType::STMT_RETURN ? 1 : 0;
+    for (const auto &c : n->get_children()) {
+        count += count_returns(c);
+    }
+    return count;
+}
+
+void collect_calls(const std::shared_ptr<Node> &n,
+                   std::vector<std::shared_ptr<expr::FunctionCall>> &calls)
+{
+    if (n->get_node_type() == NodeType::EXPR_FCN_CALL) {
+        calls.push_back(std::dynamic_pointer_cast<expr::FunctionCall>(n));
+    }
+    for (const auto &c : n->get_children()) {
+        collect_calls(c, calls);
+    }
+}
+
+bool is_void_type(const std::shared_ptr<ty::Type> &type)
+{
+    auto prim = std::dynamic_pointer_cast<ty::Primitive>(type);
+    return prim && prim->type_id == ty::PrimitiveType::VOID;
+}
+
+bool is_rw_resource(const std::shared_ptr<ty::Type> &type)
+{
+    if (type->base_type == ty::BaseType::BUFFER) {
+        return std::dynamic_pointer_cast<ty::Buffer>(type)->access == ty::Access::READ_WRITE;
+    }
+    if (type->base_type == ty::BaseType::TEXTURE) {
+        return std::dynamic_pointer_cast<ty::Texture>(type)->access == ty::Access::READ_WRITE;
+    }
+    return false;
+}
+
+bool has_array_access(
+    const std::vector<std::shared_ptr<expr::StructArrayAccessFragment>> &fragments)
+{
+    return std::any_of(fragments.begin(), fragments.end(), [](const auto &f) {
+        return std::dynamic_pointer_cast<expr::ArrayAccessFragment>(f) != nullptr;
+    });
+}
+
+bool is_constant_expression(const std::shared_ptr<Node> &n)
+{
+    if (n->get_node_type() == NodeType::EXPR_LITERAL_VAR ||
+        n->get_node_type() == NodeType::EXPR_FCN_CALL) {
+        return false;
+    }
+    for (const auto &c : n->get_children()) {
+        if (!is_constant_expression(c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool is_specialization_constant(const std::shared_ptr<decl::Variable> &var)
+{
+    return var->get_type()->modifiers.contains(ty::Modifier::SPECIALIZE);
+}
+
+std::shared_ptr<expr::Constant> make_constant(antlr4::Token *token,
+                                              const ty::PrimitiveType type,
+                                              const std::any &value)
+{
+    switch (type) {
+    case ty::PrimitiveType::BOOL:
+        return std::make_shared<expr::Constant>(token, std::any_cast<bool>(value));
+    case ty::PrimitiveType::INT:
+        return std::make_shared<expr::Constant>(token, std::any_cast<int>(value));
+    case ty::PrimitiveType::FLOAT:
+        return std::make_shared<expr::Constant>(token, std::any_cast<float>(value));
+    default:
+        return nullptr;
+    }
+}
+
+bool is_output_param(const std::shared_ptr<decl::Variable> &param)
+{
+    const auto &modifiers = param->get_type()->modifiers;
+    return modifiers.contains(ty::Modifier::OUT) || modifiers.contains(ty::Modifier::IN_OUT);
+}
+
+std::shared_ptr<decl::Variable> payload_parameter(
+    const std::shared_ptr<decl::EntryPoint> &entry_point)
+{
+    auto type = std::dynamic_pointer_cast<ty::EntryPoint>(entry_point->get_type());
+    if ((type->entry_point_type != ty::EntryPointType::CLOSEST_HIT &&
+         type->entry_point_type != ty::EntryPointType::ANY_HIT &&
+         type->entry_point_type != ty::EntryPointType::MISS) ||
+        entry_point->parameters.empty()) {
+        return nullptr;
+    }
+    return entry_point->parameters[0];
+}
+
+std::shared_ptr<decl::Variable> hit_attribute_parameter(
+    const std::shared_ptr<decl::EntryPoint> &entry_point)
+{
+    auto type = std::dynamic_pointer_cast<ty::EntryPoint>(entry_point->get_type());
+    if ((type->entry_point_type != ty::EntryPointType::CLOSEST_HIT &&
+         type->entry_point_type != ty::EntryPointType::ANY_HIT) ||
+        entry_point->parameters.size() < 2) {
+        return nullptr;
+    }
+    return entry_point->parameters[1];
+}
+
+bool is_shader_record_parameter(const std::shared_ptr<decl::EntryPoint> &entry_point,
+                                const std::shared_ptr<decl::Variable> &param)
+{
+    return param != payload_parameter(entry_point) &&
+           param != hit_attribute_parameter(entry_point);
+}
+
+std::shared_ptr<decl::Variable> accessed_variable(const std::shared_ptr<expr::Expression> &e,
+                                                  const ResolverPassResult &resolved)
+{
+    std::shared_ptr<expr::Variable> var;
+    if (e->get_node_type() == NodeType::EXPR_LITERAL_VAR) {
+        var = std::dynamic_pointer_cast<expr::Variable>(e);
+    } else if (e->get_node_type() == NodeType::EXPR_STRUCT_ARRAY_ACCESS) {
+        var = std::dynamic_pointer_cast<expr::StructArrayAccess>(e)->variable;
+    }
+    if (!var) {
+        return nullptr;
+    }
+    auto fnd = resolved.var_expr.find(var);
+    return fnd != resolved.var_expr.end() ? fnd->second : nullptr;
+}
+
+bool is_variable_written(const std::shared_ptr<Node> &n,
+                         const std::shared_ptr<decl::Variable> &var,
+                         const ResolverPassResult &resolved)
+{
+    if (n->get_node_type() == NodeType::EXPR_ASSIGN) {
+        auto assign = std::dynamic_pointer_cast<expr::Assignment>(n);
+        if (accessed_variable(assign->lhs, resolved) == var) {
+            return true;
+        }
+    } else if (n->get_node_type() == NodeType::EXPR_FCN_CALL) {
+        auto call = std::dynamic_pointer_cast<expr::FunctionCall>(n);
+        auto fnd = resolved.call_expr.find(call);
+        if (fnd != resolved.call_expr.end()) {
+            const auto &params = fnd->second->parameters;
+            for (size_t i = 0; i < call->args.size() && i < params.size(); ++i) {
+                if (is_output_param(params[i]) &&
+                    accessed_variable(call->args[i], resolved) == var) {
+                    return true;
+                }
+            }
+        }
+    }
+    for (const auto &c : n->get_children()) {
+        if (is_variable_written(c, var, resolved)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool contains_node(const std::shared_ptr<Node> &n, const std::shared_ptr<Node> &target)
+{
+    if (n == target) {
+        return true;
+    }
+    for (const auto &c : n->get_children()) {
+        if (contains_node(c, target)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool replace_expression(const std::shared_ptr<Node> &n,
+                        const std::shared_ptr<expr::Expression> &target,
+                        const std::shared_ptr<expr::Expression> &replacement)
+{
+    auto replace_in = [&](std::shared_ptr<expr::Expression> &e) {
+        if (!e) {
+            return false;
+        }
+        if (e == target) {
+            e = replacement;
+            return true;
+        }
+        return replace_expression(e, target, replacement);
+    };
+    auto replace_in_fragments =
+        [&](std::vector<std::shared_ptr<expr::StructArrayAccessFragment>> &fragments) {
+            for (auto &f : fragments) {
+                auto array_access = std::dynamic_pointer_cast<expr::ArrayAccessFragment>(f);
+                if (array_access && replace_in(array_access->index)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+    switch (n->get_node_type()) {
+    case NodeType::DECL_VAR:
+        return replace_in(std::dynamic_pointer_cast<decl::Variable>(n)->expression);
+    case NodeType::STMT_IF_ELSE: {
+        auto s = std::dynamic_pointer_cast<stmt::IfElse>(n);
+        return replace_in(s->condition) ||
+               replace_expression(s->if_branch, target, replacement) ||
+               (s->else_branch && replace_expression(s->else_branch, target, replacement));
+    }
+    case NodeType::STMT_WHILE: {
+        auto s = std::dynamic_pointer_cast<stmt::While>(n);
+        return replace_in(s->condition) ||
+               (s->body && replace_expression(s->body, target, replacement));
+    }
+    case NodeType::STMT_FOR: {
+        auto s = std::dynamic_pointer_cast<stmt::For>(n);
+        return (s->init && replace_expression(s->init, target, replacement)) ||
+               replace_in(s->condition) || replace_in(s->advance) ||
+               (s->body && replace_expression(s->body, target, replacement));
+    }
+    case NodeType::STMT_RETURN:
+        return replace_in(std::dynamic_pointer_cast<stmt::Return>(n)->expression);
+    case NodeType::STMT_EXPR:
+        return replace_in(std::dynamic_pointer_cast<stmt::Expression>(n)->expr);
+    case NodeType::EXPR_NEGATE:
+    case NodeType::EXPR_LOGIC_NOT:
+        return replace_in(std::dynamic_pointer_cast<expr::Unary>(n)->expr);
+    case NodeType::EXPR_MULT:
+    case NodeType::EXPR_DIV:
+    case NodeType::EXPR_ADD:
+    case NodeType::EXPR_SUB:
+    case NodeType::EXPR_SHIFT_LEFT:
+    case NodeType::EXPR_SHIFT_RIGHT:
+    case NodeType::EXPR_CMP_LESS:
+    case NodeType::EXPR_CMP_LESS_EQUAL:
+    case NodeType::EXPR_CMP_GREATER:
+    case NodeType::EXPR_CMP_GREATER_EQUAL:
+    case NodeType::EXPR_CMP_NOT_EQUAL:
+    case NodeType::EXPR_CMP_EQUAL:
+    case NodeType::EXPR_LOGIC_AND:
+    case NodeType::EXPR_LOGIC_OR: {
+        auto e = std::dynamic_pointer_cast<expr::Binary>(n);
+        return replace_in(e->left) || replace_in(e->right);
+    }
+    case NodeType::EXPR_FCN_CALL: {
+        auto e = std::dynamic_pointer_cast<expr::FunctionCall>(n);
+        for (auto &a : e->args) {
+            if (replace_in(a)) {
+                return true;
+            }
+        }
+        return replace_in_fragments(e->struct_array_access);
+    }
+    case NodeType::EXPR_STRUCT_ARRAY_ACCESS:
+        return replace_in_fragments(
+            std::dynamic_pointer_cast<expr::StructArrayAccess>(n)->struct_array_access);
+    case NodeType::EXPR_ASSIGN: {
+        auto e = std::dynamic_pointer_cast<expr::Assignment>(n);
+        return replace_in(e->lhs) || replace_in(e->value);
+    }
+    default:
+        // Blocks and variable declaration statements don't hold expressions directly
+        for (const auto &c : n->get_children()) {
+            if (replace_expression(c, target, replacement)) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+NodeType swap_comparison(const NodeType nt)
+{
+    switch (nt) {
+    case NodeType::EXPR_CMP_LESS:
+        return NodeType::EXPR_CMP_GREATER;
+    case NodeType::EXPR_CMP_LESS_EQUAL:
+        return NodeType::EXPR_CMP_GREATER_EQUAL;
+    case NodeType::EXPR_CMP_GREATER:
+        return NodeType::EXPR_CMP_LESS;
+    case NodeType::EXPR_CMP_GREATER_EQUAL:
+        return NodeType::EXPR_CMP_LESS_EQUAL;
+    default:
+        return nt;
+    }
+}
+
+bool compare_constants(const NodeType nt, const int64_t a, const int64_t b)
+{
+    switch (nt) {
+    case NodeType::EXPR_CMP_LESS:
+        return a < b;
+    case NodeType::EXPR_CMP_LESS_EQUAL:
+        return a <= b;
+    case NodeType::EXPR_CMP_GREATER:
+        return a > b;
+    case NodeType::EXPR_CMP_GREATER_EQUAL:
+        return a >= b;
+    case NodeType::EXPR_CMP_NOT_EQUAL:
+        return a != b;
+    case NodeType::EXPR_CMP_EQUAL:
+        return a == b;
+    default:
+        return false;
+    }
+}
+
+std::optional<int64_t> eval_int_constant(const std::shared_ptr<expr::Expression> &e,
+                                         const ResolverPassResult &resolved)
+{
+    switch (e->get_node_type()) {
+    case NodeType::EXPR_LITERAL_CONSTANT: {
+        auto constant = std::dynamic_pointer_cast<expr::Constant>(e);
+        if (constant->constant_type != ty::PrimitiveType::INT) {
+            return std::nullopt;
+        }
+        return std::any_cast<int>(constant->value);
+    }
+    case NodeType::EXPR_LITERAL_VAR: {
+        auto var = accessed_variable(e, resolved);
+        if (!var || !var->get_type()->is_const() || !var->expression) {
+            return std::nullopt;
+        }
+        return eval_int_constant(var->expression, resolved);
+    }
+    case NodeType::EXPR_NEGATE: {
+        auto unary = std::dynamic_pointer_cast<expr::Unary>(e);
+        auto value = eval_int_constant(unary->expr, resolved);
+        if (!value) {
+            return std::nullopt;
+        }
+        return -*value;
+    }
+    case NodeType::EXPR_MULT:
+    case NodeType::EXPR_DIV:
+    case NodeType::EXPR_ADD:
+    case NodeType::EXPR_SUB: {
+        auto binary = std::dynamic_pointer_cast<expr::Binary>(e);
+        auto left = eval_int_constant(binary->left, resolved);
+        auto right = eval_int_constant(binary->right, resolved);
+        if (!left || !right) {
+            return std::nullopt;
+        }
+        switch (e->get_node_type()) {
+        case NodeType::EXPR_MULT:
+            return *left * *right;
+        case NodeType::EXPR_DIV:
+            if (*right == 0) {
+                return std::nullopt;
+            }
+            return *left / *right;
+        case NodeType::EXPR_ADD:
+            return *left + *right;
+        default:
+            return *left - *right;
+        }
+    }
+    default:
+        return std::nullopt;
+    }
+}
+}
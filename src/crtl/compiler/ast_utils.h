@@ -0,0 +1,101 @@
+#pragma once
+
+#include <optional>
+#include "ast/declaration.h"
+#include "ast/statement.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* Utilities for querying the AST shared by the optimization passes
+ */
+
+/* The prefix of the names of variables introduced by the optimization passes. Shader code
+ * can't declare names starting with the prefix, so they don't collide with the shader's names
+ */
+const std::string COMPILER_NAME_PREFIX = "_crtl_";
+
+// Count the number of nodes in the subtree
+size_t count_nodes(const std::shared_ptr<ast::Node> &n);
+
+// Count the number of return statements in the subtree
+size_t count_returns(const std::shared_ptr<ast::Node> &n);
+
+// Collect all function call expressions in the subtree
+void collect_calls(const std::shared_ptr<ast::Node> &n,
+                   std::vector<std::shared_ptr<ast::expr::FunctionCall>> &calls);
+
+bool is_void_type(const std::shared_ptr<ast::ty::Type> &type);
+
+// Check if the type is a read-write buffer or texture
+bool is_rw_resource(const std::shared_ptr<ast::ty::Type> &type);
+
+// Check if the struct/array access fragments access an array element
+bool has_array_access(
+    const std::vector<std::shared_ptr<ast::expr::StructArrayAccessFragment>> &fragments);
+
+// Check if the expression doesn't read any variables or call any functions, these are left
+// for the backend compiler to fold
+bool is_constant_expression(const std::shared_ptr<ast::Node> &n);
+
+// Check if the variable is a specialization constant
+bool is_specialization_constant(const std::shared_ptr<ast::decl::Variable> &var);
+
+// Make a constant node holding the value of the scalar type, or nullptr if constants of the
+// type aren't supported
+std::shared_ptr<ast::expr::Constant> make_constant(antlr4::Token *token,
+                                                   const ast::ty::PrimitiveType type,
+                                                   const std::any &value);
+
+// Check if the parameter is an out or inout parameter
+bool is_output_param(const std::shared_ptr<ast::decl::Variable> &param);
+
+/* Get the ray payload parameter of the entry point, or nullptr if it doesn't receive one.
+ * The payload is the first parameter of closest hit, any hit and miss entry points
+ */
+std::shared_ptr<ast::decl::Variable> payload_parameter(
+    const std::shared_ptr<ast::decl::EntryPoint> &entry_point);
+
+/* Get the hit attributes parameter of the entry point, or nullptr if it doesn't receive
+ * them. The hit attributes are the second parameter of closest hit and any hit entry points
+ */
+std::shared_ptr<ast::decl::Variable> hit_attribute_parameter(
+    const std::shared_ptr<ast::decl::EntryPoint> &entry_point);
+
+// Check if the entry point parameter is passed through the shader record, i.e., it isn't the
+// entry point's ray payload or hit attributes
+bool is_shader_record_parameter(const std::shared_ptr<ast::decl::EntryPoint> &entry_point,
+                                const std::shared_ptr<ast::decl::Variable> &param);
+
+// Get the declaration of the variable being accessed by a variable or struct/array access
+// expression, or nullptr for other expressions
+std::shared_ptr<ast::decl::Variable> accessed_variable(
+    const std::shared_ptr<ast::expr::Expression> &e, const ResolverPassResult &resolved);
+
+// Check if the variable is assigned to or passed as an out/inout argument within the subtree
+bool is_variable_written(const std::shared_ptr<ast::Node> &n,
+                         const std::shared_ptr<ast::decl::Variable> &var,
+                         const ResolverPassResult &resolved);
+
+// Check if the node is within the subtree
+bool contains_node(const std::shared_ptr<ast::Node> &n,
+                   const std::shared_ptr<ast::Node> &target);
+
+// Swap the sides of the comparison, e.g. for 10 > i to become i < 10
+ast::NodeType swap_comparison(const ast::NodeType nt);
+
+// Evaluate the comparison on the constant values
+bool compare_constants(const ast::NodeType nt, const int64_t a, const int64_t b);
+
+// Evaluate the integer constant expression, made up of constants and const variables with
+// constant initializers
+std::optional<int64_t> eval_int_constant(const std::shared_ptr<ast::expr::Expression> &e,
+                                         const ResolverPassResult &resolved);
+
+/* Replace the target expression within the subtree with the replacement expression. Returns
+ * true if the target was found and replaced
+ */
+bool replace_expression(const std::shared_ptr<ast::Node> &n,
+                        const std::shared_ptr<ast::expr::Expression> &target,
+                        const std::shared_ptr<ast::expr::Expression> &replacement);
+}
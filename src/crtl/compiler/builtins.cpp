@@ -1,4 +1,6 @@
 #include "builtins.h"
+#include <tuple>
+#include "expression_type.h"
 
 namespace crtl {
 std::vector<std::shared_ptr<ast::decl::Declaration>> get_builtin_decls()
@@ -15,6 +17,176 @@ std::vector<std::shared_ptr<ast::decl::Declaration>> get_builtin_decls()
         builtins.push_back(std::dynamic_pointer_cast<decl::Declaration>(decl));
     }
 
+    // atomic_add(inout uint dest, uint value), adds the value to a buffer element atomically
+    {
+        auto dest_type = std::make_shared<ty::Primitive>(ty::PrimitiveType::UINT);
+        dest_type->modifiers.insert(ty::Modifier::IN_OUT);
+        std::vector<std::shared_ptr<decl::Variable>> params = {
+            std::make_shared<decl::Variable>("dest", nullptr, dest_type),
+            std::make_shared<decl::Variable>(
+                "value", nullptr, std::make_shared<ty::Primitive>(ty::PrimitiveType::UINT))};
+        auto decl = std::make_shared<decl::Function>(
+            "atomic_add", params, std::make_shared<ty::Primitive>(ty::PrimitiveType::VOID));
+        builtins.push_back(std::dynamic_pointer_cast<decl::Declaration>(decl));
+    }
+
+    /* trace_ray(AccelerationStructure scene, Ray ray, inout payload, uint flags, uint mask,
+     *           uint hit_group_offset, uint hit_group_stride, uint miss_index)
+     * The payload can be any struct type, the payload arguments are checked by the
+     * RayPayloadAnalysis
+     */
+    {
+        auto uint_type = std::make_shared<ty::Primitive>(ty::PrimitiveType::UINT);
+        auto payload_type = std::make_shared<ty::Struct>("payload");
+        payload_type->modifiers.insert(ty::Modifier::IN_OUT);
+        std::vector<std::shared_ptr<decl::Variable>> params = {
+            std::make_shared<decl::Variable>(
+                "scene", nullptr, std::make_shared<ty::AccelerationStructure>()),
+            std::make_shared<decl::Variable>("ray", nullptr, std::make_shared<ty::Ray>()),
+            std::make_shared<decl::Variable>("payload", nullptr, payload_type)};
+        for (const auto &p :
+             {"flags", "mask", "hit_group_offset", "hit_group_stride", "miss_index"}) {
+            params.push_back(std::make_shared<decl::Variable>(p, nullptr, uint_type));
+        }
+        auto decl = std::make_shared<decl::Function>(
+            "trace_ray", params, std::make_shared<ty::Primitive>(ty::PrimitiveType::VOID));
+        builtins.push_back(std::dynamic_pointer_cast<decl::Declaration>(decl));
+    }
+
+    /* Bit packing builtins, used to pack structs into 32-bit words:
+     * - insert_bits(uint word, uint value, uint offset, uint count) replaces count bits of
+     *   word starting at offset with the low bits of value, count must be less than 32
+     * - extract_bits(uint word, uint offset, uint count) returns count bits of the word
+     * - asuint, asint and asfloat reinterpret the bits of a 32-bit scalar
+     * - f32tof16 and f16tof32 convert between a float and half stored in the low 16 bits
+     * - pack_unorm(float x, uint bits) and unpack_unorm(uint x, uint bits) quantize values
+     *   in [0, 1] to the number of bits
+     * - pack_octahedral(float3 n) and unpack_octahedral(uint x) encode a unit vector in 32
+     *   bits, as 16 bit coordinates on the octahedron
+     */
+    {
+        auto uint_type = std::make_shared<ty::Primitive>(ty::PrimitiveType::UINT);
+        auto int_type = std::make_shared<ty::Primitive>(ty::PrimitiveType::INT);
+        auto float_type = std::make_shared<ty::Primitive>(ty::PrimitiveType::FLOAT);
+        auto float3_type = std::make_shared<ty::Vector>(
+            std::make_shared<ty::Primitive>(ty::PrimitiveType::FLOAT), 3);
+        using Param = std::pair<std::string, std::shared_ptr<ty::Type>>;
+        using Builtin =
+            std::tuple<std::string, std::vector<Param>, std::shared_ptr<ty::Type>>;
+        const std::vector<Builtin> packing_builtins = {
+            {"insert_bits",
+             {{"word", uint_type},
+              {"value", uint_type},
+              {"offset", uint_type},
+              {"count", uint_type}},
+             uint_type},
+            {"extract_bits",
+             {{"word", uint_type}, {"offset", uint_type}, {"count", uint_type}},
+             uint_type},
+            {"asuint", {{"x", float_type}}, uint_type},
+            {"asint", {{"x", uint_type}}, int_type},
+            {"asfloat", {{"x", uint_type}}, float_type},
+            {"f32tof16", {{"x", float_type}}, uint_type},
+            {"f16tof32", {{"x", uint_type}}, float_type},
+            {"pack_unorm", {{"x", float_type}, {"bits", uint_type}}, uint_type},
+            {"unpack_unorm", {{"x", uint_type}, {"bits", uint_type}}, float_type},
+            {"pack_octahedral", {{"n", float3_type}}, uint_type},
+            {"unpack_octahedral", {{"x", uint_type}}, float3_type}};
+        for (const auto &b : packing_builtins) {
+            std::vector<std::shared_ptr<decl::Variable>> params;
+            for (const auto &p : std::get<1>(b)) {
+                params.push_back(std::make_shared<decl::Variable>(p.first, nullptr, p.second));
+            }
+            auto decl =
+                std::make_shared<decl::Function>(std::get<0>(b), params, std::get<2>(b));
+            builtins.push_back(std::dynamic_pointer_cast<decl::Declaration>(decl));
+        }
+    }
+
+    // Math builtins, see generic_builtin_return_type
+    const std::vector<std::pair<std::string, std::vector<std::string>>> math_builtins = {
+        {"sqrt", {"x"}},
+        {"rsqrt", {"x"}},
+        {"dot", {"a", "b"}},
+        {"length", {"v"}},
+        {"normalize", {"v"}},
+        {"mad", {"a", "b", "c"}}};
+    for (const auto &b : math_builtins) {
+        std::vector<std::shared_ptr<decl::Variable>> params;
+        for (const auto &p : b.second) {
+            params.push_back(std::make_shared<decl::Variable>(
+                p, nullptr, std::make_shared<ty::Primitive>(ty::PrimitiveType::FLOAT)));
+        }
+        auto decl = std::make_shared<decl::Function>(
+            b.first, params, std::make_shared<ty::Primitive>(ty::PrimitiveType::FLOAT));
+        builtins.push_back(std::dynamic_pointer_cast<decl::Declaration>(decl));
+    }
+
+    /* Wave builtins, operating across the active lanes of the wave:
+     * - wave_active_count_bits(bool b) returns the number of active lanes where b is true
+     * - wave_active_ballot(bool b) returns a 128 bit mask of the active lanes where b is true
+     * - wave_prefix_sum(x) returns the sum of x over the active lanes below the current lane
+     * - wave_active_sum, wave_active_min and wave_active_max(x) reduce x over the active lanes
+     * - wave_read_lane_first(x) returns x from the first active lane
+     * - wave_read_lane_at(x, uint lane) returns x from the lane, which must be active
+     * - wave_lane_index() and wave_lane_count() return the lane's index and the wave size
+     * The reductions and broadcasts are generic, see generic_builtin_return_type
+     */
+    {
+        auto uint_type = std::make_shared<ty::Primitive>(ty::PrimitiveType::UINT);
+        auto bool_type = std::make_shared<ty::Primitive>(ty::PrimitiveType::BOOL);
+        auto float_type = std::make_shared<ty::Primitive>(ty::PrimitiveType::FLOAT);
+        auto uint4_type = std::make_shared<ty::Vector>(
+            std::make_shared<ty::Primitive>(ty::PrimitiveType::UINT), 4);
+        using Param = std::pair<std::string, std::shared_ptr<ty::Type>>;
+        using Builtin =
+            std::tuple<std::string, std::vector<Param>, std::shared_ptr<ty::Type>>;
+        const std::vector<Builtin> wave_builtins = {
+            {"wave_active_count_bits", {{"b", bool_type}}, uint_type},
+            {"wave_active_ballot", {{"b", bool_type}}, uint4_type},
+            {"wave_prefix_sum", {{"x", float_type}}, float_type},
+            {"wave_active_sum", {{"x", float_type}}, float_type},
+            {"wave_active_min", {{"x", float_type}}, float_type},
+            {"wave_active_max", {{"x", float_type}}, float_type},
+            {"wave_read_lane_first", {{"x", float_type}}, float_type},
+            {"wave_read_lane_at", {{"x", float_type}, {"lane", uint_type}}, float_type},
+            {"wave_lane_index", {}, uint_type},
+            {"wave_lane_count", {}, uint_type}};
+        for (const auto &b : wave_builtins) {
+            std::vector<std::shared_ptr<decl::Variable>> params;
+            for (const auto &p : std::get<1>(b)) {
+                params.push_back(std::make_shared<decl::Variable>(p.first, nullptr, p.second));
+            }
+            auto decl =
+                std::make_shared<decl::Function>(std::get<0>(b), params, std::get<2>(b));
+            builtins.push_back(std::dynamic_pointer_cast<decl::Declaration>(decl));
+        }
+    }
+
     return builtins;
 }
+
+bool is_generic_builtin(const std::string &name)
+{
+    return name == "sqrt" || name == "rsqrt" || name == "dot" || name == "length" ||
+           name == "normalize" || name == "mad" || name == "wave_prefix_sum" ||
+           name == "wave_active_sum" || name == "wave_active_min" ||
+           name == "wave_active_max" || name == "wave_read_lane_first" ||
+           name == "wave_read_lane_at";
+}
+
+bool is_wave_builtin(const std::string &name)
+{
+    return name.starts_with("wave_");
+}
+
+std::shared_ptr<ast::ty::Type> generic_builtin_return_type(
+    const std::string &name, const std::shared_ptr<ast::ty::Type> &arg_type)
+{
+    // dot and length reduce vectors to a scalar
+    if (name == "dot" || name == "length") {
+        return element_type(arg_type);
+    }
+    return arg_type;
+}
 }
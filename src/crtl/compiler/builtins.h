@@ -6,4 +6,21 @@
 
 namespace crtl {
 std::vector<std::shared_ptr<ast::decl::Declaration>> get_builtin_decls();
+
+/* The math builtins (sqrt, rsqrt, dot, length, normalize and mad) are generic over float
+ * scalars and vectors, and the wave reductions and broadcasts over scalars and vectors of
+ * any numeric type. They're declared with float parameters and return types, the type
+ * returned by a call is determined by the type of its first argument
+ */
+bool is_generic_builtin(const std::string &name);
+
+/* The wave builtins (wave_*) communicate between the lanes of the wave executing the call,
+ * their results depend on which lanes are active at the call. They must not be moved across
+ * or out of control flow, or merged with another call computing the same expression
+ */
+bool is_wave_builtin(const std::string &name);
+
+// Get the type returned by a call to the generic builtin given the type of its first argument
+std::shared_ptr<ast::ty::Type> generic_builtin_return_type(
+    const std::string &name, const std::shared_ptr<ast::ty::Type> &arg_type);
 }
@@ -0,0 +1,75 @@
+#include "call_graph_analysis.h"
+#include "ast_utils.h"
+#include "resolution_analysis.h"
+
+namespace crtl {
+
+using namespace ast;
+
+std::string CallGraphAnalysis::name() const
+{
+    return "call_graph";
+}
+
+std::set<ASTChange> CallGraphAnalysis::invalidated_by() const
+{
+    return {ASTChange::FUNCTIONS, ASTChange::CALLS};
+}
+
+void CallGraphAnalysis::run(PassManager &pm)
+{
+    auto resolved = pm.get_analysis<ResolutionAnalysis>()->resolved;
+    for (const auto &n : pm.ast->top_level_decls) {
+        auto fn = std::dynamic_pointer_cast<decl::Function>(n);
+        if (fn && !fn->is_builtin()) {
+            num_call_sites[fn] = 0;
+        }
+    }
+
+    for (const auto &n : pm.ast->top_level_decls) {
+        std::vector<std::shared_ptr<expr::FunctionCall>> calls;
+        collect_calls(n, calls);
+
+        auto caller = std::dynamic_pointer_cast<decl::Declaration>(n);
+        const bool has_body = n->get_node_type() == NodeType::DECL_FCN ||
+                              n->get_node_type() == NodeType::DECL_ENTRY_POINT;
+        for (const auto &c : calls) {
+            auto fnd = resolved->call_expr.find(c);
+            if (fnd == resolved->call_expr.end() || fnd->second->is_builtin()) {
+                continue;
+            }
+            num_call_sites[fnd->second]++;
+            if (has_body) {
+                callees[caller].push_back(fnd->second);
+            }
+        }
+    }
+}
+
+phmap::flat_hash_set<std::shared_ptr<ast::decl::Function>>
+CallGraphAnalysis::reachable_functions(const std::shared_ptr<ast::decl::Declaration> &d) const
+{
+    phmap::flat_hash_set<std::shared_ptr<decl::Function>> reachable;
+    std::vector<std::shared_ptr<decl::Declaration>> stack = {d};
+    while (!stack.empty()) {
+        auto caller = stack.back();
+        stack.pop_back();
+        auto fnd = callees.find(caller);
+        if (fnd == callees.end()) {
+            continue;
+        }
+        for (const auto &f : fnd->second) {
+            if (!reachable.contains(f)) {
+                reachable.insert(f);
+                stack.push_back(f);
+            }
+        }
+    }
+    return reachable;
+}
+
+bool CallGraphAnalysis::is_recursive(const std::shared_ptr<ast::decl::Function> &fn) const
+{
+    return reachable_functions(fn).contains(fn);
+}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "pass_manager.h"
+
+namespace crtl {
+
+// The CallGraphAnalysis finds the user functions called by each function and entry point
+class CallGraphAnalysis : public Analysis {
+public:
+    // The user functions called by each user function and entry point, with an entry for
+    // each call site
+    phmap::flat_hash_map<std::shared_ptr<ast::decl::Declaration>,
+                         std::vector<std::shared_ptr<ast::decl::Function>>>
+        callees;
+
+    // The number of call sites of each user function in the program, including calls in
+    // global initializers
+    phmap::flat_hash_map<std::shared_ptr<ast::decl::Function>, size_t> num_call_sites;
+
+    std::string name() const override;
+
+    std::set<ASTChange> invalidated_by() const override;
+
+    void run(PassManager &pm) override;
+
+    // Get the user functions reachable through calls from the function or entry point
+    phmap::flat_hash_set<std::shared_ptr<ast::decl::Function>> reachable_functions(
+        const std::shared_ptr<ast::decl::Declaration> &d) const;
+
+    // Check if the function can reach itself through the call graph
+    bool is_recursive(const std::shared_ptr<ast::decl::Function> &fn) const;
+};
+}
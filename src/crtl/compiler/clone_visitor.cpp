@@ -0,0 +1,194 @@
+#include "clone_visitor.h"
+
+namespace crtl {
+
+using namespace ast;
+
+CloneVisitor::CloneVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result,
+                           const std::string &rename_prefix)
+    : resolver_result(resolver_result), rename_prefix(rename_prefix)
+{
+}
+
+std::any CloneVisitor::visit_decl_variable(const std::shared_ptr<ast::decl::Variable> &d)
+{
+    // Note: the type is shared with the original declaration, so that struct types still
+    // resolve to their declarations
+    auto var = std::make_shared<decl::Variable>(
+        rename_prefix + d->get_text(), d->get_token(), d->get_type(), clone(d->expression));
+    var->attributes = d->attributes;
+    decl_remap[d] = var;
+    return std::dynamic_pointer_cast<Node>(var);
+}
+
+std::any CloneVisitor::visit_stmt_block(const std::shared_ptr<ast::stmt::Block> &s)
+{
+    auto block = std::make_shared<stmt::Block>(*s);
+    block->statements.clear();
+    for (const auto &st : s->statements) {
+        block->statements.push_back(clone(st));
+    }
+    return std::dynamic_pointer_cast<Node>(block);
+}
+
+std::any CloneVisitor::visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s)
+{
+    auto if_else = std::make_shared<stmt::IfElse>(*s);
+    if_else->condition = clone(s->condition);
+    if_else->if_branch = clone(s->if_branch);
+    if_else->else_branch = clone(s->else_branch);
+    return std::dynamic_pointer_cast<Node>(if_else);
+}
+
+std::any CloneVisitor::visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s)
+{
+    auto while_stmt = std::make_shared<stmt::While>(*s);
+    while_stmt->condition = clone(s->condition);
+    while_stmt->body = clone(s->body);
+    return std::dynamic_pointer_cast<Node>(while_stmt);
+}
+
+std::any CloneVisitor::visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s)
+{
+    auto for_stmt = std::make_shared<stmt::For>(*s);
+    for_stmt->init = clone(s->init);
+    for_stmt->condition = clone(s->condition);
+    for_stmt->advance = clone(s->advance);
+    for_stmt->body = clone(s->body);
+    return std::dynamic_pointer_cast<Node>(for_stmt);
+}
+
+std::any CloneVisitor::visit_stmt_return(const std::shared_ptr<ast::stmt::Return> &s)
+{
+    auto ret = std::make_shared<stmt::Return>(*s);
+    ret->expression = clone(s->expression);
+    return std::dynamic_pointer_cast<Node>(ret);
+}
+
+std::any CloneVisitor::visit_stmt_variable_declaration(
+    const std::shared_ptr<ast::stmt::VariableDeclaration> &s)
+{
+    auto var_decl = std::make_shared<stmt::VariableDeclaration>(*s);
+    var_decl->var_decl = clone(s->var_decl);
+    return std::dynamic_pointer_cast<Node>(var_decl);
+}
+
+std::any CloneVisitor::visit_stmt_expression(const std::shared_ptr<ast::stmt::Expression> &s)
+{
+    auto expr_stmt = std::make_shared<stmt::Expression>(*s);
+    expr_stmt->expr = clone(s->expr);
+    return std::dynamic_pointer_cast<Node>(expr_stmt);
+}
+
+std::any CloneVisitor::visit_expr_unary(const std::shared_ptr<ast::expr::Unary> &e)
+{
+    auto unary = std::make_shared<expr::Unary>(*e);
+    unary->expr = clone(e->expr);
+    return std::dynamic_pointer_cast<Node>(unary);
+}
+
+std::any CloneVisitor::visit_expr_binary(const std::shared_ptr<ast::expr::Binary> &e)
+{
+    auto binary = std::make_shared<expr::Binary>(*e);
+    binary->left = clone(e->left);
+    binary->right = clone(e->right);
+    return std::dynamic_pointer_cast<Node>(binary);
+}
+
+std::any CloneVisitor::visit_expr_variable(const std::shared_ptr<ast::expr::Variable> &e)
+{
+    std::shared_ptr<decl::Variable> var_decl;
+    auto fnd = resolver_result->var_expr.find(e);
+    if (fnd != resolver_result->var_expr.end()) {
+        var_decl = fnd->second;
+    }
+
+    if (var_decl) {
+        auto subst = substitutions.find(var_decl);
+        if (subst != substitutions.end()) {
+            return std::dynamic_pointer_cast<Node>(clone(subst->second));
+        }
+
+        auto remapped = decl_remap.find(var_decl);
+        if (remapped != decl_remap.end()) {
+            var_decl = remapped->second;
+        }
+    }
+
+    auto var = std::make_shared<expr::Variable>(*e);
+    if (var_decl) {
+        var->var_name = var_decl->get_text();
+        resolver_result->var_expr[var] = var_decl;
+    }
+    return std::dynamic_pointer_cast<Node>(var);
+}
+
+std::any CloneVisitor::visit_expr_constant(const std::shared_ptr<ast::expr::Constant> &e)
+{
+    return std::dynamic_pointer_cast<Node>(std::make_shared<expr::Constant>(*e));
+}
+
+std::any CloneVisitor::visit_expr_function_call(
+    const std::shared_ptr<ast::expr::FunctionCall> &e)
+{
+    auto call = std::make_shared<expr::FunctionCall>(*e);
+    call->args.clear();
+    for (const auto &a : e->args) {
+        call->args.push_back(clone(a));
+    }
+    call->struct_array_access = clone_fragments(e->struct_array_access);
+
+    auto fnd = resolver_result->call_expr.find(e);
+    if (fnd != resolver_result->call_expr.end()) {
+        resolver_result->call_expr[call] = fnd->second;
+    }
+    return std::dynamic_pointer_cast<Node>(call);
+}
+
+std::any CloneVisitor::visit_struct_array_access(
+    const std::shared_ptr<ast::expr::StructArrayAccess> &e)
+{
+    auto variable = clone<Node>(e->variable);
+    auto fragments = clone_fragments(e->struct_array_access);
+
+    // If the variable was substituted by some other expression we can't apply the struct
+    // array access to it directly, since it's no longer a variable.
+    auto var_expr = std::dynamic_pointer_cast<expr::Variable>(variable);
+    if (!var_expr) {
+        report_error(e->get_token(),
+                     "Cannot substitute a non-variable expression into a struct or array "
+                     "access expression");
+        var_expr = e->variable;
+    }
+    auto access = std::make_shared<expr::StructArrayAccess>(var_expr, fragments);
+    access->attributes = e->attributes;
+    return std::dynamic_pointer_cast<Node>(access);
+}
+
+std::any CloneVisitor::visit_expr_assignment(const std::shared_ptr<ast::expr::Assignment> &e)
+{
+    auto assign = std::make_shared<expr::Assignment>(*e);
+    assign->lhs = clone(e->lhs);
+    assign->value = clone(e->value);
+    return std::dynamic_pointer_cast<Node>(assign);
+}
+
+std::vector<std::shared_ptr<ast::expr::StructArrayAccessFragment>>
+CloneVisitor::clone_fragments(
+    const std::vector<std::shared_ptr<ast::expr::StructArrayAccessFragment>> &fragments)
+{
+    std::vector<std::shared_ptr<expr::StructArrayAccessFragment>> cloned;
+    for (const auto &f : fragments) {
+        auto array_access = std::dynamic_pointer_cast<expr::ArrayAccessFragment>(f);
+        if (array_access) {
+            cloned.push_back(
+                std::make_shared<expr::ArrayAccessFragment>(clone(array_access->index)));
+        } else {
+            // Struct member access fragments just refer to the member name token, and can
+            // be shared between the original and the copy
+            cloned.push_back(f);
+        }
+    }
+    return cloned;
+}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ast/visitor.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* The CloneVisitor makes a deep copy of the statement or expression subtree it visits and
+ * returns it as a std::shared_ptr<ast::Node>. Variables declared within the subtree are
+ * copied to new declarations, optionally renamed by prefixing them with rename_prefix. The
+ * resolver results are updated so that the variable and function call expressions in the
+ * copy resolve to the same declarations as the original, or to the copied declarations for
+ * variables declared within the subtree.
+ */
+class CloneVisitor : public ast::Visitor {
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+public:
+    /* Map of variable declarations referenced in the original subtree to the declaration
+     * that should be referenced in the copy instead. Callers can add entries before cloning
+     * to redirect references to some variable, e.g. a function's parameters, to a different
+     * declaration. Variables declared in the subtree are added to this map as they're copied
+     */
+    phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>,
+                                  std::shared_ptr<ast::decl::Variable>>
+        decl_remap;
+
+    /* Map of variable declarations referenced in the original subtree to an expression that
+     * should be substituted for reads of the variable in the copy. The expression is copied
+     * for each use. Substitutions should only be used for variables that are not written to
+     * in the subtree
+     */
+    phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>,
+                                  std::shared_ptr<ast::expr::Expression>>
+        substitutions;
+
+    // Prefix to rename the copies of variables declared in the subtree with
+    std::string rename_prefix;
+
+    CloneVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result,
+                 const std::string &rename_prefix = "");
+
+    // Clone the subtree rooted at the node and return the copy
+    template <typename T>
+    std::shared_ptr<T> clone(const std::shared_ptr<T> &n);
+
+    std::any visit_decl_variable(const std::shared_ptr<ast::decl::Variable> &d) override;
+
+    std::any visit_stmt_block(const std::shared_ptr<ast::stmt::Block> &s) override;
+    std::any visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s) override;
+    std::any visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s) override;
+    std::any visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s) override;
+    std::any visit_stmt_return(const std::shared_ptr<ast::stmt::Return> &s) override;
+    std::any visit_stmt_variable_declaration(
+        const std::shared_ptr<ast::stmt::VariableDeclaration> &s) override;
+    std::any visit_stmt_expression(const std::shared_ptr<ast::stmt::Expression> &s) override;
+
+    std::any visit_expr_unary(const std::shared_ptr<ast::expr::Unary> &e) override;
+    std::any visit_expr_binary(const std::shared_ptr<ast::expr::Binary> &e) override;
+    std::any visit_expr_variable(const std::shared_ptr<ast::expr::Variable> &e) override;
+    std::any visit_expr_constant(const std::shared_ptr<ast::expr::Constant> &e) override;
+    std::any visit_expr_function_call(
+        const std::shared_ptr<ast::expr::FunctionCall> &e) override;
+    std::any visit_struct_array_access(
+        const std::shared_ptr<ast::expr::StructArrayAccess> &e) override;
+    std::any visit_expr_assignment(const std::shared_ptr<ast::expr::Assignment> &e) override;
+
+private:
+    std::vector<std::shared_ptr<ast::expr::StructArrayAccessFragment>> clone_fragments(
+        const std::vector<std::shared_ptr<ast::expr::StructArrayAccessFragment>> &fragments);
+};
+
+template <typename T>
+std::shared_ptr<T> CloneVisitor::clone(const std::shared_ptr<T> &n)
+{
+    if (!n) {
+        return nullptr;
+    }
+    return std::dynamic_pointer_cast<T>(std::any_cast<std::shared_ptr<ast::Node>>(visit(n)));
+}
+}
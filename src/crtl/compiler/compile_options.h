@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace crtl {
+
+// The highest optimization level supported
+const uint32_t MAX_OPTIMIZATION_LEVEL = 3;
+
+struct CompileOptions {
+    /* The optimization level, selecting the transformation passes run by the compiler:
+     * 0: Only the transformations required to translate the shader to the target
+     * 1: Inline functions marked [inline] or called once, compile-time evaluation of calls
+     *    with constant arguments and value numbering
+     * 2: Cost based inlining, loop unrolling and loop invariant code motion (default)
+     * 3: Higher inlining and unrolling thresholds
+     */
+    uint32_t optimization_level = 2;
+
+    /* The maximum number of statements and expressions executed when evaluating a call at
+     * compile time. Calls which exceed the budget are left to be evaluated at runtime
+     */
+    uint32_t compile_time_evaluation_budget = 100000;
+
+    /* A regular expression matching the names of the passes to report optimization remarks
+     * for, e.g., "inline|loop_unroll" or ".*" for all passes. No remarks are reported if empty
+     */
+    std::string remarks_filter;
+
+    // Apply the fast math rewrites to all functions, not only those marked [fast_math]
+    bool fast_math = false;
+
+    /* Pack the ray payloads into 32-bit words, using the encodings selected by the payload
+     * members' attributes. Packing changes the payload layout, so all shader libraries
+     * sharing a payload must be compiled with the same setting
+     */
+    bool pack_payloads = false;
+
+    /* Declare the ray payload structs with HLSL payload access qualifiers, listing the
+     * stages reading and writing each field. The qualifiers require shader model 6.6 or
+     * higher with -enable-payload-qualifiers, or shader model 6.7
+     */
+    bool payload_access_qualifiers = false;
+
+    /* The size in bytes the shader records of the entry points should fit in. The constant
+     * members of entry point parameters in records estimated to be larger are moved into a
+     * constant buffer referenced by the record, largest first. No limit is applied if 0
+     */
+    uint32_t shader_record_budget = 0;
+
+    /* Instrument the shader with counters of how many times each function, branch and loop
+     * runs, which the application reads back from the _crtl_profile_counters buffer to save
+     * a profile. The site ID of each counter is listed in the shader info
+     */
+    bool profile_instrument = false;
+
+    /* The path of a .crtlprof profile collected from an instrumented build of the shader,
+     * used to guide inlining, loop unrolling, branch hints and code layout
+     */
+    std::string profile_use;
+
+    /* The values of the shader's specialization constants by name, written as they would be
+     * in the shader source (e.g., "true", "4" or "0.5"). Specialization constants without a
+     * value use their default value
+     */
+    std::map<std::string, std::string> specialization_values;
+};
+}
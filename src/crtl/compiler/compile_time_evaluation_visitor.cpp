@@ -0,0 +1,92 @@
+#include "compile_time_evaluation_visitor.h"
+#include <bit>
+#include "ast_utils.h"
+
+namespace crtl {
+
+using namespace ast;
+
+CompileTimeEvaluationVisitor::CompileTimeEvaluationVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result, const size_t step_budget)
+    : resolver_result(resolver_result), interpreter(resolver_result, step_budget)
+{
+}
+
+std::any CompileTimeEvaluationVisitor::visit_expr_function_call(
+    const std::shared_ptr<expr::FunctionCall> &e)
+{
+    // Calls in the arguments may be evaluated, making the arguments constant
+    auto result = ModifyingVisitor::visit_expr_function_call(e);
+
+    auto fnd = resolver_result->call_expr.find(e);
+    if (fnd == resolver_result->call_expr.end() || fnd->second->is_builtin() ||
+        !e->struct_array_access.empty()) {
+        return result;
+    }
+
+    std::vector<ASTInterpreter::Value> args;
+    for (const auto &a : e->args) {
+        auto constant = std::dynamic_pointer_cast<expr::Constant>(a);
+        if (!constant) {
+            return result;
+        }
+        args.push_back(ASTInterpreter::Value{constant->constant_type, constant->value});
+    }
+
+    const auto &fn = fnd->second;
+    const std::string key = call_key(fn, args);
+    auto cached = results.find(key);
+    if (cached == results.end()) {
+        cached = results.emplace(key, interpreter.call(fn, args)).first;
+        if (interpreter.budget_exceeded) {
+            report_warning(e->get_token(),
+                           "Compile-time evaluation of the call to '" + fn->get_text() +
+                               "' exceeded the step budget, it will be evaluated at runtime");
+        }
+    }
+    if (!cached->second) {
+        if (remarks_enabled) {
+            report_remark(RemarkKind::MISSED,
+                          e->get_token(),
+                          "Call to '" + fn->get_text() +
+                              "' not evaluated at compile time: the function accesses "
+                              "state other than its parameters or exceeded the step budget");
+        }
+        return result;
+    }
+
+    ++num_evaluated;
+    if (remarks_enabled) {
+        report_remark(RemarkKind::APPLIED,
+                      e->get_token(),
+                      "Call to '" + fn->get_text() + "' evaluated at compile time");
+    }
+    const auto &value = *cached->second;
+    return std::dynamic_pointer_cast<expr::Expression>(
+        make_constant(e->get_token(), value.type, value.value));
+}
+
+std::string CompileTimeEvaluationVisitor::call_key(
+    const std::shared_ptr<decl::Function> &fn,
+    const std::vector<ASTInterpreter::Value> &args) const
+{
+    std::string key = std::to_string(reinterpret_cast<uintptr_t>(fn.get())) + "(";
+    for (const auto &a : args) {
+        switch (a.type) {
+        case ty::PrimitiveType::BOOL:
+            key += std::any_cast<bool>(a.value) ? "true" : "false";
+            break;
+        case ty::PrimitiveType::INT:
+            key += std::to_string(std::any_cast<int>(a.value));
+            break;
+        default:
+            // Floats are keyed by their bits, since printing them may round
+            key += std::to_string(std::bit_cast<uint32_t>(std::any_cast<float>(a.value)));
+            key += "f";
+            break;
+        }
+        key += ",";
+    }
+    return key + ")";
+}
+}
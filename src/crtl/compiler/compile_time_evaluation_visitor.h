@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ast/modifying_visitor.h"
+#include "ast_interpreter.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* The CompileTimeEvaluationVisitor replaces calls to user functions whose arguments are all
+ * constants with the value they return, computed by the ASTInterpreter. This moves setup
+ * computation done by helper functions called with constant arguments (e.g., computing
+ * table entries or fit coefficients) from every invocation of the shader to compile time.
+ *
+ * The results are cached by the function and argument values, so calls with the same
+ * arguments are evaluated once. Calls which can't be evaluated are left as is, and a
+ * warning is reported for calls which exceed the step budget.
+ */
+class CompileTimeEvaluationVisitor : public ast::ModifyingVisitor {
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+    ASTInterpreter interpreter;
+
+    // The value returned by each call evaluated, or nullopt if it couldn't be evaluated, by
+    // the function and argument values
+    phmap::flat_hash_map<std::string, std::optional<ASTInterpreter::Value>> results;
+
+public:
+    // The number of calls replaced by their value
+    size_t num_evaluated = 0;
+
+    CompileTimeEvaluationVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result,
+                                 const size_t step_budget);
+
+    std::any visit_expr_function_call(
+        const std::shared_ptr<ast::expr::FunctionCall> &e) override;
+
+private:
+    // Get the key identifying the call of the function with the argument values
+    std::string call_key(const std::shared_ptr<ast::decl::Function> &fn,
+                         const std::vector<ASTInterpreter::Value> &args) const;
+};
+}
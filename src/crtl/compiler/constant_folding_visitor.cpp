@@ -0,0 +1,257 @@
+#include "constant_folding_visitor.h"
+#include <limits>
+#include <type_traits>
+#include "ast_utils.h"
+
+namespace crtl {
+
+using namespace ast;
+
+// Evaluate the unary operation on the constant, returning an empty any if it can't be folded
+template <typename T>
+std::any fold_unary_constant(const NodeType op, const T a)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        if (op == NodeType::EXPR_LOGIC_NOT) {
+            return !a;
+        }
+    } else {
+        if (op == NodeType::EXPR_NEGATE) {
+            return T(-a);
+        }
+    }
+    return std::any();
+}
+
+// Evaluate the binary operation on the constants, returning an empty any if it can't be
+// folded
+template <typename T>
+std::any fold_binary_constants(const NodeType op, const T a, const T b)
+{
+    switch (op) {
+    case NodeType::EXPR_CMP_NOT_EQUAL:
+        return a != b;
+    case NodeType::EXPR_CMP_EQUAL:
+        return a == b;
+    default:
+        break;
+    }
+
+    if constexpr (std::is_same_v<T, bool>) {
+        switch (op) {
+        case NodeType::EXPR_LOGIC_AND:
+            return a && b;
+        case NodeType::EXPR_LOGIC_OR:
+            return a || b;
+        default:
+            return std::any();
+        }
+    } else {
+        switch (op) {
+        case NodeType::EXPR_CMP_LESS:
+            return a < b;
+        case NodeType::EXPR_CMP_LESS_EQUAL:
+            return a <= b;
+        case NodeType::EXPR_CMP_GREATER:
+            return a > b;
+        case NodeType::EXPR_CMP_GREATER_EQUAL:
+            return a >= b;
+        default:
+            break;
+        }
+    }
+
+    if constexpr (std::is_same_v<T, int>) {
+        // Integer arithmetic wraps as it does on the GPU
+        const uint32_t ua = a;
+        const uint32_t ub = b;
+        switch (op) {
+        case NodeType::EXPR_MULT:
+            return int(ua * ub);
+        case NodeType::EXPR_DIV:
+            if (b == 0 || (a == std::numeric_limits<int>::min() && b == -1)) {
+                return std::any();
+            }
+            return a / b;
+        case NodeType::EXPR_ADD:
+            return int(ua + ub);
+        case NodeType::EXPR_SUB:
+            return int(ua - ub);
+        case NodeType::EXPR_SHIFT_LEFT:
+            if (b < 0 || b >= 32) {
+                return std::any();
+            }
+            return int(ua << b);
+        case NodeType::EXPR_SHIFT_RIGHT:
+            if (b < 0 || b >= 32) {
+                return std::any();
+            }
+            return a >> b;
+        default:
+            return std::any();
+        }
+    } else if constexpr (std::is_floating_point_v<T>) {
+        switch (op) {
+        case NodeType::EXPR_MULT:
+            return a * b;
+        case NodeType::EXPR_DIV:
+            return a / b;
+        case NodeType::EXPR_ADD:
+            return a + b;
+        case NodeType::EXPR_SUB:
+            return a - b;
+        default:
+            return std::any();
+        }
+    }
+    return std::any();
+}
+
+std::any fold_scalar_operation(const NodeType op,
+                               const ty::PrimitiveType type,
+                               const std::vector<std::any> &operands)
+{
+    if (operands.empty() || operands.size() > 2) {
+        return std::any();
+    }
+    const std::any &a = operands[0];
+    const bool unary = operands.size() == 1;
+    const std::any &b = operands.back();
+    switch (type) {
+    case ty::PrimitiveType::BOOL:
+        return unary ? fold_unary_constant(op, std::any_cast<bool>(a))
+                     : fold_binary_constants(
+                           op, std::any_cast<bool>(a), std::any_cast<bool>(b));
+    case ty::PrimitiveType::INT:
+        return unary ? fold_unary_constant(op, std::any_cast<int>(a))
+                     : fold_binary_constants(op, std::any_cast<int>(a), std::any_cast<int>(b));
+    case ty::PrimitiveType::FLOAT:
+        return unary ? fold_unary_constant(op, std::any_cast<float>(a))
+                     : fold_binary_constants(
+                           op, std::any_cast<float>(a), std::any_cast<float>(b));
+    default:
+        return std::any();
+    }
+}
+
+std::any ConstantFoldingVisitor::visit_stmt_if_else(const std::shared_ptr<stmt::IfElse> &s)
+{
+    s->condition = std::any_cast<std::shared_ptr<expr::Expression>>(visit(s->condition));
+
+    // Only the taken branch is kept, if the branch isn't taken and there's no else the
+    // statement is removed
+    const auto condition = constant_condition(s->condition);
+    if (condition) {
+        ++num_branches_folded;
+        if (remarks_enabled) {
+            const std::string value = *condition ? "true" : "false";
+            const std::string removed = *condition ? "else branch" : "if branch";
+            report_remark(RemarkKind::APPLIED,
+                          s->get_token(),
+                          "If condition is always " + value + ", " + removed + " removed");
+        }
+        const auto &taken = *condition ? s->if_branch : s->else_branch;
+        return taken ? visit(taken) : std::any();
+    }
+
+    s->if_branch = result_or_nullptr<stmt::Statement>(visit(s->if_branch));
+    if (!s->if_branch) {
+        // A nested if whose branch isn't taken was removed
+        s->if_branch = std::make_shared<stmt::Block>(
+            s->get_token(), std::vector<std::shared_ptr<stmt::Statement>>{});
+    }
+    if (s->else_branch) {
+        s->else_branch = result_or_nullptr<stmt::Statement>(visit(s->else_branch));
+    }
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any ConstantFoldingVisitor::visit_stmt_while(const std::shared_ptr<stmt::While> &s)
+{
+    s->condition = std::any_cast<std::shared_ptr<expr::Expression>>(visit(s->condition));
+
+    const auto condition = constant_condition(s->condition);
+    if (condition && !*condition) {
+        ++num_branches_folded;
+        report_remark(RemarkKind::APPLIED,
+                      s->get_token(),
+                      "While condition is always false, loop removed");
+        return std::any();
+    }
+
+    if (s->body) {
+        s->body = result_or_nullptr<stmt::Statement>(visit(s->body));
+    }
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any ConstantFoldingVisitor::visit_expr_unary(const std::shared_ptr<expr::Unary> &e)
+{
+    const size_t operand_remarks = remarks.size();
+    auto result = ModifyingVisitor::visit_expr_unary(e);
+    if (!e->expr) {
+        return result;
+    }
+    auto folded = fold(e, {e->expr}, operand_remarks);
+    if (folded) {
+        return folded;
+    }
+    return result;
+}
+
+std::any ConstantFoldingVisitor::visit_expr_binary(const std::shared_ptr<expr::Binary> &e)
+{
+    const size_t operand_remarks = remarks.size();
+    auto result = ModifyingVisitor::visit_expr_binary(e);
+    if (!e->left || !e->right) {
+        return result;
+    }
+    auto folded = fold(e, {e->left, e->right}, operand_remarks);
+    if (folded) {
+        return folded;
+    }
+    return result;
+}
+
+std::shared_ptr<expr::Expression> ConstantFoldingVisitor::fold(
+    const std::shared_ptr<expr::Expression> &e,
+    const std::vector<std::shared_ptr<expr::Expression>> &operands,
+    const size_t operand_remarks)
+{
+    std::vector<std::any> values;
+    std::optional<ty::PrimitiveType> type;
+    for (const auto &o : operands) {
+        auto constant = std::dynamic_pointer_cast<expr::Constant>(o);
+        if (!constant || (type && *type != constant->constant_type)) {
+            return nullptr;
+        }
+        type = constant->constant_type;
+        values.push_back(constant->value);
+    }
+
+    const std::any value = fold_scalar_operation(e->get_node_type(), *type, values);
+    if (!value.has_value()) {
+        return nullptr;
+    }
+
+    ++num_folded;
+    // The remarks for folding the operands are replaced by the one for the whole expression
+    if (remarks_enabled) {
+        remarks.resize(operand_remarks);
+        report_remark(RemarkKind::APPLIED, e->get_token(), "Constant expression folded");
+    }
+    // Comparisons produce bools, other operations produce a value of the operand type
+    const auto result_type = value.type() == typeid(bool) ? ty::PrimitiveType::BOOL : *type;
+    return make_constant(e->get_token(), result_type, value);
+}
+
+std::optional<bool> ConstantFoldingVisitor::constant_condition(
+    const std::shared_ptr<expr::Expression> &e)
+{
+    auto constant = std::dynamic_pointer_cast<expr::Constant>(e);
+    if (!constant || constant->constant_type != ty::PrimitiveType::BOOL) {
+        return std::nullopt;
+    }
+    return std::any_cast<bool>(constant->value);
+}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <optional>
+#include "ast/modifying_visitor.h"
+
+namespace crtl {
+
+/* Evaluate the arithmetic, comparison or logic operation of the expression node type on the
+ * scalar constants of the type, returning an empty any if it can't be folded. Comparisons
+ * produce a bool, other operations a value of the operand type
+ */
+std::any fold_scalar_operation(const ast::NodeType op,
+                               const ast::ty::PrimitiveType type,
+                               const std::vector<std::any> &operands);
+
+/* The ConstantFoldingVisitor evaluates arithmetic, comparison and logic expressions on
+ * scalar constants, and removes the branches of if statements and the while loops whose
+ * condition folds to a constant. It propagates the values of specialization constants
+ * through the shader, so that each specialized variant only contains the code its values
+ * enable and variants that differ only in disabled code produce the same output.
+ *
+ * Only operations on constants of the same type are folded, and integer division by zero
+ * and out of range shifts are left for the backend compiler to diagnose.
+ */
+class ConstantFoldingVisitor : public ast::ModifyingVisitor {
+public:
+    // The number of expressions replaced by their constant value
+    size_t num_folded = 0;
+
+    // The number of if statements and while loops removed or replaced by their taken branch
+    size_t num_branches_folded = 0;
+
+    std::any visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s) override;
+    std::any visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s) override;
+
+    std::any visit_expr_unary(const std::shared_ptr<ast::expr::Unary> &e) override;
+    std::any visit_expr_binary(const std::shared_ptr<ast::expr::Binary> &e) override;
+
+private:
+    /* Evaluate the operation of the expression on the constant operands, returning the
+     * folded constant or nullptr if it can't be folded. The remarks reported after
+     * operand_remarks were for folding the operands, and are replaced by the expression's
+     */
+    std::shared_ptr<ast::expr::Expression> fold(
+        const std::shared_ptr<ast::expr::Expression> &e,
+        const std::vector<std::shared_ptr<ast::expr::Expression>> &operands,
+        const size_t operand_remarks);
+
+    // Get the value of the condition if it's a bool constant
+    std::optional<bool> constant_condition(const std::shared_ptr<ast::expr::Expression> &e);
+};
+}
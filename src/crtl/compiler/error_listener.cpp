@@ -16,10 +16,32 @@ void ErrorReporter::report_warning(const antlr4::Token *token, const std::string
     report(token, "Warning", msg);
 }
 
+void ErrorReporter::report_remark(const RemarkKind kind,
+                                  const antlr4::Token *token,
+                                  const std::string &msg)
+{
+    if (!remarks_enabled) {
+        return;
+    }
+    Remark remark;
+    remark.kind = kind;
+    if (token) {
+        remark.line = token->getLine();
+        remark.column = token->getCharPositionInLine();
+    }
+    remark.message = msg;
+    remarks.push_back(remark);
+}
+
 void ErrorReporter::report(const antlr4::Token *token,
                            const std::string &prefix,
                            const std::string &msg)
 {
+    // Nodes generated by the compiler's passes don't have a source token
+    if (!token) {
+        std::cerr << prefix << " in generated code > " << msg << "\n" << std::flush;
+        return;
+    }
     std::cerr << prefix << " at " << token->getLine() << ":" << token->getCharPositionInLine()
               << " '" << token->getText() << "' > " << msg << "\n"
               << std::flush;
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <vector>
 #include "antlr4-runtime.h"
+#include "remark.h"
 
 namespace crtl {
 
@@ -8,12 +10,25 @@ class ErrorReporter {
 public:
     bool had_error = false;
 
+    /* If optimization remarks should be collected. Passes check this before building the
+     * message of a remark, so remarks cost nothing when they aren't requested
+     */
+    bool remarks_enabled = false;
+
+    // The optimization remarks reported, the PassManager sets the pass name when collecting
+    // them from the pass
+    std::vector<Remark> remarks;
+
     virtual ~ErrorReporter() = default;
 
     void report_error(const antlr4::Token *token, const std::string &msg);
 
     void report_warning(const antlr4::Token *token, const std::string &msg);
 
+    void report_remark(const RemarkKind kind,
+                       const antlr4::Token *token,
+                       const std::string &msg);
+
 private:
     void report(const antlr4::Token *token, const std::string &prefix, const std::string &msg);
 };
@@ -0,0 +1,269 @@
+#include "expression_type.h"
+#include <algorithm>
+#include "ast_utils.h"
+#include "builtins.h"
+
+namespace crtl {
+
+using namespace ast;
+
+// Drop any parameter modifiers from the type, since the inferred type is that of a value
+std::shared_ptr<ty::Type> without_modifiers(const std::shared_ptr<ty::Type> &type)
+{
+    if (!type || type->modifiers.empty()) {
+        return type;
+    }
+    auto copy = ty::copy_type(type);
+    copy->modifiers.clear();
+    return copy;
+}
+
+// Get a type with the element type and the shape of the type passed, e.g. the bool vector
+// produced by comparing two vectors
+std::shared_ptr<ty::Type> with_element_type(const std::shared_ptr<ty::Type> &type,
+                                            const ty::PrimitiveType elem)
+{
+    auto elem_type = std::make_shared<ty::Primitive>(elem);
+    if (type->base_type == ty::BaseType::VECTOR) {
+        auto vec = std::dynamic_pointer_cast<ty::Vector>(type);
+        return std::make_shared<ty::Vector>(elem_type, vec->dimensionality);
+    }
+    if (type->base_type == ty::BaseType::MATRIX) {
+        auto mat = std::dynamic_pointer_cast<ty::Matrix>(type);
+        return std::make_shared<ty::Matrix>(elem_type, mat->dim_0, mat->dim_1);
+    }
+    return elem_type;
+}
+
+// Get the type resulting from an arithmetic operation on the two types, following HLSL's
+// promotion of scalars to vectors and of the element type to the "larger" of the two types
+std::shared_ptr<ty::Type> arithmetic_result_type(const std::shared_ptr<ty::Type> &a,
+                                                 const std::shared_ptr<ty::Type> &b)
+{
+    auto a_elem = element_type(a);
+    auto b_elem = element_type(b);
+    if (!a_elem || !b_elem) {
+        return nullptr;
+    }
+    // The shape is taken from the non-scalar operand if there is one
+    const auto &shape = a->base_type != ty::BaseType::PRIMITIVE ? a : b;
+    // The primitive type enum is ordered from the smallest to largest type
+    const auto elem = std::max(a_elem->type_id, b_elem->type_id);
+    auto shape_elem = element_type(shape);
+    if (shape_elem->type_id == elem) {
+        return shape;
+    }
+    return with_element_type(shape, elem);
+}
+
+std::shared_ptr<ty::Primitive> element_type(const std::shared_ptr<ty::Type> &type)
+{
+    if (!type) {
+        return nullptr;
+    }
+    switch (type->base_type) {
+    case ty::BaseType::PRIMITIVE:
+        return std::dynamic_pointer_cast<ty::Primitive>(type);
+    case ty::BaseType::VECTOR:
+        return std::dynamic_pointer_cast<ty::Vector>(type)->element_type;
+    case ty::BaseType::MATRIX:
+        return std::dynamic_pointer_cast<ty::Matrix>(type)->element_type;
+    default:
+        return nullptr;
+    }
+}
+
+std::shared_ptr<ty::Type> struct_member_type(const std::shared_ptr<ty::Type> &type,
+                                             const std::string &member,
+                                             const ResolverPassResult &resolved)
+{
+    switch (type->base_type) {
+    case ty::BaseType::STRUCT: {
+        auto struct_ty = std::dynamic_pointer_cast<ty::Struct>(type);
+        std::shared_ptr<decl::Struct> struct_decl;
+        auto fnd = resolved.struct_type.find(struct_ty);
+        if (fnd != resolved.struct_type.end()) {
+            struct_decl = fnd->second;
+        } else {
+            // Types created by the compiler may not have been seen by the resolver, so fall
+            // back to finding the struct by name
+            for (const auto &s : resolved.struct_type) {
+                if (s.second->get_text() == struct_ty->name) {
+                    struct_decl = s.second;
+                    break;
+                }
+            }
+        }
+        if (!struct_decl) {
+            return nullptr;
+        }
+        auto m = struct_decl->get_member(member);
+        return m ? m->get_type() : nullptr;
+    }
+    case ty::BaseType::RAY: {
+        auto float_ty = std::make_shared<ty::Primitive>(ty::PrimitiveType::FLOAT);
+        if (member == "origin" || member == "direction") {
+            return std::make_shared<ty::Vector>(float_ty, 3);
+        }
+        if (member == "t_min" || member == "t_max") {
+            return float_ty;
+        }
+        return nullptr;
+    }
+    case ty::BaseType::PRIMITIVE:
+    case ty::BaseType::VECTOR: {
+        // Swizzles
+        const bool valid_swizzle = !member.empty() && member.size() <= 4 &&
+                                   (member.find_first_not_of("xyzw") == std::string::npos ||
+                                    member.find_first_not_of("rgba") == std::string::npos);
+        if (!valid_swizzle) {
+            return nullptr;
+        }
+        auto elem = element_type(type);
+        if (member.size() == 1) {
+            return elem;
+        }
+        return std::make_shared<ty::Vector>(elem, member.size());
+    }
+    default:
+        return nullptr;
+    }
+}
+
+std::shared_ptr<ty::Type> struct_array_access_type(
+    const std::shared_ptr<ty::Type> &type,
+    const std::vector<std::shared_ptr<expr::StructArrayAccessFragment>> &fragments,
+    const ResolverPassResult &resolved)
+{
+    auto current = type;
+    for (const auto &f : fragments) {
+        if (!current) {
+            return nullptr;
+        }
+        auto member_access = std::dynamic_pointer_cast<expr::StructMemberAccessFragment>(f);
+        if (member_access) {
+            current = struct_member_type(current, member_access->name(), resolved);
+            continue;
+        }
+
+        switch (current->base_type) {
+        case ty::BaseType::BUFFER:
+        case ty::BaseType::TEXTURE: {
+            current = std::dynamic_pointer_cast<ty::Template>(current)->template_parameters[0];
+            // Quantized elements are decoded when they're loaded
+            auto quantized = std::dynamic_pointer_cast<ty::Quantized>(current);
+            if (quantized) {
+                current = quantized->decoded_type();
+            }
+            break;
+        }
+        case ty::BaseType::VECTOR:
+            current = element_type(current);
+            break;
+        case ty::BaseType::MATRIX: {
+            // Indexing a matrix returns a row
+            auto mat = std::dynamic_pointer_cast<ty::Matrix>(current);
+            current = std::make_shared<ty::Vector>(mat->element_type, mat->dim_1);
+            break;
+        }
+        default:
+            return nullptr;
+        }
+    }
+    return without_modifiers(current);
+}
+
+std::shared_ptr<ty::Type> infer_expression_type(const std::shared_ptr<expr::Expression> &e,
+                                                const ResolverPassResult &resolved)
+{
+    switch (e->get_node_type()) {
+    case NodeType::EXPR_NEGATE:
+    case NodeType::EXPR_LOGIC_NOT: {
+        auto unary = std::dynamic_pointer_cast<expr::Unary>(e);
+        auto type = infer_expression_type(unary->expr, resolved);
+        if (type && e->get_node_type() == NodeType::EXPR_LOGIC_NOT) {
+            return with_element_type(type, ty::PrimitiveType::BOOL);
+        }
+        return type;
+    }
+    case NodeType::EXPR_MULT:
+    case NodeType::EXPR_DIV:
+    case NodeType::EXPR_ADD:
+    case NodeType::EXPR_SUB: {
+        auto binary = std::dynamic_pointer_cast<expr::Binary>(e);
+        auto left = infer_expression_type(binary->left, resolved);
+        auto right = infer_expression_type(binary->right, resolved);
+        if (!left || !right) {
+            return nullptr;
+        }
+        return without_modifiers(arithmetic_result_type(left, right));
+    }
+    case NodeType::EXPR_SHIFT_LEFT:
+    case NodeType::EXPR_SHIFT_RIGHT: {
+        // Shifts produce the type of the value being shifted
+        auto binary = std::dynamic_pointer_cast<expr::Binary>(e);
+        return infer_expression_type(binary->left, resolved);
+    }
+    case NodeType::EXPR_CMP_LESS:
+    case NodeType::EXPR_CMP_LESS_EQUAL:
+    case NodeType::EXPR_CMP_GREATER:
+    case NodeType::EXPR_CMP_GREATER_EQUAL:
+    case NodeType::EXPR_CMP_NOT_EQUAL:
+    case NodeType::EXPR_CMP_EQUAL:
+    case NodeType::EXPR_LOGIC_AND:
+    case NodeType::EXPR_LOGIC_OR: {
+        // Comparisons are performed component wise and produce a bool of the same shape
+        auto binary = std::dynamic_pointer_cast<expr::Binary>(e);
+        auto left = infer_expression_type(binary->left, resolved);
+        auto right = infer_expression_type(binary->right, resolved);
+        if (!left || !right) {
+            return nullptr;
+        }
+        const auto &shape = left->base_type != ty::BaseType::PRIMITIVE ? left : right;
+        return with_element_type(shape, ty::PrimitiveType::BOOL);
+    }
+    case NodeType::EXPR_LITERAL_VAR: {
+        auto decl = accessed_variable(e, resolved);
+        return decl ? without_modifiers(decl->get_type()) : nullptr;
+    }
+    case NodeType::EXPR_LITERAL_CONSTANT:
+        return std::make_shared<ty::Primitive>(
+            std::dynamic_pointer_cast<expr::Constant>(e)->constant_type);
+    case NodeType::EXPR_FCN_CALL: {
+        auto call = std::dynamic_pointer_cast<expr::FunctionCall>(e);
+        auto fnd = resolved.call_expr.find(call);
+        if (fnd == resolved.call_expr.end()) {
+            return nullptr;
+        }
+        auto fn_type = std::dynamic_pointer_cast<ty::Function>(fnd->second->get_type());
+        if (!fn_type) {
+            return nullptr;
+        }
+        auto return_type = fn_type->return_type;
+        if (fnd->second->is_builtin() && is_generic_builtin(fnd->second->get_text()) &&
+            !call->args.empty()) {
+            auto arg_type = infer_expression_type(call->args[0], resolved);
+            if (!arg_type) {
+                return nullptr;
+            }
+            return_type = generic_builtin_return_type(fnd->second->get_text(), arg_type);
+        }
+        return struct_array_access_type(return_type, call->struct_array_access, resolved);
+    }
+    case NodeType::EXPR_STRUCT_ARRAY_ACCESS: {
+        auto access = std::dynamic_pointer_cast<expr::StructArrayAccess>(e);
+        auto decl = accessed_variable(e, resolved);
+        if (!decl) {
+            return nullptr;
+        }
+        return struct_array_access_type(
+            decl->get_type(), access->struct_array_access, resolved);
+    }
+    case NodeType::EXPR_ASSIGN:
+        return infer_expression_type(std::dynamic_pointer_cast<expr::Assignment>(e)->lhs,
+                                     resolved);
+    default:
+        return nullptr;
+    }
+}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ast/expression.h"
+#include "ast/type.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* Infer the type of the expression from the declarations of the variables and functions it
+ * references. This is not a type checker: the expression is assumed to be well typed, and
+ * nullptr is returned if the type can't be determined. The returned type may be shared with
+ * the declaration it was found from, and any parameter modifiers are dropped.
+ */
+std::shared_ptr<ast::ty::Type> infer_expression_type(
+    const std::shared_ptr<ast::expr::Expression> &e, const ResolverPassResult &resolved);
+
+/* Get the type produced by applying the struct member and array accesses to a value of the
+ * given type, or nullptr if the type can't be determined
+ */
+std::shared_ptr<ast::ty::Type> struct_array_access_type(
+    const std::shared_ptr<ast::ty::Type> &type,
+    const std::vector<std::shared_ptr<ast::expr::StructArrayAccessFragment>> &fragments,
+    const ResolverPassResult &resolved);
+
+// Get the primitive element type of a primitive, vector or matrix type, or nullptr
+std::shared_ptr<ast::ty::Primitive> element_type(const std::shared_ptr<ast::ty::Type> &type);
+}
@@ -0,0 +1,287 @@
+#include "fast_math_visitor.h"
+#include <bit>
+#include <optional>
+#include "ast_utils.h"
+#include "clone_visitor.h"
+#include "expression_type.h"
+
+namespace crtl {
+
+using namespace ast;
+
+// Check if the expression is cheap to evaluate and has no side effects, so it can be
+// duplicated by a rewrite
+bool is_simple_operand(const std::shared_ptr<expr::Expression> &e)
+{
+    switch (e->get_node_type()) {
+    case NodeType::EXPR_LITERAL_VAR:
+    case NodeType::EXPR_LITERAL_CONSTANT:
+        return true;
+    case NodeType::EXPR_STRUCT_ARRAY_ACCESS: {
+        auto access = std::dynamic_pointer_cast<expr::StructArrayAccess>(e);
+        for (const auto &f : access->struct_array_access) {
+            auto array_access = std::dynamic_pointer_cast<expr::ArrayAccessFragment>(f);
+            if (array_access && !is_simple_operand(array_access->index)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// Get the value of the expression if it's a float or int constant
+std::optional<float> float_constant_value(const std::shared_ptr<expr::Expression> &e)
+{
+    auto constant = std::dynamic_pointer_cast<expr::Constant>(e);
+    if (!constant) {
+        return std::nullopt;
+    }
+    if (constant->constant_type == ty::PrimitiveType::FLOAT) {
+        return std::any_cast<float>(constant->value);
+    }
+    if (constant->constant_type == ty::PrimitiveType::INT) {
+        return static_cast<float>(std::any_cast<int>(constant->value));
+    }
+    return std::nullopt;
+}
+
+// Get log2 of the expression's value if it's an int constant that's a power of two > 1
+std::optional<int> power_of_two_exponent(const std::shared_ptr<expr::Expression> &e)
+{
+    auto constant = std::dynamic_pointer_cast<expr::Constant>(e);
+    if (!constant || constant->constant_type != ty::PrimitiveType::INT) {
+        return std::nullopt;
+    }
+    const int value = std::any_cast<int>(constant->value);
+    if (value <= 1 || !std::has_single_bit(static_cast<uint32_t>(value))) {
+        return std::nullopt;
+    }
+    return std::countr_zero(static_cast<uint32_t>(value));
+}
+
+bool has_element_type(const std::shared_ptr<ty::Type> &type, const ty::PrimitiveType id)
+{
+    if (!type) {
+        return false;
+    }
+    auto elem = element_type(type);
+    return elem && elem->type_id == id;
+}
+
+FastMathVisitor::FastMathVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result,
+    const std::vector<std::shared_ptr<ast::decl::Declaration>> &builtins,
+    const bool fast_math)
+    : resolver_result(resolver_result), fast_math(fast_math)
+{
+    for (const auto &b : builtins) {
+        auto fn = std::dynamic_pointer_cast<decl::Function>(b);
+        if (fn) {
+            this->builtins[fn->get_text()] = fn;
+        }
+    }
+}
+
+std::any FastMathVisitor::visit_decl_function(const std::shared_ptr<ast::decl::Function> &d)
+{
+    enabled = fast_math || d->has_attribute("fast_math");
+    return ModifyingVisitor::visit_decl_function(d);
+}
+
+std::any FastMathVisitor::visit_decl_entry_point(
+    const std::shared_ptr<ast::decl::EntryPoint> &d)
+{
+    enabled = fast_math || d->has_attribute("fast_math");
+    return ModifyingVisitor::visit_decl_entry_point(d);
+}
+
+std::any FastMathVisitor::visit_stmt_variable_declaration(
+    const std::shared_ptr<ast::stmt::VariableDeclaration> &s)
+{
+    const bool precise = s->var_decl->get_type()->modifiers.contains(ty::Modifier::PRECISE);
+    if (precise) {
+        ++precise_depth;
+    }
+    auto result = ModifyingVisitor::visit_stmt_variable_declaration(s);
+    if (precise) {
+        --precise_depth;
+    }
+    return result;
+}
+
+std::any FastMathVisitor::visit_expr_binary(const std::shared_ptr<ast::expr::Binary> &e)
+{
+    // Rewrite the operands first, so rewrites of the operands can enable further rewrites of
+    // the expression. E.g., a / 2.0 + b becomes a * 0.5 + b and then mad(a, 0.5, b)
+    ModifyingVisitor::visit_expr_binary(e);
+    if (!rewrites_enabled()) {
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+    return rewrite_binary(e);
+}
+
+std::any FastMathVisitor::visit_expr_function_call(
+    const std::shared_ptr<ast::expr::FunctionCall> &e)
+{
+    ModifyingVisitor::visit_expr_function_call(e);
+
+    auto fnd = resolver_result->call_expr.find(e);
+    if (!rewrites_enabled() || fnd == resolver_result->call_expr.end() ||
+        !fnd->second->is_builtin() || e->args.size() != 1 || !e->struct_array_access.empty()) {
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+
+    const std::string name = fnd->second->get_text();
+    const auto &v = e->args[0];
+    if ((name != "normalize" && name != "length") || !is_simple_operand(v) ||
+        !has_element_type(infer_expression_type(v, *resolver_result),
+                          ty::PrimitiveType::FLOAT)) {
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+
+    auto dot = make_call("dot", {v, clone(v)});
+    if (name == "normalize") {
+        auto rsqrt = make_call("rsqrt", {dot});
+        return applied("normalize(v) to v * rsqrt(dot(v, v))",
+                       expr::Binary::multiply(nullptr, clone(v), rsqrt));
+    }
+    return applied("length(v) to sqrt(dot(v, v))", make_call("sqrt", {dot}));
+}
+
+std::any FastMathVisitor::visit_expr_assignment(
+    const std::shared_ptr<ast::expr::Assignment> &e)
+{
+    auto var = accessed_variable(e->lhs, *resolver_result);
+    const bool precise = var && var->get_type()->modifiers.contains(ty::Modifier::PRECISE);
+    if (precise) {
+        ++precise_depth;
+    }
+    auto result = ModifyingVisitor::visit_expr_assignment(e);
+    if (precise) {
+        --precise_depth;
+    }
+    return result;
+}
+
+bool FastMathVisitor::rewrites_enabled() const
+{
+    return enabled && precise_depth == 0;
+}
+
+std::shared_ptr<ast::expr::Expression> FastMathVisitor::rewrite_binary(
+    const std::shared_ptr<ast::expr::Binary> &e)
+{
+    auto type = infer_expression_type(e, *resolver_result);
+    const bool is_float = has_element_type(type, ty::PrimitiveType::FLOAT);
+    const bool is_int = has_element_type(type, ty::PrimitiveType::INT);
+    const bool is_uint = has_element_type(type, ty::PrimitiveType::UINT);
+
+    switch (e->get_node_type()) {
+    case NodeType::EXPR_DIV: {
+        // Shifting right only matches division for unsigned values, signed division rounds
+        // towards zero
+        auto shift = power_of_two_exponent(e->right);
+        if (is_uint && shift) {
+            auto amount = std::make_shared<expr::Constant>(nullptr, *shift);
+            return applied("unsigned division by power of two to shift",
+                           expr::Binary::shift_right(e->get_token(), e->left, amount));
+        }
+        if (!is_float) {
+            break;
+        }
+        auto divisor = float_constant_value(e->right);
+        if (divisor && *divisor != 0.f) {
+            auto reciprocal = std::make_shared<expr::Constant>(nullptr, 1.f / *divisor);
+            return applied("division by constant to multiplication by reciprocal",
+                           expr::Binary::multiply(e->get_token(), e->left, reciprocal));
+        }
+
+        auto call = std::dynamic_pointer_cast<expr::FunctionCall>(e->right);
+        auto fnd = call ? resolver_result->call_expr.find(call)
+                        : resolver_result->call_expr.end();
+        if (fnd == resolver_result->call_expr.end() || !fnd->second->is_builtin() ||
+            fnd->second->get_text() != "sqrt" || call->args.size() != 1 ||
+            !call->struct_array_access.empty()) {
+            break;
+        }
+        auto rsqrt = make_call("rsqrt", {call->args[0]});
+        auto dividend = float_constant_value(e->left);
+        if (dividend && *dividend == 1.f) {
+            return applied("division by sqrt to rsqrt", rsqrt);
+        }
+        return applied("division by sqrt to rsqrt",
+                       expr::Binary::multiply(e->get_token(), e->left, rsqrt));
+    }
+    case NodeType::EXPR_MULT: {
+        if (!is_int && !is_uint) {
+            break;
+        }
+        auto shift = power_of_two_exponent(e->right);
+        auto value = e->left;
+        if (!shift) {
+            shift = power_of_two_exponent(e->left);
+            value = e->right;
+        }
+        if (shift) {
+            auto amount = std::make_shared<expr::Constant>(nullptr, *shift);
+            return applied("multiplication by power of two to shift",
+                           expr::Binary::shift_left(e->get_token(), value, amount));
+        }
+        break;
+    }
+    case NodeType::EXPR_ADD: {
+        if (!is_float) {
+            break;
+        }
+        // Note: the operands must have the same type, since mad doesn't broadcast scalars
+        // like the arithmetic operators do
+        auto mult = std::dynamic_pointer_cast<expr::Binary>(e->left);
+        auto addend = e->right;
+        if (!mult || mult->get_node_type() != NodeType::EXPR_MULT) {
+            mult = std::dynamic_pointer_cast<expr::Binary>(e->right);
+            addend = e->left;
+        }
+        if (!mult || mult->get_node_type() != NodeType::EXPR_MULT) {
+            break;
+        }
+        const std::string type_str = type->to_string();
+        for (const auto &operand : {mult->left, mult->right, addend}) {
+            auto operand_type = infer_expression_type(operand, *resolver_result);
+            if (!operand_type || operand_type->to_string() != type_str) {
+                return e;
+            }
+        }
+        return applied("multiply-add to mad",
+                       make_call("mad", {mult->left, mult->right, addend}));
+    }
+    default:
+        break;
+    }
+    return e;
+}
+
+std::shared_ptr<ast::expr::Expression> FastMathVisitor::applied(
+    const std::string &rewrite, const std::shared_ptr<ast::expr::Expression> &e)
+{
+    ++num_rewrites[rewrite];
+    return e;
+}
+
+std::shared_ptr<ast::expr::FunctionCall> FastMathVisitor::make_call(
+    const std::string &name, const std::vector<std::shared_ptr<ast::expr::Expression>> &args)
+{
+    auto call = std::make_shared<expr::FunctionCall>(name, args);
+    resolver_result->call_expr[call] = builtins[name];
+    return call;
+}
+
+std::shared_ptr<ast::expr::Expression> FastMathVisitor::clone(
+    const std::shared_ptr<ast::expr::Expression> &e)
+{
+    CloneVisitor cloner(resolver_result);
+    return cloner.clone(e);
+}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <map>
+#include "ast/modifying_visitor.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* The FastMathVisitor applies strength reductions and floating point rewrites that trade
+ * exactness for speed. The rewrites are applied to all functions when fast math is enabled
+ * for the whole shader, or to functions marked [fast_math]:
+ *
+ * - Float division by a constant becomes multiplication by its reciprocal
+ * - Integer multiplication and unsigned division by a power of two become shifts
+ * - Float a * b + c becomes mad(a, b, c)
+ * - normalize(v) becomes v * rsqrt(dot(v, v)) and length(v) becomes sqrt(dot(v, v)), so that
+ *   repeated normalize and length calls on the same vector can share the dot product
+ * - Float division by sqrt(x) becomes multiplication by rsqrt(x)
+ *
+ * Expressions computing the value of a variable declared precise are left as is.
+ */
+class FastMathVisitor : public ast::ModifyingVisitor {
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+    // The builtin functions, used to resolve the calls introduced by the rewrites
+    phmap::flat_hash_map<std::string, std::shared_ptr<ast::decl::Function>> builtins;
+
+    // If fast math is enabled for all functions
+    bool fast_math = false;
+
+    // If fast math is enabled for the function being visited
+    bool enabled = false;
+
+    // When > 0 we're visiting an expression computing the value of a precise variable
+    size_t precise_depth = 0;
+
+public:
+    // The number of times each rewrite was applied, by the name of the rewrite
+    std::map<std::string, size_t> num_rewrites;
+
+    FastMathVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result,
+                    const std::vector<std::shared_ptr<ast::decl::Declaration>> &builtins,
+                    const bool fast_math);
+
+    std::any visit_decl_function(const std::shared_ptr<ast::decl::Function> &d) override;
+    std::any visit_decl_entry_point(const std::shared_ptr<ast::decl::EntryPoint> &d) override;
+
+    std::any visit_stmt_variable_declaration(
+        const std::shared_ptr<ast::stmt::VariableDeclaration> &s) override;
+
+    std::any visit_expr_binary(const std::shared_ptr<ast::expr::Binary> &e) override;
+    std::any visit_expr_function_call(
+        const std::shared_ptr<ast::expr::FunctionCall> &e) override;
+    std::any visit_expr_assignment(const std::shared_ptr<ast::expr::Assignment> &e) override;
+
+private:
+    bool rewrites_enabled() const;
+
+    // Rewrite the binary expression, returning the original expression if no rewrite applies
+    std::shared_ptr<ast::expr::Expression> rewrite_binary(
+        const std::shared_ptr<ast::expr::Binary> &e);
+
+    // Record that the rewrite was applied and return the rewritten expression
+    std::shared_ptr<ast::expr::Expression> applied(
+        const std::string &rewrite, const std::shared_ptr<ast::expr::Expression> &e);
+
+    std::shared_ptr<ast::expr::FunctionCall> make_call(
+        const std::string &name,
+        const std::vector<std::shared_ptr<ast::expr::Expression>> &args);
+
+    std::shared_ptr<ast::expr::Expression> clone(
+        const std::shared_ptr<ast::expr::Expression> &e);
+};
+}
@@ -24,6 +24,8 @@ std::any GlobalStructParamExpansionVisitor::visit_decl_global_param(
     for (const auto &m : struct_decl->members) {
         auto gp = std::make_shared<decl::GlobalParam>(
             d->get_text() + "_" + m->get_text(), nullptr, m->get_type());
+        // The member's attributes apply to the parameter replacing it, e.g., [soa]
+        gp->attributes = m->attributes;
         expanded_decls.push_back(gp);
         expanded_param->members[m->get_text()] = gp;
     }
@@ -5,16 +5,35 @@
 #include "antlr4-runtime.h"
 #include "ast/modifying_visitor.h"
 #include "ast_builder_visitor.h"
-#include "builtins.h"
+#include "call_graph_analysis.h"
+#include "compile_time_evaluation_visitor.h"
+#include "constant_folding_visitor.h"
 #include "error_listener.h"
+#include "fast_math_visitor.h"
 #include "global_struct_param_expansion_visitor.h"
+#include "inline_function_visitor.h"
 #include "json_visitor.h"
+#include "loop_invariant_code_motion_visitor.h"
+#include "loop_unroll_visitor.h"
+#include "monomorphization_visitor.h"
+#include "parameter_liveness_analysis.h"
 #include "parameter_transforms.h"
+#include "pass_manager.h"
+#include "payload_dead_write_visitor.h"
+#include "payload_field_analysis.h"
+#include "payload_packing_visitor.h"
+#include "profile_guided_visitor.h"
+#include "profile_instrumentation_visitor.h"
+#include "ray_payload_analysis.h"
 #include "rename_entry_point_param_visitor.h"
-#include "resolver_visitor.h"
+#include "resolution_analysis.h"
+#include "soa_buffer_expansion_visitor.h"
+#include "specialization_visitor.h"
+#include "value_numbering_visitor.h"
 
 #include "hlsl/output_visitor.h"
 #include "hlsl/parameter_metadata_output_visitor.h"
+#include "hlsl/register_allocation_analysis.h"
 
 namespace crtl {
 namespace hlsl {
@@ -25,7 +44,8 @@ ShaderCompilationResult::ShaderCompilationResult(const std::string &hlsl_src,
 {
 }
 
-std::shared_ptr<ShaderCompilationResult> compile_crtl(const std::string &crtl_src)
+std::shared_ptr<ShaderCompilationResult> compile_crtl(const std::string &crtl_src,
+                                                      const CompileOptions &options)
 {
     const std::string DIVIDER(8, '-');
     // TODO: This compilation step needs to be done in the crtl_compiler library
@@ -77,21 +97,21 @@ std::shared_ptr<ShaderCompilationResult> compile_crtl(const std::string &crtl_sr
 
     std::cout << "AST JSON:\n" << ast_json.dump(4) << "\n";
 
-    auto builtins = get_builtin_decls();
+    PassManager pass_manager(ast, options);
 
-    ResolverVisitor resolver_visitor(builtins);
-    resolver_visitor.visit_ast(ast);
-
-    auto resolver_result = resolver_visitor.resolved;
+    // The resolver runs before any transformations so that errors are reported against the
+    // program as written
+    auto resolution = pass_manager.get_analysis<ResolutionAnalysis>();
+    auto resolver_result = resolution->resolved;
 
     // For testing, print out some info about what was resolved by the resolver
-    for (const auto &x : resolver_visitor.resolved->struct_type) {
+    for (const auto &x : resolver_result->struct_type) {
         auto decl = std::any_cast<nlohmann::json>(json_visitor.visit(x.second));
         std::cout << "Resolved struct type: " << x.first->name << " to decl:\n"
                   << decl.dump(4) << "\n";
     }
 
-    for (const auto &x : resolver_visitor.resolved->var_expr) {
+    for (const auto &x : resolver_result->var_expr) {
         auto expr = std::any_cast<nlohmann::json>(json_visitor.visit(x.first));
         auto decl = std::any_cast<nlohmann::json>(json_visitor.visit(x.second));
         std::cout << "Resolved var expr:\n"
@@ -99,7 +119,7 @@ std::shared_ptr<ShaderCompilationResult> compile_crtl(const std::string &crtl_sr
                   << decl.dump(4) << "\n";
     }
 
-    for (const auto &x : resolver_visitor.resolved->call_expr) {
+    for (const auto &x : resolver_result->call_expr) {
         auto expr = std::any_cast<nlohmann::json>(json_visitor.visit(x.first));
         std::cout << "Resolved function call:\n"
                   << expr.dump(4) << "\nto function declared:\n";
@@ -111,36 +131,365 @@ std::shared_ptr<ShaderCompilationResult> compile_crtl(const std::string &crtl_sr
         }
     }
 
-    if (resolver_visitor.had_error) {
-        std::cout << "Error during resolver pass, exiting\n";
-        throw std::runtime_error("Resolver error");
+    // Each transformation gets the analyses it needs from the pass manager, and returns the
+    // changes it made that invalidate cached analyses. Passes which generate new nodes
+    // register them in the resolver results, so the resolution stays valid throughout
+
+    // Generic functions are replaced by their instantiations first, since the other passes
+    // only handle functions whose types are known
+    pass_manager.add_transform("monomorphization", 0, [&](PassManager &pm) {
+        MonomorphizationVisitor monomorphization_visitor(
+            pm.get_analysis<ResolutionAnalysis>()->resolved);
+        pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+            monomorphization_visitor.visit_ast(pm.ast));
+        if (monomorphization_visitor.num_generics == 0) {
+            return std::set<ASTChange>{};
+        }
+        std::cout << "Replaced " << monomorphization_visitor.num_generics
+                  << " generic functions with " << monomorphization_visitor.num_instances
+                  << " instantiations\n";
+        return std::set<ASTChange>{ASTChange::FUNCTIONS, ASTChange::CALLS};
+    });
+
+    // Specialization constants are replaced by their values and folded through the shader
+    // before any other transformations, so that they only see the code enabled by the values.
+    // This is required to translate the shader, so it's done at all optimization levels
+    pass_manager.add_transform("specialization", 0, [&](PassManager &pm) {
+        SpecializationVisitor specialization_visitor(
+            pm.get_analysis<ResolutionAnalysis>()->resolved, pm.options.specialization_values);
+        pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+            specialization_visitor.visit_ast(pm.ast));
+        if (specialization_visitor.had_error) {
+            std::cout << "Error specializing shader, exiting\n";
+            throw std::runtime_error("Specialization error");
+        }
+        std::cout << "Substituted " << specialization_visitor.num_substituted
+                  << " specialization constant reads\n";
+        return std::set<ASTChange>{};
+    });
+
+    pass_manager.add_transform("constant_folding", 0, [&](PassManager &pm) {
+        ConstantFoldingVisitor constant_folding_visitor;
+        pm.enable_remarks(constant_folding_visitor);
+        pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+            constant_folding_visitor.visit_ast(pm.ast));
+        pm.collect_remarks(constant_folding_visitor);
+        std::cout << "Folded " << constant_folding_visitor.num_folded
+                  << " constant expressions and "
+                  << constant_folding_visitor.num_branches_folded << " branches\n";
+        if (constant_folding_visitor.num_branches_folded == 0) {
+            return std::set<ASTChange>{};
+        }
+        // Removing branches may remove calls and parameter accesses
+        return std::set<ASTChange>{ASTChange::CALLS, ASTChange::PARAMETER_ACCESSES};
+    });
+
+    // Profile instrumentation and profile guided hints are applied to the shader as written,
+    // so that the sites match between the instrumented and optimized builds. They run after
+    // specialization so that only the sites in the enabled code are counted
+    std::vector<std::string> profile_counter_sites;
+    if (options.profile_instrument) {
+        pass_manager.add_transform("profile_instrumentation", 0, [&](PassManager &pm) {
+            ProfileInstrumentationVisitor instrumentation_visitor;
+            pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+                instrumentation_visitor.visit_ast(pm.ast));
+            if (instrumentation_visitor.had_error) {
+                std::cout << "Error instrumenting shader, exiting\n";
+                throw std::runtime_error("Profile instrumentation error");
+            }
+            profile_counter_sites = instrumentation_visitor.counter_sites;
+            std::cout << "Inserted " << profile_counter_sites.size() << " profile counters\n";
+            return std::set<ASTChange>{ASTChange::UNRESOLVED_NODES,
+                                       ASTChange::PARAMETERS,
+                                       ASTChange::PARAMETER_ACCESSES};
+        });
     }
 
-    // TODO: These depend on the target API backend
-    GlobalStructParamExpansionVisitor global_struct_param_expansion_visitor(resolver_result);
-    ast = std::any_cast<std::shared_ptr<ast::AST>>(
-        global_struct_param_expansion_visitor.visit_ast(ast));
+    if (!options.profile_use.empty()) {
+        pass_manager.add_transform("profile_guided", 1, [&](PassManager &pm) {
+            const Profile profile = Profile::load(pm.options.profile_use);
+            ProfileGuidedVisitor profile_guided_visitor(profile);
+            pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+                profile_guided_visitor.visit_ast(pm.ast));
+            std::cout << "Matched " << profile_guided_visitor.num_sites_matched
+                      << " profiled sites, added " << profile_guided_visitor.num_hints
+                      << " hints and reordered "
+                      << profile_guided_visitor.num_branches_reordered << " branches\n";
+            return std::set<ASTChange>{};
+        });
+    }
 
-    RenameEntryPointParamVisitor rename_entry_point_params(resolver_result);
-    rename_entry_point_params.visit_ast(ast);
+    // Calls to pure functions with constant arguments are replaced by their value, and the
+    // new constants folded through the shader. This runs before fast math so that the calls
+    // are evaluated as written
+    pass_manager.add_transform("compile_time_evaluation", 1, [&](PassManager &pm) {
+        CompileTimeEvaluationVisitor evaluation_visitor(
+            pm.get_analysis<ResolutionAnalysis>()->resolved,
+            pm.options.compile_time_evaluation_budget);
+        pm.enable_remarks(evaluation_visitor);
+        pm.ast =
+            std::any_cast<std::shared_ptr<ast::AST>>(evaluation_visitor.visit_ast(pm.ast));
+        pm.collect_remarks(evaluation_visitor);
+        if (evaluation_visitor.num_evaluated == 0) {
+            return std::set<ASTChange>{};
+        }
+        ConstantFoldingVisitor constant_folding_visitor;
+        pm.enable_remarks(constant_folding_visitor);
+        pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+            constant_folding_visitor.visit_ast(pm.ast));
+        pm.collect_remarks(constant_folding_visitor);
+        std::cout << "Evaluated " << evaluation_visitor.num_evaluated
+                  << " calls at compile time, folded "
+                  << constant_folding_visitor.num_folded << " constant expressions and "
+                  << constant_folding_visitor.num_branches_folded << " branches\n";
+        return std::set<ASTChange>{ASTChange::CALLS, ASTChange::PARAMETER_ACCESSES};
+    });
+
+    // Dead payload writes are removed before packing, so that the fields written are known
+    // before the payload is only accessed through the pack and unpack functions
+    pass_manager.add_transform("payload_dead_writes", 1, [&](PassManager &pm) {
+        PayloadDeadWriteVisitor dead_write_visitor(
+            pm.get_analysis<ResolutionAnalysis>()->resolved,
+            pm.get_analysis<PayloadFieldAnalysis>());
+        pm.enable_remarks(dead_write_visitor);
+        pm.ast =
+            std::any_cast<std::shared_ptr<ast::AST>>(dead_write_visitor.visit_ast(pm.ast));
+        pm.collect_remarks(dead_write_visitor);
+        std::cout << "Removed " << dead_write_visitor.num_removed << " dead payload writes\n";
+        if (dead_write_visitor.num_removed == 0) {
+            return std::set<ASTChange>{};
+        }
+        return std::set<ASTChange>{ASTChange::PAYLOAD_ACCESSES, ASTChange::PARAMETER_ACCESSES};
+    });
+
+    // Payload packing runs before inlining so that the generated pack and unpack functions
+    // are inlined into the trace_ray call sites and entry points
+    if (options.pack_payloads) {
+        pass_manager.add_transform("payload_packing", 0, [&](PassManager &pm) {
+            PayloadPackingVisitor payload_packing_visitor(
+                pm.get_analysis<ResolutionAnalysis>()->resolved,
+                pm.get_analysis<RayPayloadAnalysis>());
+            pm.enable_remarks(payload_packing_visitor);
+            pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+                payload_packing_visitor.visit_ast(pm.ast));
+            pm.collect_remarks(payload_packing_visitor);
+            std::cout << "Packed " << payload_packing_visitor.num_payloads_packed
+                      << " ray payloads used at " << payload_packing_visitor.num_sites_packed
+                      << " trace calls and entry points\n";
+            if (payload_packing_visitor.num_payloads_packed == 0) {
+                return std::set<ASTChange>{};
+            }
+            return std::set<ASTChange>{ASTChange::UNRESOLVED_NODES,
+                                       ASTChange::FUNCTIONS,
+                                       ASTChange::CALLS,
+                                       ASTChange::PARAMETERS};
+        });
+    }
 
-    auto param_transforms = std::make_shared<ParameterTransforms>(
-        global_struct_param_expansion_visitor.expanded_global_params,
-        rename_entry_point_params.renamed_vars);
+    // Fast math runs before inlining so that it only applies to the bodies of functions
+    // marked [fast_math], and not to other functions they're inlined into
+    pass_manager.add_transform("fast_math", 0, [&](PassManager &pm) {
+        auto resolution = pm.get_analysis<ResolutionAnalysis>();
+        FastMathVisitor fast_math_visitor(
+            resolution->resolved, resolution->builtins, pm.options.fast_math);
+        pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(fast_math_visitor.visit_ast(pm.ast));
+        if (fast_math_visitor.num_rewrites.empty()) {
+            return std::set<ASTChange>{};
+        }
+        std::cout << "Fast math rewrites applied:\n";
+        for (const auto &r : fast_math_visitor.num_rewrites) {
+            std::cout << "    " << r.first << ": " << r.second << "\n";
+        }
+        return std::set<ASTChange>{ASTChange::PARAMETER_ACCESSES};
+    });
+
+    // -O1 only inlines functions marked [inline] or called once, higher levels use the cost
+    // model
+    pass_manager.add_transform("inline", 1, [&](PassManager &pm) {
+        size_t inline_threshold = DEFAULT_INLINE_THRESHOLD;
+        if (pm.options.optimization_level == 1) {
+            inline_threshold = 0;
+        } else if (pm.options.optimization_level >= 3) {
+            inline_threshold = 4 * DEFAULT_INLINE_THRESHOLD;
+        }
+        InlineFunctionVisitor inline_function_visitor(
+            pm.get_analysis<ResolutionAnalysis>()->resolved,
+            pm.get_analysis<CallGraphAnalysis>(),
+            inline_threshold);
+        pm.enable_remarks(inline_function_visitor);
+        pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+            inline_function_visitor.visit_ast(pm.ast));
+        pm.collect_remarks(inline_function_visitor);
+        if (inline_function_visitor.had_error) {
+            std::cout << "Error during inlining pass, exiting\n";
+            throw std::runtime_error("Inlining error");
+        }
+        std::cout << "Inlined " << inline_function_visitor.num_inlined_calls << " calls\n";
+        if (inline_function_visitor.num_inlined_calls == 0) {
+            return std::set<ASTChange>{};
+        }
+        return std::set<ASTChange>{ASTChange::FUNCTIONS, ASTChange::CALLS};
+    });
+
+    pass_manager.add_transform("loop_unroll", 2, [&](PassManager &pm) {
+        const size_t unroll_threshold = pm.options.optimization_level >= 3
+                                            ? 4 * DEFAULT_UNROLL_THRESHOLD
+                                            : DEFAULT_UNROLL_THRESHOLD;
+        LoopUnrollVisitor loop_unroll_visitor(pm.get_analysis<ResolutionAnalysis>()->resolved,
+                                              unroll_threshold);
+        pm.enable_remarks(loop_unroll_visitor);
+        pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+            loop_unroll_visitor.visit_ast(pm.ast));
+        pm.collect_remarks(loop_unroll_visitor);
+        if (loop_unroll_visitor.had_error) {
+            std::cout << "Error during loop unrolling pass, exiting\n";
+            throw std::runtime_error("Loop unrolling error");
+        }
+        std::cout << "Unrolled " << loop_unroll_visitor.num_unrolled_loops << " loops ("
+                  << loop_unroll_visitor.num_partially_unrolled_loops << " partially)\n";
+        if (loop_unroll_visitor.num_unrolled_loops == 0) {
+            return std::set<ASTChange>{};
+        }
+        return std::set<ASTChange>{ASTChange::CALLS};
+    });
 
-    OutputVisitor hlsl_translator(resolver_visitor.resolved);
+    // TODO: These depend on the target API backend
+    phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::GlobalParam>,
+                                  std::shared_ptr<ExpandedGlobalParam>>
+        expanded_global_params;
+    pass_manager.add_transform("global_struct_param_expansion", 0, [&](PassManager &pm) {
+        GlobalStructParamExpansionVisitor global_struct_param_expansion_visitor(
+            pm.get_analysis<ResolutionAnalysis>()->resolved);
+        pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+            global_struct_param_expansion_visitor.visit_ast(pm.ast));
+        expanded_global_params = global_struct_param_expansion_visitor.expanded_global_params;
+        if (expanded_global_params.empty()) {
+            return std::set<ASTChange>{};
+        }
+        return std::set<ASTChange>{ASTChange::PARAMETERS, ASTChange::PARAMETER_ACCESSES};
+    });
+
+    // [soa] buffers are split after the global struct params are expanded, so the [soa]
+    // members of global struct params are split as the global params replacing them
+    SoaBuffers soa_buffers;
+    pass_manager.add_transform("soa_buffer_expansion", 0, [&](PassManager &pm) {
+        SoaBufferExpansionVisitor soa_buffer_expansion_visitor(
+            pm.get_analysis<ResolutionAnalysis>()->resolved);
+        pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+            soa_buffer_expansion_visitor.visit_ast(pm.ast));
+        if (soa_buffer_expansion_visitor.had_error) {
+            std::cout << "Error splitting [soa] buffers, exiting\n";
+            throw std::runtime_error("SoA buffer expansion error");
+        }
+        soa_buffers = soa_buffer_expansion_visitor.soa_buffers;
+        if (soa_buffers.empty()) {
+            return std::set<ASTChange>{};
+        }
+        return std::set<ASTChange>{ASTChange::PARAMETERS, ASTChange::PARAMETER_ACCESSES};
+    });
+
+    phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>, std::string>
+        renamed_vars;
+    pass_manager.add_transform("rename_entry_point_params", 0, [&](PassManager &pm) {
+        RenameEntryPointParamVisitor rename_entry_point_params(
+            pm.get_analysis<ResolutionAnalysis>()->resolved);
+        rename_entry_point_params.visit_ast(pm.ast);
+        renamed_vars = rename_entry_point_params.renamed_vars;
+        if (renamed_vars.empty()) {
+            return std::set<ASTChange>{};
+        }
+        return std::set<ASTChange>{ASTChange::PARAMETERS};
+    });
+
+    // Loop invariant code motion and value numbering run after the parameter transforms so
+    // that they see the final form of the expressions accessing the parameters. Value
+    // numbering runs last to merge any redundant expressions hoisted out of loops. Neither
+    // changes the calls or the parameters read
+    pass_manager.add_transform("licm", 2, [&](PassManager &pm) {
+        LoopInvariantCodeMotionVisitor licm_visitor(
+            pm.get_analysis<ResolutionAnalysis>()->resolved);
+        pm.enable_remarks(licm_visitor);
+        pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(licm_visitor.visit_ast(pm.ast));
+        pm.collect_remarks(licm_visitor);
+        std::cout << "Hoisted " << licm_visitor.num_hoisted << " loop invariant expressions\n";
+        return std::set<ASTChange>{};
+    });
+
+    pass_manager.add_transform("value_numbering", 1, [&](PassManager &pm) {
+        ValueNumberingVisitor value_numbering_visitor(
+            pm.get_analysis<ResolutionAnalysis>()->resolved);
+        pm.enable_remarks(value_numbering_visitor);
+        pm.ast = std::any_cast<std::shared_ptr<ast::AST>>(
+            value_numbering_visitor.visit_ast(pm.ast));
+        pm.collect_remarks(value_numbering_visitor);
+        std::cout << "Eliminated " << value_numbering_visitor.num_eliminated
+                  << " redundant expressions, propagated "
+                  << value_numbering_visitor.num_copies_propagated << " copies\n";
+        return std::set<ASTChange>{};
+    });
+
+    std::cout << "Running passes at -O" << options.optimization_level << "\n";
+    pass_manager.run();
+    ast = pass_manager.ast;
+    resolver_result = pass_manager.get_analysis<ResolutionAnalysis>()->resolved;
+
+    auto parameter_liveness = pass_manager.get_analysis<ParameterLivenessAnalysis>();
+    for (const auto &n : ast->top_level_decls) {
+        auto param = std::dynamic_pointer_cast<ast::decl::GlobalParam>(n);
+        if (param && !parameter_liveness->live_params.contains(param)) {
+            std::cout << "Global parameter '" << param->get_text()
+                      << "' is not used by any entry point\n";
+            pass_manager.add_remark("parameter_liveness",
+                                    RemarkKind::ANALYSIS,
+                                    param->get_token(),
+                                    "Global parameter '" + param->get_text() +
+                                        "' is not used by any entry point and can be removed");
+        }
+    }
+
+    auto param_transforms = std::make_shared<ParameterTransforms>(
+        expanded_global_params, renamed_vars, soa_buffers);
+
+    auto register_allocation = pass_manager.get_analysis<RegisterAllocationAnalysis>();
+    auto payload_fields = pass_manager.get_analysis<PayloadFieldAnalysis>();
+    OutputVisitor hlsl_translator(
+        resolver_result,
+        register_allocation->parameter_bindings,
+        options.payload_access_qualifiers ? payload_fields : nullptr);
     const std::string hlsl_src = std::any_cast<std::string>(hlsl_translator.visit_ast(ast));
     std::cout << "CRTL shader translated to HLSL:\n" << hlsl_src << "\n";
 
     std::cout << "Building parameter metadata JSON\n";
     ParameterMetadataOutputVisitor param_metadata_output(
-        resolver_visitor.resolved, param_transforms, hlsl_translator.parameter_bindings);
+        resolver_result,
+        param_transforms,
+        register_allocation->parameter_bindings,
+        pass_manager.get_analysis<RayPayloadAnalysis>(),
+        payload_fields);
     auto param_binding_json =
         std::any_cast<nlohmann::json>(param_metadata_output.visit_ast(ast));
+    if (param_metadata_output.had_error) {
+        std::cout << "Error building parameter metadata, exiting\n";
+        throw std::runtime_error("Parameter metadata error");
+    }
     std::cout << param_binding_json.dump(4) << "\n";
 
+    for (const auto &a : pass_manager.num_analysis_runs) {
+        std::cout << "Analysis " << a.first << " computed " << a.second << " times\n";
+    }
+
+    if (options.profile_instrument) {
+        param_binding_json["profile_counters"] = profile_counter_sites;
+    }
+
+    for (const auto &r : pass_manager.remarks) {
+        std::cerr << r.to_string() << "\n";
+    }
+
     // TODO: The param binding json will be a lot more than just the param binding info
-    return std::make_shared<ShaderCompilationResult>(hlsl_src, param_binding_json);
+    auto result = std::make_shared<ShaderCompilationResult>(hlsl_src, param_binding_json);
+    result->remarks = pass_manager.remarks;
+    return result;
 }
 
 }
@@ -2,7 +2,10 @@
 
 #include <memory>
 #include <string>
+#include <vector>
+#include "compile_options.h"
 #include "json.hpp"
+#include "remark.h"
 
 namespace crtl {
 namespace hlsl {
@@ -11,11 +14,18 @@ struct ShaderCompilationResult {
     std::string hlsl_src;
     nlohmann::json shader_info;
 
+    // The optimization remarks reported by the passes selected by the options' remarks_filter
+    std::vector<Remark> remarks;
+
     ShaderCompilationResult() = default;
 
     ShaderCompilationResult(const std::string &hlsl_src, nlohmann::json &shader_info);
 };
 
-std::shared_ptr<ShaderCompilationResult> compile_crtl(const std::string &crtl_src);
+/* Compile the CRTL shader source to HLSL, running the transformation passes selected by the
+ * options
+ */
+std::shared_ptr<ShaderCompilationResult> compile_crtl(
+    const std::string &crtl_src, const CompileOptions &options = CompileOptions());
 }
 }
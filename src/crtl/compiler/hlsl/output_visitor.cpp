@@ -1,31 +1,93 @@
 #include "output_visitor.h"
+#include <cstdio>
 #include <memory>
+#include "ast_utils.h"
+#include "expression_type.h"
 #include "shader_register_binding.h"
 #include "translate_builtin_function_call.h"
 #include "translate_builtin_type.h"
+#include "type_layout.h"
 
 namespace crtl {
 namespace hlsl {
 
 using namespace ast;
 
-OutputVisitor::OutputVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result)
-    : resolver_result(resolver_result)
+// Get the precedence of the binary operator or assignment in HLSL, lower values bind tighter.
+// Returns 0 for other expressions, which don't need parentheses
+int binary_operator_precedence(const NodeType nt)
+{
+    switch (nt) {
+    case NodeType::EXPR_MULT:
+    case NodeType::EXPR_DIV:
+        return 1;
+    case NodeType::EXPR_ADD:
+    case NodeType::EXPR_SUB:
+        return 2;
+    case NodeType::EXPR_SHIFT_LEFT:
+    case NodeType::EXPR_SHIFT_RIGHT:
+        return 3;
+    case NodeType::EXPR_CMP_LESS:
+    case NodeType::EXPR_CMP_LESS_EQUAL:
+    case NodeType::EXPR_CMP_GREATER:
+    case NodeType::EXPR_CMP_GREATER_EQUAL:
+        return 4;
+    case NodeType::EXPR_CMP_NOT_EQUAL:
+    case NodeType::EXPR_CMP_EQUAL:
+        return 5;
+    case NodeType::EXPR_LOGIC_AND:
+        return 6;
+    case NodeType::EXPR_LOGIC_OR:
+        return 7;
+    case NodeType::EXPR_ASSIGN:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+OutputVisitor::OutputVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result,
+    const phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>,
+                                        std::shared_ptr<ParameterRegisterBinding>>
+        &param_bindings,
+    const std::shared_ptr<PayloadFieldAnalysis> &payload_fields)
+    : resolver_result(resolver_result),
+      parameter_bindings(param_bindings),
+      payload_fields(payload_fields)
 {
 }
 
 std::any OutputVisitor::visit_ast(const std::shared_ptr<ast::AST> &ast)
 {
-    std::string hlsl_src = "// CRTL HLSL Output\n";
+    std::string decls_src;
     for (auto &n : ast->top_level_decls) {
-        hlsl_src += std::any_cast<std::string>(visit(n)) + "\n";
+        decls_src += std::any_cast<std::string>(visit(n)) + "\n";
     }
-    return hlsl_src;
+
+    // The helper functions for the builtins called are declared before the program
+    std::string hlsl_src = "// CRTL HLSL Output\n";
+    for (const auto &b : helper_builtins) {
+        hlsl_src += builtin_helper_function(b) + "\n";
+    }
+    return hlsl_src + decls_src;
 }
 
 std::any OutputVisitor::visit_decl_function(const std::shared_ptr<ast::decl::Function> &d)
 {
-    std::string hlsl_src;
+    auto fn_type = std::dynamic_pointer_cast<ty::Function>(d->get_type());
+    std::string hlsl_src = translate_type(fn_type->return_type) + " " + d->get_text() + "(";
+    for (size_t i = 0; i < d->parameters.size(); ++i) {
+        const auto &p = d->parameters[i];
+        hlsl_src += translate_modifiers(p->get_type()->modifiers) +
+                    translate_type(p->get_type()) + " " + p->get_text();
+        if (i + 1 < d->parameters.size()) {
+            hlsl_src += ", ";
+        }
+    }
+    hlsl_src += ")\n";
+
+    hlsl_src += std::any_cast<std::string>(visit(d->block));
     return hlsl_src;
 }
 
@@ -37,7 +99,9 @@ std::any OutputVisitor::visit_decl_entry_point(const std::shared_ptr<ast::decl::
     // Translate the entry point's parameters into shader input parameters for HLSL
     std::string hlsl_src;
     for (auto &p : d->parameters) {
-        hlsl_src += bind_parameter(p) + "\n";
+        if (is_shader_record_parameter(d, p)) {
+            hlsl_src += parameter_declaration(p) + "\n";
+        }
     }
 
     // Emit the entry point declaration, then translate the entry point function body
@@ -71,15 +135,32 @@ std::any OutputVisitor::visit_decl_entry_point(const std::shared_ptr<ast::decl::
             "TODO WILL: Compute shaders need to take & translate num threads annotation");
     }
 
-    // Emit the declaration
-    hlsl_src += "void " + d->get_text() + "()\n";
+    // Emit the declaration, the ray payload and hit attributes are passed to the entry point
+    // by the runtime instead of through the shader record
+    std::vector<std::string> stage_params;
+    auto payload = payload_parameter(d);
+    if (payload) {
+        stage_params.push_back("inout " + payload->get_type()->to_string() + " " +
+                               payload->get_text());
+    }
+    auto attributes = hit_attribute_parameter(d);
+    if (attributes) {
+        stage_params.push_back("in " + attributes->get_type()->to_string() + " " +
+                               attributes->get_text());
+    }
+    hlsl_src += "void " + d->get_text() + "(";
+    for (size_t i = 0; i < stage_params.size(); ++i) {
+        hlsl_src += (i > 0 ? ", " : "") + stage_params[i];
+    }
+    hlsl_src += ")\n";
 
     // Map the parameter bindings for any structs back to make the struct the user's code is
     // working with
     // TODO: I think these should get optimized out to the same code by DXC?
     hlsl_src += "{\n";
     for (auto &p : d->parameters) {
-        if (p->get_type()->base_type == ty::BaseType::STRUCT) {
+        if (p->get_type()->base_type == ty::BaseType::STRUCT &&
+            is_shader_record_parameter(d, p)) {
             auto struct_ty = std::dynamic_pointer_cast<ty::Struct>(p->get_type());
             // Output variable declaration
             hlsl_src += p->get_type()->to_string() + " " + p->get_text() + ";\n";
@@ -107,24 +188,50 @@ std::any OutputVisitor::visit_decl_global_param(
         report_error(d->get_token(), "Error: Global parameters should not be struct types!");
         return std::string();
     }
-    std::string hlsl_src = bind_parameter(d);
+    std::string hlsl_src = parameter_declaration(d);
     return hlsl_src;
 }
 
 std::any OutputVisitor::visit_decl_struct(const std::shared_ptr<ast::decl::Struct> &d)
 {
-    std::string hlsl_src = "struct " + d->get_text() + " {\n";
+    struct_payload_fields = nullptr;
+    if (payload_fields) {
+        auto fnd = payload_fields->payloads.find(d);
+        if (fnd != payload_fields->payloads.end()) {
+            struct_payload_fields = &fnd->second;
+        }
+    }
+
+    const std::string payload_attribute = struct_payload_fields ? "[raypayload] " : "";
+    std::string hlsl_src = "struct " + payload_attribute + d->get_text() + " {\n";
     for (auto &m : d->members) {
         hlsl_src += std::any_cast<std::string>(visit(m)) + "\n";
     }
     hlsl_src += "};\n";
+    struct_payload_fields = nullptr;
     return hlsl_src;
 }
 
 std::any OutputVisitor::visit_decl_struct_member(
     const std::shared_ptr<ast::decl::StructMember> &d)
 {
-    return translate_type(d->get_type()) + " " + d->get_text() + ";";
+    std::string hlsl_src = translate_type(d->get_type()) + " " + d->get_text();
+    // Payload fields list the stages reading and writing them, e.g.
+    // float3 color : read(caller) : write(closesthit, miss);
+    if (struct_payload_fields) {
+        std::string read;
+        std::string write;
+        for (const auto &s : struct_payload_fields->stages) {
+            if (s.second.read.contains(d->get_text())) {
+                read += (read.empty() ? "" : ", ") + to_string(s.first);
+            }
+            if (s.second.written.contains(d->get_text())) {
+                write += (write.empty() ? "" : ", ") + to_string(s.first);
+            }
+        }
+        hlsl_src += " : read(" + read + ") : write(" + write + ")";
+    }
+    return hlsl_src + ";";
 }
 
 std::any OutputVisitor::visit_decl_variable(const std::shared_ptr<ast::decl::Variable> &d)
@@ -147,28 +254,84 @@ std::any OutputVisitor::visit_stmt_block(const std::shared_ptr<ast::stmt::Block>
     return hlsl_src;
 }
 
-std::any OutputVisitor::visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s)
+/* Get the HLSL attributes passing the branch and loop hints on the statement through to the
+ * HLSL compiler: [branch] and [flatten] on if statements, and [unroll(N)], [loop] and
+ * [allow_uav_condition] on loops. [unroll] is removed from the loops unrolled by the
+ * compiler, so it's only passed through on loops the loop unrolling pass didn't unroll
+ */
+std::string statement_hints(const std::shared_ptr<ast::stmt::Statement> &s)
 {
+    static const std::set<std::string> hints = {
+        "branch", "flatten", "unroll", "loop", "allow_uav_condition"};
     std::string hlsl_src;
+    for (const auto &a : s->attributes) {
+        if (!hints.contains(a->name)) {
+            continue;
+        }
+        hlsl_src += "[" + a->name;
+        if (!a->args.empty()) {
+            hlsl_src += "(" + a->args[0] + ")";
+        }
+        hlsl_src += "]\n";
+    }
+    return hlsl_src;
+}
+
+std::any OutputVisitor::visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s)
+{
+    std::string hlsl_src = statement_hints(s);
+    hlsl_src += "if (" + std::any_cast<std::string>(visit(s->condition)) + ")\n";
+    hlsl_src += std::any_cast<std::string>(visit(s->if_branch));
+    if (s->else_branch) {
+        hlsl_src += "\nelse\n" + std::any_cast<std::string>(visit(s->else_branch));
+    }
     return hlsl_src;
 }
 
 std::any OutputVisitor::visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s)
 {
-    std::string hlsl_src;
+    std::string hlsl_src = statement_hints(s);
+    hlsl_src += "while (" + std::any_cast<std::string>(visit(s->condition)) + ")\n";
+    if (s->body) {
+        hlsl_src += std::any_cast<std::string>(visit(s->body));
+    } else {
+        hlsl_src += ";";
+    }
     return hlsl_src;
 }
 
 std::any OutputVisitor::visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s)
 {
-    std::string hlsl_src;
+    // The init statement's output includes its trailing semicolon
+    std::string hlsl_src = statement_hints(s) + "for (";
+    if (s->init) {
+        hlsl_src += std::any_cast<std::string>(visit(s->init));
+    } else {
+        hlsl_src += ";";
+    }
+    hlsl_src += " ";
+    if (s->condition) {
+        hlsl_src += std::any_cast<std::string>(visit(s->condition));
+    }
+    hlsl_src += "; ";
+    if (s->advance) {
+        hlsl_src += std::any_cast<std::string>(visit(s->advance));
+    }
+    hlsl_src += ")\n";
+    if (s->body) {
+        hlsl_src += std::any_cast<std::string>(visit(s->body));
+    } else {
+        hlsl_src += ";";
+    }
     return hlsl_src;
 }
 
 std::any OutputVisitor::visit_stmt_return(const std::shared_ptr<ast::stmt::Return> &s)
 {
-    std::string hlsl_src;
-    return hlsl_src;
+    if (s->expression) {
+        return "return " + std::any_cast<std::string>(visit(s->expression)) + ";";
+    }
+    return std::string("return;");
 }
 
 std::any OutputVisitor::visit_stmt_variable_declaration(
@@ -176,10 +339,13 @@ std::any OutputVisitor::visit_stmt_variable_declaration(
 {
     std::string hlsl_src;
     auto var_decl = s->var_decl;
+    if (var_decl->get_type()->modifiers.contains(ty::Modifier::PRECISE)) {
+        hlsl_src = "precise ";
+    }
     if (var_decl->get_type()->base_type != ty::BaseType::STRUCT) {
-        hlsl_src = translate_builtin_type(var_decl->get_type());
+        hlsl_src += translate_builtin_type(var_decl->get_type());
     } else {
-        hlsl_src = var_decl->get_type()->to_string();
+        hlsl_src += var_decl->get_type()->to_string();
     }
     hlsl_src += " " + var_decl->get_text();
     if (var_decl->expression) {
@@ -197,14 +363,27 @@ std::any OutputVisitor::visit_stmt_expression(const std::shared_ptr<ast::stmt::E
 
 std::any OutputVisitor::visit_expr_unary(const std::shared_ptr<ast::expr::Unary> &e)
 {
-    const std::string operand = std::any_cast<std::string>(visit(e->expr));
+    std::string operand = std::any_cast<std::string>(visit(e->expr));
+    if (std::dynamic_pointer_cast<expr::Binary>(e->expr)) {
+        operand = "(" + operand + ")";
+    }
     return e->operator_string() + operand;
 }
 
 std::any OutputVisitor::visit_expr_binary(const std::shared_ptr<ast::expr::Binary> &e)
 {
-    const std::string lhs = std::any_cast<std::string>(visit(e->left));
-    const std::string rhs = std::any_cast<std::string>(visit(e->right));
+    // The AST doesn't keep the parentheses from the source, so they're added back where
+    // needed to preserve the grouping of the expression. Binary operators are left
+    // associative, so the right operand also needs them at the same precedence
+    const int precedence = binary_operator_precedence(e->get_node_type());
+    std::string lhs = std::any_cast<std::string>(visit(e->left));
+    if (binary_operator_precedence(e->left->get_node_type()) > precedence) {
+        lhs = "(" + lhs + ")";
+    }
+    std::string rhs = std::any_cast<std::string>(visit(e->right));
+    if (binary_operator_precedence(e->right->get_node_type()) >= precedence) {
+        rhs = "(" + rhs + ")";
+    }
     return lhs + " " + e->operator_string() + " " + rhs;
 }
 
@@ -223,9 +402,17 @@ std::any OutputVisitor::visit_expr_constant(const std::shared_ptr<ast::expr::Con
     case ty::PrimitiveType::INT:
         hlsl_src = std::to_string(std::any_cast<int>(e->value));
         break;
-    case ty::PrimitiveType::FLOAT:
-        hlsl_src = std::to_string(std::any_cast<float>(e->value));
+    case ty::PrimitiveType::FLOAT: {
+        // Print enough digits to round trip the value, std::to_string only prints 6 decimal
+        // places which loses small values like reciprocals introduced by fast math
+        char buf[32] = {0};
+        std::snprintf(buf, sizeof(buf), "%.9g", std::any_cast<float>(e->value));
+        hlsl_src = buf;
+        if (hlsl_src.find_first_of(".e") == std::string::npos) {
+            hlsl_src += ".0";
+        }
         break;
+    }
     default:
         report_error(e->get_token(),
                      "HLSL Output error: Unhandled/unrecognized constant type: " +
@@ -241,15 +428,22 @@ std::any OutputVisitor::visit_expr_function_call(
     std::string hlsl_src;
     auto callee = resolver_result->call_expr[e];
 
+    auto args = std::any_cast<std::vector<std::any>>(visit_children(e));
     // Translate calls to built-ins to the appropriate built in HLSL function
     if (callee->is_builtin()) {
-        hlsl_src = translate_builtin_function_call(e.get(), callee.get());
+        std::vector<std::string> arg_srcs;
+        for (const auto &a : args) {
+            arg_srcs.push_back(std::any_cast<std::string>(a));
+        }
+        hlsl_src = translate_builtin_function_call(e.get(), callee.get(), arg_srcs);
+        if (!builtin_helper_function(callee->get_text()).empty()) {
+            helper_builtins.insert(callee->get_text());
+        }
         if (hlsl_src.empty()) {
             report_error(e->get_token(), "Unhandled built-in call!");
         }
     } else {
         hlsl_src += e->get_text() + "(";
-        auto args = std::any_cast<std::vector<std::any>>(visit_children(e));
         for (size_t i = 0; i < args.size(); ++i) {
             hlsl_src += std::any_cast<std::string>(args[i]);
             if (i + 1 < args.size()) {
@@ -261,10 +455,58 @@ std::any OutputVisitor::visit_expr_function_call(
     return hlsl_src;
 }
 
+/* Get the HLSL loading the element from the ByteAddressBuffer and converting it to the
+ * buffer's element type, which is a 3 component 32-bit vector or a quantized format. The
+ * quantized formats are decoded by helper functions, oct32 and unorm16_2 elements are 4 bytes
+ * and snorm16_3 elements are 6 bytes, following the 24 byte header holding the float3 scale
+ * and bias of the positions
+ */
+std::string byte_address_load(const std::shared_ptr<ty::Buffer> &buffer,
+                              const std::string &buffer_src,
+                              const std::string &index)
+{
+    auto quantized = std::dynamic_pointer_cast<ty::Quantized>(buffer->template_parameters[0]);
+    if (quantized) {
+        switch (quantized->format) {
+        case ty::QuantizedFormat::OCT32:
+            return "crtl_unpack_octahedral(" + buffer_src + ".Load((" + index + ") * 4))";
+        case ty::QuantizedFormat::UNORM16_2:
+            return "crtl_decode_unorm16_2(" + buffer_src + ".Load((" + index + ") * 4))";
+        case ty::QuantizedFormat::SNORM16_3:
+            return "crtl_decode_snorm16_3(" + buffer_src + ", " + index + ")";
+        }
+    }
+    auto vector = std::dynamic_pointer_cast<ty::Vector>(buffer->template_parameters[0]);
+    const std::string load = buffer_src + ".Load3((" + index + ") * 12)";
+    switch (vector->element_type->type_id) {
+    case ty::PrimitiveType::INT:
+        return "asint(" + load + ")";
+    case ty::PrimitiveType::FLOAT:
+        return "asfloat(" + load + ")";
+    default:
+        return load;
+    }
+}
+
+// Get the helper function decoding elements of the quantized format
+std::string quantized_decode_helper(const ty::QuantizedFormat format)
+{
+    switch (format) {
+    case ty::QuantizedFormat::OCT32:
+        return "unpack_octahedral";
+    case ty::QuantizedFormat::UNORM16_2:
+        return "decode_unorm16_2";
+    default:
+        return "decode_snorm16_3";
+    }
+}
+
 std::any OutputVisitor::visit_struct_array_access(
     const std::shared_ptr<ast::expr::StructArrayAccess> &e)
 {
     std::string hlsl_src = e->variable->name();
+    // The type accessed so far, to find the buffers translated to ByteAddressBuffers
+    auto access_type = infer_expression_type(e->variable, *resolver_result);
     for (auto &f : e->struct_array_access) {
         auto member_access = std::dynamic_pointer_cast<expr::StructMemberAccessFragment>(f);
         if (member_access) {
@@ -274,7 +516,20 @@ std::any OutputVisitor::visit_struct_array_access(
         } else {
             auto array_access = std::dynamic_pointer_cast<expr::ArrayAccessFragment>(f);
             const std::string idx = std::any_cast<std::string>(visit(array_access->index));
-            hlsl_src += "[" + idx + "]";
+            auto buffer = std::dynamic_pointer_cast<ty::Buffer>(access_type);
+            if (buffer && buffer_layout(buffer) == BufferLayout::BYTE_ADDRESS) {
+                hlsl_src = byte_address_load(buffer, hlsl_src, idx);
+                auto quantized =
+                    std::dynamic_pointer_cast<ty::Quantized>(buffer->template_parameters[0]);
+                if (quantized) {
+                    helper_builtins.insert(quantized_decode_helper(quantized->format));
+                }
+            } else {
+                hlsl_src += "[" + idx + "]";
+            }
+        }
+        if (access_type) {
+            access_type = struct_array_access_type(access_type, {f}, *resolver_result);
         }
     }
     return hlsl_src;
@@ -287,65 +542,33 @@ std::any OutputVisitor::visit_expr_assignment(const std::shared_ptr<ast::expr::A
     return lhs + " = " + value;
 }
 
-std::string OutputVisitor::bind_parameter(const std::shared_ptr<ast::decl::Variable> &param)
+std::string OutputVisitor::parameter_declaration(
+    const std::shared_ptr<ast::decl::Variable> &param)
 {
+    auto fnd = parameter_bindings.find(param);
+    if (fnd == parameter_bindings.end()) {
+        report_error(param->get_token(),
+                     "Error: No register binding for parameter '" + param->get_text() + "'");
+        return "";
+    }
+
     std::string hlsl_src;
     const auto param_type = param->get_type();
     if (!param_type->is_builtin()) {
         const auto struct_decl =
             resolver_result->struct_type[dynamic_cast<ty::Struct *>(param_type.get())];
-        if (!struct_decl) {
-            report_error(param->get_token(),
-                         "Error: Failed to find resolved struct decl for struct var decl");
-            return "";
-        }
-
-        auto binding = std::make_shared<StructRegisterBinding>();
+        auto binding = std::dynamic_pointer_cast<StructRegisterBinding>(fnd->second);
         const std::string struct_name = param->get_text();
-        for (const auto &m : struct_decl->members) {
-            // Primitive/Vector/Matrix types get packed into a constant buffer
-            const auto member_ty = m->get_type();
-            const std::string &name = m->get_text();
-            if (member_ty->base_type == ty::BaseType::PRIMITIVE ||
-                member_ty->base_type == ty::BaseType::VECTOR ||
-                member_ty->base_type == ty::BaseType::MATRIX) {
-                binding->constant_buffer_contents.push_back(name);
-            } else if (member_ty->base_type == ty::BaseType::STRUCT) {
-                // If we have another struct type member we need to expand it out to flatten
-                // the structs down
-                // TODO: Maybe this is best done as a pre-pass on the AST that does this
-                // flattening of the types, then we don't need to worry about it at this point
-                report_error(param->get_token(),
-                             "TODO Will: Nested structs in global/entry point param");
-            } else {
-                binding->members[name] = bind_builtin_type_parameter(member_ty);
-            }
-        }
-        if (!binding->constant_buffer_contents.empty()) {
-            binding->constant_buffer_register = register_allocator.bind_cbv(1);
-        }
-        parameter_bindings[param] = binding;
 
-        std::string cbuffer_src;
-        if (!binding->constant_buffer_contents.empty()) {
-            cbuffer_src = "cbuffer " + struct_name + "_cbv : " +
-                          binding->constant_buffer_register.shader_register.to_string() +
-                          "{\n";
-        }
         for (const auto &m : struct_decl->members) {
             const auto member_ty = m->get_type();
             const std::string &name = m->get_text();
 
             const std::string type_str = translate_builtin_type(member_ty);
-            if (member_ty->base_type == ty::BaseType::PRIMITIVE ||
-                member_ty->base_type == ty::BaseType::VECTOR ||
-                member_ty->base_type == ty::BaseType::MATRIX) {
-                // Rename the cbuffer members to StructParamName_MemberName
-                // TODO: This should be based on a slightly different naming, maybe do a
-                // pre-pass renaming the structs for entry points to avoid name collisions
-                cbuffer_src += "\t" + type_str + " " + struct_name + "_" + name + ";\n";
-
-            } else if (member_ty->base_type != ty::BaseType::STRUCT) {
+            if (member_ty->base_type != ty::BaseType::PRIMITIVE &&
+                member_ty->base_type != ty::BaseType::VECTOR &&
+                member_ty->base_type != ty::BaseType::MATRIX &&
+                member_ty->base_type != ty::BaseType::STRUCT) {
                 const auto reg = binding->members[name];
                 // Rename the members to StructParamName_MemberName
                 // TODO: This should be based on a slightly different naming, maybe do a
@@ -355,30 +578,30 @@ std::string OutputVisitor::bind_parameter(const std::shared_ptr<ast::decl::Varia
             }
         }
 
-        // Generate the constant buffer, if we have one
-        if (!cbuffer_src.empty()) {
-            cbuffer_src += "}\n";
-            hlsl_src += cbuffer_src;
+        // Generate the constant buffer and the spill buffer, if we have them
+        if (!binding->constant_buffer_contents.empty()) {
+            hlsl_src += constant_buffer_declaration(struct_name + "_cbv",
+                                                    struct_name,
+                                                    struct_decl,
+                                                    binding->constant_buffer_register,
+                                                    binding->constant_buffer_contents);
+        }
+        if (!binding->spill_buffer_contents.empty()) {
+            hlsl_src += constant_buffer_declaration(struct_name + "_spill_cbv",
+                                                    struct_name,
+                                                    struct_decl,
+                                                    binding->spill_buffer_register,
+                                                    binding->spill_buffer_contents);
         }
     } else if (param_type->base_type == ty::BaseType::BUFFER ||
                param_type->base_type == ty::BaseType::TEXTURE ||
                param_type->base_type == ty::BaseType::ACCELERATION_STRUCTURE) {
-        auto binding =
-            std::make_shared<ShaderRegisterBinding>(bind_builtin_type_parameter(param_type));
-        parameter_bindings[param] = binding;
-
+        auto binding = std::dynamic_pointer_cast<ShaderRegisterBinding>(fnd->second);
         const std::string type_str = translate_builtin_type(param->get_type());
         hlsl_src = type_str + " " + param->get_text() + " : " +
                    binding->shader_register.to_string() + ";";
     } else {
-        // TODO: This can be better: if we have a lot of individual constant args to an entry
-        // point or as a global, we generate a CBV for each one. We could pack them into a
-        // single CBV instead. They could be made to view the same buffer at different
-        // offsets, but it'd be best to pack them all together into a single CBV
-        auto binding =
-            std::make_shared<ShaderRegisterBinding>(bind_builtin_type_parameter(param_type));
-        parameter_bindings[param] = binding;
-
+        auto binding = std::dynamic_pointer_cast<ShaderRegisterBinding>(fnd->second);
         const std::string type_str = translate_builtin_type(param->get_type());
         hlsl_src = "cbuffer " + param->get_text() +
                    "_cbv : " + binding->shader_register.to_string() + " {\n\t" + type_str +
@@ -387,40 +610,30 @@ std::string OutputVisitor::bind_parameter(const std::shared_ptr<ast::decl::Varia
     return hlsl_src;
 }
 
-ShaderRegisterBinding OutputVisitor::bind_builtin_type_parameter(
-    const std::shared_ptr<ast::ty::Type> &type)
+std::string OutputVisitor::constant_buffer_declaration(
+    const std::string &cbuffer_name,
+    const std::string &param_name,
+    const std::shared_ptr<ast::decl::Struct> &decl,
+    const ShaderRegisterBinding &binding,
+    const std::vector<ConstantBufferMember> &contents)
 {
-    // TODO: Need to add array (and unsized) declaration support for array and unsized array
-    // params
-    if (type->base_type == ty::BaseType::PRIMITIVE ||
-        type->base_type == ty::BaseType::VECTOR || type->base_type == ty::BaseType::MATRIX) {
-        return register_allocator.bind_cbv(1);
-    } else if (type->base_type == ty::BaseType::BUFFER) {
-        // Buffer is SRV
-        // RWBuffer is UAV
-        const auto buf_ty = std::dynamic_pointer_cast<ty::Buffer>(type);
-        if (buf_ty->access == ty::Access::READ_ONLY) {
-            return register_allocator.bind_srv(1);
-        } else {
-            return register_allocator.bind_uav(1);
-        }
-    } else if (type->base_type == ty::BaseType::TEXTURE) {
-        // Texture is SRV + needs a sampler
-        // TODO: Samplers should be added to the built in types
-        // RWTexture is UAV
-        const auto tex_ty = std::dynamic_pointer_cast<ty::Texture>(type);
-        if (tex_ty->access == ty::Access::READ_ONLY) {
-            return register_allocator.bind_srv(1);
-        } else {
-            return register_allocator.bind_uav(1);
-        }
-    } else if (type->base_type == ty::BaseType::ACCELERATION_STRUCTURE) {
-        // AccelerationStructure is SRV
-        return register_allocator.bind_srv(1);
-    } else {
-        throw std::runtime_error("Unsupported parameter type: '" + type->to_string() + "'");
+    std::string cbuffer_src =
+        "cbuffer " + cbuffer_name + " : " + binding.shader_register.to_string() + "{\n";
+    // The constant buffer members are reordered by the register allocation, so each
+    // member is placed at its computed offset to keep the layout in sync with the
+    // metadata
+    for (const auto &cm : contents) {
+        const std::string type_str =
+            translate_builtin_type(decl->get_member(cm.name)->get_type());
+        const uint32_t reg = cm.offset / CONSTANT_REGISTER_SIZE;
+        const std::string component(1, "xyzw"[cm.offset % CONSTANT_REGISTER_SIZE / 4]);
+        // Rename the cbuffer members to StructParamName_MemberName
+        // TODO: This should be based on a slightly different naming, maybe do a
+        // pre-pass renaming the structs for entry points to avoid name collisions
+        cbuffer_src += "\t" + type_str + " " + param_name + "_" + cm.name +
+                       " : packoffset(c" + std::to_string(reg) + "." + component + ");\n";
     }
-    return ShaderRegisterBinding();
+    return cbuffer_src + "}\n";
 }
 }
 }
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <set>
 #include "ast/visitor.h"
+#include "payload_field_analysis.h"
 #include "resolver_visitor.h"
 #include "shader_register_allocator.h"
 
@@ -12,15 +14,31 @@ namespace hlsl {
 class OutputVisitor : public ast::Visitor {
     std::shared_ptr<ResolverPassResult> resolver_result;
 
-    ShaderRegisterAllocator register_allocator;
-
-public:
     // Map of global and entry point parameter names to their register binding information
     phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>,
                                   std::shared_ptr<ParameterRegisterBinding>>
         parameter_bindings;
 
-    OutputVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result);
+    // The builtins called by the shader which are implemented by HLSL helper functions
+    std::set<std::string> helper_builtins;
+
+    // The payload field accesses used to declare the payloads' access qualifiers, if enabled
+    std::shared_ptr<PayloadFieldAnalysis> payload_fields;
+
+    // The fields accessed by the stages using the payload struct being declared, if any
+    const PayloadFields *struct_payload_fields = nullptr;
+
+public:
+    /* Create the visitor to translate the program using the parameter bindings computed by
+     * the RegisterAllocationAnalysis. If the payload field accesses are passed the payload
+     * structs are declared with payload access qualifiers
+     */
+    OutputVisitor(
+        const std::shared_ptr<ResolverPassResult> &resolver_result,
+        const phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>,
+                                            std::shared_ptr<ParameterRegisterBinding>>
+            &param_bindings,
+        const std::shared_ptr<PayloadFieldAnalysis> &payload_fields = nullptr);
 
     // NOTE: Most statements don't need any rewriting but we do still need to visit
     // everything to build the HLSL source code
@@ -62,16 +80,17 @@ public:
     std::any visit_expr_assignment(const std::shared_ptr<ast::expr::Assignment> &e) override;
 
 private:
-    /* Bind the passed global or entry point parameter to registers and return the HLSL source
-     * for the binding. The ParameterRegisterBinding metadata will be stored in the
-     * parameter_binding map
-     */
-    std::string bind_parameter(const std::shared_ptr<ast::decl::Variable> &param);
+    // Get the HLSL source declaring the global or entry point parameter at its binding
+    std::string parameter_declaration(const std::shared_ptr<ast::decl::Variable> &param);
 
-    /* Bind the passed built in parameter type (i.e. not a struct) to a shader register.
+    /* Get the HLSL source declaring a constant buffer holding the struct parameter's members,
+     * with each member placed at the offset it was assigned by the register allocation
      */
-    ShaderRegisterBinding bind_builtin_type_parameter(
-        const std::shared_ptr<ast::ty::Type> &type);
+    std::string constant_buffer_declaration(const std::string &cbuffer_name,
+                                            const std::string &param_name,
+                                            const std::shared_ptr<ast::decl::Struct> &decl,
+                                            const ShaderRegisterBinding &binding,
+                                            const std::vector<ConstantBufferMember> &contents);
 };
 }
 }
@@ -1,4 +1,8 @@
 #include "parameter_metadata_output_visitor.h"
+#include <algorithm>
+#include "ast_utils.h"
+#include "translate_builtin_type.h"
+#include "type_layout.h"
 
 namespace crtl {
 namespace hlsl {
@@ -10,10 +14,14 @@ ParameterMetadataOutputVisitor::ParameterMetadataOutputVisitor(
     const std::shared_ptr<ParameterTransforms> &param_transforms,
     const phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>,
                                         std::shared_ptr<ParameterRegisterBinding>>
-        &param_bindings)
+        &param_bindings,
+    const std::shared_ptr<RayPayloadAnalysis> &ray_payloads,
+    const std::shared_ptr<PayloadFieldAnalysis> &payload_fields)
     : resolver_result(resolver_result),
       param_transforms(param_transforms),
-      parameter_bindings(param_bindings)
+      parameter_bindings(param_bindings),
+      ray_payloads(ray_payloads),
+      payload_fields(payload_fields)
 {
 }
 
@@ -47,6 +55,43 @@ std::any ParameterMetadataOutputVisitor::visit_ast(const std::shared_ptr<ast::AS
         param_metadata["expanded_globals"][eg.first->get_text()] = expanded_global_json;
     }
 
+    /* The [soa] global params are output as a global param per field for their binding info,
+     * here we record the fields of the struct split into each of them
+     */
+    for (const auto &sb : param_transforms->soa_buffers.global_params) {
+        param_metadata["soa_buffers"][sb.first] = soa_buffer_json(sb.second);
+    }
+
+    param_metadata["max_payload_size"] = max_payload_size;
+    param_metadata["max_attribute_size"] = max_attribute_size;
+
+    /* Record the payload fields used by each stage, and for each ray type the fields used and
+     * their size, so the runtime can size the payload for each ray type. The field sets are
+     * only complete if the payload is traced in the library
+     */
+    for (const auto &p : ray_payloads->payloads) {
+        const auto &fields = payload_fields->payloads[p];
+        nlohmann::json payload_json;
+        payload_json["traced"] = fields.traced;
+        payload_json["stages"] = stage_fields_json(fields.stages);
+        for (const auto &r : fields.ray_types) {
+            std::set<std::string> used;
+            for (const auto &s : r.second) {
+                used.insert(s.second.read.begin(), s.second.read.end());
+                used.insert(s.second.written.begin(), s.second.written.end());
+            }
+            const auto layout = scalar_layout(p, *resolver_result, &used);
+            nlohmann::json ray_type_json;
+            ray_type_json["size"] = layout ? layout->size : 0;
+            ray_type_json["stages"] = stage_fields_json(r.second);
+            const std::string ray_type = r.first == PayloadFieldAnalysis::ANY_RAY_TYPE
+                                             ? "any"
+                                             : std::to_string(r.first);
+            payload_json["ray_types"][ray_type] = ray_type_json;
+        }
+        param_metadata["payloads"][p->get_text()] = payload_json;
+    }
+
     return param_metadata;
 }
 
@@ -58,7 +103,42 @@ std::any ParameterMetadataOutputVisitor::visit_decl_entry_point(
     metadata["name"] = d->get_text();
     metadata["type"] = ty::to_string(type->entry_point_type);
 
+    // Record the payloads traced and received by the entry point and its hit attributes, the
+    // pipeline's payload size must fit all payloads used by its entry points
+    uint32_t payload_size = 0;
+    uint32_t attribute_size = 0;
+    const auto &payloads = ray_payloads->entry_points[d];
+    for (const auto &p : payloads.traced_payloads) {
+        nlohmann::json payload_json;
+        payload_size = std::max(payload_size, stage_struct_size(p, payload_json));
+        metadata["traced_payloads"].push_back(payload_json);
+    }
+    if (payloads.received_payload) {
+        payload_size = std::max(
+            payload_size, stage_struct_size(payloads.received_payload, metadata["payload"]));
+        const auto &fields = payload_fields->entry_points[d];
+        metadata["payload"]["read"] = fields.read;
+        metadata["payload"]["written"] = fields.written;
+    }
+    if (payloads.hit_attributes) {
+        attribute_size =
+            stage_struct_size(payloads.hit_attributes, metadata["hit_attributes"]);
+        if (attribute_size > MAX_ATTRIBUTE_SIZE) {
+            report_error(hit_attribute_parameter(d)->get_token(),
+                         "The hit attributes of '" + d->get_text() + "' are " +
+                             std::to_string(attribute_size) + " bytes, larger than the " +
+                             std::to_string(MAX_ATTRIBUTE_SIZE) + " bytes supported");
+        }
+    }
+    metadata["max_payload_size"] = payload_size;
+    metadata["max_attribute_size"] = attribute_size;
+    max_payload_size = std::max(max_payload_size, payload_size);
+    max_attribute_size = std::max(max_attribute_size, attribute_size);
+
     for (const auto &p : d->parameters) {
+        if (!is_shader_record_parameter(d, p)) {
+            continue;
+        }
         nlohmann::json param_json;
         const std::string source_name = param_transforms->renamed_vars[p];
         param_json["source_name"] = source_name;
@@ -76,6 +156,7 @@ std::any ParameterMetadataOutputVisitor::visit_decl_entry_point(
             param_json["slot"] = reg_binding->shader_register.slot;
             param_json["register_type"] = hlsl::to_string(reg_binding->shader_register.type);
             param_json["count"] = reg_binding->count;
+            buffer_layout_json(p->get_type(), param_json);
         } else {
             auto struct_ty = std::dynamic_pointer_cast<ty::Struct>(p->get_type());
             auto struct_decl = resolver_result->struct_type[struct_ty];
@@ -89,30 +170,35 @@ std::any ParameterMetadataOutputVisitor::visit_decl_entry_point(
                 member_json["count"] = m.second.count;
                 member_json["type"] =
                     struct_decl->get_member(m.first)->get_type()->to_string();
+                buffer_layout_json(struct_decl->get_member(m.first)->get_type(), member_json);
 
                 param_json["members"][m.first] = member_json;
             }
 
-            // Record the constant buffer contents
+            // Record the constant buffer contents, and the contents of the spill buffer
+            // holding the constants moved out of the shader record
             if (!struct_binding->constant_buffer_contents.empty()) {
-                param_json["constant_buffer"]["space"] =
-                    struct_binding->constant_buffer_register.shader_register.space;
-                param_json["constant_buffer"]["slot"] =
-                    struct_binding->constant_buffer_register.shader_register.slot;
-                param_json["constant_buffer"]["register_type"] = hlsl::to_string(
-                    struct_binding->constant_buffer_register.shader_register.type);
-
-                std::vector<nlohmann::json> constant_buf_content;
-                for (const auto &cm : struct_binding->constant_buffer_contents) {
-                    nlohmann::json constant_member;
-                    const auto m = struct_decl->get_member(cm);
-
-                    constant_member["name"] = cm;
-                    constant_member["type"] = m->get_type()->to_string();
-                    constant_buf_content.push_back(constant_member);
-                }
+                param_json["constant_buffer"] =
+                    constant_buffer_json(struct_decl,
+                                         struct_binding->constant_buffer_register,
+                                         struct_binding->constant_buffer_contents,
+                                         struct_binding->constant_buffer_size);
+            }
+            if (!struct_binding->spill_buffer_contents.empty()) {
+                param_json["spill_buffer"] =
+                    constant_buffer_json(struct_decl,
+                                         struct_binding->spill_buffer_register,
+                                         struct_binding->spill_buffer_contents,
+                                         struct_binding->spill_buffer_size);
+            }
 
-                param_json["constant_buffer"]["contents"] = constant_buf_content;
+            // Record the [soa] buffer members split into a member per field, so the runtime
+            // can scatter the array of structs set for the member into the field buffers
+            auto soa_members = param_transforms->soa_buffers.struct_members.find(struct_decl);
+            if (soa_members != param_transforms->soa_buffers.struct_members.end()) {
+                for (const auto &m : soa_members->second) {
+                    param_json["soa_buffers"][m.first] = soa_buffer_json(m.second);
+                }
             }
         }
 
@@ -134,9 +220,146 @@ std::any ParameterMetadataOutputVisitor::visit_decl_global_param(
     metadata["register_type"] = hlsl::to_string(reg_binding->shader_register.type);
     metadata["count"] = reg_binding->count;
     metadata["type"] = d->get_type()->to_string();
+    buffer_layout_json(d->get_type(), metadata);
 
     return metadata;
 }
 
+uint32_t ParameterMetadataOutputVisitor::stage_struct_size(
+    const std::shared_ptr<ast::decl::Struct> &decl, nlohmann::json &json)
+{
+    const auto layout = scalar_layout(decl, *resolver_result);
+    if (!layout) {
+        report_error(decl->get_token(),
+                     "Struct '" + decl->get_text() +
+                         "' is passed between shader stages and can only contain primitive, "
+                         "vector, matrix and struct members");
+    }
+    const uint32_t size = layout ? layout->size : 0;
+    json["type"] = decl->get_text();
+    json["size"] = size;
+    return size;
+}
+
+void ParameterMetadataOutputVisitor::buffer_layout_json(
+    const std::shared_ptr<ty::Type> &type, nlohmann::json &json)
+{
+    auto buffer = std::dynamic_pointer_cast<ty::Buffer>(type);
+    if (!buffer) {
+        return;
+    }
+    json["buffer_layout"] = to_string(buffer_layout(buffer));
+    const auto &element_type = buffer->template_parameters[0];
+    const auto element_layout = scalar_layout(element_type, *resolver_result);
+    if (element_layout) {
+        json["stride"] = element_layout->size;
+    }
+
+    // Buffers of structs also record the offset of each field, so the application can write
+    // its data with the same layout the shader reads it with
+    auto struct_ty = std::dynamic_pointer_cast<ty::Struct>(element_type);
+    if (!struct_ty) {
+        return;
+    }
+    auto fnd = resolver_result->struct_type.find(struct_ty);
+    if (fnd == resolver_result->struct_type.end()) {
+        return;
+    }
+    const auto &struct_decl = fnd->second;
+    if (!element_layout) {
+        report_error(struct_decl->get_token(),
+                     "Struct '" + struct_decl->get_text() +
+                         "' is stored in a buffer and can only contain primitive, vector, "
+                         "matrix and struct members");
+        return;
+    }
+    json["fields"] = struct_fields_json(struct_decl);
+}
+
+nlohmann::json ParameterMetadataOutputVisitor::struct_fields_json(
+    const std::shared_ptr<ast::decl::Struct> &decl) const
+{
+    std::vector<uint32_t> offsets;
+    scalar_layout(decl, *resolver_result, nullptr, &offsets);
+
+    auto fields = nlohmann::json::array();
+    for (size_t i = 0; i < decl->members.size(); ++i) {
+        const auto &m = decl->members[i];
+        nlohmann::json field_json;
+        field_json["name"] = m->get_text();
+        field_json["type"] = m->get_type()->to_string();
+        field_json["offset"] = offsets[i];
+
+        auto member_struct = std::dynamic_pointer_cast<ty::Struct>(m->get_type());
+        if (member_struct) {
+            field_json["fields"] =
+                struct_fields_json(resolver_result->struct_type[member_struct]);
+        }
+        fields.push_back(field_json);
+    }
+    return fields;
+}
+
+nlohmann::json ParameterMetadataOutputVisitor::soa_buffer_json(
+    const SoaBuffer &soa_buffer) const
+{
+    std::vector<uint32_t> offsets;
+    const auto layout =
+        scalar_layout(soa_buffer.element, *resolver_result, nullptr, &offsets);
+
+    nlohmann::json json;
+    json["type"] = "BUFFER<" + soa_buffer.element->get_text() + ">";
+    json["stride"] = layout ? layout->size : 0;
+    json["fields"] = nlohmann::json::array();
+    for (size_t i = 0; layout && i < soa_buffer.fields.size(); ++i) {
+        const auto &member = soa_buffer.element->members[i];
+        nlohmann::json field_json;
+        field_json["name"] = soa_buffer.fields[i].first;
+        field_json["parameter"] = soa_buffer.fields[i].second;
+        field_json["type"] = member->get_type()->to_string();
+        field_json["offset"] = offsets[i];
+        field_json["size"] = scalar_layout(member->get_type(), *resolver_result)->size;
+        json["fields"].push_back(field_json);
+    }
+    return json;
+}
+
+nlohmann::json ParameterMetadataOutputVisitor::constant_buffer_json(
+    const std::shared_ptr<ast::decl::Struct> &decl,
+    const ShaderRegisterBinding &binding,
+    const std::vector<ConstantBufferMember> &contents,
+    const uint32_t size) const
+{
+    nlohmann::json json;
+    json["space"] = binding.shader_register.space;
+    json["slot"] = binding.shader_register.slot;
+    json["register_type"] = hlsl::to_string(binding.shader_register.type);
+    json["size"] = size;
+
+    std::vector<nlohmann::json> constant_buf_content;
+    for (const auto &cm : contents) {
+        nlohmann::json constant_member;
+        const auto m = decl->get_member(cm.name);
+
+        constant_member["name"] = cm.name;
+        constant_member["type"] = m->get_type()->to_string();
+        constant_member["offset"] = cm.offset;
+        constant_buf_content.push_back(constant_member);
+    }
+    json["contents"] = constant_buf_content;
+    return json;
+}
+
+nlohmann::json ParameterMetadataOutputVisitor::stage_fields_json(
+    const std::map<PayloadStage, PayloadFieldAccesses> &stages) const
+{
+    nlohmann::json json;
+    for (const auto &s : stages) {
+        json[to_string(s.first)]["read"] = s.second.read;
+        json[to_string(s.first)]["written"] = s.second.written;
+    }
+    return json;
+}
+
 }
 }
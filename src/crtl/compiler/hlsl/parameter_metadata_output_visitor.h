@@ -3,6 +3,8 @@
 #include <memory>
 #include "ast/visitor.h"
 #include "parameter_transforms.h"
+#include "payload_field_analysis.h"
+#include "ray_payload_analysis.h"
 #include "resolver_visitor.h"
 #include "shader_register_allocator.h"
 
@@ -19,17 +21,31 @@ class ParameterMetadataOutputVisitor : public ast::Visitor {
                                   std::shared_ptr<ParameterRegisterBinding>>
         parameter_bindings;
 
+    std::shared_ptr<RayPayloadAnalysis> ray_payloads;
+
+    std::shared_ptr<PayloadFieldAnalysis> payload_fields;
+
+    // The largest ray payload and hit attributes used by the library
+    uint32_t max_payload_size = 0;
+    uint32_t max_attribute_size = 0;
+
 public:
     ParameterMetadataOutputVisitor(
         const std::shared_ptr<ResolverPassResult> &resolver_result,
         const std::shared_ptr<ParameterTransforms> &param_transforms,
         const phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>,
                                             std::shared_ptr<ParameterRegisterBinding>>
-            &param_bindings);
+            &param_bindings,
+        const std::shared_ptr<RayPayloadAnalysis> &ray_payloads,
+        const std::shared_ptr<PayloadFieldAnalysis> &payload_fields);
 
     /* Visit the AST and build the parameter binding metadata JSON info for use at runtime.
      * Returns the nlohmann::json containing the parameter binding information for use by the
-     * DXR runtime
+     * DXR runtime. The sizes of the ray payloads and hit attributes used by the entry points
+     * are recorded for the runtime to configure the pipeline with, it's an error for hit
+     * attributes to be larger than the 32 bytes supported by DXR. The payload fields read and
+     * written by each stage are recorded for each payload and ray type, along with the size
+     * of the fields used by each ray type
      */
     std::any visit_ast(const std::shared_ptr<ast::AST> &ast) override;
 
@@ -39,6 +55,40 @@ public:
     std::any visit_decl_entry_point(const std::shared_ptr<ast::decl::EntryPoint> &d) override;
     std::any visit_decl_global_param(
         const std::shared_ptr<ast::decl::GlobalParam> &d) override;
+
+private:
+    /* Get the size of the ray payload or hit attributes struct, and output its name and
+     * size to the JSON
+     */
+    uint32_t stage_struct_size(const std::shared_ptr<ast::decl::Struct> &decl,
+                               nlohmann::json &json);
+
+    // Output the fields read and written by the stages to the JSON
+    nlohmann::json stage_fields_json(
+        const std::map<PayloadStage, PayloadFieldAccesses> &stages) const;
+
+    /* Output the HLSL buffer type selected for the parameter and the stride of its elements
+     * to the JSON, if it's a buffer, so the runtime can check the buffer views bound to it.
+     * Buffers of structs also output the offsets of the struct's fields
+     */
+    void buffer_layout_json(const std::shared_ptr<ast::ty::Type> &type,
+                            nlohmann::json &json);
+
+    /* Get the name, type and scalar layout offset of each of the struct's fields, with the
+     * fields of nested structs listed under their member
+     */
+    nlohmann::json struct_fields_json(const std::shared_ptr<ast::decl::Struct> &decl) const;
+
+    /* Get the type and stride of the [soa] buffer's original struct elements, and the name,
+     * type, offset and size of each field along with the parameter holding its buffer
+     */
+    nlohmann::json soa_buffer_json(const SoaBuffer &soa_buffer) const;
+
+    // Output the register, size and the members' offsets and types of the constant buffer
+    nlohmann::json constant_buffer_json(const std::shared_ptr<ast::decl::Struct> &decl,
+                                        const ShaderRegisterBinding &binding,
+                                        const std::vector<ConstantBufferMember> &contents,
+                                        const uint32_t size) const;
 };
 }
 }
@@ -0,0 +1,367 @@
+#include "register_allocation_analysis.h"
+#include <algorithm>
+#include <iostream>
+#include "ast_utils.h"
+#include "resolution_analysis.h"
+
+namespace crtl {
+namespace hlsl {
+
+using namespace ast;
+
+// The shader record layout used by the runtime's local root signatures: the shader
+// identifier followed by the root constants, padded to 8 bytes, and the root descriptors
+const uint32_t SHADER_IDENTIFIER_SIZE = 32;
+const uint32_t ROOT_CONSTANT_SIZE = 4;
+const uint32_t ROOT_DESCRIPTOR_SIZE = 8;
+const uint32_t SHADER_RECORD_ALIGNMENT = 32;
+
+uint32_t align_to(const uint32_t size, const uint32_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+/* Lay out the constant buffer members, returning the size of the buffer and filling in the
+ * contents in the order of their offsets. Members aligned to a register are placed first,
+ * followed by the remaining members largest first, each placed in the first register with
+ * space left for it to minimize the padding between members
+ */
+uint32_t layout_constant_buffer(std::vector<ConstantMemberLayout> members,
+                                std::vector<ConstantBufferMember> &contents)
+{
+    std::stable_sort(members.begin(), members.end(), [](const auto &a, const auto &b) {
+        const bool a_register = a.layout.alignment == CONSTANT_REGISTER_SIZE;
+        const bool b_register = b.layout.alignment == CONSTANT_REGISTER_SIZE;
+        if (a_register != b_register) {
+            return a_register;
+        }
+        return a.layout.size > b.layout.size;
+    });
+
+    // The number of bytes used at the start of each register
+    std::vector<uint32_t> registers_used;
+    uint32_t size = 0;
+    for (const auto &m : members) {
+        const TypeLayout &layout = m.layout;
+        uint32_t offset = 0;
+        if (layout.alignment == CONSTANT_REGISTER_SIZE) {
+            // Members aligned to a register start a new one, and fill all the registers they
+            // cover except for the used part of the last one
+            offset = registers_used.size() * CONSTANT_REGISTER_SIZE;
+            const uint32_t num_registers = align_to(layout.size, CONSTANT_REGISTER_SIZE) /
+                                           CONSTANT_REGISTER_SIZE;
+            registers_used.resize(registers_used.size() + num_registers,
+                                  CONSTANT_REGISTER_SIZE);
+            registers_used.back() =
+                layout.size - (num_registers - 1) * CONSTANT_REGISTER_SIZE;
+        } else {
+            auto reg = std::find_if(
+                registers_used.begin(), registers_used.end(), [&](const uint32_t used) {
+                    return align_to(used, layout.alignment) + layout.size <=
+                           CONSTANT_REGISTER_SIZE;
+                });
+            if (reg == registers_used.end()) {
+                reg = registers_used.insert(registers_used.end(), 0);
+            }
+            const uint32_t start = align_to(*reg, layout.alignment);
+            offset =
+                std::distance(registers_used.begin(), reg) * CONSTANT_REGISTER_SIZE + start;
+            *reg = start + layout.size;
+        }
+        contents.push_back(ConstantBufferMember{m.member->get_text(), offset});
+        size = std::max(size, offset + layout.size);
+    }
+    std::stable_sort(contents.begin(), contents.end(), [](const auto &a, const auto &b) {
+        return a.offset < b.offset;
+    });
+    return size;
+}
+
+/* Estimate the size of the shader record passing the root constants of each struct
+ * parameter and the root descriptors
+ */
+uint32_t shader_record_size(const std::vector<std::vector<ConstantMemberLayout>> &constants,
+                            const size_t num_descriptors)
+{
+    uint32_t constants_size = 0;
+    for (const auto &c : constants) {
+        std::vector<ConstantBufferMember> contents;
+        constants_size += align_to(layout_constant_buffer(c, contents), ROOT_CONSTANT_SIZE);
+    }
+    return align_to(SHADER_IDENTIFIER_SIZE + align_to(constants_size, ROOT_DESCRIPTOR_SIZE) +
+                        num_descriptors * ROOT_DESCRIPTOR_SIZE,
+                    SHADER_RECORD_ALIGNMENT);
+}
+
+/* Select the constants to move out of the shader record into the spill buffers of their
+ * parameters, given the constants of each struct parameter in the record and the number of
+ * root descriptors, removing them from the constants passed and returning the spilled
+ * constants of each parameter. The largest constants of the record are moved first until it
+ * fits in the budget, keeping the number moved which gives the smallest record
+ */
+std::vector<std::vector<ConstantMemberLayout>> spill_constants(
+    std::vector<std::vector<ConstantMemberLayout>> &constants,
+    const size_t num_descriptors,
+    const uint32_t budget)
+{
+    std::vector<std::vector<ConstantMemberLayout>> spilled(constants.size());
+    uint32_t best_size = shader_record_size(constants, num_descriptors);
+    if (best_size <= budget) {
+        return spilled;
+    }
+
+    // The constants of all parameters paired with the parameter they belong to
+    std::vector<std::pair<size_t, ConstantMemberLayout>> by_size;
+    for (size_t i = 0; i < constants.size(); ++i) {
+        for (const auto &c : constants[i]) {
+            by_size.emplace_back(i, c);
+        }
+    }
+    std::stable_sort(by_size.begin(), by_size.end(), [](const auto &a, const auto &b) {
+        return a.second.layout.size > b.second.layout.size;
+    });
+    size_t num_spilled = 0;
+    for (size_t n = 1; n <= by_size.size(); ++n) {
+        std::vector<std::vector<ConstantMemberLayout>> remaining(constants.size());
+        std::vector<bool> has_spill_buffer(constants.size(), false);
+        for (size_t i = 0; i < by_size.size(); ++i) {
+            if (i < n) {
+                has_spill_buffer[by_size[i].first] = true;
+            } else {
+                remaining[by_size[i].first].push_back(by_size[i].second);
+            }
+        }
+        // Each spill buffer's address takes another root descriptor in the record
+        const size_t num_spill_buffers =
+            std::count(has_spill_buffer.begin(), has_spill_buffer.end(), true);
+        const uint32_t size =
+            shader_record_size(remaining, num_descriptors + num_spill_buffers);
+        if (size < best_size) {
+            best_size = size;
+            num_spilled = n;
+        }
+        if (size <= budget) {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < num_spilled; ++i) {
+        spilled[by_size[i].first].push_back(by_size[i].second);
+    }
+    for (size_t i = 0; i < constants.size(); ++i) {
+        std::erase_if(constants[i], [&](const ConstantMemberLayout &c) {
+            return std::find_if(spilled[i].begin(), spilled[i].end(), [&](const auto &s) {
+                       return s.member == c.member;
+                   }) != spilled[i].end();
+        });
+    }
+    return spilled;
+}
+
+std::string RegisterAllocationAnalysis::name() const
+{
+    return "register_allocation";
+}
+
+std::set<ASTChange> RegisterAllocationAnalysis::invalidated_by() const
+{
+    return {ASTChange::PARAMETERS};
+}
+
+void RegisterAllocationAnalysis::run(PassManager &pm)
+{
+    auto resolved = pm.get_analysis<ResolutionAnalysis>()->resolved;
+    shader_record_budget = pm.options.shader_record_budget;
+    for (const auto &n : pm.ast->top_level_decls) {
+        if (n->get_node_type() == NodeType::DECL_GLOBAL_PARAM) {
+            // Struct global parameters are expanded before translation, any remaining
+            // are reported by the OutputVisitor
+            auto param = std::dynamic_pointer_cast<decl::GlobalParam>(n);
+            if (param->get_type()->base_type != ty::BaseType::STRUCT) {
+                bind_parameter(param, *resolved);
+            }
+        } else if (n->get_node_type() == NodeType::DECL_ENTRY_POINT) {
+            bind_entry_point_parameters(
+                pm, std::dynamic_pointer_cast<decl::EntryPoint>(n), *resolved);
+        }
+    }
+}
+
+void RegisterAllocationAnalysis::bind_entry_point_parameters(
+    PassManager &pm,
+    const std::shared_ptr<ast::decl::EntryPoint> &entry_point,
+    const ResolverPassResult &resolved)
+{
+    // The ray payload and hit attributes aren't bound to registers. The constant members of
+    // the struct parameters are laid out once the constants to spill are chosen for the
+    // whole record
+    std::vector<std::shared_ptr<StructRegisterBinding>> struct_bindings;
+    std::vector<std::shared_ptr<ast::decl::Variable>> struct_params;
+    std::vector<std::vector<ConstantMemberLayout>> constants;
+    size_t num_descriptors = 0;
+    for (const auto &p : entry_point->parameters) {
+        if (!is_shader_record_parameter(entry_point, p)) {
+            continue;
+        }
+        std::vector<ConstantMemberLayout> constant_members;
+        bind_parameter(p, resolved, &constant_members);
+        auto binding = std::dynamic_pointer_cast<StructRegisterBinding>(parameter_bindings[p]);
+        if (binding) {
+            struct_bindings.push_back(binding);
+            struct_params.push_back(p);
+            constants.push_back(constant_members);
+            num_descriptors += binding->members.size();
+        } else if (parameter_bindings.contains(p)) {
+            ++num_descriptors;
+        }
+    }
+
+    // The runtime doesn't support spill buffers in hit group records yet, so their
+    // constants are kept in the record
+    const auto type = std::dynamic_pointer_cast<ty::EntryPoint>(entry_point->get_type());
+    const bool is_hit_group = type->entry_point_type == ty::EntryPointType::CLOSEST_HIT ||
+                              type->entry_point_type == ty::EntryPointType::ANY_HIT ||
+                              type->entry_point_type == ty::EntryPointType::INTERSECTION;
+    std::vector<std::vector<ConstantMemberLayout>> spilled(constants.size());
+    if (shader_record_budget > 0 && is_hit_group) {
+        const uint32_t size = shader_record_size(constants, num_descriptors);
+        if (size > shader_record_budget) {
+            report_warning(entry_point->get_token(),
+                           "The shader record of '" + entry_point->get_text() + "' is " +
+                               std::to_string(size) + "b, over the " +
+                               std::to_string(shader_record_budget) +
+                               "b budget. Constants can't be moved out of hit group records");
+        }
+    } else if (shader_record_budget > 0) {
+        spilled = spill_constants(constants, num_descriptors, shader_record_budget);
+    }
+
+    for (size_t i = 0; i < struct_bindings.size(); ++i) {
+        auto &binding = struct_bindings[i];
+        binding->constant_buffer_size =
+            layout_constant_buffer(constants[i], binding->constant_buffer_contents);
+        binding->spill_buffer_size =
+            layout_constant_buffer(spilled[i], binding->spill_buffer_contents);
+        if (!binding->constant_buffer_contents.empty()) {
+            binding->constant_buffer_register = register_allocator.bind_cbv(1);
+        }
+        if (binding->spill_buffer_contents.empty()) {
+            continue;
+        }
+        binding->spill_buffer_register = register_allocator.bind_cbv(1);
+
+        const auto &param = struct_params[i];
+        std::cout << "Moved " << spilled[i].size() << " constants ("
+                  << binding->spill_buffer_size << "b) of parameter '" << param->get_text()
+                  << "' to a spill buffer\n";
+        pm.add_remark("shader_record_spill",
+                      RemarkKind::APPLIED,
+                      param->get_token(),
+                      "Moved " + std::to_string(spilled[i].size()) +
+                          " constant members of parameter '" + param->get_text() +
+                          "' out of the shader record to fit the " +
+                          std::to_string(shader_record_budget) + "b budget");
+    }
+}
+
+void RegisterAllocationAnalysis::bind_parameter(
+    const std::shared_ptr<ast::decl::Variable> &param,
+    const ResolverPassResult &resolved,
+    std::vector<ConstantMemberLayout> *constant_members)
+{
+    const auto param_type = param->get_type();
+    if (!param_type->is_builtin()) {
+        auto struct_type = std::dynamic_pointer_cast<ty::Struct>(param_type);
+        auto fnd = resolved.struct_type.find(struct_type);
+        if (fnd == resolved.struct_type.end()) {
+            report_error(param->get_token(),
+                         "Error: Failed to find resolved struct decl for struct var decl");
+            return;
+        }
+        const auto struct_decl = fnd->second;
+
+        auto binding = std::make_shared<StructRegisterBinding>();
+        std::vector<ConstantMemberLayout> members;
+        for (const auto &m : struct_decl->members) {
+            // Primitive/Vector/Matrix types get packed into a constant buffer
+            const auto member_ty = m->get_type();
+            const std::string &name = m->get_text();
+            if (member_ty->base_type == ty::BaseType::PRIMITIVE ||
+                member_ty->base_type == ty::BaseType::VECTOR ||
+                member_ty->base_type == ty::BaseType::MATRIX) {
+                const auto layout = constant_buffer_layout(member_ty);
+                if (!layout) {
+                    report_error(m->get_token(),
+                                 "Error: Unsupported type for constant buffer member '" +
+                                     name + "'");
+                    continue;
+                }
+                members.push_back(ConstantMemberLayout{m, *layout});
+            } else if (member_ty->base_type == ty::BaseType::STRUCT) {
+                // If we have another struct type member we need to expand it out to flatten
+                // the structs down
+                // TODO: Maybe this is best done as a pre-pass on the AST that does this
+                // flattening of the types, then we don't need to worry about it at this point
+                report_error(param->get_token(),
+                             "TODO Will: Nested structs in global/entry point param");
+            } else {
+                binding->members[name] = bind_builtin_type_parameter(member_ty);
+            }
+        }
+        if (constant_members) {
+            *constant_members = members;
+        } else {
+            binding->constant_buffer_size =
+                layout_constant_buffer(members, binding->constant_buffer_contents);
+            if (!binding->constant_buffer_contents.empty()) {
+                binding->constant_buffer_register = register_allocator.bind_cbv(1);
+            }
+        }
+        parameter_bindings[param] = binding;
+    } else {
+        // TODO: This can be better: if we have a lot of individual constant args to an entry
+        // point or as a global, we generate a CBV for each one. We could pack them into a
+        // single CBV instead. They could be made to view the same buffer at different
+        // offsets, but it'd be best to pack them all together into a single CBV
+        parameter_bindings[param] =
+            std::make_shared<ShaderRegisterBinding>(bind_builtin_type_parameter(param_type));
+    }
+}
+
+ShaderRegisterBinding RegisterAllocationAnalysis::bind_builtin_type_parameter(
+    const std::shared_ptr<ast::ty::Type> &type)
+{
+    // TODO: Need to add array (and unsized) declaration support for array and unsized array
+    // params
+    if (type->base_type == ty::BaseType::PRIMITIVE ||
+        type->base_type == ty::BaseType::VECTOR || type->base_type == ty::BaseType::MATRIX) {
+        return register_allocator.bind_cbv(1);
+    } else if (type->base_type == ty::BaseType::BUFFER) {
+        // Buffer is SRV
+        // RWBuffer is UAV
+        const auto buf_ty = std::dynamic_pointer_cast<ty::Buffer>(type);
+        if (buf_ty->access == ty::Access::READ_ONLY) {
+            return register_allocator.bind_srv(1);
+        } else {
+            return register_allocator.bind_uav(1);
+        }
+    } else if (type->base_type == ty::BaseType::TEXTURE) {
+        // Texture is SRV + needs a sampler
+        // TODO: Samplers should be added to the built in types
+        // RWTexture is UAV
+        const auto tex_ty = std::dynamic_pointer_cast<ty::Texture>(type);
+        if (tex_ty->access == ty::Access::READ_ONLY) {
+            return register_allocator.bind_srv(1);
+        } else {
+            return register_allocator.bind_uav(1);
+        }
+    } else if (type->base_type == ty::BaseType::ACCELERATION_STRUCTURE) {
+        // AccelerationStructure is SRV
+        return register_allocator.bind_srv(1);
+    } else {
+        throw std::runtime_error("Unsupported parameter type: '" + type->to_string() + "'");
+    }
+    return ShaderRegisterBinding();
+}
+}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "pass_manager.h"
+#include "resolver_visitor.h"
+#include "shader_register_allocator.h"
+#include "type_layout.h"
+
+namespace crtl {
+namespace hlsl {
+
+// A struct parameter member placed in a constant buffer and its layout in the buffer
+struct ConstantMemberLayout {
+    std::shared_ptr<ast::decl::StructMember> member;
+    TypeLayout layout;
+};
+
+/* The RegisterAllocationAnalysis binds the global and entry point parameters to HLSL shader
+ * registers, in the order they're declared in the program.
+ *
+ * The constant members of entry point struct parameters are passed in the shader record as
+ * root constants, so a large parameter struct increases the stride of the whole shader
+ * table. If the estimated size of an entry point's shader record, holding all its shader
+ * record parameters, exceeds the shader_record_budget option, the largest constant members
+ * are moved into spill constant buffers referenced by their address in the record until it
+ * fits in the budget, as long as this makes the record smaller. Hit group records aren't
+ * spilled, since the runtime doesn't support spill buffers in them yet.
+ */
+class RegisterAllocationAnalysis : public Analysis {
+    ShaderRegisterAllocator register_allocator;
+
+    uint32_t shader_record_budget = 0;
+
+public:
+    // Map of global and entry point parameter names to their register binding information
+    phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>,
+                                  std::shared_ptr<ParameterRegisterBinding>>
+        parameter_bindings;
+
+    std::string name() const override;
+
+    std::set<ASTChange> invalidated_by() const override;
+
+    void run(PassManager &pm) override;
+
+private:
+    /* Bind the shader record parameters of the entry point to registers. The constant
+     * members of the struct parameters may be moved into spill buffers to fit the whole
+     * shader record holding the parameters in the shader record budget
+     */
+    void bind_entry_point_parameters(PassManager &pm,
+                                     const std::shared_ptr<ast::decl::EntryPoint> &entry_point,
+                                     const ResolverPassResult &resolved);
+
+    /* Bind the passed global or entry point parameter to registers, storing the
+     * ParameterRegisterBinding in the parameter_bindings map. If constant_members is passed
+     * the constant members of struct parameters are returned in it to be laid out by the
+     * caller, instead of being placed in the parameter's constant buffer
+     */
+    void bind_parameter(const std::shared_ptr<ast::decl::Variable> &param,
+                        const ResolverPassResult &resolved,
+                        std::vector<ConstantMemberLayout> *constant_members = nullptr);
+
+    /* Bind the passed built in parameter type (i.e. not a struct) to a shader register.
+     */
+    ShaderRegisterBinding bind_builtin_type_parameter(
+        const std::shared_ptr<ast::ty::Type> &type);
+};
+}
+}
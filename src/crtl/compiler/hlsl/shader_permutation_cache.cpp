@@ -0,0 +1,79 @@
+#include "shader_permutation_cache.h"
+#include <fstream>
+#include <iostream>
+
+namespace crtl {
+namespace hlsl {
+
+std::shared_ptr<ShaderCompilationResult> ShaderPermutationCache::compile(
+    const std::string &crtl_src, const CompileOptions &options)
+{
+    const std::string key = permutation_key(crtl_src, options);
+    auto fnd = permutations.find(key);
+    if (fnd != permutations.end()) {
+        ++num_hits;
+        return fnd->second;
+    }
+
+    auto result = compile_crtl(crtl_src, options);
+    ++num_compiled;
+
+    // Permutations are identical if they produce the same shader, the source and shader
+    // info output are both deterministic. Permutations with remarks are only identical if
+    // their remarks are too, since they describe how each permutation was compiled
+    std::string canonical_output = result->hlsl_src + "\n" + result->shader_info.dump();
+    if (!result->remarks.empty()) {
+        canonical_output += "\n" + nlohmann::json(result->remarks).dump();
+    }
+    auto canonical = canonical_results.find(canonical_output);
+    if (canonical != canonical_results.end()) {
+        ++num_deduplicated;
+        std::cout << "Shader permutation is identical to a previously compiled permutation\n";
+        result = canonical->second;
+    } else {
+        canonical_results[canonical_output] = result;
+    }
+
+    permutations[key] = result;
+    return result;
+}
+
+std::string ShaderPermutationCache::permutation_key(const std::string &crtl_src,
+                                                    const CompileOptions &options)
+{
+    // The key holds the whole source rather than a hash of it, so that different sources
+    // can't collide. It's prefixed with its length so the options following it can't be
+    // mistaken for part of the source
+    std::string key = std::to_string(crtl_src.size()) + ":" + crtl_src + ";O" +
+                      std::to_string(options.optimization_level) +
+                      (options.fast_math ? ";fast_math" : "") +
+                      (options.profile_instrument ? ";profile_instrument" : "") +
+                      (options.pack_payloads ? ";pack_payloads" : "") +
+                      (options.payload_access_qualifiers ? ";payload_access_qualifiers" : "");
+    // The remarks are part of the compilation result, so the filter selecting them is too
+    if (!options.remarks_filter.empty()) {
+        key += ";remarks=" + options.remarks_filter;
+    }
+    // The budget decides which calls are evaluated at compile time, changing the output
+    key += ";consteval_budget=" + std::to_string(options.compile_time_evaluation_budget);
+    if (options.shader_record_budget > 0) {
+        key += ";shader_record_budget=" + std::to_string(options.shader_record_budget);
+    }
+    // The profile is keyed by its contents, so that permutations are recompiled when it's
+    // rewritten by a new profiling run
+    if (!options.profile_use.empty()) {
+        std::ifstream profile{options.profile_use};
+        const std::string profile_content{std::istreambuf_iterator<char>{profile},
+                                          std::istreambuf_iterator<char>{}};
+        key += ";profile_use=" + options.profile_use + ":" +
+               std::to_string(profile_content.size()) + ":" + profile_content;
+    }
+    // The specialization values are stored sorted by name, so the key doesn't depend on the
+    // order they were given in
+    for (const auto &v : options.specialization_values) {
+        key += ";" + v.first + "=" + v.second;
+    }
+    return key;
+}
+}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <parallel_hashmap/phmap.h>
+#include "crtl_to_hlsl.h"
+
+namespace crtl {
+namespace hlsl {
+
+/* The ShaderPermutationCache holds the compiled permutations of shader libraries, keyed by
+ * the source and the compile options, which include the specialization values. Requesting a
+ * permutation that was already compiled returns the existing result.
+ *
+ * Permutations whose output is identical after specialization (the same HLSL source and
+ * shader info) share a single compilation result, e.g., when a specialization constant only
+ * selects between branches that fold to the same code. Backends can key their native shader
+ * compilation on the result to compile each distinct variant once.
+ */
+class ShaderPermutationCache {
+    // The compilation result of each permutation, by the source and compile options
+    phmap::flat_hash_map<std::string, std::shared_ptr<ShaderCompilationResult>> permutations;
+
+    // The distinct compilation results by their canonical output
+    phmap::flat_hash_map<std::string, std::shared_ptr<ShaderCompilationResult>>
+        canonical_results;
+
+public:
+    // The number of permutations compiled, and the number which were found to be identical
+    // to an existing permutation after compilation
+    size_t num_compiled = 0;
+    size_t num_deduplicated = 0;
+
+    // The number of requests served from the cache without compiling
+    size_t num_hits = 0;
+
+    // Get the compilation result for the permutation of the shader, compiling it if needed
+    std::shared_ptr<ShaderCompilationResult> compile(const std::string &crtl_src,
+                                                     const CompileOptions &options);
+
+private:
+    // Build the key identifying the permutation of the shader
+    static std::string permutation_key(const std::string &crtl_src,
+                                       const CompileOptions &options);
+};
+}
+}
@@ -46,14 +46,30 @@ struct ShaderRegisterBinding : ParameterRegisterBinding {
     ShaderRegisterBinding() = default;
 };
 
+// A struct member placed in the struct parameter's constant buffer
+struct ConstantBufferMember {
+    std::string name;
+    // The byte offset of the member in the constant buffer
+    uint32_t offset = 0;
+};
+
 /* The register binding for a struct parameter whose members may be split
  * over multiple different parameter types. All primitive/vector/matrix members
  * of the struct are packed into a constant buffer, while any buffers, textures, etc.
- * are bound to registers
+ * are bound to registers. The constant buffer members are reordered to minimize the
+ * padding between them and are listed in order of their offsets
  */
 struct StructRegisterBinding : ParameterRegisterBinding {
     ShaderRegisterBinding constant_buffer_register;
-    std::vector<std::string> constant_buffer_contents;
+    std::vector<ConstantBufferMember> constant_buffer_contents;
+    // The size in bytes of the constant buffer up to the end of its last member
+    uint32_t constant_buffer_size = 0;
+
+    // The constant members moved out of the shader record into a constant buffer referenced
+    // by its address, to keep the shader record within the shader record budget
+    ShaderRegisterBinding spill_buffer_register;
+    std::vector<ConstantBufferMember> spill_buffer_contents;
+    uint32_t spill_buffer_size = 0;
 
     // Binding info for all non-constant buffer suitable data
     phmap::parallel_flat_hash_map<std::string, ShaderRegisterBinding> members;
@@ -1,14 +1,136 @@
 #include "translate_builtin_function_call.h"
+#include "builtins.h"
+#include "parallel_hashmap/phmap.h"
 
 namespace crtl {
 namespace hlsl {
 using namespace ast;
+
+// The bit packing builtins implemented by helper functions, see builtin_helper_function, and
+// the helpers decoding loads from buffers of quantized elements
+const phmap::flat_hash_map<std::string, std::string> builtin_helpers = {
+    {"insert_bits",
+     R"(uint crtl_insert_bits(uint word, uint value, uint offset, uint count)
+{
+    const uint mask = ((1u << count) - 1u) << offset;
+    return (word & ~mask) | ((value << offset) & mask);
+}
+)"},
+    {"extract_bits",
+     R"(uint crtl_extract_bits(uint word, uint offset, uint count)
+{
+    return (word >> offset) & ((1u << count) - 1u);
+}
+)"},
+    {"pack_unorm",
+     R"(uint crtl_pack_unorm(float x, uint bits)
+{
+    return uint(saturate(x) * float((1u << bits) - 1u) + 0.5f);
+}
+)"},
+    {"unpack_unorm",
+     R"(float crtl_unpack_unorm(uint x, uint bits)
+{
+    return float(x) / float((1u << bits) - 1u);
+}
+)"},
+    {"pack_octahedral",
+     R"(uint crtl_pack_octahedral(float3 n)
+{
+    float2 p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    if (n.z < 0.f) {
+        const float2 s = float2(p.x >= 0.f ? 1.f : -1.f, p.y >= 0.f ? 1.f : -1.f);
+        p = (1.f - abs(p.yx)) * s;
+    }
+    const uint2 q = uint2(round(clamp(p, -1.f, 1.f) * 32767.f) + 32767.f);
+    return q.x | (q.y << 16);
+}
+)"},
+    {"unpack_octahedral",
+     R"(float3 crtl_unpack_octahedral(uint x)
+{
+    const float2 p = float2(x & 0xffff, x >> 16) / 32767.f - 1.f;
+    float3 n = float3(p, 1.f - abs(p.x) - abs(p.y));
+    const float t = saturate(-n.z);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+    return normalize(n);
+}
+)"},
+    {"decode_unorm16_2",
+     R"(float2 crtl_decode_unorm16_2(uint x)
+{
+    return float2(x & 0xffff, x >> 16) / 65535.f;
+}
+)"},
+    {"decode_snorm16_3",
+     R"(float3 crtl_decode_snorm16_3(ByteAddressBuffer buf, uint i)
+{
+    const float3 scale = asfloat(buf.Load3(0));
+    const float3 bias = asfloat(buf.Load3(12));
+    const float3 p = float3(buf.Load<int16_t3>(24 + i * 6));
+    return max(p / 32767.f, -1.f) * scale + bias;
+}
+)"}};
+
+// The HLSL wave intrinsics implementing the wave builtins
+const phmap::flat_hash_map<std::string, std::string> wave_intrinsics = {
+    {"wave_active_count_bits", "WaveActiveCountBits"},
+    {"wave_active_ballot", "WaveActiveBallot"},
+    {"wave_prefix_sum", "WavePrefixSum"},
+    {"wave_active_sum", "WaveActiveSum"},
+    {"wave_active_min", "WaveActiveMin"},
+    {"wave_active_max", "WaveActiveMax"},
+    {"wave_read_lane_first", "WaveReadLaneFirst"},
+    {"wave_read_lane_at", "WaveReadLaneAt"},
+    {"wave_lane_index", "WaveGetLaneIndex"},
+    {"wave_lane_count", "WaveGetLaneCount"}};
+
+std::string builtin_helper_function(const std::string &builtin)
+{
+    auto fnd = builtin_helpers.find(builtin);
+    return fnd != builtin_helpers.end() ? fnd->second : "";
+}
 std::string translate_builtin_function_call(ast::expr::FunctionCall *call,
-                                            ast::decl::Function *callee)
+                                            ast::decl::Function *callee,
+                                            const std::vector<std::string> &args)
 {
     if (callee->get_text() == "ray_index") {
         return "DispatchRaysIndex().xy";
     }
+    if (callee->get_text() == "trace_ray") {
+        // TraceRay takes the ray and payload after the flags and shader table indices
+        return "TraceRay(" + args[0] + ", " + args[3] + ", " + args[4] + ", " + args[5] +
+               ", " + args[6] + ", " + args[7] + ", " + args[1] + ", " + args[2] + ")";
+    }
+    if (callee->get_text() == "atomic_add") {
+        return "InterlockedAdd(" + args[0] + ", " + args[1] + ")";
+    }
+    /* The math and bit conversion builtins map directly to the HLSL intrinsics of the same
+     * name and the wave builtins to the corresponding wave intrinsics, the other packing
+     * builtins call their helper function
+     */
+    const std::string &name = callee->get_text();
+    auto wave_intrinsic = wave_intrinsics.find(name);
+    const bool is_intrinsic = is_generic_builtin(name) || name == "asuint" ||
+                              name == "asint" || name == "asfloat" || name == "f32tof16" ||
+                              name == "f16tof32";
+    if (wave_intrinsic != wave_intrinsics.end() || is_intrinsic ||
+        builtin_helpers.contains(name)) {
+        std::string hlsl_src;
+        if (wave_intrinsic != wave_intrinsics.end()) {
+            hlsl_src = wave_intrinsic->second + "(";
+        } else {
+            hlsl_src = (is_intrinsic ? name : "crtl_" + name) + "(";
+        }
+        for (size_t i = 0; i < args.size(); ++i) {
+            hlsl_src += args[i];
+            if (i + 1 < args.size()) {
+                hlsl_src += ", ";
+            }
+        }
+        return hlsl_src + ")";
+    }
     return "";
 }
 }
@@ -5,8 +5,16 @@
 
 namespace crtl {
 namespace hlsl {
-// Translate the call expression calling the builtin function callee
+// Translate the call expression calling the builtin function callee, given the translated
+// arguments of the call
 std::string translate_builtin_function_call(ast::expr::FunctionCall *call,
-                                            ast::decl::Function *callee);
+                                            ast::decl::Function *callee,
+                                            const std::vector<std::string> &args);
+
+/* Get the HLSL source of the helper function implementing the builtin, which must be
+ * declared before the builtin is called. Returns an empty string for builtins that are
+ * translated directly to HLSL intrinsics or expressions
+ */
+std::string builtin_helper_function(const std::string &builtin);
 }
 }
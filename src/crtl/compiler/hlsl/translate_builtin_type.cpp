@@ -4,6 +4,37 @@ namespace crtl {
 namespace hlsl {
 using namespace ast;
 
+const std::string to_string(const BufferLayout &layout)
+{
+    switch (layout) {
+    case BufferLayout::STRUCTURED:
+        return "structured";
+    case BufferLayout::BYTE_ADDRESS:
+        return "byte_address";
+    default:
+        return "invalid";
+    }
+}
+
+BufferLayout buffer_layout(const std::shared_ptr<ast::ty::Buffer> &type)
+{
+    if (type->template_parameters[0]->base_type == ty::BaseType::QUANTIZED) {
+        return BufferLayout::BYTE_ADDRESS;
+    }
+    auto vector = std::dynamic_pointer_cast<ty::Vector>(type->template_parameters[0]);
+    if (type->access != ty::Access::READ_ONLY || !vector || vector->dimensionality != 3) {
+        return BufferLayout::STRUCTURED;
+    }
+    switch (vector->element_type->type_id) {
+    case ty::PrimitiveType::INT:
+    case ty::PrimitiveType::UINT:
+    case ty::PrimitiveType::FLOAT:
+        return BufferLayout::BYTE_ADDRESS;
+    default:
+        return BufferLayout::STRUCTURED;
+    }
+}
+
 std::string translate_modifiers(const std::set<ast::ty::Modifier> &modifiers)
 {
     std::string str;
@@ -26,10 +57,19 @@ std::string translate_primitive_type(const std::shared_ptr<ast::ty::Primitive> &
     switch (type->type_id) {
     case ty::PrimitiveType::BOOL:
         return "bool";
+    // The 16-bit types are the native ones, which need shader model 6.2 and DXC's
+    // -enable-16bit-types. The min precision types aren't used since they may be stored with
+    // 32 bits, which wouldn't match the layout the metadata describes
+    case ty::PrimitiveType::INT16:
+        return "int16_t";
+    case ty::PrimitiveType::UINT16:
+        return "uint16_t";
     case ty::PrimitiveType::INT:
         return "int";
     case ty::PrimitiveType::UINT:
         return "uint";
+    case ty::PrimitiveType::HALF:
+        return "float16_t";
     case ty::PrimitiveType::FLOAT:
         return "float";
     case ty::PrimitiveType::DOUBLE:
@@ -54,6 +94,9 @@ std::string translate_matrix_type(const std::shared_ptr<ast::ty::Matrix> &type)
 
 std::string translate_buffer_type(const std::shared_ptr<ast::ty::Buffer> &type)
 {
+    if (buffer_layout(type) == BufferLayout::BYTE_ADDRESS) {
+        return "ByteAddressBuffer";
+    }
     std::string element_str = "";
     if (type->template_parameters[0]->is_builtin()) {
         element_str = translate_builtin_type(type->template_parameters[0]);
@@ -7,6 +7,19 @@
 namespace crtl {
 namespace hlsl {
 
+// The HLSL buffer type a Buffer is translated to
+enum class BufferLayout { STRUCTURED, BYTE_ADDRESS };
+
+const std::string to_string(const BufferLayout &layout);
+
+/* Select the HLSL buffer type for the buffer from its element type and access. Read only
+ * buffers of 3 component 32-bit vectors, e.g., vertex positions and indices, are translated
+ * to ByteAddressBuffers read with Load3, so the data is fetched with a single 12 byte load
+ * without padding the elements to 16 bytes. Other buffers are StructuredBuffers, which are
+ * tightly packed with the element's scalar layout
+ */
+BufferLayout buffer_layout(const std::shared_ptr<ast::ty::Buffer> &type);
+
 std::string translate_modifiers(const std::set<ast::ty::Modifier> &modifiers);
 
 /* Translate the passed built-in type to the corresponding HLSL type string. Types that can be
@@ -0,0 +1,144 @@
+#include "type_layout.h"
+#include <algorithm>
+
+namespace crtl {
+namespace hlsl {
+
+using namespace ast;
+
+uint32_t primitive_size(const ty::PrimitiveType type)
+{
+    switch (type) {
+    case ty::PrimitiveType::INT16:
+    case ty::PrimitiveType::UINT16:
+    case ty::PrimitiveType::HALF:
+        return 2;
+    case ty::PrimitiveType::BOOL:
+    case ty::PrimitiveType::INT:
+    case ty::PrimitiveType::UINT:
+    case ty::PrimitiveType::FLOAT:
+        return 4;
+    case ty::PrimitiveType::DOUBLE:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+std::optional<TypeLayout> scalar_layout(const std::shared_ptr<ty::Type> &type,
+                                        const ResolverPassResult &resolved)
+{
+    uint32_t element_size = 0;
+    uint32_t count = 1;
+    switch (type->base_type) {
+    case ty::BaseType::PRIMITIVE:
+        element_size =
+            primitive_size(std::dynamic_pointer_cast<ty::Primitive>(type)->type_id);
+        break;
+    case ty::BaseType::VECTOR: {
+        auto vector = std::dynamic_pointer_cast<ty::Vector>(type);
+        element_size = primitive_size(vector->element_type->type_id);
+        count = vector->dimensionality;
+        break;
+    }
+    case ty::BaseType::MATRIX: {
+        auto matrix = std::dynamic_pointer_cast<ty::Matrix>(type);
+        element_size = primitive_size(matrix->element_type->type_id);
+        count = matrix->dim_0 * matrix->dim_1;
+        break;
+    }
+    case ty::BaseType::STRUCT: {
+        auto fnd = resolved.struct_type.find(std::dynamic_pointer_cast<ty::Struct>(type));
+        if (fnd == resolved.struct_type.end()) {
+            return std::nullopt;
+        }
+        return scalar_layout(fnd->second, resolved);
+    }
+    case ty::BaseType::QUANTIZED:
+        // The quantized formats are stored as two or three 16-bit values
+        element_size = 2;
+        count = std::dynamic_pointer_cast<ty::Quantized>(type)->format ==
+                        ty::QuantizedFormat::SNORM16_3
+                    ? 3
+                    : 2;
+        break;
+    default:
+        break;
+    }
+
+    if (element_size == 0) {
+        return std::nullopt;
+    }
+    return TypeLayout{element_size * count, element_size};
+}
+
+std::optional<TypeLayout> scalar_layout(const std::shared_ptr<decl::Struct> &decl,
+                                        const ResolverPassResult &resolved,
+                                        const std::set<std::string> *members,
+                                        std::vector<uint32_t> *offsets)
+{
+    TypeLayout layout;
+    layout.alignment = 1;
+    for (const auto &m : decl->members) {
+        if (members && !members->contains(m->get_text())) {
+            continue;
+        }
+        const auto member_layout = scalar_layout(m->get_type(), resolved);
+        if (!member_layout) {
+            return std::nullopt;
+        }
+        const uint32_t align = member_layout->alignment;
+        const uint32_t offset = (layout.size + align - 1) / align * align;
+        if (offsets) {
+            offsets->push_back(offset);
+        }
+        layout.size = offset + member_layout->size;
+        layout.alignment = std::max(layout.alignment, align);
+    }
+    layout.size = (layout.size + layout.alignment - 1) / layout.alignment * layout.alignment;
+    return layout;
+}
+
+std::optional<TypeLayout> constant_buffer_layout(const std::shared_ptr<ty::Type> &type)
+{
+    switch (type->base_type) {
+    case ty::BaseType::PRIMITIVE: {
+        const uint32_t size =
+            primitive_size(std::dynamic_pointer_cast<ty::Primitive>(type)->type_id);
+        if (size == 0) {
+            return std::nullopt;
+        }
+        return TypeLayout{size, std::max(size, CONSTANT_COMPONENT_SIZE)};
+    }
+    case ty::BaseType::VECTOR: {
+        auto vector = std::dynamic_pointer_cast<ty::Vector>(type);
+        const uint32_t element_size = primitive_size(vector->element_type->type_id);
+        const uint32_t size = element_size * vector->dimensionality;
+        if (element_size == 0) {
+            return std::nullopt;
+        }
+        // Vectors larger than a register (double3 and double4) start a new register
+        const uint32_t alignment = size > CONSTANT_REGISTER_SIZE
+                                       ? CONSTANT_REGISTER_SIZE
+                                       : std::max(element_size, CONSTANT_COMPONENT_SIZE);
+        return TypeLayout{size, alignment};
+    }
+    case ty::BaseType::MATRIX: {
+        // dim_0 is the number of rows and dim_1 the number of columns
+        auto matrix = std::dynamic_pointer_cast<ty::Matrix>(type);
+        const uint32_t column_size = primitive_size(matrix->element_type->type_id) *
+                                     matrix->dim_0;
+        if (column_size == 0) {
+            return std::nullopt;
+        }
+        const uint32_t column_stride = (column_size + CONSTANT_REGISTER_SIZE - 1) /
+                                       CONSTANT_REGISTER_SIZE * CONSTANT_REGISTER_SIZE;
+        return TypeLayout{(matrix->dim_1 - 1) * column_stride + column_size,
+                          CONSTANT_REGISTER_SIZE};
+    }
+    default:
+        return std::nullopt;
+    }
+}
+}
+}
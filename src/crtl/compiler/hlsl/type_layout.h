@@ -0,0 +1,58 @@
+#pragma once
+
+#include <optional>
+#include <set>
+#include <vector>
+#include "ast/type.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+namespace hlsl {
+
+// The maximum size of the hit attributes passed from intersection to hit shaders in DXR
+const uint32_t MAX_ATTRIBUTE_SIZE = 32;
+
+// The size of a constant buffer register, which constant buffer members can't straddle
+const uint32_t CONSTANT_REGISTER_SIZE = 16;
+
+// The size of a constant buffer register component, the granularity members can be placed at
+// with packoffset
+const uint32_t CONSTANT_COMPONENT_SIZE = 4;
+
+struct TypeLayout {
+    uint32_t size = 0;
+    uint32_t alignment = 0;
+};
+
+/* Compute the size and alignment of the type when stored with HLSL's scalar layout, which is
+ * used for the ray payloads and hit attributes passed between the shader stages. Scalars are
+ * aligned to their size, with bools stored as 32-bit values, vectors and matrices are tightly
+ * packed arrays of their element type and structs are aligned to their largest member, with
+ * their size padded to a multiple of their alignment. Returns nullopt for types which can't be
+ * stored in memory, such as resources
+ */
+std::optional<TypeLayout> scalar_layout(const std::shared_ptr<ast::ty::Type> &type,
+                                        const ResolverPassResult &resolved);
+
+/* Compute the layout of the struct's members with HLSL's scalar layout. If members is passed
+ * only the listed members are laid out, e.g., to size the payload fields used by a ray type.
+ * If offsets is passed the offset of each member laid out is appended to it in declaration
+ * order. Scalar layout is also the layout of structured buffer elements, so it's the single
+ * layout rule for buffers of structs in the HLSL target
+ */
+std::optional<TypeLayout> scalar_layout(const std::shared_ptr<ast::decl::Struct> &decl,
+                                        const ResolverPassResult &resolved,
+                                        const std::set<std::string> *members = nullptr,
+                                        std::vector<uint32_t> *offsets = nullptr);
+
+/* Compute the size and alignment of a primitive, vector or matrix type when stored in a
+ * constant buffer with HLSL's packing rules. Scalars and vectors are aligned to their element
+ * size and can't straddle a 16 byte register, or start a new register if they're larger than
+ * one. 16-bit scalars and vectors are aligned to a register component instead, the finest
+ * offset packoffset can place them at. Matrices are column major with each column starting a
+ * new register, so they're aligned to a register and their last column can be followed by
+ * other members. Returns nullopt for types which can't be stored in a constant buffer
+ */
+std::optional<TypeLayout> constant_buffer_layout(const std::shared_ptr<ast::ty::Type> &type);
+}
+}
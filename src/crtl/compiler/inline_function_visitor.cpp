@@ -0,0 +1,435 @@
+#include "inline_function_visitor.h"
+#include "ast_utils.h"
+#include "clone_visitor.h"
+
+namespace crtl {
+
+using namespace ast;
+
+// Calls within loops are more likely to be hot, so we're willing to inline larger functions
+// into loops
+const size_t LOOP_INLINE_THRESHOLD_SCALE = 4;
+
+// Limit on how deep we'll inline calls made from within inlined function bodies
+const size_t MAX_INLINE_DEPTH = 16;
+
+InlineFunctionVisitor::InlineFunctionVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result,
+    const std::shared_ptr<CallGraphAnalysis> &call_graph,
+    const size_t inline_threshold)
+    : resolver_result(resolver_result),
+      call_graph(call_graph),
+      inline_threshold(inline_threshold)
+{
+}
+
+std::any InlineFunctionVisitor::visit_ast(const std::shared_ptr<ast::AST> &ast)
+{
+    make_inline_decisions(ast);
+
+    auto ast_out = std::any_cast<std::shared_ptr<AST>>(ModifyingVisitor::visit_ast(ast));
+
+    // Remove any functions that had all their calls inlined
+    std::vector<std::shared_ptr<expr::FunctionCall>> remaining_calls;
+    for (const auto &n : ast_out->top_level_decls) {
+        collect_calls(n, remaining_calls);
+    }
+    phmap::flat_hash_set<std::shared_ptr<decl::Function>> called_fns;
+    for (const auto &c : remaining_calls) {
+        auto fnd = resolver_result->call_expr.find(c);
+        if (fnd != resolver_result->call_expr.end()) {
+            called_fns.insert(fnd->second);
+        }
+    }
+
+    std::vector<std::shared_ptr<Node>> decls;
+    for (const auto &n : ast_out->top_level_decls) {
+        auto fn = std::dynamic_pointer_cast<decl::Function>(n);
+        if (fn && !called_fns.contains(fn)) {
+            const auto &decision = inline_decisions[fn];
+            if (decision.inline_calls && decision.num_call_sites > 0) {
+                continue;
+            }
+        }
+        decls.push_back(n);
+    }
+    ast_out->top_level_decls = decls;
+    return ast_out;
+}
+
+std::any InlineFunctionVisitor::visit_stmt_block(const std::shared_ptr<ast::stmt::Block> &s)
+{
+    std::vector<std::shared_ptr<stmt::Statement>> statements;
+    for (auto &st : s->statements) {
+        auto results = visit_statement(st);
+        statements.insert(statements.end(), results.begin(), results.end());
+    }
+    s->statements = statements;
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any InlineFunctionVisitor::visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s)
+{
+    // The condition is evaluated once before the branch, so calls in it can be inlined
+    // before the if statement
+    s->condition = std::any_cast<std::shared_ptr<expr::Expression>>(visit(s->condition));
+    s->if_branch = visit_nested_statement(s->if_branch);
+    if (s->else_branch) {
+        s->else_branch = visit_nested_statement(s->else_branch);
+    }
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any InlineFunctionVisitor::visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s)
+{
+    ++loop_depth;
+    // The condition is evaluated each iteration, so calls in it are not inlined
+    ++no_inline_depth;
+    s->condition = std::any_cast<std::shared_ptr<expr::Expression>>(visit(s->condition));
+    --no_inline_depth;
+
+    if (s->body) {
+        s->body = visit_nested_statement(s->body);
+    }
+    --loop_depth;
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any InlineFunctionVisitor::visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s)
+{
+    // The init statement is run once before the loop, so calls in it can be inlined before
+    // the loop
+    if (s->init) {
+        s->init = result_or_nullptr<stmt::Statement>(visit(s->init));
+    }
+
+    ++loop_depth;
+    ++no_inline_depth;
+    if (s->condition) {
+        s->condition = result_or_nullptr<expr::Expression>(visit(s->condition));
+    }
+    if (s->advance) {
+        s->advance = result_or_nullptr<expr::Expression>(visit(s->advance));
+    }
+    --no_inline_depth;
+
+    if (s->body) {
+        s->body = visit_nested_statement(s->body);
+    }
+    --loop_depth;
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any InlineFunctionVisitor::visit_stmt_expression(
+    const std::shared_ptr<ast::stmt::Expression> &s)
+{
+    if (s->expr->get_node_type() == NodeType::EXPR_FCN_CALL) {
+        discarded_call = s->expr;
+    }
+    auto result = ModifyingVisitor::visit_stmt_expression(s);
+    discarded_call = nullptr;
+    return result;
+}
+
+std::any InlineFunctionVisitor::visit_expr_binary(const std::shared_ptr<ast::expr::Binary> &e)
+{
+    if (e->get_node_type() != NodeType::EXPR_LOGIC_AND &&
+        e->get_node_type() != NodeType::EXPR_LOGIC_OR) {
+        return ModifyingVisitor::visit_expr_binary(e);
+    }
+
+    // The right hand side of && and || is only conditionally evaluated, so calls in it are
+    // not inlined
+    e->left = std::any_cast<std::shared_ptr<expr::Expression>>(visit(e->left));
+    ++no_inline_depth;
+    e->right = std::any_cast<std::shared_ptr<expr::Expression>>(visit(e->right));
+    --no_inline_depth;
+    return std::dynamic_pointer_cast<expr::Expression>(e);
+}
+
+std::any InlineFunctionVisitor::visit_expr_function_call(
+    const std::shared_ptr<ast::expr::FunctionCall> &e)
+{
+    // Inline any calls in the arguments first
+    ModifyingVisitor::visit_expr_function_call(e);
+
+    auto fnd = resolver_result->call_expr.find(e);
+    if (fnd == resolver_result->call_expr.end() || fnd->second->is_builtin()) {
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+
+    // We can't inline calls outside of statements (e.g., in global initializers) as there's
+    // nowhere to put the inlined body
+    const auto &fn = fnd->second;
+    if (no_inline_depth > 0 || pending_stmts.empty() || inline_depth >= MAX_INLINE_DEPTH ||
+        !should_inline(fn)) {
+        if (remarks_enabled) {
+            report_remark(RemarkKind::MISSED,
+                          e->get_token(),
+                          "'" + fn->get_text() + "' not inlined: " + missed_reason(fn));
+        }
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+    if (remarks_enabled) {
+        report_remark(RemarkKind::APPLIED,
+                      e->get_token(),
+                      "'" + fn->get_text() + "' inlined (cost " +
+                          std::to_string(inline_decisions[fn].cost) + ")");
+    }
+    return inline_call(e, fn);
+}
+
+void InlineFunctionVisitor::make_inline_decisions(const std::shared_ptr<ast::AST> &ast)
+{
+    std::vector<std::shared_ptr<decl::Function>> functions;
+    for (const auto &n : ast->top_level_decls) {
+        auto fn = std::dynamic_pointer_cast<decl::Function>(n);
+        if (fn && !fn->is_builtin()) {
+            functions.push_back(fn);
+            inline_decisions[fn] = InlineDecision();
+        }
+    }
+
+    for (const auto &fn : functions) {
+        auto &decision = inline_decisions[fn];
+        decision.cost = count_nodes(fn->block);
+        decision.num_call_sites = call_graph->num_call_sites.at(fn);
+        const bool recursive = call_graph->is_recursive(fn);
+
+        const auto &stmts = fn->block->statements;
+        const size_t num_returns = count_returns(fn->block);
+        const bool single_exit =
+            num_returns == 0 ||
+            (num_returns == 1 && stmts.back()->get_node_type() == NodeType::STMT_RETURN);
+
+        if (fn->has_attribute("noinline")) {
+            decision.reason = "marked [noinline]";
+        } else if (recursive) {
+            decision.reason = "function is recursive";
+        } else if (!single_exit) {
+            decision.reason = "function returns before the end of its body";
+        } else {
+            decision.inline_calls = true;
+            decision.forced = fn->has_attribute("inline");
+            if (!decision.forced && decision.num_call_sites > 1 &&
+                decision.cost > inline_threshold) {
+                decision.reason = "cost " + std::to_string(decision.cost) +
+                                  " exceeds inline threshold " +
+                                  std::to_string(inline_threshold);
+            }
+        }
+
+        // [inline] hints generated by profile guided optimization are dropped silently
+        auto inline_attrib = fn->get_attribute("inline");
+        if (inline_attrib && inline_attrib->token && !decision.inline_calls) {
+            report_warning(inline_attrib->token,
+                           "Function '" + fn->get_text() +
+                               "' is marked [inline] but cannot be inlined: " +
+                               decision.reason);
+        }
+    }
+}
+
+std::vector<std::shared_ptr<ast::stmt::Statement>> InlineFunctionVisitor::visit_statement(
+    const std::shared_ptr<ast::stmt::Statement> &s)
+{
+    pending_stmts.emplace_back();
+    auto result = visit(s);
+    auto statements = std::move(pending_stmts.back());
+    pending_stmts.pop_back();
+
+    collect_results(result, statements);
+    return statements;
+}
+
+std::shared_ptr<ast::stmt::Statement> InlineFunctionVisitor::visit_nested_statement(
+    const std::shared_ptr<ast::stmt::Statement> &s)
+{
+    auto statements = visit_statement(s);
+    if (statements.size() == 1) {
+        return statements[0];
+    }
+    return std::make_shared<stmt::Block>(nullptr, statements);
+}
+
+bool InlineFunctionVisitor::should_inline(const std::shared_ptr<ast::decl::Function> &fn)
+{
+    const auto &decision = inline_decisions[fn];
+    if (!decision.inline_calls) {
+        return false;
+    }
+    // Functions with a single call site are always inlined, since we can then remove the
+    // function entirely
+    if (decision.forced || decision.num_call_sites == 1) {
+        return true;
+    }
+    const size_t threshold =
+        loop_depth > 0 ? inline_threshold * LOOP_INLINE_THRESHOLD_SCALE : inline_threshold;
+    return decision.cost <= threshold;
+}
+
+std::string InlineFunctionVisitor::missed_reason(
+    const std::shared_ptr<ast::decl::Function> &fn)
+{
+    if (no_inline_depth > 0) {
+        return "call is in a loop condition or the right hand side of && or ||";
+    }
+    if (pending_stmts.empty()) {
+        return "call is outside of a function body";
+    }
+    if (inline_depth >= MAX_INLINE_DEPTH) {
+        return "maximum inline depth of " + std::to_string(MAX_INLINE_DEPTH) + " reached";
+    }
+    const auto &decision = inline_decisions[fn];
+    if (!decision.inline_calls) {
+        return decision.reason;
+    }
+    const size_t threshold =
+        loop_depth > 0 ? inline_threshold * LOOP_INLINE_THRESHOLD_SCALE : inline_threshold;
+    return "cost " + std::to_string(decision.cost) + " exceeds inline threshold " +
+           std::to_string(threshold);
+}
+
+std::any InlineFunctionVisitor::inline_call(
+    const std::shared_ptr<ast::expr::FunctionCall> &call,
+    const std::shared_ptr<ast::decl::Function> &fn)
+{
+    if (call->args.size() != fn->parameters.size()) {
+        report_error(call->get_token(),
+                     "Incorrect number of arguments passed to '" + fn->get_text() + "'");
+        return std::dynamic_pointer_cast<expr::Expression>(call);
+    }
+
+    // The inlined variables are given reserved names so they can't shadow or collide with
+    // the variables at the call site. The result variable is named separately from the
+    // prefix, which is applied to the function's own locals
+    const std::string inline_id = std::to_string(inline_counter++);
+    const std::string prefix = COMPILER_NAME_PREFIX + fn->get_text() + "_inl" + inline_id + "_";
+    CloneVisitor cloner(resolver_result, prefix);
+
+    std::vector<std::shared_ptr<stmt::Statement>> statements;
+    std::vector<std::pair<std::shared_ptr<expr::Expression>, std::shared_ptr<decl::Variable>>>
+        write_backs;
+    for (size_t i = 0; i < fn->parameters.size(); ++i) {
+        const auto &param = fn->parameters[i];
+        const auto &arg = call->args[i];
+        const bool is_output = is_output_param(param);
+
+        if (is_output && !accessed_variable(arg, *resolver_result)) {
+            report_error(call->get_token(),
+                         "Argument for out/inout parameter '" + param->get_text() +
+                             "' must be a variable");
+            return std::dynamic_pointer_cast<expr::Expression>(call);
+        }
+
+        // Constants passed to parameters that are never written can be substituted directly
+        // to allow constant folding across the call. Resource parameters are just handles to
+        // the resource, so the resource variable passed can also be substituted directly
+        const auto param_base_type = param->get_type()->base_type;
+        const bool is_resource = param_base_type == ty::BaseType::BUFFER ||
+                                 param_base_type == ty::BaseType::TEXTURE ||
+                                 param_base_type == ty::BaseType::ACCELERATION_STRUCTURE;
+        if (!is_output &&
+            (arg->get_node_type() == NodeType::EXPR_LITERAL_CONSTANT ||
+             (is_resource && arg->get_node_type() == NodeType::EXPR_LITERAL_VAR)) &&
+            !is_variable_written(fn->block, param, *resolver_result)) {
+            cloner.substitutions[param] = arg;
+            continue;
+        }
+
+        // The local variable replacing the parameter keeps any const modifier, but drops the
+        // in/out modifiers which are only valid on parameters
+        auto local_type = ty::copy_type(param->get_type());
+        local_type->modifiers.erase(ty::Modifier::IN);
+        local_type->modifiers.erase(ty::Modifier::OUT);
+        local_type->modifiers.erase(ty::Modifier::IN_OUT);
+        if (local_type->base_type == ty::BaseType::STRUCT) {
+            auto orig_struct = std::dynamic_pointer_cast<ty::Struct>(param->get_type());
+            resolver_result->struct_type[std::dynamic_pointer_cast<ty::Struct>(local_type)] =
+                resolver_result->struct_type[orig_struct];
+        }
+
+        // out parameters are uninitialized on entry to the function
+        const bool is_out_only = param->get_type()->modifiers.contains(ty::Modifier::OUT) &&
+                                 !param->get_type()->modifiers.contains(ty::Modifier::IN);
+        std::shared_ptr<expr::Expression> init = is_out_only ? nullptr : arg;
+        // For inout params the argument is also the write back target, so we need a copy
+        // of it for the initializer
+        if (init && is_output) {
+            init = CloneVisitor(resolver_result).clone(arg);
+        }
+
+        auto local = std::make_shared<decl::Variable>(
+            prefix + param->get_text(), nullptr, local_type, init);
+        statements.push_back(std::make_shared<stmt::VariableDeclaration>(nullptr, local));
+        cloner.decl_remap[param] = local;
+
+        if (is_output) {
+            write_backs.emplace_back(arg, local);
+        }
+    }
+
+    auto return_type = std::dynamic_pointer_cast<ty::Function>(fn->get_type())->return_type;
+    const bool has_result = !is_void_type(return_type) && call != discarded_call;
+    std::shared_ptr<decl::Variable> result;
+    if (has_result) {
+        result = std::make_shared<decl::Variable>(
+            COMPILER_NAME_PREFIX + "ret" + inline_id, nullptr, return_type);
+        statements.push_back(std::make_shared<stmt::VariableDeclaration>(nullptr, result));
+    }
+
+    // Copy the function body and replace the trailing return with an assignment to the
+    // result variable
+    auto body = cloner.clone(fn->block);
+    if (!body->statements.empty() &&
+        body->statements.back()->get_node_type() == NodeType::STMT_RETURN) {
+        auto ret = std::dynamic_pointer_cast<stmt::Return>(body->statements.back());
+        body->statements.pop_back();
+        if (ret->expression && result) {
+            auto result_var = std::make_shared<expr::Variable>(result->get_text());
+            resolver_result->var_expr[result_var] = result;
+            body->statements.push_back(std::make_shared<stmt::Expression>(
+                nullptr, std::make_shared<expr::Assignment>(result_var, ret->expression)));
+        } else if (ret->expression &&
+                   ret->expression->get_node_type() == NodeType::EXPR_FCN_CALL) {
+            // If the result is unused we still need to keep any call made in the return
+            // statement for its side effects
+            body->statements.push_back(
+                std::make_shared<stmt::Expression>(nullptr, ret->expression));
+        }
+    }
+
+    // Inline any calls made by the inlined body
+    ++inline_depth;
+    body = std::dynamic_pointer_cast<stmt::Block>(
+        std::any_cast<std::shared_ptr<stmt::Statement>>(visit(body)));
+    --inline_depth;
+    statements.push_back(body);
+
+    // Write the out/inout parameters back to the arguments passed
+    for (const auto &wb : write_backs) {
+        auto param_var = std::make_shared<expr::Variable>(wb.second->get_text());
+        resolver_result->var_expr[param_var] = wb.second;
+        statements.push_back(std::make_shared<stmt::Expression>(
+            nullptr, std::make_shared<expr::Assignment>(wb.first, param_var)));
+    }
+
+    auto &pending = pending_stmts.back();
+    pending.insert(pending.end(), statements.begin(), statements.end());
+    ++num_inlined_calls;
+
+    if (!result) {
+        return std::any();
+    }
+
+    auto result_var = std::make_shared<expr::Variable>(result->get_text());
+    resolver_result->var_expr[result_var] = result;
+    // Apply any struct/array access made on the returned value to the result variable
+    if (!call->struct_array_access.empty()) {
+        return std::dynamic_pointer_cast<expr::Expression>(
+            std::make_shared<expr::StructArrayAccess>(result_var,
+                                                      call->struct_array_access));
+    }
+    return std::dynamic_pointer_cast<expr::Expression>(result_var);
+}
+}
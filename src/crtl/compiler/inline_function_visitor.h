@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ast/modifying_visitor.h"
+#include "call_graph_analysis.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+// Default max cost (in AST nodes) of functions that will be inlined without an [inline]
+// attribute
+const size_t DEFAULT_INLINE_THRESHOLD = 40;
+
+struct InlineDecision {
+    // If calls to the function should be inlined
+    bool inline_calls = false;
+    // If the function was marked [inline] and should be inlined regardless of its cost
+    bool forced = false;
+    // The estimated cost of the function, as the number of AST nodes in its body
+    size_t cost = 0;
+    // The number of calls to the function found in the program
+    size_t num_call_sites = 0;
+    // A description of why the function won't be inlined, if it won't be
+    std::string reason;
+};
+
+/* The InlineFunctionVisitor inlines calls to user functions into their call sites. Which
+ * functions are inlined is decided by a simple size based cost model, which can be
+ * overridden by marking functions [inline] or [noinline]. Calls are inlined by replacing
+ * the call with a variable holding its return value and inserting the function body before
+ * the statement containing the call:
+ *
+ * - Function parameters become local variables initialized by the arguments. Parameters
+ *   that are never written and passed a constant have the constant substituted directly
+ * - out and inout parameters are written back to their arguments after the inlined body
+ * - Locals of the inlined function are renamed to avoid colliding with the caller's names
+ *
+ * Functions can only be inlined if their only return statement is the last statement in the
+ * function. Calls that are conditionally evaluated or evaluated multiple times within a
+ * statement (loop conditions or the right hand side of && and ||) are not inlined. User
+ * functions that have all their calls inlined are removed from the AST.
+ */
+class InlineFunctionVisitor : public ast::ModifyingVisitor {
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+    std::shared_ptr<CallGraphAnalysis> call_graph;
+
+    size_t inline_threshold = DEFAULT_INLINE_THRESHOLD;
+
+    // Statements to insert before the statement currently being visited in each enclosing
+    // block, used to insert the bodies of inlined calls
+    std::vector<std::vector<std::shared_ptr<ast::stmt::Statement>>> pending_stmts;
+
+    // When > 0 we're visiting an expression that isn't always evaluated exactly once when
+    // its statement is executed, and calls within it can't be inlined
+    size_t no_inline_depth = 0;
+
+    // The depth of loops containing the current node
+    size_t loop_depth = 0;
+
+    // The depth of inlined bodies being visited, to limit how deep we'll inline nested calls
+    size_t inline_depth = 0;
+
+    // The call expression statement being visited, whose return value is unused
+    std::shared_ptr<ast::expr::Expression> discarded_call;
+
+    // Counter used to generate unique names for the variables of each inlined call
+    size_t inline_counter = 0;
+
+public:
+    // The inlining decision made for each user function in the program
+    phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Function>, InlineDecision>
+        inline_decisions;
+
+    // The number of calls that were inlined
+    size_t num_inlined_calls = 0;
+
+    InlineFunctionVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result,
+                          const std::shared_ptr<CallGraphAnalysis> &call_graph,
+                          const size_t inline_threshold = DEFAULT_INLINE_THRESHOLD);
+
+    std::any visit_ast(const std::shared_ptr<ast::AST> &ast) override;
+
+    std::any visit_stmt_block(const std::shared_ptr<ast::stmt::Block> &s) override;
+    std::any visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s) override;
+    std::any visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s) override;
+    std::any visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s) override;
+    std::any visit_stmt_expression(
+        const std::shared_ptr<ast::stmt::Expression> &s) override;
+
+    std::any visit_expr_binary(const std::shared_ptr<ast::expr::Binary> &e) override;
+    std::any visit_expr_function_call(
+        const std::shared_ptr<ast::expr::FunctionCall> &e) override;
+
+private:
+    // Compute the inlining decision for each user function in the program
+    void make_inline_decisions(const std::shared_ptr<ast::AST> &ast);
+
+    /* Visit the statement and return it along with the statements for any calls inlined
+     * into it, which must be inserted before it
+     */
+    std::vector<std::shared_ptr<ast::stmt::Statement>> visit_statement(
+        const std::shared_ptr<ast::stmt::Statement> &s);
+
+    /* Visit a statement nested in another statement, e.g. an if branch or loop body. If
+     * calls were inlined into the statement it's wrapped into a block along with the inlined
+     * bodies
+     */
+    std::shared_ptr<ast::stmt::Statement> visit_nested_statement(
+        const std::shared_ptr<ast::stmt::Statement> &s);
+
+    // Check if the call should be inlined at this call site
+    bool should_inline(const std::shared_ptr<ast::decl::Function> &fn);
+
+    // Describe why the call at this call site isn't inlined, for the missed remark
+    std::string missed_reason(const std::shared_ptr<ast::decl::Function> &fn);
+
+    /* Inline the call, appending the inlined body to the pending statements and returning
+     * the expression to replace the call with. Returns an empty std::any if the call's
+     * result is unused
+     */
+    std::any inline_call(const std::shared_ptr<ast::expr::FunctionCall> &call,
+                         const std::shared_ptr<ast::decl::Function> &fn);
+};
+}
@@ -25,6 +25,9 @@ std::any JSONVisitor::visit_decl_function(const std::shared_ptr<decl::Function>
         d_json["line"] = sym->token->getLine();
     }
     d_json["type"] = d->get_type()->to_string();
+    if (d->is_generic()) {
+        d_json["type_parameters"] = d->type_parameters;
+    }
 
     auto children = d->get_children();
     // Get a list of just the parameters to visit
@@ -409,7 +412,7 @@ std::vector<nlohmann::json> JSONVisitor::visit_struct_array_fragments(
         if (struct_fragment) {
             nlohmann::json j;
             j["ast_node"] = "ast::expr::StructMemberAccessFragment";
-            j["member_name"] = struct_fragment->member->getText();
+            j["member_name"] = struct_fragment->name();
             results.push_back(j);
         } else {
             auto array_fragment = std::dynamic_pointer_cast<expr::ArrayAccessFragment>(f);
@@ -0,0 +1,388 @@
+#include "loop_invariant_code_motion_visitor.h"
+#include "ast_utils.h"
+#include "builtins.h"
+#include "expression_type.h"
+
+namespace crtl {
+
+using namespace ast;
+
+// Check if hoisting the expression saves any work, reading a variable or struct member
+// directly doesn't
+bool is_worth_hoisting(const std::shared_ptr<expr::Expression> &e)
+{
+    if (e->get_node_type() == NodeType::EXPR_STRUCT_ARRAY_ACCESS) {
+        auto access = std::dynamic_pointer_cast<expr::StructArrayAccess>(e);
+        return has_array_access(access->struct_array_access);
+    }
+    return e->get_node_type() != NodeType::EXPR_LITERAL_VAR && !is_constant_expression(e);
+}
+
+/* Check if evaluating the expression where it wouldn't otherwise be evaluated may be
+ * undefined behavior: array accesses may be out of bounds, since buffers bound as root
+ * descriptors aren't bounds checked, and integer divisions may divide by zero
+ */
+bool may_trap(const std::shared_ptr<expr::Expression> &e, const ResolverPassResult &resolved)
+{
+    switch (e->get_node_type()) {
+    case NodeType::EXPR_STRUCT_ARRAY_ACCESS:
+        if (has_array_access(
+                std::dynamic_pointer_cast<expr::StructArrayAccess>(e)->struct_array_access)) {
+            return true;
+        }
+        break;
+    case NodeType::EXPR_FCN_CALL:
+        if (has_array_access(
+                std::dynamic_pointer_cast<expr::FunctionCall>(e)->struct_array_access)) {
+            return true;
+        }
+        break;
+    case NodeType::EXPR_DIV: {
+        auto elem = element_type(infer_expression_type(e, resolved));
+        if (!elem || (elem->type_id != ty::PrimitiveType::FLOAT &&
+                      elem->type_id != ty::PrimitiveType::DOUBLE &&
+                      elem->type_id != ty::PrimitiveType::HALF)) {
+            return true;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    for (const auto &c : e->get_children()) {
+        auto child = std::dynamic_pointer_cast<expr::Expression>(c);
+        if (child && may_trap(child, resolved)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+LoopInvariantCodeMotionVisitor::LoopInvariantCodeMotionVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result)
+    : resolver_result(resolver_result)
+{
+}
+
+std::any LoopInvariantCodeMotionVisitor::visit_stmt_while(
+    const std::shared_ptr<ast::stmt::While> &s)
+{
+    // Process any nested loops first
+    ModifyingVisitor::visit_stmt_while(s);
+    // The condition is evaluated whenever the loop is reached, the body may never run
+    return hoist_invariants(s, {{s->condition, true}, {s->body, false}});
+}
+
+std::any LoopInvariantCodeMotionVisitor::visit_stmt_for(
+    const std::shared_ptr<ast::stmt::For> &s)
+{
+    ModifyingVisitor::visit_stmt_for(s);
+    // The init statement is only evaluated once, so there's nothing to gain from hoisting
+    // expressions out of it. The advance expression runs at least once if the body does and
+    // doesn't return
+    const bool runs_body = runs_at_least_once(s);
+    const bool runs_advance = runs_body && (!s->body || count_returns(s->body) == 0);
+    return hoist_invariants(
+        s, {{s->condition, true}, {s->advance, runs_advance}, {s->body, runs_body}});
+}
+
+std::shared_ptr<ast::stmt::Statement> LoopInvariantCodeMotionVisitor::hoist_invariants(
+    const std::shared_ptr<ast::stmt::Statement> &loop,
+    const std::vector<std::pair<std::shared_ptr<ast::Node>, bool>> &evaluated_per_iteration)
+{
+    LoopWrites writes;
+    collect_writes(loop, writes);
+
+    std::vector<std::shared_ptr<expr::Expression>> invariants;
+    for (const auto &n : evaluated_per_iteration) {
+        if (n.first) {
+            collect_invariants(n.first, writes, n.second, invariants);
+        }
+    }
+
+    /* Note: the hoisted expressions are evaluated even if the loop runs zero times or the
+     * expression is in a branch that's not taken. This is safe since the expressions are
+     * pure, and those that may trap are only hoisted if they're evaluated whenever the loop
+     * is reached.
+     */
+    std::vector<std::shared_ptr<stmt::Statement>> statements;
+    for (const auto &e : invariants) {
+        auto type = infer_expression_type(e, *resolver_result);
+        if (!type || is_void_type(type)) {
+            continue;
+        }
+        auto temp = std::make_shared<decl::Variable>(
+            COMPILER_NAME_PREFIX + "licm" + std::to_string(temp_counter++),
+            nullptr,
+            type,
+            nullptr);
+        replace_expression(loop, e, make_variable(temp));
+        temp->expression = e;
+        statements.push_back(std::make_shared<stmt::VariableDeclaration>(nullptr, temp));
+        ++num_hoisted;
+        report_remark(RemarkKind::APPLIED,
+                      e->get_token(),
+                      "Loop invariant expression hoisted out of the loop");
+    }
+
+    if (statements.empty()) {
+        return loop;
+    }
+    statements.push_back(loop);
+    return std::make_shared<stmt::Block>(nullptr, statements);
+}
+
+void LoopInvariantCodeMotionVisitor::collect_writes(const std::shared_ptr<ast::Node> &n,
+                                                    LoopWrites &writes)
+{
+    auto add_write = [&](const std::shared_ptr<expr::Expression> &e) {
+        auto var = accessed_variable(e, *resolver_result);
+        if (var) {
+            writes.variables.insert(var);
+            // The resource may be a local or parameter referring to some other resource
+            writes.rw_resources = writes.rw_resources || is_rw_resource(var->get_type());
+        }
+    };
+
+    switch (n->get_node_type()) {
+    case NodeType::DECL_VAR:
+        writes.variables.insert(std::dynamic_pointer_cast<decl::Variable>(n));
+        break;
+    case NodeType::EXPR_ASSIGN:
+        add_write(std::dynamic_pointer_cast<expr::Assignment>(n)->lhs);
+        break;
+    case NodeType::EXPR_FCN_CALL: {
+        auto call = std::dynamic_pointer_cast<expr::FunctionCall>(n);
+        auto fnd = resolver_result->call_expr.find(call);
+        // User functions may write to any read-write resource
+        if (fnd == resolver_result->call_expr.end() || !fnd->second->is_builtin()) {
+            writes.rw_resources = true;
+        }
+        if (fnd != resolver_result->call_expr.end()) {
+            const auto &params = fnd->second->parameters;
+            for (size_t i = 0; i < call->args.size() && i < params.size(); ++i) {
+                if (is_output_param(params[i])) {
+                    add_write(call->args[i]);
+                }
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    for (const auto &c : n->get_children()) {
+        collect_writes(c, writes);
+    }
+}
+
+bool LoopInvariantCodeMotionVisitor::is_invariant(
+    const std::shared_ptr<ast::expr::Expression> &e, const LoopWrites &writes)
+{
+    auto fragments_invariant =
+        [&](const std::vector<std::shared_ptr<expr::StructArrayAccessFragment>> &fragments) {
+            for (const auto &f : fragments) {
+                auto array_access = std::dynamic_pointer_cast<expr::ArrayAccessFragment>(f);
+                if (array_access && !is_invariant(array_access->index, writes)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+    switch (e->get_node_type()) {
+    case NodeType::EXPR_LITERAL_CONSTANT:
+        return true;
+    case NodeType::EXPR_LITERAL_VAR: {
+        auto var = accessed_variable(e, *resolver_result);
+        return var && !writes.variables.contains(var) &&
+               !(writes.rw_resources && is_rw_resource(var->get_type()));
+    }
+    case NodeType::EXPR_NEGATE:
+    case NodeType::EXPR_LOGIC_NOT:
+        return is_invariant(std::dynamic_pointer_cast<expr::Unary>(e)->expr, writes);
+    case NodeType::EXPR_MULT:
+    case NodeType::EXPR_DIV:
+    case NodeType::EXPR_ADD:
+    case NodeType::EXPR_SUB:
+    case NodeType::EXPR_SHIFT_LEFT:
+    case NodeType::EXPR_SHIFT_RIGHT:
+    case NodeType::EXPR_CMP_LESS:
+    case NodeType::EXPR_CMP_LESS_EQUAL:
+    case NodeType::EXPR_CMP_GREATER:
+    case NodeType::EXPR_CMP_GREATER_EQUAL:
+    case NodeType::EXPR_CMP_NOT_EQUAL:
+    case NodeType::EXPR_CMP_EQUAL:
+    case NodeType::EXPR_LOGIC_AND:
+    case NodeType::EXPR_LOGIC_OR: {
+        auto binary = std::dynamic_pointer_cast<expr::Binary>(e);
+        return is_invariant(binary->left, writes) && is_invariant(binary->right, writes);
+    }
+    case NodeType::EXPR_STRUCT_ARRAY_ACCESS: {
+        auto access = std::dynamic_pointer_cast<expr::StructArrayAccess>(e);
+        return is_invariant(access->variable, writes) &&
+               fragments_invariant(access->struct_array_access);
+    }
+    case NodeType::EXPR_FCN_CALL: {
+        auto call = std::dynamic_pointer_cast<expr::FunctionCall>(e);
+        auto fnd = resolver_result->call_expr.find(call);
+        // Wave builtins depend on the lanes active in the loop, which may change each
+        // iteration
+        if (fnd == resolver_result->call_expr.end() || !fnd->second->is_builtin() ||
+            is_wave_builtin(fnd->second->get_text())) {
+            return false;
+        }
+        for (const auto &p : fnd->second->parameters) {
+            if (is_output_param(p)) {
+                return false;
+            }
+        }
+        for (const auto &a : call->args) {
+            if (!is_invariant(a, writes)) {
+                return false;
+            }
+        }
+        return fragments_invariant(call->struct_array_access);
+    }
+    default:
+        return false;
+    }
+}
+
+void LoopInvariantCodeMotionVisitor::collect_invariants(
+    const std::shared_ptr<ast::Node> &n,
+    const LoopWrites &writes,
+    const bool unconditional,
+    std::vector<std::shared_ptr<ast::expr::Expression>> &invariants)
+{
+    auto e = std::dynamic_pointer_cast<expr::Expression>(n);
+    if (e && is_invariant(e, writes) && (unconditional || !may_trap(e, *resolver_result))) {
+        if (is_worth_hoisting(e)) {
+            invariants.push_back(e);
+        }
+        return;
+    }
+
+    switch (n->get_node_type()) {
+    case NodeType::STMT_BLOCK: {
+        // Statements after one that may return are not reached on every iteration
+        bool reached = unconditional;
+        for (const auto &st : std::dynamic_pointer_cast<stmt::Block>(n)->statements) {
+            collect_invariants(st, writes, reached, invariants);
+            reached = reached && count_returns(st) == 0;
+        }
+        return;
+    }
+    case NodeType::STMT_IF_ELSE: {
+        auto if_else = std::dynamic_pointer_cast<stmt::IfElse>(n);
+        collect_invariants(if_else->condition, writes, unconditional, invariants);
+        collect_invariants(if_else->if_branch, writes, false, invariants);
+        if (if_else->else_branch) {
+            collect_invariants(if_else->else_branch, writes, false, invariants);
+        }
+        return;
+    }
+    case NodeType::STMT_WHILE: {
+        auto loop = std::dynamic_pointer_cast<stmt::While>(n);
+        collect_invariants(loop->condition, writes, unconditional, invariants);
+        if (loop->body) {
+            collect_invariants(loop->body, writes, false, invariants);
+        }
+        return;
+    }
+    case NodeType::STMT_FOR: {
+        auto loop = std::dynamic_pointer_cast<stmt::For>(n);
+        const std::vector<std::pair<std::shared_ptr<ast::Node>, bool>> parts = {
+            {loop->init, unconditional},
+            {loop->condition, unconditional},
+            {loop->advance, false},
+            {loop->body, false}};
+        for (const auto &p : parts) {
+            if (p.first) {
+                collect_invariants(p.first, writes, p.second, invariants);
+            }
+        }
+        return;
+    }
+    case NodeType::EXPR_LOGIC_AND:
+    case NodeType::EXPR_LOGIC_OR: {
+        // The right hand side is only evaluated depending on the left hand side
+        auto binary = std::dynamic_pointer_cast<expr::Binary>(n);
+        collect_invariants(binary->left, writes, unconditional, invariants);
+        collect_invariants(binary->right, writes, false, invariants);
+        return;
+    }
+    default:
+        break;
+    }
+
+    for (const auto &c : n->get_children()) {
+        collect_invariants(c, writes, unconditional, invariants);
+    }
+    // The index expressions of accesses on a call's return value are not children of the call
+    if (n->get_node_type() == NodeType::EXPR_FCN_CALL) {
+        auto call = std::dynamic_pointer_cast<expr::FunctionCall>(n);
+        for (const auto &f : call->struct_array_access) {
+            auto array_access = std::dynamic_pointer_cast<expr::ArrayAccessFragment>(f);
+            if (array_access) {
+                collect_invariants(array_access->index, writes, unconditional, invariants);
+            }
+        }
+    }
+}
+
+bool LoopInvariantCodeMotionVisitor::runs_at_least_once(
+    const std::shared_ptr<ast::stmt::For> &s)
+{
+    if (!s->init || !s->condition) {
+        return false;
+    }
+
+    // Find the counter and its initial value from the init statement
+    std::shared_ptr<decl::Variable> counter;
+    std::optional<int64_t> start;
+    if (s->init->get_node_type() == NodeType::STMT_VAR_DECL) {
+        counter = std::dynamic_pointer_cast<stmt::VariableDeclaration>(s->init)->var_decl;
+        if (counter->expression) {
+            start = eval_int_constant(counter->expression, *resolver_result);
+        }
+    } else if (s->init->get_node_type() == NodeType::STMT_EXPR) {
+        auto init = std::dynamic_pointer_cast<stmt::Expression>(s->init)->expr;
+        auto assign = std::dynamic_pointer_cast<expr::Assignment>(init);
+        if (assign && assign->lhs->get_node_type() == NodeType::EXPR_LITERAL_VAR) {
+            counter = accessed_variable(assign->lhs, *resolver_result);
+            start = eval_int_constant(assign->value, *resolver_result);
+        }
+    }
+    if (!counter || !start) {
+        return false;
+    }
+
+    // The condition must hold for the initial value when comparing it against a constant
+    auto is_counter = [&](const std::shared_ptr<expr::Expression> &e) {
+        return e->get_node_type() == NodeType::EXPR_LITERAL_VAR &&
+               accessed_variable(e, *resolver_result) == counter;
+    };
+    auto condition = std::dynamic_pointer_cast<expr::Binary>(s->condition);
+    if (!condition) {
+        return false;
+    }
+    NodeType comparison = condition->get_node_type();
+    std::optional<int64_t> bound;
+    if (is_counter(condition->left)) {
+        bound = eval_int_constant(condition->right, *resolver_result);
+    } else if (is_counter(condition->right)) {
+        bound = eval_int_constant(condition->left, *resolver_result);
+        comparison = swap_comparison(comparison);
+    }
+    return bound && compare_constants(comparison, *start, *bound);
+}
+
+std::shared_ptr<ast::expr::Variable> LoopInvariantCodeMotionVisitor::make_variable(
+    const std::shared_ptr<ast::decl::Variable> &var)
+{
+    auto var_expr = std::make_shared<expr::Variable>(var->get_text());
+    resolver_result->var_expr[var_expr] = var;
+    return var_expr;
+}
+}
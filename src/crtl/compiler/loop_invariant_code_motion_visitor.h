@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ast/modifying_visitor.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* The LoopInvariantCodeMotionVisitor hoists expressions computing the same value on every
+ * iteration of a while or for loop out of the loop. An expression is loop invariant if it's
+ * pure (arithmetic, comparisons, struct member and buffer/texture loads, and builtin calls
+ * without out parameters, other than the wave builtins) and only reads variables that are
+ * declared outside the loop and not written within it. Loads from read-write resources are
+ * only invariant if the loop doesn't store to any read-write resource or call a user
+ * function, since read-write resources may alias each other.
+ *
+ * Array accesses and integer divisions are only hoisted if they're evaluated whenever the
+ * loop is reached: in the loop condition, or unconditionally in the body of a for loop known
+ * to run at least once. Elsewhere they might be out of bounds or divide by zero in the
+ * iterations that would skip them.
+ *
+ * Each maximal invariant expression is stored in a new temporary declared before the loop,
+ * and the loop is wrapped in a block with the temporaries. Nested loops are processed first,
+ * so invariant expressions are hoisted out of as many loops as they're invariant in.
+ */
+class LoopInvariantCodeMotionVisitor : public ast::ModifyingVisitor {
+    // The variables modified by a loop
+    struct LoopWrites {
+        // Variables written or declared within the loop
+        phmap::flat_hash_set<std::shared_ptr<ast::decl::Variable>> variables;
+        // If the loop may write to read-write resources
+        bool rw_resources = false;
+    };
+
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+    // Counter used to generate unique names for the temporary variables
+    size_t temp_counter = 0;
+
+public:
+    // The number of expressions hoisted out of loops
+    size_t num_hoisted = 0;
+
+    LoopInvariantCodeMotionVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result);
+
+    std::any visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s) override;
+    std::any visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s) override;
+
+private:
+    /* Hoist the invariant expressions in the loop's condition, advance expression and body
+     * into temporaries, returning the loop wrapped in a block with the temporaries. If
+     * nothing can be hoisted the loop is returned as is. Each part of the loop is paired
+     * with whether it's evaluated whenever the loop is reached
+     */
+    std::shared_ptr<ast::stmt::Statement> hoist_invariants(
+        const std::shared_ptr<ast::stmt::Statement> &loop,
+        const std::vector<std::pair<std::shared_ptr<ast::Node>, bool>>
+            &evaluated_per_iteration);
+
+    // Collect the variables written or declared in the subtree
+    void collect_writes(const std::shared_ptr<ast::Node> &n, LoopWrites &writes);
+
+    // Check if the expression computes the same value on each iteration of the loop
+    bool is_invariant(const std::shared_ptr<ast::expr::Expression> &e,
+                      const LoopWrites &writes);
+
+    /* Collect the maximal invariant expressions in the subtree which are worth hoisting.
+     * If the subtree isn't evaluated unconditionally whenever the loop is reached,
+     * expressions that may trap are not collected
+     */
+    void collect_invariants(const std::shared_ptr<ast::Node> &n,
+                            const LoopWrites &writes,
+                            const bool unconditional,
+                            std::vector<std::shared_ptr<ast::expr::Expression>> &invariants);
+
+    // Check if the for loop's condition holds on entry, from its counter's constant initial
+    // value and a constant bound
+    bool runs_at_least_once(const std::shared_ptr<ast::stmt::For> &s);
+
+    std::shared_ptr<ast::expr::Variable> make_variable(
+        const std::shared_ptr<ast::decl::Variable> &var);
+};
+}
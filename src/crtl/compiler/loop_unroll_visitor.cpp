@@ -0,0 +1,319 @@
+#include "loop_unroll_visitor.h"
+#include <limits>
+#include "ast_utils.h"
+#include "clone_visitor.h"
+
+namespace crtl {
+
+using namespace ast;
+
+// Max trip count of loops we'll unroll, also limits how long we'll simulate the loop counter
+// to compute the trip count
+const size_t MAX_UNROLL_TRIP_COUNT = 1024;
+
+// Max factor to partially unroll loops by when not specified by an [unroll(N)] attribute
+const size_t MAX_PARTIAL_UNROLL_FACTOR = 4;
+
+LoopUnrollVisitor::LoopUnrollVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result, const size_t unroll_threshold)
+    : resolver_result(resolver_result), unroll_threshold(unroll_threshold)
+{
+}
+
+std::any LoopUnrollVisitor::visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s)
+{
+    // Unroll any nested loops first, so the cost of the body includes them
+    ModifyingVisitor::visit_stmt_for(s);
+
+    if (s->has_attribute("loop")) {
+        report_remark(RemarkKind::MISSED, s->get_token(), "Loop not unrolled: marked [loop]");
+        return std::dynamic_pointer_cast<stmt::Statement>(s);
+    }
+
+    // The [unroll] hint is removed from the loops unrolled here to not have the native
+    // compiler unroll them again. Otherwise it's passed on to the native compiler along with
+    // the other hints on the loop
+    auto unroll = s->get_attribute("unroll");
+    auto counter = find_loop_counter(s);
+    if (!counter) {
+        // [unroll] hints generated by profile guided optimization are dropped silently
+        if (unroll && unroll->token) {
+            report_warning(unroll->token,
+                           "Loop marked [unroll] does not have a constant trip count and "
+                           "will only be unrolled by the native compiler");
+        } else if (unroll) {
+            s->remove_attribute("unroll");
+        }
+        report_remark(RemarkKind::MISSED,
+                      s->get_token(),
+                      "Loop not unrolled: it does not have a constant trip count");
+        return std::dynamic_pointer_cast<stmt::Statement>(s);
+    }
+
+    const size_t trip_count = counter->trip_count;
+    const size_t body_cost = s->body ? count_nodes(s->body) : 0;
+    size_t factor = 1;
+    if (unroll) {
+        factor = unroll->args.empty() ? trip_count : std::stoi(unroll->args[0]);
+    } else if (trip_count * body_cost <= unroll_threshold) {
+        factor = trip_count;
+    } else {
+        factor = MAX_PARTIAL_UNROLL_FACTOR;
+        while (factor > 1 && factor * body_cost > unroll_threshold) {
+            factor /= 2;
+        }
+    }
+
+    if (factor >= trip_count) {
+        ++num_unrolled_loops;
+        if (remarks_enabled) {
+            report_remark(RemarkKind::APPLIED,
+                          s->get_token(),
+                          "Loop fully unrolled, trip count " + std::to_string(trip_count));
+        }
+        s->remove_attribute("unroll");
+        return unroll_fully(s, *counter);
+    }
+    if (factor > 1) {
+        ++num_partially_unrolled_loops;
+        if (remarks_enabled) {
+            report_remark(RemarkKind::APPLIED,
+                          s->get_token(),
+                          "Loop partially unrolled by a factor of " + std::to_string(factor) +
+                              ", trip count " + std::to_string(trip_count));
+        }
+        s->remove_attribute("unroll");
+        return unroll_partially(s, *counter, factor);
+    }
+    if (remarks_enabled) {
+        const std::string reason = unroll ? "marked [unroll(1)]"
+                                          : "body cost " + std::to_string(body_cost) +
+                                                " is too large for unroll threshold " +
+                                                std::to_string(unroll_threshold);
+        report_remark(RemarkKind::MISSED, s->get_token(), "Loop not unrolled: " + reason);
+    }
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::optional<LoopUnrollVisitor::LoopCounter> LoopUnrollVisitor::find_loop_counter(
+    const std::shared_ptr<ast::stmt::For> &s)
+{
+    if (!s->init || !s->condition || !s->advance) {
+        return std::nullopt;
+    }
+
+    // Find the counter and its initial value from the init statement
+    LoopCounter counter;
+    std::optional<int64_t> start;
+    if (s->init->get_node_type() == NodeType::STMT_VAR_DECL) {
+        counter.var = std::dynamic_pointer_cast<stmt::VariableDeclaration>(s->init)->var_decl;
+        counter.declared_in_init = true;
+        if (counter.var->expression) {
+            start = eval_int_constant(counter.var->expression, *resolver_result);
+        }
+    } else if (s->init->get_node_type() == NodeType::STMT_EXPR) {
+        auto init = std::dynamic_pointer_cast<stmt::Expression>(s->init)->expr;
+        auto assign = std::dynamic_pointer_cast<expr::Assignment>(init);
+        if (assign && assign->lhs->get_node_type() == NodeType::EXPR_LITERAL_VAR) {
+            counter.var = accessed_variable(assign->lhs, *resolver_result);
+            start = eval_int_constant(assign->value, *resolver_result);
+        }
+    }
+    if (!counter.var || !start) {
+        return std::nullopt;
+    }
+    counter.start = *start;
+
+    // The counter is replaced by int constants in the unrolled loop, there are no uint
+    // constants to substitute for a uint counter
+    auto counter_type = std::dynamic_pointer_cast<ty::Primitive>(counter.var->get_type());
+    if (!counter_type || counter_type->type_id != ty::PrimitiveType::INT) {
+        return std::nullopt;
+    }
+
+    auto is_counter = [&](const std::shared_ptr<expr::Expression> &e) {
+        return e->get_node_type() == NodeType::EXPR_LITERAL_VAR &&
+               accessed_variable(e, *resolver_result) == counter.var;
+    };
+
+    // The condition must compare the counter against a constant
+    auto condition = std::dynamic_pointer_cast<expr::Binary>(s->condition);
+    if (!condition) {
+        return std::nullopt;
+    }
+    NodeType comparison = condition->get_node_type();
+    std::optional<int64_t> bound;
+    if (is_counter(condition->left)) {
+        bound = eval_int_constant(condition->right, *resolver_result);
+    } else if (is_counter(condition->right)) {
+        bound = eval_int_constant(condition->left, *resolver_result);
+        comparison = swap_comparison(comparison);
+    }
+    if (!bound) {
+        return std::nullopt;
+    }
+
+    // The advance must add or subtract a constant from the counter
+    auto advance = std::dynamic_pointer_cast<expr::Assignment>(s->advance);
+    if (!advance || !is_counter(advance->lhs)) {
+        return std::nullopt;
+    }
+    auto step_expr = std::dynamic_pointer_cast<expr::Binary>(advance->value);
+    std::optional<int64_t> step;
+    if (step_expr && step_expr->get_node_type() == NodeType::EXPR_ADD) {
+        if (is_counter(step_expr->left)) {
+            step = eval_int_constant(step_expr->right, *resolver_result);
+        } else if (is_counter(step_expr->right)) {
+            step = eval_int_constant(step_expr->left, *resolver_result);
+        }
+    } else if (step_expr && step_expr->get_node_type() == NodeType::EXPR_SUB &&
+               is_counter(step_expr->left)) {
+        step = eval_int_constant(step_expr->right, *resolver_result);
+        if (step) {
+            step = -*step;
+        }
+    }
+    if (!step || *step == 0) {
+        return std::nullopt;
+    }
+    counter.step = *step;
+
+    if (s->body && is_variable_written(s->body, counter.var, *resolver_result)) {
+        return std::nullopt;
+    }
+
+    // Step the counter until the condition fails to find the trip count. If the counter
+    // would wrap around we don't try to unroll the loop
+    const int64_t min_value = std::numeric_limits<int32_t>::min();
+    const int64_t max_value = std::numeric_limits<int32_t>::max();
+    int64_t value = counter.start;
+    if (value < min_value || value > max_value) {
+        return std::nullopt;
+    }
+    while (compare_constants(comparison, value, *bound)) {
+        if (counter.trip_count == MAX_UNROLL_TRIP_COUNT) {
+            return std::nullopt;
+        }
+        ++counter.trip_count;
+        value += counter.step;
+        if (value < min_value || value > max_value) {
+            return std::nullopt;
+        }
+    }
+    return counter;
+}
+
+std::shared_ptr<ast::stmt::Statement> LoopUnrollVisitor::unroll_fully(
+    const std::shared_ptr<ast::stmt::For> &s, const LoopCounter &counter)
+{
+    std::vector<std::shared_ptr<stmt::Statement>> statements;
+    for (size_t i = 0; i < counter.trip_count && s->body; ++i) {
+        CloneVisitor cloner(resolver_result);
+        cloner.substitutions[counter.var] =
+            make_int_constant(counter.start + i * counter.step);
+        statements.push_back(cloner.clone(s->body));
+        had_error = had_error || cloner.had_error;
+    }
+
+    if (!counter.declared_in_init) {
+        const int64_t final_value = counter.start + counter.trip_count * counter.step;
+        statements.push_back(std::make_shared<stmt::Expression>(
+            nullptr,
+            std::make_shared<expr::Assignment>(make_variable(counter.var),
+                                               make_int_constant(final_value))));
+    }
+    return std::make_shared<stmt::Block>(nullptr, statements);
+}
+
+std::shared_ptr<ast::stmt::Statement> LoopUnrollVisitor::unroll_partially(
+    const std::shared_ptr<ast::stmt::For> &s, const LoopCounter &counter, const size_t factor)
+{
+    std::vector<std::shared_ptr<stmt::Statement>> statements;
+
+    // Peel off the iterations that don't fill a group of factor iterations
+    const size_t num_peeled = counter.trip_count % factor;
+    for (size_t i = 0; i < num_peeled && s->body; ++i) {
+        CloneVisitor cloner(resolver_result);
+        cloner.substitutions[counter.var] =
+            make_int_constant(counter.start + i * counter.step);
+        statements.push_back(cloner.clone(s->body));
+        had_error = had_error || cloner.had_error;
+    }
+
+    // Start the counter after the peeled iterations
+    const int64_t start = counter.start + num_peeled * counter.step;
+    if (counter.declared_in_init) {
+        counter.var->expression = make_int_constant(start);
+        statements.push_back(s->init);
+    } else {
+        statements.push_back(std::make_shared<stmt::Expression>(
+            nullptr,
+            std::make_shared<expr::Assignment>(make_variable(counter.var),
+                                               make_int_constant(start))));
+    }
+
+    // Each iteration of the unrolled loop runs factor copies of the body, where each copy
+    // declares its own counter offset from the loop's counter
+    const NodeType step_op = counter.step > 0 ? NodeType::EXPR_ADD : NodeType::EXPR_SUB;
+    const int64_t step_size = counter.step > 0 ? counter.step : -counter.step;
+    std::vector<std::shared_ptr<stmt::Statement>> body;
+    if (s->body) {
+        body.push_back(s->body);
+        for (size_t i = 1; i < factor; ++i) {
+            // The counter may be a parameter, but the copies are local variables
+            auto counter_type = ty::copy_type(counter.var->get_type());
+            counter_type->modifiers.erase(ty::Modifier::IN);
+            counter_type->modifiers.erase(ty::Modifier::OUT);
+            counter_type->modifiers.erase(ty::Modifier::IN_OUT);
+            auto offset = std::make_shared<expr::Binary>(nullptr,
+                                                         step_op,
+                                                         make_variable(counter.var),
+                                                         make_int_constant(i * step_size));
+            // The copies are given reserved names so they can't shadow user variables read
+            // in the body
+            auto copy_counter = std::make_shared<decl::Variable>(
+                COMPILER_NAME_PREFIX + counter.var->get_text() + "_unr" + std::to_string(i),
+                nullptr,
+                counter_type,
+                offset);
+
+            CloneVisitor cloner(resolver_result);
+            cloner.decl_remap[counter.var] = copy_counter;
+            std::vector<std::shared_ptr<stmt::Statement>> copy = {
+                std::make_shared<stmt::VariableDeclaration>(nullptr, copy_counter),
+                cloner.clone(s->body)};
+            body.push_back(std::make_shared<stmt::Block>(nullptr, copy));
+            had_error = had_error || cloner.had_error;
+        }
+    }
+
+    auto advance = std::make_shared<expr::Assignment>(
+        make_variable(counter.var),
+        std::make_shared<expr::Binary>(nullptr,
+                                       step_op,
+                                       make_variable(counter.var),
+                                       make_int_constant(factor * step_size)));
+    auto loop = std::make_shared<stmt::For>(s->get_token(),
+                                            nullptr,
+                                            s->condition,
+                                            advance,
+                                            std::make_shared<stmt::Block>(nullptr, body));
+    loop->attributes = s->attributes;
+    statements.push_back(loop);
+    return std::make_shared<stmt::Block>(nullptr, statements);
+}
+
+std::shared_ptr<ast::expr::Expression> LoopUnrollVisitor::make_int_constant(
+    const int64_t value)
+{
+    return std::make_shared<expr::Constant>(nullptr, static_cast<int>(value));
+}
+
+std::shared_ptr<ast::expr::Variable> LoopUnrollVisitor::make_variable(
+    const std::shared_ptr<ast::decl::Variable> &var)
+{
+    auto var_expr = std::make_shared<expr::Variable>(var->get_text());
+    resolver_result->var_expr[var_expr] = var;
+    return var_expr;
+}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <optional>
+#include "ast/modifying_visitor.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+// Default max size (in AST nodes) of the unrolled body of loops that are unrolled without an
+// [unroll] attribute
+const size_t DEFAULT_UNROLL_THRESHOLD = 256;
+
+/* The LoopUnrollVisitor unrolls for loops with a constant trip count. A loop has a constant
+ * trip count if it has an int counter that's initialized to a constant, compared against a
+ * constant in the condition, advanced by a constant step and not written in the loop body,
+ * e.g.:
+ *
+ * for (int i = 0; i < NUM_SAMPLES; i = i + 1)
+ *
+ * Loops whose unrolled body is below the unroll threshold are fully unrolled, with the
+ * counter replaced by its constant value in each copy of the body. Larger loops are partially
+ * unrolled by the largest power of two factor that fits within the threshold, with the
+ * remaining iterations peeled off before the loop. The choice can be overridden with
+ * attributes on the loop: [unroll] fully unrolls the loop, [unroll(N)] unrolls it by a factor
+ * of N and [loop] prevents unrolling. [unroll] on loops that aren't unrolled is left for the
+ * native compiler.
+ */
+class LoopUnrollVisitor : public ast::ModifyingVisitor {
+    // The counter of a loop with a constant trip count
+    struct LoopCounter {
+        std::shared_ptr<ast::decl::Variable> var;
+        // If the counter is declared in the loop's init statement, and thus scoped to it
+        bool declared_in_init = false;
+        int64_t start = 0;
+        int64_t step = 0;
+        size_t trip_count = 0;
+    };
+
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+    size_t unroll_threshold = DEFAULT_UNROLL_THRESHOLD;
+
+public:
+    // The number of loops that were fully unrolled
+    size_t num_unrolled_loops = 0;
+
+    // The number of loops that were partially unrolled
+    size_t num_partially_unrolled_loops = 0;
+
+    LoopUnrollVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result,
+                      const size_t unroll_threshold = DEFAULT_UNROLL_THRESHOLD);
+
+    std::any visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s) override;
+
+private:
+    // Find the loop's counter and compute its trip count, if the loop has a constant trip
+    // count
+    std::optional<LoopCounter> find_loop_counter(const std::shared_ptr<ast::stmt::For> &s);
+
+    /* Replace the loop with a block containing a copy of the body for each iteration. If the
+     * counter is declared outside the loop it's assigned its final value after the copies
+     */
+    std::shared_ptr<ast::stmt::Statement> unroll_fully(
+        const std::shared_ptr<ast::stmt::For> &s, const LoopCounter &counter);
+
+    /* Replace the loop with a block containing copies of the body for the iterations that
+     * don't fill a group of factor iterations, followed by a loop running factor copies of
+     * the body each iteration
+     */
+    std::shared_ptr<ast::stmt::Statement> unroll_partially(
+        const std::shared_ptr<ast::stmt::For> &s,
+        const LoopCounter &counter,
+        const size_t factor);
+
+    std::shared_ptr<ast::expr::Expression> make_int_constant(const int64_t value);
+
+    std::shared_ptr<ast::expr::Variable> make_variable(
+        const std::shared_ptr<ast::decl::Variable> &var);
+};
+}
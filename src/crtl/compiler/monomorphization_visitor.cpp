@@ -0,0 +1,42 @@
+#include "monomorphization_visitor.h"
+
+namespace crtl {
+
+using namespace ast;
+
+MonomorphizationVisitor::MonomorphizationVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result)
+    : resolver_result(resolver_result)
+{
+}
+
+std::any MonomorphizationVisitor::visit_ast(const std::shared_ptr<ast::AST> &ast)
+{
+    // Calls are resolved to the instantiation for their argument types, which may have a
+    // different name than the generic function being called
+    for (auto &c : resolver_result->call_expr) {
+        if (!c.second->is_builtin()) {
+            c.first->callee_name = c.second->get_text();
+        }
+    }
+    return ModifyingVisitor::visit_ast(ast);
+}
+
+std::any MonomorphizationVisitor::visit_decl_function(const std::shared_ptr<decl::Function> &d)
+{
+    if (!d->is_generic()) {
+        return ModifyingVisitor::visit_decl_function(d);
+    }
+
+    ++num_generics;
+    std::vector<std::shared_ptr<decl::Declaration>> instances;
+    auto fnd = resolver_result->generic_instances.find(d);
+    if (fnd != resolver_result->generic_instances.end()) {
+        for (const auto &instance : fnd->second) {
+            collect_results(ModifyingVisitor::visit_decl_function(instance), instances);
+        }
+    }
+    num_instances += instances.size();
+    return instances;
+}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ast/modifying_visitor.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* The MonomorphizationVisitor replaces each generic function with the instantiations made
+ * for it by the resolver, and renames the calls to the generic function to call the
+ * instantiation for their argument types. Each instantiation is emitted once, in place of
+ * the generic function, and generic functions which are never called are removed.
+ */
+class MonomorphizationVisitor : public ast::ModifyingVisitor {
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+public:
+    // The number of instantiations emitted
+    size_t num_instances = 0;
+
+    // The number of generic functions replaced by their instantiations
+    size_t num_generics = 0;
+
+    MonomorphizationVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result);
+
+    // Rename the calls of generic functions before replacing the generic functions
+    std::any visit_ast(const std::shared_ptr<ast::AST> &ast) override;
+
+    std::any visit_decl_function(const std::shared_ptr<ast::decl::Function> &d) override;
+};
+}
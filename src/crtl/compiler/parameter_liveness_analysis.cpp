@@ -0,0 +1,70 @@
+#include "parameter_liveness_analysis.h"
+#include "call_graph_analysis.h"
+#include "resolution_analysis.h"
+
+namespace crtl {
+
+using namespace ast;
+
+// Collect the global parameters read by variable expressions in the subtree
+void collect_global_param_reads(
+    const std::shared_ptr<ast::Node> &n,
+    const ResolverPassResult &resolved,
+    phmap::flat_hash_set<std::shared_ptr<ast::decl::GlobalParam>> &params)
+{
+    if (n->get_node_type() == NodeType::EXPR_LITERAL_VAR) {
+        auto fnd = resolved.var_expr.find(std::dynamic_pointer_cast<expr::Variable>(n));
+        if (fnd != resolved.var_expr.end()) {
+            auto param = std::dynamic_pointer_cast<decl::GlobalParam>(fnd->second);
+            if (param) {
+                params.insert(param);
+            }
+        }
+    }
+    for (const auto &c : n->get_children()) {
+        collect_global_param_reads(c, resolved, params);
+    }
+}
+
+std::string ParameterLivenessAnalysis::name() const
+{
+    return "parameter_liveness";
+}
+
+std::set<ASTChange> ParameterLivenessAnalysis::invalidated_by() const
+{
+    return {ASTChange::PARAMETERS, ASTChange::PARAMETER_ACCESSES};
+}
+
+void ParameterLivenessAnalysis::run(PassManager &pm)
+{
+    auto resolved = pm.get_analysis<ResolutionAnalysis>()->resolved;
+    auto call_graph = pm.get_analysis<CallGraphAnalysis>();
+
+    // The parameters read directly by each function are shared by the entry points calling
+    // it, so they're only collected once
+    phmap::flat_hash_map<std::shared_ptr<decl::Function>,
+                         phmap::flat_hash_set<std::shared_ptr<decl::GlobalParam>>>
+        function_params;
+    for (const auto &n : pm.ast->top_level_decls) {
+        auto fn = std::dynamic_pointer_cast<decl::Function>(n);
+        if (fn && !fn->is_builtin()) {
+            collect_global_param_reads(fn, *resolved, function_params[fn]);
+        }
+    }
+
+    for (const auto &n : pm.ast->top_level_decls) {
+        auto entry_point = std::dynamic_pointer_cast<decl::EntryPoint>(n);
+        if (!entry_point) {
+            continue;
+        }
+        auto &params = entry_point_params[entry_point];
+        collect_global_param_reads(entry_point, *resolved, params);
+        for (const auto &fn : call_graph->reachable_functions(entry_point)) {
+            const auto &fn_params = function_params[fn];
+            params.insert(fn_params.begin(), fn_params.end());
+        }
+        live_params.insert(params.begin(), params.end());
+    }
+}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "pass_manager.h"
+
+namespace crtl {
+
+/* The ParameterLivenessAnalysis finds the global parameters read by each entry point,
+ * directly or through the functions it calls
+ */
+class ParameterLivenessAnalysis : public Analysis {
+public:
+    phmap::flat_hash_map<std::shared_ptr<ast::decl::EntryPoint>,
+                         phmap::flat_hash_set<std::shared_ptr<ast::decl::GlobalParam>>>
+        entry_point_params;
+
+    // The global parameters read by any entry point
+    phmap::flat_hash_set<std::shared_ptr<ast::decl::GlobalParam>> live_params;
+
+    std::string name() const override;
+
+    std::set<ASTChange> invalidated_by() const override;
+
+    void run(PassManager &pm) override;
+};
+}
@@ -6,8 +6,11 @@ ParameterTransforms::ParameterTransforms(
                                         std::shared_ptr<ExpandedGlobalParam>>
         &in_expanded_global_params,
     const phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>, std::string>
-        &in_renamed_vars)
-    : expanded_global_params(in_expanded_global_params), renamed_vars(in_renamed_vars)
+        &in_renamed_vars,
+    const SoaBuffers &in_soa_buffers)
+    : expanded_global_params(in_expanded_global_params),
+      renamed_vars(in_renamed_vars),
+      soa_buffers(in_soa_buffers)
 {
 }
 
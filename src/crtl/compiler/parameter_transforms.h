@@ -3,6 +3,7 @@
 #include <parallel_hashmap/phmap.h>
 #include "ast/declaration.h"
 #include "global_struct_param_expansion_visitor.h"
+#include "soa_buffer_expansion_visitor.h"
 
 namespace crtl {
 using namespace ast;
@@ -25,12 +26,18 @@ struct ParameterTransforms {
     phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>, std::string>
         renamed_vars;
 
+    /* Buffers of structs marked [soa] that were split into a buffer per field in the SoA
+     * buffer expansion pass
+     */
+    SoaBuffers soa_buffers;
+
     ParameterTransforms(
         const phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::GlobalParam>,
                                             std::shared_ptr<ExpandedGlobalParam>>
             &expanded_global_params,
         const phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Variable>, std::string>
-            &renamed_vars);
+            &renamed_vars,
+        const SoaBuffers &soa_buffers);
 
     ParameterTransforms() = default;
 };
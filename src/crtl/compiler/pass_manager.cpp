@@ -0,0 +1,100 @@
+#include "pass_manager.h"
+
+namespace crtl {
+
+PassManager::PassManager(const std::shared_ptr<ast::AST> &ast, const CompileOptions &options)
+    : ast(ast), options(options)
+{
+    if (!options.remarks_filter.empty()) {
+        try {
+            remarks_filter = std::regex(options.remarks_filter);
+        } catch (const std::regex_error &e) {
+            throw std::invalid_argument("Invalid optimization remarks filter '" +
+                                        options.remarks_filter + "': " + e.what());
+        }
+    }
+}
+
+void PassManager::add_transform(const std::string &name,
+                                const uint32_t min_optimization_level,
+                                const TransformPass &pass)
+{
+    if (options.optimization_level >= min_optimization_level) {
+        transforms.push_back(Transform{name, pass});
+    }
+}
+
+void PassManager::run()
+{
+    for (const auto &t : transforms) {
+        running_transform = t.name;
+        const auto changes = t.pass(*this);
+        invalidate(changes);
+    }
+    running_transform.clear();
+}
+
+void PassManager::invalidate(const std::set<ASTChange> &changes)
+{
+    if (changes.empty()) {
+        return;
+    }
+
+    std::vector<std::type_index> invalid;
+    for (const auto &a : analyses) {
+        for (const auto &c : a.second->invalidated_by()) {
+            if (changes.contains(c)) {
+                invalid.push_back(a.first);
+                break;
+            }
+        }
+    }
+
+    while (!invalid.empty()) {
+        const auto type = invalid.back();
+        invalid.pop_back();
+        if (analyses.erase(type) == 0) {
+            continue;
+        }
+        auto fnd = dependents.find(type);
+        if (fnd != dependents.end()) {
+            invalid.insert(invalid.end(), fnd->second.begin(), fnd->second.end());
+            dependents.erase(fnd);
+        }
+    }
+}
+
+bool PassManager::remarks_enabled(const std::string &pass) const
+{
+    return remarks_filter && std::regex_match(pass, *remarks_filter);
+}
+
+void PassManager::enable_remarks(ErrorReporter &reporter) const
+{
+    reporter.remarks_enabled = remarks_enabled(running_transform);
+}
+
+void PassManager::collect_remarks(ErrorReporter &reporter)
+{
+    for (auto &r : reporter.remarks) {
+        r.pass = running_transform;
+        remarks.push_back(r);
+    }
+    reporter.remarks.clear();
+}
+
+void PassManager::add_remark(const std::string &pass,
+                             const RemarkKind kind,
+                             const antlr4::Token *token,
+                             const std::string &msg)
+{
+    if (!remarks_enabled(pass)) {
+        return;
+    }
+    ErrorReporter reporter;
+    reporter.remarks_enabled = true;
+    reporter.report_remark(kind, token, msg);
+    reporter.remarks.back().pass = pass;
+    remarks.push_back(reporter.remarks.back());
+}
+}
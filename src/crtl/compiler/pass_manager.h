@@ -0,0 +1,161 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <vector>
+#include <parallel_hashmap/phmap.h>
+#include "ast/declaration.h"
+#include "compile_options.h"
+#include "error_listener.h"
+
+namespace crtl {
+
+class PassManager;
+
+// The kinds of changes a transformation can make to the AST, used to invalidate the analyses
+// which depend on them
+enum class ASTChange {
+    // Nodes were added that aren't registered in the resolver results
+    UNRESOLVED_NODES,
+    // User functions were added or removed
+    FUNCTIONS,
+    // Calls to user functions were added or removed
+    CALLS,
+    // Global or entry point parameters were added, removed, renamed or changed type
+    PARAMETERS,
+    // Reads of global parameters were added or removed
+    PARAMETER_ACCESSES,
+    // Reads or writes of ray payload fields were removed
+    PAYLOAD_ACCESSES,
+};
+
+/* An analysis computes information about the AST that's cached by the PassManager until a
+ * transformation makes a change the analysis depends on. Analyses can get the results of
+ * other analyses they need from the PassManager, and are invalidated along with them.
+ */
+class Analysis : public ErrorReporter {
+public:
+    virtual std::string name() const = 0;
+
+    // The changes to the AST which invalidate the results of the analysis
+    virtual std::set<ASTChange> invalidated_by() const = 0;
+
+    virtual void run(PassManager &pm) = 0;
+};
+
+/* A transformation pass modifies the AST held by the PassManager, returning the changes it
+ * made that analyses may depend on. Passes which keep the resolver results up to date for
+ * the nodes they generate don't invalidate the resolution, and passes which didn't change
+ * anything should return no changes.
+ */
+using TransformPass = std::function<std::set<ASTChange>(PassManager &pm)>;
+
+/* The PassManager runs the transformation passes registered for the selected optimization
+ * level and provides the analysis results used by the passes and the backends. Analysis
+ * results are computed on first use and reused until a pass reports a change that
+ * invalidates them, so passes don't need to re-run the resolver or rebuild other analyses
+ * after earlier passes run.
+ */
+class PassManager {
+    struct Transform {
+        std::string name;
+        TransformPass pass;
+    };
+
+    std::vector<Transform> transforms;
+
+    // The cached analysis results by type
+    phmap::flat_hash_map<std::type_index, std::shared_ptr<Analysis>> analyses;
+
+    // The analyses which used the results of each analysis, and must be invalidated with it
+    phmap::flat_hash_map<std::type_index, phmap::flat_hash_set<std::type_index>> dependents;
+
+    // The analyses currently being computed, to track the dependencies between them
+    std::vector<std::type_index> running_analyses;
+
+    // The name of the transformation being run
+    std::string running_transform;
+
+    // The passes to report remarks for, compiled from the options' remarks_filter
+    std::optional<std::regex> remarks_filter;
+
+public:
+    std::shared_ptr<ast::AST> ast;
+
+    CompileOptions options;
+
+    // The number of times each analysis was computed
+    std::map<std::string, size_t> num_analysis_runs;
+
+    // The optimization remarks collected from the passes, in the order they were reported
+    std::vector<Remark> remarks;
+
+    // Throws std::invalid_argument if the options' remarks filter isn't a valid regex
+    PassManager(const std::shared_ptr<ast::AST> &ast, const CompileOptions &options);
+
+    /* Add a transformation pass to run if the optimization level is at least
+     * min_optimization_level
+     */
+    void add_transform(const std::string &name,
+                       const uint32_t min_optimization_level,
+                       const TransformPass &pass);
+
+    // Run the transformation passes in the order they were added
+    void run();
+
+    // Invalidate the analyses depending on the changes, and the analyses that used them
+    void invalidate(const std::set<ASTChange> &changes);
+
+    // Check if remarks were requested for the pass
+    bool remarks_enabled(const std::string &pass) const;
+
+    // Enable collecting remarks in the reporter if they were requested for the running
+    // transformation
+    void enable_remarks(ErrorReporter &reporter) const;
+
+    // Collect the remarks reported by the running transformation
+    void collect_remarks(ErrorReporter &reporter);
+
+    // Add a remark reported outside of a transformation if remarks were requested for the pass
+    void add_remark(const std::string &pass,
+                    const RemarkKind kind,
+                    const antlr4::Token *token,
+                    const std::string &msg);
+
+    // Get the results of the analysis, computing it if there isn't a valid cached result
+    template <typename T>
+    std::shared_ptr<T> get_analysis()
+    {
+        const std::type_index type(typeid(T));
+        if (!running_analyses.empty()) {
+            dependents[type].insert(running_analyses.back());
+        }
+
+        auto fnd = analyses.find(type);
+        if (fnd != analyses.end()) {
+            return std::static_pointer_cast<T>(fnd->second);
+        }
+
+        auto analysis = std::make_shared<T>();
+        running_analyses.push_back(type);
+        analysis->run(*this);
+        running_analyses.pop_back();
+        ++num_analysis_runs[analysis->name()];
+
+        if (analysis->had_error) {
+            std::cout << "Error during " << analysis->name() << " analysis, exiting\n";
+            throw std::runtime_error(analysis->name() + " analysis error");
+        }
+        analyses[type] = analysis;
+        return analysis;
+    }
+};
+}
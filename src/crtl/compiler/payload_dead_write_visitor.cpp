@@ -0,0 +1,80 @@
+#include "payload_dead_write_visitor.h"
+#include "ast_utils.h"
+
+namespace crtl {
+
+using namespace ast;
+
+PayloadDeadWriteVisitor::PayloadDeadWriteVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result,
+    const std::shared_ptr<PayloadFieldAnalysis> &payload_fields)
+    : resolver_result(resolver_result), payload_fields(payload_fields)
+{
+}
+
+std::any PayloadDeadWriteVisitor::visit_decl_function(
+    const std::shared_ptr<decl::Function> &d)
+{
+    // Only the entry points receive a payload
+    return std::dynamic_pointer_cast<decl::Declaration>(d);
+}
+
+std::any PayloadDeadWriteVisitor::visit_decl_entry_point(
+    const std::shared_ptr<decl::EntryPoint> &d)
+{
+    if (!payload_fields->entry_points.contains(d)) {
+        return std::dynamic_pointer_cast<decl::Declaration>(d);
+    }
+    entry_point = d;
+    payload = payload_parameter(d);
+    auto result = ModifyingVisitor::visit_decl_entry_point(d);
+    entry_point = nullptr;
+    payload = nullptr;
+    return result;
+}
+
+std::any PayloadDeadWriteVisitor::visit_stmt_if_else(const std::shared_ptr<stmt::IfElse> &s)
+{
+    s->if_branch = result_or_nullptr<stmt::Statement>(visit(s->if_branch));
+    if (!s->if_branch) {
+        // The if branch was a removed write
+        s->if_branch = std::make_shared<stmt::Block>(
+            s->get_token(), std::vector<std::shared_ptr<stmt::Statement>>{});
+    }
+    if (s->else_branch) {
+        s->else_branch = result_or_nullptr<stmt::Statement>(visit(s->else_branch));
+    }
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any PayloadDeadWriteVisitor::visit_stmt_expression(
+    const std::shared_ptr<stmt::Expression> &s)
+{
+    auto assign = std::dynamic_pointer_cast<expr::Assignment>(s->expr);
+    auto lhs = assign ? std::dynamic_pointer_cast<expr::StructArrayAccess>(assign->lhs)
+                      : nullptr;
+    if (!lhs || accessed_variable(lhs, *resolver_result) != payload ||
+        lhs->struct_array_access.size() != 1) {
+        return std::dynamic_pointer_cast<stmt::Statement>(s);
+    }
+    auto member = std::dynamic_pointer_cast<expr::StructMemberAccessFragment>(
+        lhs->struct_array_access[0]);
+    if (!member || !payload_fields->is_dead_write(entry_point, member->name())) {
+        return std::dynamic_pointer_cast<stmt::Statement>(s);
+    }
+
+    ++num_removed;
+    report_remark(RemarkKind::APPLIED,
+                  s->get_token(),
+                  "Write to payload field '" + member->name() + "' in '" +
+                      entry_point->get_text() + "' removed, the field is never read after it");
+
+    std::vector<std::shared_ptr<expr::FunctionCall>> calls;
+    collect_calls(assign->value, calls);
+    if (calls.empty()) {
+        return std::any();
+    }
+    s->expr = assign->value;
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+}
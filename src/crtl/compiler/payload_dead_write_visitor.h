@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ast/modifying_visitor.h"
+#include "payload_field_analysis.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* The PayloadDeadWriteVisitor removes the assignments to ray payload fields in hit and miss
+ * entry points whose value can't be read, as found by the PayloadFieldAnalysis: fields that
+ * aren't read by the callers tracing the entry point's ray types (or for any hit entry
+ * points, by the hit stages after it) and aren't read by the entry point itself. Assigned
+ * values which call functions are kept as expression statements.
+ *
+ * Writes are only removed for payloads traced in the library, which is assumed to contain
+ * all the trace_ray calls using the payload.
+ */
+class PayloadDeadWriteVisitor : public ast::ModifyingVisitor {
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+    std::shared_ptr<PayloadFieldAnalysis> payload_fields;
+
+    // The hit or miss entry point being visited and its payload parameter
+    std::shared_ptr<ast::decl::EntryPoint> entry_point;
+    std::shared_ptr<ast::decl::Variable> payload;
+
+public:
+    // The number of payload field writes removed
+    size_t num_removed = 0;
+
+    PayloadDeadWriteVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result,
+                            const std::shared_ptr<PayloadFieldAnalysis> &payload_fields);
+
+    std::any visit_decl_function(const std::shared_ptr<ast::decl::Function> &d) override;
+    std::any visit_decl_entry_point(const std::shared_ptr<ast::decl::EntryPoint> &d) override;
+
+    std::any visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s) override;
+    std::any visit_stmt_expression(const std::shared_ptr<ast::stmt::Expression> &s) override;
+};
+}
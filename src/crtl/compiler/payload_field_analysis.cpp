@@ -0,0 +1,348 @@
+#include "payload_field_analysis.h"
+#include <algorithm>
+#include "ast_utils.h"
+#include "resolution_analysis.h"
+
+namespace crtl {
+
+using namespace ast;
+
+std::string to_string(const PayloadStage stage)
+{
+    switch (stage) {
+    case PayloadStage::CALLER:
+        return "caller";
+    case PayloadStage::CLOSEST_HIT:
+        return "closesthit";
+    case PayloadStage::ANY_HIT:
+        return "anyhit";
+    case PayloadStage::MISS:
+        return "miss";
+    default:
+        return "invalid";
+    }
+}
+
+void PayloadFieldAccesses::add(const PayloadFieldAccesses &other)
+{
+    read.insert(other.read.begin(), other.read.end());
+    written.insert(other.written.begin(), other.written.end());
+}
+
+// Collects the fields of a payload variable read and written within a subtree
+struct FieldAccessCollector {
+    const ResolverPassResult &resolved;
+    std::shared_ptr<decl::Variable> payload;
+    std::set<std::string> fields;
+
+    PayloadFieldAccesses accesses;
+
+    FieldAccessCollector(const ResolverPassResult &resolved,
+                         const std::shared_ptr<decl::Variable> &payload,
+                         const std::shared_ptr<decl::Struct> &payload_struct)
+        : resolved(resolved), payload(payload)
+    {
+        for (const auto &m : payload_struct->members) {
+            fields.insert(m->get_text());
+        }
+    }
+
+    // Record the access through the expression if it accesses the payload, returning false
+    // if it doesn't
+    bool access(const std::shared_ptr<expr::Expression> &e, const bool write)
+    {
+        if (accessed_variable(e, resolved) != payload) {
+            return false;
+        }
+        auto struct_access = std::dynamic_pointer_cast<expr::StructArrayAccess>(e);
+        auto member =
+            struct_access && !struct_access->struct_array_access.empty()
+                ? std::dynamic_pointer_cast<expr::StructMemberAccessFragment>(
+                      struct_access->struct_array_access[0])
+                : nullptr;
+        const std::set<std::string> accessed =
+            member ? std::set<std::string>{member->name()} : fields;
+
+        // Writing part of a field keeps the rest of its value, so the field is also read
+        const bool partial_write =
+            write && member && struct_access->struct_array_access.size() > 1;
+        if (!write || partial_write) {
+            accesses.read.insert(accessed.begin(), accessed.end());
+        }
+        if (write) {
+            accesses.written.insert(accessed.begin(), accessed.end());
+        }
+        if (struct_access) {
+            for (const auto &f : struct_access->struct_array_access) {
+                auto array_access = std::dynamic_pointer_cast<expr::ArrayAccessFragment>(f);
+                if (array_access) {
+                    visit(array_access->index);
+                }
+            }
+        }
+        return true;
+    }
+
+    void visit(const std::shared_ptr<Node> &n)
+    {
+        switch (n->get_node_type()) {
+        case NodeType::EXPR_ASSIGN: {
+            auto assign = std::dynamic_pointer_cast<expr::Assignment>(n);
+            if (!access(assign->lhs, true)) {
+                visit(assign->lhs);
+            }
+            visit(assign->value);
+            return;
+        }
+        case NodeType::EXPR_FCN_CALL: {
+            auto call = std::dynamic_pointer_cast<expr::FunctionCall>(n);
+            auto fnd = resolved.call_expr.find(call);
+            if (fnd == resolved.call_expr.end()) {
+                break;
+            }
+            const auto &params = fnd->second->parameters;
+            for (size_t i = 0; i < call->args.size(); ++i) {
+                // The payloads passed to trace_ray are accessed by the hit and miss stages,
+                // the trace_ray calls are analyzed separately
+                if (fnd->second->is_builtin() && fnd->second->get_text() == "trace_ray" &&
+                    i == 2) {
+                    continue;
+                }
+                // Output arguments are read and written, since inout parameters read them
+                // and out parameters may leave part of the value unwritten
+                const bool output = i < params.size() && is_output_param(params[i]);
+                if (!access(call->args[i], false)) {
+                    visit(call->args[i]);
+                } else if (output) {
+                    access(call->args[i], true);
+                }
+            }
+            return;
+        }
+        case NodeType::EXPR_LITERAL_VAR:
+        case NodeType::EXPR_STRUCT_ARRAY_ACCESS:
+            if (access(std::dynamic_pointer_cast<expr::Expression>(n), false)) {
+                return;
+            }
+            break;
+        case NodeType::DECL_VAR:
+            if (n == payload && payload->expression) {
+                accesses.written.insert(fields.begin(), fields.end());
+            }
+            break;
+        default:
+            break;
+        }
+        for (const auto &c : n->get_children()) {
+            if (c) {
+                visit(c);
+            }
+        }
+    }
+};
+
+// Get the payload stage of the entry point, if it receives a payload
+std::optional<PayloadStage> entry_point_stage(const std::shared_ptr<decl::EntryPoint> &ep)
+{
+    auto type = std::dynamic_pointer_cast<ty::EntryPoint>(ep->get_type());
+    switch (type->entry_point_type) {
+    case ty::EntryPointType::CLOSEST_HIT:
+        return PayloadStage::CLOSEST_HIT;
+    case ty::EntryPointType::ANY_HIT:
+        return PayloadStage::ANY_HIT;
+    case ty::EntryPointType::MISS:
+        return PayloadStage::MISS;
+    default:
+        return std::nullopt;
+    }
+}
+
+// Get the value of the trace_ray call's ray type index argument (the hit group offset or
+// miss index) if it's a constant, otherwise ANY_RAY_TYPE
+int trace_ray_index(const std::shared_ptr<expr::FunctionCall> &call, const size_t arg)
+{
+    auto index = call->args.size() > arg
+                     ? std::dynamic_pointer_cast<expr::Constant>(call->args[arg])
+                     : nullptr;
+    if (!index || index->constant_type != ty::PrimitiveType::INT) {
+        return PayloadFieldAnalysis::ANY_RAY_TYPE;
+    }
+    return std::any_cast<int>(index->value);
+}
+
+std::string PayloadFieldAnalysis::name() const
+{
+    return "payload_field";
+}
+
+std::set<ASTChange> PayloadFieldAnalysis::invalidated_by() const
+{
+    return {ASTChange::FUNCTIONS,
+            ASTChange::CALLS,
+            ASTChange::PARAMETERS,
+            ASTChange::PAYLOAD_ACCESSES};
+}
+
+void PayloadFieldAnalysis::run(PassManager &pm)
+{
+    auto resolved = pm.get_analysis<ResolutionAnalysis>()->resolved;
+    ray_payloads = pm.get_analysis<RayPayloadAnalysis>();
+
+    for (const auto &p : ray_payloads->payloads) {
+        payloads[p];
+    }
+
+    // The caller's accesses are shared by the trace_ray calls passing the same variable in a
+    // function, so they're collected once for each variable
+    for (const auto &n : pm.ast->top_level_decls) {
+        auto fn = std::dynamic_pointer_cast<decl::Function>(n);
+        if (n->get_node_type() != NodeType::DECL_ENTRY_POINT &&
+            (!fn || fn->is_builtin() || fn->is_generic())) {
+            continue;
+        }
+        std::vector<std::shared_ptr<expr::FunctionCall>> calls;
+        collect_calls(n, calls);
+        phmap::flat_hash_map<std::shared_ptr<decl::Variable>, PayloadFieldAccesses>
+            caller_accesses;
+        for (const auto &c : calls) {
+            auto fnd = ray_payloads->trace_calls.find(c);
+            if (fnd == ray_payloads->trace_calls.end()) {
+                continue;
+            }
+            auto var = accessed_variable(c->args[2], *resolved);
+            if (!caller_accesses.contains(var)) {
+                FieldAccessCollector collector(*resolved, var, fnd->second);
+                collector.visit(n);
+                caller_accesses[var] = collector.accesses;
+            }
+            trace_calls[c] =
+                TraceCall{trace_ray_index(c, 5), trace_ray_index(c, 7), caller_accesses[var]};
+            payloads[fnd->second].traced = true;
+        }
+    }
+
+    std::set<int> ray_types;
+    for (const auto &t : trace_calls) {
+        if (t.second.ray_type != ANY_RAY_TYPE) {
+            ray_types.insert(t.second.ray_type);
+        }
+    }
+    for (const auto &n : pm.ast->top_level_decls) {
+        auto ep = std::dynamic_pointer_cast<decl::EntryPoint>(n);
+        auto param = ep ? payload_parameter(ep) : nullptr;
+        auto fnd = ep ? ray_payloads->entry_points.find(ep) : ray_payloads->entry_points.end();
+        if (!param || fnd == ray_payloads->entry_points.end() ||
+            !fnd->second.received_payload) {
+            continue;
+        }
+        FieldAccessCollector collector(*resolved, param, fnd->second.received_payload);
+        collector.visit(ep->block);
+        entry_points[ep] = collector.accesses;
+
+        // The arguments were checked to be ray type indices by the resolver
+        auto &ep_ray_types = entry_point_ray_types[ep];
+        auto ray_type = ep->get_attribute("ray_type");
+        if (ray_type) {
+            for (const auto &arg : ray_type->args) {
+                ep_ray_types.push_back(std::stoi(arg));
+                ray_types.insert(ep_ray_types.back());
+            }
+        }
+    }
+
+    // Add the accesses to the payload's stage for the ray type, or for every ray type
+    auto add_accesses = [&](const std::shared_ptr<decl::Struct> &payload,
+                            const PayloadStage stage,
+                            const int ray_type,
+                            const PayloadFieldAccesses &accesses) {
+        auto &fields = payloads[payload];
+        fields.stages[stage].add(accesses);
+        if (ray_type != ANY_RAY_TYPE) {
+            fields.ray_types[ray_type][stage].add(accesses);
+        } else if (ray_types.empty()) {
+            fields.ray_types[ANY_RAY_TYPE][stage].add(accesses);
+        } else {
+            for (const auto &r : ray_types) {
+                fields.ray_types[r][stage].add(accesses);
+            }
+        }
+    };
+    for (const auto &t : trace_calls) {
+        add_accesses(ray_payloads->trace_calls[t.first],
+                     PayloadStage::CALLER,
+                     t.second.ray_type,
+                     t.second.caller);
+    }
+    for (const auto &ep : entry_points) {
+        const auto &payload = ray_payloads->entry_points[ep.first].received_payload;
+        const PayloadStage stage = *entry_point_stage(ep.first);
+        const auto &ep_ray_types = entry_point_ray_types[ep.first];
+        if (ep_ray_types.empty()) {
+            add_accesses(payload, stage, ANY_RAY_TYPE, ep.second);
+        }
+        for (const auto &r : ep_ray_types) {
+            add_accesses(payload, stage, r, ep.second);
+        }
+    }
+}
+
+bool PayloadFieldAnalysis::is_dead_write(const std::shared_ptr<decl::EntryPoint> &entry_point,
+                                         const std::string &field) const
+{
+    auto ep_fnd = entry_points.find(entry_point);
+    if (ep_fnd == entry_points.end() || ep_fnd->second.read.contains(field)) {
+        return false;
+    }
+    auto ep_payloads = ray_payloads->entry_points.find(entry_point);
+    auto fnd = ep_payloads != ray_payloads->entry_points.end()
+                   ? payloads.find(ep_payloads->second.received_payload)
+                   : payloads.end();
+    if (fnd == payloads.end() || !fnd->second.traced) {
+        return false;
+    }
+
+    // The miss shader run is selected by the trace call's miss index, so the payload written
+    // by a miss stage is read by the callers tracing one of its ray types as the miss index
+    const PayloadStage stage = *entry_point_stage(entry_point);
+    const auto &ep_ray_types = entry_point_ray_types.at(entry_point);
+    if (stage == PayloadStage::MISS) {
+        for (const auto &t : trace_calls) {
+            if (ray_payloads->trace_calls.at(t.first) != fnd->first) {
+                continue;
+            }
+            const bool reaches_entry_point =
+                ep_ray_types.empty() || t.second.miss_index == ANY_RAY_TYPE ||
+                std::find(ep_ray_types.begin(), ep_ray_types.end(), t.second.miss_index) !=
+                    ep_ray_types.end();
+            if (reaches_entry_point && t.second.caller.read.contains(field)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<int> ray_types = ep_ray_types;
+    if (ray_types.empty()) {
+        for (const auto &r : fnd->second.ray_types) {
+            ray_types.push_back(r.first);
+        }
+    }
+    // The payload written by a closest hit stage is only read by the caller, while the
+    // payload written by an any hit stage is also read by the hit stages run after it
+    for (const auto &r : ray_types) {
+        auto ray_type = fnd->second.ray_types.find(r);
+        if (ray_type == fnd->second.ray_types.end()) {
+            continue;
+        }
+        for (const auto &s : ray_type->second) {
+            const bool reads_after = s.first == PayloadStage::CALLER ||
+                                     (stage == PayloadStage::ANY_HIT &&
+                                      s.first != PayloadStage::MISS);
+            if (reads_after && s.second.read.contains(field)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+}
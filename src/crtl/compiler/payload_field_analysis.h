@@ -0,0 +1,92 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include "pass_manager.h"
+#include "ray_payload_analysis.h"
+
+namespace crtl {
+
+// The shader stages passing a ray payload between them
+enum class PayloadStage { CALLER, CLOSEST_HIT, ANY_HIT, MISS };
+
+// Get the name of the stage, matching the stage names of HLSL's payload access qualifiers
+std::string to_string(const PayloadStage stage);
+
+// The fields of a payload struct read and written by a shader stage
+struct PayloadFieldAccesses {
+    std::set<std::string> read;
+    std::set<std::string> written;
+
+    void add(const PayloadFieldAccesses &other);
+};
+
+// The fields of a payload struct accessed by each stage, overall and for each ray type
+struct PayloadFields {
+    std::map<PayloadStage, PayloadFieldAccesses> stages;
+
+    std::map<int, std::map<PayloadStage, PayloadFieldAccesses>> ray_types;
+
+    // If the payload is passed to trace_ray in the library, so all its callers are known
+    bool traced = false;
+};
+
+/* The PayloadFieldAnalysis finds the fields of each ray payload read and written by the
+ * stages it's passed between: the functions calling trace_ray with it, and the closest hit,
+ * any hit and miss entry points receiving it. The caller's accesses are the accesses to the
+ * payload variable anywhere in the function calling trace_ray, the hit and miss stages' are
+ * the accesses to their payload parameter. Assigning or reading the whole payload, or
+ * passing it to a function, accesses all its fields, and writing part of a field also reads
+ * it.
+ *
+ * The accesses are also grouped by ray type. The ray type of a trace_ray call is its hit
+ * group offset when it's a constant, and hit and miss entry points can list the ray types
+ * they're used for with a [ray_type(N, ...)] attribute. Calls with a non-constant offset and
+ * entry points without the attribute are counted for every ray type, or under ANY_RAY_TYPE
+ * if there are none. The miss shader run is selected by the miss index instead of the hit
+ * group offset, so miss entry points are matched to the calls tracing their ray types as
+ * the miss index.
+ */
+class PayloadFieldAnalysis : public Analysis {
+public:
+    static constexpr int ANY_RAY_TYPE = -1;
+
+    phmap::flat_hash_map<std::shared_ptr<ast::decl::Struct>, PayloadFields> payloads;
+
+    // The fields of the received payload accessed by each hit and miss entry point
+    phmap::flat_hash_map<std::shared_ptr<ast::decl::EntryPoint>, PayloadFieldAccesses>
+        entry_points;
+
+    // The ray types listed by the hit and miss entry points, empty if not listed
+    phmap::flat_hash_map<std::shared_ptr<ast::decl::EntryPoint>, std::vector<int>>
+        entry_point_ray_types;
+
+    // A trace_ray call's ray type, miss index and the fields accessed by the function
+    // calling it. The ray type and miss index are ANY_RAY_TYPE if they aren't constants
+    struct TraceCall {
+        int ray_type = ANY_RAY_TYPE;
+        int miss_index = ANY_RAY_TYPE;
+        PayloadFieldAccesses caller;
+    };
+
+    phmap::flat_hash_map<std::shared_ptr<ast::expr::FunctionCall>, TraceCall> trace_calls;
+
+    std::string name() const override;
+
+    std::set<ASTChange> invalidated_by() const override;
+
+    void run(PassManager &pm) override;
+
+    /* Check if a write to the field by the hit or miss entry point can't be read: it isn't
+     * read by the entry point itself, by the callers tracing the entry point's ray types (as
+     * the miss index for miss entry points), or for any hit entry points, by the hit stages
+     * run after it. Writes are only dead if the payload is traced in the library, otherwise
+     * its callers aren't known
+     */
+    bool is_dead_write(const std::shared_ptr<ast::decl::EntryPoint> &entry_point,
+                       const std::string &field) const;
+
+private:
+    std::shared_ptr<RayPayloadAnalysis> ray_payloads;
+};
+}
@@ -0,0 +1,413 @@
+#include "payload_packing_visitor.h"
+#include <algorithm>
+#include "ast_utils.h"
+
+namespace crtl {
+
+using namespace ast;
+
+const std::string PACKED_PREFIX = COMPILER_NAME_PREFIX + "packed_";
+
+// Make an access of the member and vector component of the variable
+std::shared_ptr<expr::Expression> make_member_access(const std::string &var,
+                                                     const std::string &member,
+                                                     const std::string &component = "")
+{
+    std::vector<std::shared_ptr<expr::StructArrayAccessFragment>> fragments = {
+        std::make_shared<expr::StructMemberAccessFragment>(member)};
+    if (!component.empty()) {
+        fragments.push_back(std::make_shared<expr::StructMemberAccessFragment>(component));
+    }
+    return std::make_shared<expr::StructArrayAccess>(std::make_shared<expr::Variable>(var),
+                                                     fragments);
+}
+
+std::shared_ptr<expr::Expression> make_call(
+    const std::string &fn, const std::vector<std::shared_ptr<expr::Expression>> &args)
+{
+    return std::make_shared<expr::FunctionCall>(fn, args);
+}
+
+std::shared_ptr<expr::Expression> make_int(const uint32_t value)
+{
+    return std::make_shared<expr::Constant>(nullptr, int(value));
+}
+
+std::shared_ptr<stmt::Statement> make_assignment(
+    const std::shared_ptr<expr::Expression> &lhs,
+    const std::shared_ptr<expr::Expression> &value)
+{
+    return std::make_shared<stmt::Expression>(nullptr,
+                                              std::make_shared<expr::Assignment>(lhs, value));
+}
+
+std::string word_name(const uint32_t word)
+{
+    return "word" + std::to_string(word);
+}
+
+PayloadPackingVisitor::PayloadPackingVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result,
+    const std::shared_ptr<RayPayloadAnalysis> &ray_payloads)
+    : resolver_result(resolver_result), ray_payloads(ray_payloads)
+{
+}
+
+std::any PayloadPackingVisitor::visit_ast(const std::shared_ptr<ast::AST> &ast)
+{
+    for (const auto &p : ray_payloads->payloads) {
+        auto packed = packed_layout(p);
+        if (!packed) {
+            continue;
+        }
+        generate_declarations(p, *packed);
+        packed_payloads[p] = *packed;
+        ++num_payloads_packed;
+        if (remarks_enabled) {
+            report_remark(RemarkKind::APPLIED,
+                          p->get_token(),
+                          "Payload '" + p->get_text() + "' packed from " +
+                              std::to_string(packed->unpacked_size) + " to " +
+                              std::to_string(packed->num_words * 4) + " bytes");
+        }
+    }
+    if (packed_payloads.empty()) {
+        return ast;
+    }
+
+    // The generated declarations follow the payload struct, so that they're declared before
+    // any function using the payload
+    std::vector<std::shared_ptr<Node>> top_level_decls;
+    for (const auto &n : ast->top_level_decls) {
+        top_level_decls.push_back(n);
+        auto fnd = packed_payloads.find(std::dynamic_pointer_cast<decl::Struct>(n));
+        if (fnd != packed_payloads.end()) {
+            top_level_decls.push_back(fnd->second.packed_struct);
+            top_level_decls.push_back(fnd->second.pack_fn);
+            top_level_decls.push_back(fnd->second.unpack_fn);
+        }
+    }
+    ast->top_level_decls = top_level_decls;
+    return ModifyingVisitor::visit_ast(ast);
+}
+
+std::any PayloadPackingVisitor::visit_decl_entry_point(
+    const std::shared_ptr<ast::decl::EntryPoint> &d)
+{
+    auto payload = payload_parameter(d);
+    const auto &payloads = ray_payloads->entry_points[d];
+    auto fnd = packed_payloads.find(payloads.received_payload);
+    if (!payload || fnd == packed_payloads.end()) {
+        return ModifyingVisitor::visit_decl_entry_point(d);
+    }
+    const auto &decl = fnd->first;
+
+    // The entry point receives the packed payload, and the payload parameter becomes a
+    // local variable unpacked from it
+    auto packed_type = std::make_shared<ty::Struct>(fnd->second.packed_struct->get_text());
+    auto packed_payload = std::make_shared<decl::Variable>(
+        PACKED_PREFIX + payload->get_text(), payload->get_token(), packed_type);
+    std::replace(d->parameters.begin(), d->parameters.end(), payload, packed_payload);
+
+    payload->expression =
+        make_call(fnd->second.unpack_fn->get_text(),
+                  {std::make_shared<expr::Variable>(packed_payload->get_text())});
+
+    // The payload is only packed back if the entry point modifies it
+    if (is_variable_written(d->block, payload, *resolver_result)) {
+        entry_payload_struct = decl;
+        entry_payload = payload;
+        entry_packed_payload = packed_payload;
+    }
+    auto result = ModifyingVisitor::visit_decl_entry_point(d);
+
+    d->block->statements.insert(d->block->statements.begin(),
+                                std::make_shared<stmt::VariableDeclaration>(nullptr, payload));
+    if (entry_payload) {
+        d->block->statements.push_back(
+            make_pack(decl, packed_payload->get_text(), payload->get_text()));
+    }
+    entry_payload_struct = nullptr;
+    entry_payload = nullptr;
+    entry_packed_payload = nullptr;
+    ++num_sites_packed;
+    return result;
+}
+
+std::any PayloadPackingVisitor::visit_stmt_return(const std::shared_ptr<ast::stmt::Return> &s)
+{
+    auto result = ModifyingVisitor::visit_stmt_return(s);
+    if (!entry_payload) {
+        return result;
+    }
+    auto pack = make_pack(
+        entry_payload_struct, entry_packed_payload->get_text(), entry_payload->get_text());
+    return std::dynamic_pointer_cast<stmt::Statement>(std::make_shared<stmt::Block>(
+        nullptr, std::vector<std::shared_ptr<stmt::Statement>>{pack, s}));
+}
+
+std::any PayloadPackingVisitor::visit_stmt_expression(
+    const std::shared_ptr<ast::stmt::Expression> &s)
+{
+    auto result = ModifyingVisitor::visit_stmt_expression(s);
+    auto call = std::dynamic_pointer_cast<expr::FunctionCall>(s->expr);
+    auto trace = call ? ray_payloads->trace_calls.find(call) : ray_payloads->trace_calls.end();
+    if (trace == ray_payloads->trace_calls.end()) {
+        return result;
+    }
+    auto fnd = packed_payloads.find(trace->second);
+    if (fnd == packed_payloads.end()) {
+        return result;
+    }
+
+    // The payload is packed into a temporary passed to trace_ray, and unpacked after the
+    // trace returns
+    const std::string payload =
+        std::dynamic_pointer_cast<expr::Variable>(call->args[2])->name();
+    auto packed_payload = std::make_shared<decl::Variable>(
+        PACKED_PREFIX + payload,
+        call->args[2]->get_token(),
+        std::make_shared<ty::Struct>(fnd->second.packed_struct->get_text()),
+        make_call(fnd->second.pack_fn->get_text(),
+                  {std::make_shared<expr::Variable>(payload)}));
+    call->args[2] = std::make_shared<expr::Variable>(packed_payload->get_text());
+
+    auto unpack = make_assignment(
+        std::make_shared<expr::Variable>(payload),
+        make_call(fnd->second.unpack_fn->get_text(),
+                  {std::make_shared<expr::Variable>(packed_payload->get_text())}));
+    ++num_sites_packed;
+    return std::dynamic_pointer_cast<stmt::Statement>(std::make_shared<stmt::Block>(
+        nullptr,
+        std::vector<std::shared_ptr<stmt::Statement>>{
+            std::make_shared<stmt::VariableDeclaration>(nullptr, packed_payload), s, unpack}));
+}
+
+std::optional<PackedPayload> PayloadPackingVisitor::packed_layout(
+    const std::shared_ptr<ast::decl::Struct> &decl)
+{
+    static const std::vector<std::string> components = {"x", "y", "z", "w"};
+
+    PackedPayload packed;
+    for (const auto &m : decl->members) {
+        auto vector = std::dynamic_pointer_cast<ty::Vector>(m->get_type());
+        auto primitive = vector ? vector->element_type
+                                : std::dynamic_pointer_cast<ty::Primitive>(m->get_type());
+        // 16-bit members aren't packed, they already take half a word in the payload
+        if (!primitive || primitive->type_id == ty::PrimitiveType::DOUBLE ||
+            primitive->type_id == ty::PrimitiveType::HALF ||
+            primitive->type_id == ty::PrimitiveType::INT16 ||
+            primitive->type_id == ty::PrimitiveType::UINT16) {
+            report_remark(RemarkKind::MISSED,
+                          m->get_token(),
+                          "Payload '" + decl->get_text() + "' not packed, member '" +
+                              m->get_text() + "' of type " + m->get_type()->to_string() +
+                              " can't be packed");
+            return std::nullopt;
+        }
+
+        PackedPayloadField field;
+        field.member = m->get_text();
+        field.type = primitive->type_id;
+        if (field.type == ty::PrimitiveType::BOOL) {
+            field.encoding = PayloadEncoding::BITS;
+            field.bits = 1;
+        }
+        auto attribute = m->attributes.empty() ? nullptr : m->attributes[0];
+        if (attribute && attribute->name == "bits") {
+            field.encoding = PayloadEncoding::BITS;
+            field.bits = std::stoi(attribute->args[0]);
+        } else if (attribute && attribute->name == "half") {
+            field.encoding = PayloadEncoding::HALF;
+            field.bits = 16;
+        } else if (attribute && attribute->name == "unorm") {
+            field.encoding = PayloadEncoding::UNORM;
+            field.bits = attribute->args.empty() ? 8 : std::stoi(attribute->args[0]);
+        } else if (attribute && attribute->name == "octahedral") {
+            field.encoding = PayloadEncoding::OCTAHEDRAL;
+            field.bits = 32;
+        }
+
+        const uint32_t n_components = vector ? vector->dimensionality : 1;
+        packed.unpacked_size += 4 * n_components;
+        if (!vector || field.encoding == PayloadEncoding::OCTAHEDRAL) {
+            packed.fields.push_back(field);
+            continue;
+        }
+        for (uint32_t i = 0; i < n_components; ++i) {
+            field.component = components[i];
+            packed.fields.push_back(field);
+        }
+    }
+
+    // Fields are packed first fit, largest first, into the words with space for them
+    std::stable_sort(packed.fields.begin(),
+                     packed.fields.end(),
+                     [](const PackedPayloadField &a, const PackedPayloadField &b) {
+                         return a.bits > b.bits;
+                     });
+    std::vector<uint32_t> word_bits;
+    for (auto &f : packed.fields) {
+        auto word = std::find_if(word_bits.begin(), word_bits.end(), [&](const uint32_t w) {
+            return w + f.bits <= 32;
+        });
+        if (word == word_bits.end()) {
+            word = word_bits.insert(word_bits.end(), 0);
+        }
+        f.word = std::distance(word_bits.begin(), word);
+        f.offset = *word;
+        *word += f.bits;
+    }
+    packed.num_words = word_bits.size();
+
+    if (packed.num_words * 4 >= packed.unpacked_size) {
+        report_remark(RemarkKind::MISSED,
+                      decl->get_token(),
+                      "Payload '" + decl->get_text() +
+                          "' not packed, packing doesn't reduce its size of " +
+                          std::to_string(packed.unpacked_size) + " bytes");
+        return std::nullopt;
+    }
+    return packed;
+}
+
+void PayloadPackingVisitor::generate_declarations(
+    const std::shared_ptr<ast::decl::Struct> &decl, PackedPayload &packed)
+{
+    const std::string packed_name = PACKED_PREFIX + decl->get_text();
+    std::vector<std::shared_ptr<decl::StructMember>> words;
+    for (uint32_t i = 0; i < packed.num_words; ++i) {
+        words.push_back(std::make_shared<decl::StructMember>(
+            word_name(i), nullptr, std::make_shared<ty::Primitive>(ty::PrimitiveType::UINT)));
+    }
+    packed.packed_struct = std::make_shared<decl::Struct>(packed_name, nullptr, words);
+
+    // The functions take the payload struct's token, since functions without a token are
+    // builtins
+
+    // _crtl_packed_S _crtl_pack_S(S value), each word is assigned its first field then has
+    // the remaining fields inserted into it
+    std::vector<std::shared_ptr<stmt::Statement>> pack_body = {
+        std::make_shared<stmt::VariableDeclaration>(
+            nullptr,
+            std::make_shared<decl::Variable>(
+                "packed", nullptr, std::make_shared<ty::Struct>(packed_name)))};
+    std::vector<bool> word_assigned(packed.num_words, false);
+    for (const auto &f : packed.fields) {
+        auto word = make_member_access("packed", word_name(f.word));
+        auto value = encode_field(f, "value");
+        if (f.bits < 32) {
+            auto current = word_assigned[f.word]
+                               ? make_member_access("packed", word_name(f.word))
+                               : make_int(0);
+            value = make_call("insert_bits",
+                              {current, value, make_int(f.offset), make_int(f.bits)});
+        }
+        word_assigned[f.word] = true;
+        pack_body.push_back(make_assignment(word, value));
+    }
+    pack_body.push_back(
+        std::make_shared<stmt::Return>(nullptr, std::make_shared<expr::Variable>("packed")));
+    packed.pack_fn = std::make_shared<decl::Function>(
+        COMPILER_NAME_PREFIX + "pack_" + decl->get_text(),
+        decl->get_token(),
+        std::vector<std::shared_ptr<decl::Variable>>{std::make_shared<decl::Variable>(
+            "value", nullptr, std::make_shared<ty::Struct>(decl->get_text()))},
+        std::make_shared<stmt::Block>(nullptr, pack_body),
+        std::make_shared<ty::Struct>(packed_name));
+
+    // S _crtl_unpack_S(_crtl_packed_S packed)
+    std::vector<std::shared_ptr<stmt::Statement>> unpack_body = {
+        std::make_shared<stmt::VariableDeclaration>(
+            nullptr,
+            std::make_shared<decl::Variable>(
+                "value", nullptr, std::make_shared<ty::Struct>(decl->get_text())))};
+    for (const auto &f : packed.fields) {
+        auto member = make_member_access("value", f.member, f.component);
+        unpack_body.push_back(make_assignment(member, decode_field(f, "packed")));
+    }
+    unpack_body.push_back(
+        std::make_shared<stmt::Return>(nullptr, std::make_shared<expr::Variable>("value")));
+    packed.unpack_fn = std::make_shared<decl::Function>(
+        COMPILER_NAME_PREFIX + "unpack_" + decl->get_text(),
+        decl->get_token(),
+        std::vector<std::shared_ptr<decl::Variable>>{std::make_shared<decl::Variable>(
+            "packed", nullptr, std::make_shared<ty::Struct>(packed_name))},
+        std::make_shared<stmt::Block>(nullptr, unpack_body),
+        std::make_shared<ty::Struct>(decl->get_text()));
+}
+
+std::shared_ptr<ast::expr::Expression> PayloadPackingVisitor::encode_field(
+    const PackedPayloadField &field, const std::string &value)
+{
+    auto member = make_member_access(value, field.member, field.component);
+    switch (field.encoding) {
+    case PayloadEncoding::HALF:
+        return make_call("f32tof16", {member});
+    case PayloadEncoding::UNORM:
+        return make_call("pack_unorm", {member, make_int(field.bits)});
+    case PayloadEncoding::OCTAHEDRAL:
+        return make_call("pack_octahedral", {member});
+    default:
+        break;
+    }
+    // Ints and bools are converted to uint by insert_bits, floats have their bits stored
+    if (field.encoding == PayloadEncoding::FULL && field.type != ty::PrimitiveType::UINT) {
+        return make_call("asuint", {member});
+    }
+    return member;
+}
+
+std::shared_ptr<ast::expr::Expression> PayloadPackingVisitor::decode_field(
+    const PackedPayloadField &field, const std::string &packed)
+{
+    std::shared_ptr<expr::Expression> bits = make_member_access(packed, word_name(field.word));
+    if (field.bits < 32) {
+        bits = make_call("extract_bits", {bits, make_int(field.offset), make_int(field.bits)});
+    }
+    switch (field.encoding) {
+    case PayloadEncoding::HALF:
+        return make_call("f16tof32", {bits});
+    case PayloadEncoding::UNORM:
+        return make_call("unpack_unorm", {bits, make_int(field.bits)});
+    case PayloadEncoding::OCTAHEDRAL:
+        return make_call("unpack_octahedral", {bits});
+    default:
+        break;
+    }
+    switch (field.type) {
+    case ty::PrimitiveType::BOOL:
+        return std::make_shared<expr::Binary>(
+            nullptr, NodeType::EXPR_CMP_NOT_EQUAL, bits, make_int(0));
+    case ty::PrimitiveType::INT: {
+        if (field.bits == 32) {
+            return make_call("asint", {bits});
+        }
+        // Sign extend the value by shifting its sign bit to the top of the word, then back
+        // down with an arithmetic shift
+        const uint32_t shift = 32 - field.bits;
+        auto high_bits = std::make_shared<expr::Binary>(
+            nullptr, NodeType::EXPR_SHIFT_LEFT, bits, make_int(shift));
+        return std::make_shared<expr::Binary>(nullptr,
+                                              NodeType::EXPR_SHIFT_RIGHT,
+                                              make_call("asint", {high_bits}),
+                                              make_int(shift));
+    }
+    case ty::PrimitiveType::FLOAT:
+        return make_call("asfloat", {bits});
+    default:
+        return bits;
+    }
+}
+
+std::shared_ptr<ast::stmt::Statement> PayloadPackingVisitor::make_pack(
+    const std::shared_ptr<ast::decl::Struct> &decl,
+    const std::string &packed,
+    const std::string &payload)
+{
+    const auto &pack_fn = packed_payloads[decl].pack_fn;
+    return make_assignment(
+        std::make_shared<expr::Variable>(packed),
+        make_call(pack_fn->get_text(), {std::make_shared<expr::Variable>(payload)}));
+}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <optional>
+#include "ast/modifying_visitor.h"
+#include "ray_payload_analysis.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+// How a payload member is encoded in the packed payload, selected by the member's attribute
+enum class PayloadEncoding {
+    // The 32 bits of the value, used for members without an attribute
+    FULL,
+    // The low bits of a bool, or of an int or uint marked [bits(N)]
+    BITS,
+    // A float stored as a half, marked [half]
+    HALF,
+    // A float in [0, 1] quantized to N bits, marked [unorm(N)]
+    UNORM,
+    // A float3 unit vector stored as 16 bit octahedral coordinates, marked [octahedral]
+    OCTAHEDRAL,
+};
+
+// A scalar or vector component of a payload member, stored in the bits of a packed word
+struct PackedPayloadField {
+    std::string member;
+    // The vector component stored ("x", "y", "z" or "w"), empty for scalars and for
+    // octahedral vectors, which store the whole vector
+    std::string component;
+    ast::ty::PrimitiveType type = ast::ty::PrimitiveType::FLOAT;
+    PayloadEncoding encoding = PayloadEncoding::FULL;
+    uint32_t bits = 32;
+    uint32_t word = 0;
+    uint32_t offset = 0;
+};
+
+// The packed layout of a payload struct and the generated struct and functions using it
+struct PackedPayload {
+    std::vector<PackedPayloadField> fields;
+    uint32_t num_words = 0;
+    uint32_t unpacked_size = 0;
+
+    std::shared_ptr<ast::decl::Struct> packed_struct;
+    std::shared_ptr<ast::decl::Function> pack_fn;
+    std::shared_ptr<ast::decl::Function> unpack_fn;
+};
+
+/* The PayloadPackingVisitor packs the ray payloads passed to trace_ray into the minimum
+ * number of 32-bit words, to reduce the payload size and let more rays be in flight. Bools
+ * take one bit, and members can be marked with attributes selecting a smaller encoding:
+ * [bits(N)] stores the low N bits of ints or uints, with ints sign extended when unpacked,
+ * [half] stores floats as halfs, [unorm(N)] quantizes floats in [0, 1] to N bits (default 8)
+ * and [octahedral] stores float3 unit vectors in 32 bits. Fields smaller than a word are
+ * packed first fit, largest first.
+ *
+ * For each payload struct S a struct _crtl_packed_S holding the words is generated along
+ * with _crtl_pack_S and _crtl_unpack_S functions converting between them. The payload passed
+ * to each trace_ray call is packed before the call and unpacked after it, and hit and miss
+ * entry points receive the packed payload, unpacking it on entry and packing it back before
+ * returning if they write to it. Payloads with members that can't be packed (e.g., structs
+ * or matrices), or which aren't made smaller by packing, are left unchanged.
+ *
+ * Packing changes the payload layout seen by the other shader stages, so all libraries
+ * sharing a payload must be compiled with packing enabled.
+ */
+class PayloadPackingVisitor : public ast::ModifyingVisitor {
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+    std::shared_ptr<RayPayloadAnalysis> ray_payloads;
+
+    phmap::flat_hash_map<std::shared_ptr<ast::decl::Struct>, PackedPayload> packed_payloads;
+
+    // The payload of the hit or miss entry point being visited, which is packed into
+    // entry_packed_payload before the entry point returns if it's modified
+    std::shared_ptr<ast::decl::Struct> entry_payload_struct;
+    std::shared_ptr<ast::decl::Variable> entry_payload;
+    std::shared_ptr<ast::decl::Variable> entry_packed_payload;
+
+public:
+    // The number of payload structs packed
+    size_t num_payloads_packed = 0;
+
+    // The number of trace_ray calls and hit or miss entry points using a packed payload
+    size_t num_sites_packed = 0;
+
+    PayloadPackingVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result,
+                          const std::shared_ptr<RayPayloadAnalysis> &ray_payloads);
+
+    // Compute the packed layouts and declare the generated structs and functions
+    std::any visit_ast(const std::shared_ptr<ast::AST> &ast) override;
+
+    std::any visit_decl_entry_point(const std::shared_ptr<ast::decl::EntryPoint> &d) override;
+
+    std::any visit_stmt_return(const std::shared_ptr<ast::stmt::Return> &s) override;
+    std::any visit_stmt_expression(const std::shared_ptr<ast::stmt::Expression> &s) override;
+
+private:
+    // Compute the packed layout of the payload, or nullopt if it's not packed
+    std::optional<PackedPayload> packed_layout(const std::shared_ptr<ast::decl::Struct> &decl);
+
+    // Generate the struct, pack and unpack functions for the packed payload
+    void generate_declarations(const std::shared_ptr<ast::decl::Struct> &decl,
+                               PackedPayload &packed);
+
+    // Get the expression encoding the field of the payload value in the bits of a uint
+    std::shared_ptr<ast::expr::Expression> encode_field(const PackedPayloadField &field,
+                                                        const std::string &value);
+
+    // Get the expression decoding the field from the word of the packed payload
+    std::shared_ptr<ast::expr::Expression> decode_field(const PackedPayloadField &field,
+                                                        const std::string &packed);
+
+    // Make a statement assigning the payload to the packed payload variable
+    std::shared_ptr<ast::stmt::Statement> make_pack(
+        const std::shared_ptr<ast::decl::Struct> &decl,
+        const std::string &packed,
+        const std::string &payload);
+};
+}
@@ -0,0 +1,82 @@
+#include "profile.h"
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+namespace crtl {
+
+std::string profile_site_id(const std::string &function,
+                            const std::shared_ptr<ast::Node> &node,
+                            const ProfileSite site)
+{
+    if (node->is_generated()) {
+        return "";
+    }
+    std::string id = function + ":" + std::to_string(node->get_token()->getLine()) + ":" +
+                     std::to_string(node->get_token()->getCharPositionInLine()) + ":";
+    switch (site) {
+    case ProfileSite::FUNCTION_ENTRY:
+        return id + "entry";
+    case ProfileSite::IF_TAKEN:
+        return id + "if.taken";
+    case ProfileSite::IF_NOT_TAKEN:
+        return id + "if.not_taken";
+    case ProfileSite::LOOP_ENTRY:
+        return id + "loop.entry";
+    case ProfileSite::LOOP_BODY:
+        return id + "loop.body";
+    default:
+        return "";
+    }
+}
+
+Profile Profile::from_counters(const nlohmann::json &profile_counters,
+                               const uint32_t *counters)
+{
+    Profile profile;
+    for (size_t i = 0; i < profile_counters.size(); ++i) {
+        profile.counts[profile_counters[i].get<std::string>()] = counters[i];
+    }
+    return profile;
+}
+
+Profile Profile::load(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open profile " + path);
+    }
+    const auto profile_json = nlohmann::json::parse(file);
+
+    Profile profile;
+    for (const auto &c : profile_json["counts"].items()) {
+        profile.counts[c.key()] = c.value().get<uint64_t>();
+    }
+    return profile;
+}
+
+void Profile::save(const std::string &path) const
+{
+    // Sort the counts by site so the files are deterministic and diff cleanly
+    nlohmann::json counts_json = nlohmann::json::object();
+    std::map<std::string, uint64_t> sorted_counts(counts.begin(), counts.end());
+    for (const auto &c : sorted_counts) {
+        counts_json[c.first] = c.second;
+    }
+
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open profile " + path + " for writing");
+    }
+    file << nlohmann::json{{"counts", counts_json}}.dump(4) << "\n";
+}
+
+std::optional<uint64_t> Profile::count(const std::string &site_id) const
+{
+    auto fnd = counts.find(site_id);
+    if (fnd == counts.end()) {
+        return std::nullopt;
+    }
+    return fnd->second;
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "ast/node.h"
+#include "ast_utils.h"
+#include "json.hpp"
+#include "parallel_hashmap/phmap.h"
+
+namespace crtl {
+
+// The name of the global parameter holding the counters of instrumented shaders
+const std::string PROFILE_COUNTERS_PARAM = COMPILER_NAME_PREFIX + "profile_counters";
+
+// The kinds of sites in the shader counted by the profile instrumentation
+enum class ProfileSite {
+    // Calls of a function or entry point
+    FUNCTION_ENTRY,
+    // Executions of the branches of an if statement
+    IF_TAKEN,
+    IF_NOT_TAKEN,
+    // Executions of a loop statement, and iterations of its body
+    LOOP_ENTRY,
+    LOOP_BODY,
+};
+
+/* Get the ID identifying the site of the node in the function. IDs are built from the
+ * function name and the node's source location, so they're stable across compiles of the
+ * same source and independent of the transformations run. Returns an empty string for
+ * generated nodes, which have no source location.
+ */
+std::string profile_site_id(const std::string &function,
+                            const std::shared_ptr<ast::Node> &node,
+                            const ProfileSite site);
+
+/* A Profile holds the execution counts of the instrumented sites of a shader, collected by
+ * running a shader compiled with profile instrumentation. Profiles are saved to .crtlprof
+ * files as JSON, mapping each site ID to its count.
+ */
+struct Profile {
+    phmap::flat_hash_map<std::string, uint64_t> counts;
+
+    // Build the profile from the counters read back from the _crtl_profile_counters buffer,
+    // using the list of counter site IDs in the instrumented shader's info
+    static Profile from_counters(const nlohmann::json &profile_counters,
+                                 const uint32_t *counters);
+
+    // Load a profile from a .crtlprof file, throws if it can't be read
+    static Profile load(const std::string &path);
+
+    void save(const std::string &path) const;
+
+    // Get the count of the site, or nullopt if the site wasn't profiled
+    std::optional<uint64_t> count(const std::string &site_id) const;
+};
+}
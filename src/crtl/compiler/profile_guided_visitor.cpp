@@ -0,0 +1,144 @@
+#include "profile_guided_visitor.h"
+#include <algorithm>
+#include "ast_utils.h"
+
+namespace crtl {
+
+using namespace ast;
+
+ProfileGuidedVisitor::ProfileGuidedVisitor(const Profile &profile) : profile(profile) {}
+
+std::any ProfileGuidedVisitor::visit_ast(const std::shared_ptr<ast::AST> &ast)
+{
+    for (const auto &n : ast->top_level_decls) {
+        auto entry_pt = std::dynamic_pointer_cast<decl::EntryPoint>(n);
+        if (!entry_pt) {
+            continue;
+        }
+        auto count = profile.count(
+            profile_site_id(entry_pt->get_text(), entry_pt, ProfileSite::FUNCTION_ENTRY));
+        if (count) {
+            hot_count = std::max(hot_count, *count);
+        }
+    }
+
+    auto result = ModifyingVisitor::visit_ast(ast);
+    if (num_sites_matched == 0 && !profile.counts.empty()) {
+        report_warning(nullptr,
+                       "None of the sites in the profile were found in the shader, the "
+                       "profile may have been collected from a different shader");
+    }
+    return result;
+}
+
+std::any ProfileGuidedVisitor::visit_decl_function(const std::shared_ptr<decl::Function> &d)
+{
+    function_name = d->get_text();
+    auto count = site_count(d, ProfileSite::FUNCTION_ENTRY);
+    if (count && !d->has_attribute("inline") && !d->has_attribute("noinline")) {
+        if (*count == 0) {
+            add_hint(d, "noinline");
+        } else if (hot_count > 0 && *count >= hot_count) {
+            add_hint(d, "inline");
+        }
+    }
+    return ModifyingVisitor::visit_decl_function(d);
+}
+
+std::any ProfileGuidedVisitor::visit_decl_entry_point(
+    const std::shared_ptr<decl::EntryPoint> &d)
+{
+    function_name = d->get_text();
+    site_count(d, ProfileSite::FUNCTION_ENTRY);
+    return ModifyingVisitor::visit_decl_entry_point(d);
+}
+
+std::any ProfileGuidedVisitor::visit_stmt_if_else(const std::shared_ptr<stmt::IfElse> &s)
+{
+    auto result = ModifyingVisitor::visit_stmt_if_else(s);
+
+    auto taken = site_count(s, ProfileSite::IF_TAKEN);
+    auto not_taken = site_count(s, ProfileSite::IF_NOT_TAKEN);
+    if (!taken || !not_taken || *taken + *not_taken == 0) {
+        return result;
+    }
+
+    if (!s->has_attribute("branch") && !s->has_attribute("flatten")) {
+        const double bias = double(std::max(*taken, *not_taken)) / (*taken + *not_taken);
+        const size_t else_cost = s->else_branch ? count_nodes(s->else_branch) : 0;
+        if (bias >= PROFILE_BIASED_BRANCH_RATIO) {
+            add_hint(s, "branch");
+        } else if (count_nodes(s->if_branch) <= PROFILE_FLATTEN_THRESHOLD &&
+                   else_cost <= PROFILE_FLATTEN_THRESHOLD) {
+            add_hint(s, "flatten");
+        }
+    }
+
+    if (s->else_branch && *not_taken > *taken) {
+        ++num_branches_reordered;
+        s->condition = expr::Unary::logic_not(nullptr, s->condition);
+        std::swap(s->if_branch, s->else_branch);
+        // An if statement moved into the if branch must be in a block so that the else
+        // isn't attached to it in the output
+        if (s->if_branch->get_node_type() != NodeType::STMT_BLOCK) {
+            s->if_branch = std::make_shared<stmt::Block>(
+                nullptr, std::vector<std::shared_ptr<stmt::Statement>>{s->if_branch});
+        }
+    }
+    return result;
+}
+
+std::any ProfileGuidedVisitor::visit_stmt_while(const std::shared_ptr<stmt::While> &s)
+{
+    auto result = ModifyingVisitor::visit_stmt_while(s);
+    hint_loop(s);
+    return result;
+}
+
+std::any ProfileGuidedVisitor::visit_stmt_for(const std::shared_ptr<stmt::For> &s)
+{
+    auto result = ModifyingVisitor::visit_stmt_for(s);
+    hint_loop(s);
+    return result;
+}
+
+std::optional<uint64_t> ProfileGuidedVisitor::site_count(const std::shared_ptr<Node> &node,
+                                                         const ProfileSite site)
+{
+    const std::string site_id = profile_site_id(function_name, node, site);
+    if (site_id.empty()) {
+        return std::nullopt;
+    }
+    auto count = profile.count(site_id);
+    if (count) {
+        ++num_sites_matched;
+    }
+    return count;
+}
+
+void ProfileGuidedVisitor::hint_loop(const std::shared_ptr<stmt::Statement> &loop)
+{
+    auto entries = site_count(loop, ProfileSite::LOOP_ENTRY);
+    auto iterations = site_count(loop, ProfileSite::LOOP_BODY);
+    if (!entries || !iterations || loop->has_attribute("unroll") ||
+        loop->has_attribute("loop")) {
+        return;
+    }
+
+    if (*entries == 0) {
+        add_hint(loop, "loop");
+    } else if (hot_count > 0 && *iterations >= hot_count &&
+               *iterations / *entries <= PROFILE_UNROLL_MAX_TRIP_COUNT) {
+        add_hint(loop, "unroll");
+    }
+}
+
+void ProfileGuidedVisitor::add_hint(const std::shared_ptr<Node> &node,
+                                    const std::string &attribute)
+{
+    // Hints from the profile have no source token, so passes which can't apply them know
+    // not to report it as an error in the source
+    ++num_hints;
+    node->attributes.push_back(std::make_shared<Attribute>(attribute, nullptr));
+}
+}
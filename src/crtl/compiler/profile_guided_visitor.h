@@ -0,0 +1,71 @@
+#pragma once
+
+#include "ast/modifying_visitor.h"
+#include "profile.h"
+
+namespace crtl {
+
+// Branches taking the same direction at least this fraction of the time are biased
+const double PROFILE_BIASED_BRANCH_RATIO = 0.9;
+
+// Max size (in AST nodes) of each branch of unbiased if statements that are flattened
+const size_t PROFILE_FLATTEN_THRESHOLD = 16;
+
+// Max average trip count of hot loops that are unrolled
+const uint64_t PROFILE_UNROLL_MAX_TRIP_COUNT = 8;
+
+/* The ProfileGuidedVisitor applies the execution counts of a profile collected from an
+ * instrumented build of the shader as hints for the optimization passes. A site is hot if it
+ * runs at least as many times as the most frequently called entry point, and cold if it
+ * never ran:
+ *
+ * - Hot functions are marked [inline], and cold functions [noinline]
+ * - Hot loops with a small average trip count are marked [unroll], and cold loops [loop]
+ * - Biased if statements are marked [branch], and unbiased ones with small branches
+ *   [flatten]
+ * - If statements whose else branch is taken more often than the if branch have their
+ *   condition negated and branches swapped, so that the common path comes first
+ *
+ * Attributes written in the source take precedence over the profile. Hints are matched to
+ * the shader by their site IDs, so a profile only applies to the shader it was collected
+ * from. Sites the profile doesn't have counts for are left as is.
+ */
+class ProfileGuidedVisitor : public ast::ModifyingVisitor {
+    const Profile &profile;
+
+    // The name of the function or entry point being visited
+    std::string function_name;
+
+    // The count of the most frequently called entry point
+    uint64_t hot_count = 0;
+
+public:
+    // The number of sites in the shader with counts in the profile
+    size_t num_sites_matched = 0;
+
+    // The number of attributes added from the profile
+    size_t num_hints = 0;
+
+    // The number of if statements whose branches were swapped
+    size_t num_branches_reordered = 0;
+
+    ProfileGuidedVisitor(const Profile &profile);
+
+    std::any visit_ast(const std::shared_ptr<ast::AST> &ast) override;
+
+    std::any visit_decl_function(const std::shared_ptr<ast::decl::Function> &d) override;
+    std::any visit_decl_entry_point(const std::shared_ptr<ast::decl::EntryPoint> &d) override;
+
+    std::any visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s) override;
+    std::any visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s) override;
+    std::any visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s) override;
+
+private:
+    std::optional<uint64_t> site_count(const std::shared_ptr<ast::Node> &node,
+                                       const ProfileSite site);
+
+    void hint_loop(const std::shared_ptr<ast::stmt::Statement> &loop);
+
+    void add_hint(const std::shared_ptr<ast::Node> &node, const std::string &attribute);
+};
+}
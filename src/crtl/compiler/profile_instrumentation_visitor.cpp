@@ -0,0 +1,133 @@
+#include "profile_instrumentation_visitor.h"
+
+namespace crtl {
+
+using namespace ast;
+
+std::any ProfileInstrumentationVisitor::visit_ast(const std::shared_ptr<ast::AST> &ast)
+{
+    auto ast_out = std::any_cast<std::shared_ptr<AST>>(ModifyingVisitor::visit_ast(ast));
+    if (!counter_sites.empty()) {
+        auto counters_type = std::make_shared<ty::Buffer>(
+            std::make_shared<ty::Primitive>(ty::PrimitiveType::UINT), ty::Access::READ_WRITE);
+        auto counters = std::make_shared<decl::GlobalParam>(
+            PROFILE_COUNTERS_PARAM, nullptr, counters_type);
+        ast_out->top_level_decls.insert(ast_out->top_level_decls.begin(), counters);
+    }
+    return ast_out;
+}
+
+std::any ProfileInstrumentationVisitor::visit_decl_function(
+    const std::shared_ptr<decl::Function> &d)
+{
+    function_name = d->get_text();
+    auto result = ModifyingVisitor::visit_decl_function(d);
+    instrument_entry(d, d->block);
+    return result;
+}
+
+std::any ProfileInstrumentationVisitor::visit_decl_entry_point(
+    const std::shared_ptr<decl::EntryPoint> &d)
+{
+    function_name = d->get_text();
+    auto result = ModifyingVisitor::visit_decl_entry_point(d);
+    instrument_entry(d, d->block);
+    return result;
+}
+
+std::any ProfileInstrumentationVisitor::visit_stmt_if_else(
+    const std::shared_ptr<stmt::IfElse> &s)
+{
+    auto result = ModifyingVisitor::visit_stmt_if_else(s);
+
+    auto taken = make_counter(s, ProfileSite::IF_TAKEN);
+    if (!taken) {
+        return result;
+    }
+    s->if_branch = prepend_counter(taken, s->if_branch);
+
+    auto not_taken = make_counter(s, ProfileSite::IF_NOT_TAKEN);
+    if (s->else_branch) {
+        s->else_branch = prepend_counter(not_taken, s->else_branch);
+    } else {
+        s->else_branch = std::make_shared<stmt::Block>(
+            nullptr, std::vector<std::shared_ptr<stmt::Statement>>{not_taken});
+    }
+    return result;
+}
+
+std::any ProfileInstrumentationVisitor::visit_stmt_while(const std::shared_ptr<stmt::While> &s)
+{
+    ModifyingVisitor::visit_stmt_while(s);
+    return instrument_loop(s, s->body);
+}
+
+std::any ProfileInstrumentationVisitor::visit_stmt_for(const std::shared_ptr<stmt::For> &s)
+{
+    ModifyingVisitor::visit_stmt_for(s);
+    return instrument_loop(s, s->body);
+}
+
+void ProfileInstrumentationVisitor::instrument_entry(
+    const std::shared_ptr<decl::Declaration> &d, const std::shared_ptr<stmt::Block> &block)
+{
+    auto counter = make_counter(d, ProfileSite::FUNCTION_ENTRY);
+    if (counter) {
+        block->statements.insert(block->statements.begin(), counter);
+    }
+}
+
+std::shared_ptr<stmt::Statement> ProfileInstrumentationVisitor::instrument_loop(
+    const std::shared_ptr<stmt::Statement> &loop, std::shared_ptr<stmt::Statement> &body)
+{
+    auto entry = make_counter(loop, ProfileSite::LOOP_ENTRY);
+    if (!entry) {
+        return loop;
+    }
+    body = prepend_counter(make_counter(loop, ProfileSite::LOOP_BODY), body);
+
+    // The loop is wrapped in a block instead of returning both statements, since loops
+    // may be the branch or body of another statement
+    return std::make_shared<stmt::Block>(
+        nullptr, std::vector<std::shared_ptr<stmt::Statement>>{entry, loop});
+}
+
+std::shared_ptr<stmt::Statement> ProfileInstrumentationVisitor::make_counter(
+    const std::shared_ptr<Node> &node, const ProfileSite site)
+{
+    const std::string site_id = profile_site_id(function_name, node, site);
+    if (site_id.empty()) {
+        return nullptr;
+    }
+    const int index = counter_sites.size();
+    counter_sites.push_back(site_id);
+
+    // atomic_add(_crtl_profile_counters[index], 1);
+    auto counter = std::make_shared<expr::StructArrayAccess>(
+        std::make_shared<expr::Variable>(PROFILE_COUNTERS_PARAM),
+        std::vector<std::shared_ptr<expr::StructArrayAccessFragment>>{
+            std::make_shared<expr::ArrayAccessFragment>(
+                std::make_shared<expr::Constant>(nullptr, index))});
+    auto increment = std::make_shared<expr::FunctionCall>(
+        "atomic_add",
+        std::vector<std::shared_ptr<expr::Expression>>{
+            counter, std::make_shared<expr::Constant>(nullptr, 1)});
+    return std::make_shared<stmt::Expression>(nullptr, increment);
+}
+
+std::shared_ptr<stmt::Statement> ProfileInstrumentationVisitor::prepend_counter(
+    const std::shared_ptr<stmt::Statement> &counter, const std::shared_ptr<stmt::Statement> &s)
+{
+    if (!s) {
+        return std::make_shared<stmt::Block>(
+            nullptr, std::vector<std::shared_ptr<stmt::Statement>>{counter});
+    }
+    auto block = std::dynamic_pointer_cast<stmt::Block>(s);
+    if (block) {
+        block->statements.insert(block->statements.begin(), counter);
+        return block;
+    }
+    return std::make_shared<stmt::Block>(
+        nullptr, std::vector<std::shared_ptr<stmt::Statement>>{counter, s});
+}
+}
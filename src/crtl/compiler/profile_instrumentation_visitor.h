@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ast/modifying_visitor.h"
+#include "profile.h"
+
+namespace crtl {
+
+/* The ProfileInstrumentationVisitor inserts counters into the shader that count how many
+ * times each function and entry point is called, each branch of an if statement is taken,
+ * and each loop is entered and runs its body. The counters are atomically incremented in
+ * the _crtl_profile_counters global parameter, a RWBuffer<uint> bound by the application,
+ * which reads back the counts to build a Profile. Branches without an else get an else
+ * holding its counter, so that the counts of both branches are known.
+ *
+ * Counters are only placed at nodes from the source, so each counter is identified by the
+ * stable site ID of its node. The instrumentation is inserted before the optimization passes
+ * run, so that the sites correspond to the shader as written.
+ */
+class ProfileInstrumentationVisitor : public ast::ModifyingVisitor {
+    // The name of the function or entry point being visited
+    std::string function_name;
+
+public:
+    // The site ID counted by each counter, indexed by counter
+    std::vector<std::string> counter_sites;
+
+    std::any visit_ast(const std::shared_ptr<ast::AST> &ast) override;
+
+    std::any visit_decl_function(const std::shared_ptr<ast::decl::Function> &d) override;
+    std::any visit_decl_entry_point(const std::shared_ptr<ast::decl::EntryPoint> &d) override;
+
+    std::any visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s) override;
+    std::any visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s) override;
+    std::any visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s) override;
+
+private:
+    // Instrument the entry of the function or entry point body
+    void instrument_entry(const std::shared_ptr<ast::decl::Declaration> &d,
+                          const std::shared_ptr<ast::stmt::Block> &block);
+
+    // Instrument the loop, returning a block holding the loop entry counter and the loop
+    std::shared_ptr<ast::stmt::Statement> instrument_loop(
+        const std::shared_ptr<ast::stmt::Statement> &loop,
+        std::shared_ptr<ast::stmt::Statement> &body);
+
+    /* Make a statement incrementing a new counter for the site of the node, or nullptr if
+     * the node is generated and has no stable site ID
+     */
+    std::shared_ptr<ast::stmt::Statement> make_counter(const std::shared_ptr<ast::Node> &node,
+                                                       const ProfileSite site);
+
+    // Prepend the counter to the statement, wrapping the statement in a block if needed
+    std::shared_ptr<ast::stmt::Statement> prepend_counter(
+        const std::shared_ptr<ast::stmt::Statement> &counter,
+        const std::shared_ptr<ast::stmt::Statement> &s);
+};
+}
@@ -0,0 +1,114 @@
+#include "ray_payload_analysis.h"
+#include <algorithm>
+#include "ast_utils.h"
+#include "call_graph_analysis.h"
+#include "resolution_analysis.h"
+
+namespace crtl {
+
+using namespace ast;
+
+// Add the struct to the list if it's not already in it
+void add_unique(std::vector<std::shared_ptr<decl::Struct>> &structs,
+                const std::shared_ptr<decl::Struct> &s)
+{
+    if (s && std::find(structs.begin(), structs.end(), s) == structs.end()) {
+        structs.push_back(s);
+    }
+}
+
+std::string RayPayloadAnalysis::name() const
+{
+    return "ray_payload";
+}
+
+std::set<ASTChange> RayPayloadAnalysis::invalidated_by() const
+{
+    return {ASTChange::FUNCTIONS, ASTChange::CALLS, ASTChange::PARAMETERS};
+}
+
+void RayPayloadAnalysis::run(PassManager &pm)
+{
+    auto resolved = pm.get_analysis<ResolutionAnalysis>()->resolved;
+    auto call_graph = pm.get_analysis<CallGraphAnalysis>();
+
+    // Struct types are looked up by name, since types with modifiers are copies of the
+    // declared struct type
+    phmap::flat_hash_map<std::string, std::shared_ptr<decl::Struct>> structs;
+    for (const auto &n : pm.ast->top_level_decls) {
+        auto s = std::dynamic_pointer_cast<decl::Struct>(n);
+        if (s) {
+            structs[s->get_text()] = s;
+        }
+    }
+    auto struct_decl = [&](const std::shared_ptr<ty::Type> &type) {
+        auto struct_type = std::dynamic_pointer_cast<ty::Struct>(type);
+        auto fnd = struct_type ? structs.find(struct_type->name) : structs.end();
+        return fnd != structs.end() ? fnd->second : nullptr;
+    };
+
+    // The payloads traced directly by each function and entry point
+    phmap::flat_hash_map<std::shared_ptr<decl::Declaration>,
+                         std::vector<std::shared_ptr<decl::Struct>>>
+        traced;
+    for (const auto &n : pm.ast->top_level_decls) {
+        auto d = std::dynamic_pointer_cast<decl::Declaration>(n);
+        if (!d || (n->get_node_type() != NodeType::DECL_FCN &&
+                   n->get_node_type() != NodeType::DECL_ENTRY_POINT)) {
+            continue;
+        }
+        std::vector<std::shared_ptr<expr::FunctionCall>> calls;
+        collect_calls(n, calls);
+        for (const auto &c : calls) {
+            auto fnd = resolved->call_expr.find(c);
+            if (fnd == resolved->call_expr.end() || !fnd->second->is_builtin() ||
+                fnd->second->get_text() != "trace_ray" || c->args.size() < 3) {
+                continue;
+            }
+            const auto &payload_arg = c->args[2];
+            auto var = payload_arg->get_node_type() == NodeType::EXPR_LITERAL_VAR
+                           ? accessed_variable(payload_arg, *resolved)
+                           : nullptr;
+            auto payload = var ? struct_decl(var->get_type()) : nullptr;
+            if (!payload) {
+                report_error(payload_arg->get_token(),
+                             "The payload passed to trace_ray must be a struct variable");
+                continue;
+            }
+            trace_calls[c] = payload;
+            add_unique(traced[d], payload);
+        }
+    }
+
+    for (const auto &n : pm.ast->top_level_decls) {
+        auto entry_point = std::dynamic_pointer_cast<decl::EntryPoint>(n);
+        if (!entry_point) {
+            continue;
+        }
+        auto &ep_payloads = entry_points[entry_point];
+        for (const auto &p : traced[entry_point]) {
+            add_unique(ep_payloads.traced_payloads, p);
+        }
+        for (const auto &fn : call_graph->reachable_functions(entry_point)) {
+            for (const auto &p : traced[fn]) {
+                add_unique(ep_payloads.traced_payloads, p);
+            }
+        }
+
+        auto payload_param = payload_parameter(entry_point);
+        if (payload_param) {
+            ep_payloads.received_payload = struct_decl(payload_param->get_type());
+        }
+        auto attributes_param = hit_attribute_parameter(entry_point);
+        if (attributes_param) {
+            ep_payloads.hit_attributes = struct_decl(attributes_param->get_type());
+        }
+
+        for (const auto &p : ep_payloads.traced_payloads) {
+            add_unique(payloads, p);
+        }
+        add_unique(payloads, ep_payloads.received_payload);
+        add_unique(hit_attributes, ep_payloads.hit_attributes);
+    }
+}
+}
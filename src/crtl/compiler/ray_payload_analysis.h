@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pass_manager.h"
+
+namespace crtl {
+
+// The ray payload and hit attribute structs used by an entry point
+struct EntryPointPayloads {
+    // The payload structs passed to trace_ray by the entry point and the functions it calls
+    std::vector<std::shared_ptr<ast::decl::Struct>> traced_payloads;
+
+    // The payload struct received by a hit or miss entry point
+    std::shared_ptr<ast::decl::Struct> received_payload;
+
+    // The hit attributes struct received by a hit entry point
+    std::shared_ptr<ast::decl::Struct> hit_attributes;
+};
+
+/* The RayPayloadAnalysis finds the structs passed between the shader stages as ray payloads
+ * and hit attributes: the payloads passed to trace_ray, directly or through the functions an
+ * entry point calls, and the payloads and hit attributes received by hit and miss entry
+ * points. It's an error to pass a value that isn't a struct variable as the payload of
+ * trace_ray.
+ */
+class RayPayloadAnalysis : public Analysis {
+public:
+    phmap::flat_hash_map<std::shared_ptr<ast::decl::EntryPoint>, EntryPointPayloads>
+        entry_points;
+
+    // The payload struct passed by each trace_ray call
+    phmap::flat_hash_map<std::shared_ptr<ast::expr::FunctionCall>,
+                         std::shared_ptr<ast::decl::Struct>>
+        trace_calls;
+
+    // All structs used as payloads and as hit attributes in the program, in the order
+    // they're first used
+    std::vector<std::shared_ptr<ast::decl::Struct>> payloads;
+    std::vector<std::shared_ptr<ast::decl::Struct>> hit_attributes;
+
+    std::string name() const override;
+
+    std::set<ASTChange> invalidated_by() const override;
+
+    void run(PassManager &pm) override;
+};
+}
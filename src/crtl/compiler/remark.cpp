@@ -0,0 +1,37 @@
+#include "remark.h"
+
+namespace crtl {
+
+std::string Remark::to_string() const
+{
+    std::string location = "in generated code";
+    if (line != 0) {
+        location = "at " + std::to_string(line) + ":" + std::to_string(column);
+    }
+    return "Remark " + location + " [" + pass + ", " + crtl::to_string(kind) + "] > " +
+           message;
+}
+
+std::string to_string(const RemarkKind kind)
+{
+    switch (kind) {
+    case RemarkKind::APPLIED:
+        return "applied";
+    case RemarkKind::MISSED:
+        return "missed";
+    case RemarkKind::ANALYSIS:
+        return "analysis";
+    default:
+        return "unknown";
+    }
+}
+
+void to_json(nlohmann::json &j, const Remark &remark)
+{
+    j = nlohmann::json{{"kind", to_string(remark.kind)},
+                       {"pass", remark.pass},
+                       {"line", remark.line},
+                       {"column", remark.column},
+                       {"message", remark.message}};
+}
+}
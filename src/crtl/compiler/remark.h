@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "json.hpp"
+
+namespace crtl {
+
+enum class RemarkKind {
+    // An optimization was applied
+    APPLIED,
+    // An optimization was considered but not applied
+    MISSED,
+    // Information about the shader found by an analysis
+    ANALYSIS,
+};
+
+/* An optimization remark reports a decision made by a compiler pass at a location in the
+ * shader, so that shader authors can see which optimizations were applied or missed and why
+ */
+struct Remark {
+    RemarkKind kind = RemarkKind::APPLIED;
+
+    // The name of the pass reporting the remark
+    std::string pass;
+
+    // The source location of the remark, 0 for generated code which has no source location
+    size_t line = 0;
+    size_t column = 0;
+
+    std::string message;
+
+    std::string to_string() const;
+};
+
+std::string to_string(const RemarkKind kind);
+
+void to_json(nlohmann::json &j, const Remark &remark);
+}
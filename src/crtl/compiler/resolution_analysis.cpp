@@ -0,0 +1,25 @@
+#include "resolution_analysis.h"
+#include "builtins.h"
+
+namespace crtl {
+
+std::string ResolutionAnalysis::name() const
+{
+    return "resolution";
+}
+
+std::set<ASTChange> ResolutionAnalysis::invalidated_by() const
+{
+    return {ASTChange::UNRESOLVED_NODES};
+}
+
+void ResolutionAnalysis::run(PassManager &pm)
+{
+    builtins = get_builtin_decls();
+
+    ResolverVisitor resolver_visitor(builtins);
+    resolver_visitor.visit_ast(pm.ast);
+    resolved = resolver_visitor.resolved;
+    had_error = resolver_visitor.had_error;
+}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "pass_manager.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* The ResolutionAnalysis runs the resolver over the AST. Transformations register the nodes
+ * they generate in the resolver results, so the resolution stays valid across them unless a
+ * pass reports adding unresolved nodes.
+ */
+class ResolutionAnalysis : public Analysis {
+public:
+    // The builtin declarations the program is resolved against, passes generating calls to
+    // builtins must reference these declarations
+    std::vector<std::shared_ptr<ast::decl::Declaration>> builtins;
+
+    std::shared_ptr<ResolverPassResult> resolved;
+
+    std::string name() const override;
+
+    std::set<ASTChange> invalidated_by() const override;
+
+    void run(PassManager &pm) override;
+};
+}
@@ -1,10 +1,50 @@
 #include "resolver_visitor.h"
+#include <algorithm>
+#include <cctype>
+#include <limits>
 #include "ast/visitor.h"
+#include "ast_utils.h"
+#include "clone_visitor.h"
 #include "error_listener.h"
+#include "expression_type.h"
 #include "parallel_hashmap/phmap.h"
 
 namespace crtl {
 
+using TypeArguments = phmap::flat_hash_map<std::string, std::shared_ptr<ast::ty::Type>>;
+
+// Substitute the type argument for the type if it's a type parameter, keeping the modifiers
+std::shared_ptr<ast::ty::Type> substitute_type_argument(
+    const std::shared_ptr<ast::ty::Type> &type, const TypeArguments &type_args)
+{
+    auto struct_type = std::dynamic_pointer_cast<ast::ty::Struct>(type);
+    if (!struct_type) {
+        return type;
+    }
+    auto fnd = type_args.find(struct_type->name);
+    if (fnd == type_args.end()) {
+        return type;
+    }
+    auto substituted = ast::ty::copy_type(fnd->second);
+    substituted->modifiers = type->modifiers;
+    return substituted;
+}
+
+// Substitute the type arguments into the types of the variables declared in the subtree
+void substitute_variable_type_arguments(const std::shared_ptr<ast::Node> &n,
+                                        const TypeArguments &type_args)
+{
+    auto var = std::dynamic_pointer_cast<ast::decl::Variable>(n);
+    if (var) {
+        var->get_type() = substitute_type_argument(var->get_type(), type_args);
+    }
+    for (const auto &c : n->get_children()) {
+        if (c) {
+            substitute_variable_type_arguments(c, type_args);
+        }
+    }
+}
+
 ResolverVisitor::SymbolStatus::SymbolStatus(
     const std::shared_ptr<ast::decl::Declaration> &decl)
     : decl(decl)
@@ -22,9 +62,22 @@ ResolverVisitor::ResolverVisitor(
 
 std::any ResolverVisitor::visit_decl_function(const std::shared_ptr<ast::decl::Function> &d)
 {
+    validate_attributes(d, {{"inline", 0}, {"noinline", 0}, {"fast_math", 0}});
+    if (d->has_attribute("inline") && d->has_attribute("noinline")) {
+        report_error(d->get_attribute("noinline")->token,
+                     "Function '" + d->get_text() + "' cannot be both inline and noinline");
+    }
+
     declare(d);
     define(d);
 
+    // Generic functions are resolved when they're instantiated, since the types of their
+    // parameters and variables aren't known until then
+    if (d->is_generic()) {
+        generic_scopes[d] = global_scope;
+        return std::any();
+    }
+
     begin_scope();
     // decl::Function's children are the parameters followed by the block,
     // so we can just visit them in order
@@ -53,9 +106,46 @@ std::any ResolverVisitor::visit_decl_entry_point(
     // Entry points are not callable from regular shader code, so we don't declare/define
     // them for resolution. Just push on a scope for the parameters and visit the node's
     // children (parameters and block)
+    validate_attributes(d,
+                        {{"fast_math", 0}, {"ray_type", std::numeric_limits<size_t>::max()}});
     begin_scope();
     visit_children(d);
     end_scope();
+
+    // The ray payload and hit attributes are passed between the shader stages as structs
+    auto payload = payload_parameter(d);
+    if (payload && payload->get_type()->base_type != ast::ty::BaseType::STRUCT) {
+        report_error(payload->get_token(),
+                     "The ray payload parameter '" + payload->get_text() +
+                         "' must be a struct, the payload is the first parameter of hit and "
+                         "miss entry points");
+    }
+    auto attributes = hit_attribute_parameter(d);
+    if (attributes && attributes->get_type()->base_type != ast::ty::BaseType::STRUCT) {
+        report_error(attributes->get_token(),
+                     "The hit attributes parameter '" + attributes->get_text() +
+                         "' must be a struct, the hit attributes are the second parameter of "
+                         "hit entry points");
+    }
+
+    // Hit and miss entry points can list the ray types they're used for, which are the hit
+    // group offsets (or miss indices) passed to trace_ray
+    auto ray_type = d->get_attribute("ray_type");
+    if (ray_type) {
+        if (!payload) {
+            report_error(ray_type->token,
+                         "ray_type can only be applied to hit and miss entry points");
+        }
+        if (ray_type->args.empty()) {
+            report_error(ray_type->token, "ray_type must list at least one ray type");
+        }
+        for (const auto &r : ray_type->args) {
+            if (r.empty() || r.size() > 9 ||
+                r.find_first_not_of("0123456789") != std::string::npos) {
+                report_error(ray_type->token, "ray_type must list non-negative integers");
+            }
+        }
+    }
     return std::any();
 }
 
@@ -69,6 +159,7 @@ std::any ResolverVisitor::visit_decl_global_param(
                      "Use of undeclared struct '" + d->get_type()->to_string() + "'");
         return std::any();
     }
+    validate_buffer_attributes(d, d->get_type());
     declare(d);
     define(d);
     return std::any();
@@ -77,7 +168,15 @@ std::any ResolverVisitor::visit_decl_global_param(
 std::any ResolverVisitor::visit_decl_struct(const std::shared_ptr<ast::decl::Struct> &d)
 {
     // No need to visit decl::Struct children, as members aren't resolved independently
-    // of the struct itself
+    // of the struct itself. Struct members are resolved so that the layout of nested
+    // structs can be computed
+    for (const auto &m : d->members) {
+        if (!resolve_type(m->get_type())) {
+            report_error(m->get_token(),
+                         "Use of undeclared struct '" + m->get_type()->to_string() + "'");
+        }
+        validate_member_attributes(m);
+    }
     declare(d);
     define(d);
     return std::any();
@@ -106,8 +205,27 @@ std::any ResolverVisitor::visit_stmt_block(const std::shared_ptr<ast::stmt::Bloc
     return std::any();
 }
 
+std::any ResolverVisitor::visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s)
+{
+    validate_attributes(s, {{"branch", 0}, {"flatten", 0}});
+    if (s->has_attribute("branch") && s->has_attribute("flatten")) {
+        report_error(s->get_attribute("flatten")->token,
+                     "If statement cannot be marked both branch and flatten");
+    }
+    visit_children(s);
+    return std::any();
+}
+
+std::any ResolverVisitor::visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s)
+{
+    validate_loop_attributes(s);
+    visit_children(s);
+    return std::any();
+}
+
 std::any ResolverVisitor::visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s)
 {
+    validate_loop_attributes(s);
     // Push on a scope for the for loop's loop variable declaration
     begin_scope();
     visit_children(s);
@@ -130,7 +248,19 @@ std::any ResolverVisitor::visit_expr_variable(const std::shared_ptr<ast::expr::V
 std::any ResolverVisitor::visit_expr_function_call(
     const std::shared_ptr<ast::expr::FunctionCall> &e)
 {
+    // Resolve the variables and calls in the arguments
+    visit_children(e);
+
     auto fn_decl = resolve_function(e);
+    if (fn_decl && fn_decl->is_generic()) {
+        // Errors deducing the type arguments are reported by instantiate
+        fn_decl = instantiate(fn_decl, e);
+        if (!fn_decl) {
+            resolved->call_expr.erase(e);
+            return std::any();
+        }
+    }
+
     if (fn_decl) {
         resolved->call_expr[e] = fn_decl;
     } else {
@@ -159,6 +289,14 @@ void ResolverVisitor::declare(const std::shared_ptr<ast::decl::Declaration> &dec
 {
     auto *current_scope = scopes.empty() ? &global_scope : &scopes.back();
     const std::string decl_name = decl->get_text();
+    // Declarations made by the compiler don't have a token, or take the token of the
+    // declaration they're generated from, so only names written in the source are checked
+    if (decl->get_token() && decl->get_token()->getText() == decl_name &&
+        decl_name.starts_with(COMPILER_NAME_PREFIX)) {
+        report_error(decl->get_token(),
+                     "Names starting with '" + COMPILER_NAME_PREFIX +
+                         "' are reserved for the compiler");
+    }
     auto fnd = current_scope->find(decl_name);
     if (fnd != current_scope->end()) {
         report_error(decl->get_token(),
@@ -174,8 +312,143 @@ void ResolverVisitor::define(const std::shared_ptr<ast::decl::Declaration> &decl
     (*current_scope)[decl->get_text()].defined = true;
 }
 
+void ResolverVisitor::validate_attributes(
+    const std::shared_ptr<ast::Node> &node,
+    const phmap::flat_hash_map<std::string, size_t> &supported)
+{
+    for (const auto &a : node->attributes) {
+        auto fnd = supported.find(a->name);
+        if (fnd == supported.end()) {
+            report_error(a->token, "Unsupported attribute '" + a->name + "'");
+        } else if (a->args.size() > fnd->second) {
+            report_error(a->token,
+                         "Too many arguments passed to attribute '" + a->name + "'");
+        }
+    }
+}
+
+void ResolverVisitor::validate_loop_attributes(const std::shared_ptr<ast::Node> &node)
+{
+    validate_attributes(node, {{"unroll", 1}, {"loop", 0}, {"allow_uav_condition", 0}});
+    if (node->has_attribute("unroll") && node->has_attribute("loop")) {
+        report_error(node->get_attribute("loop")->token,
+                     "Loop cannot be marked both unroll and loop");
+    }
+
+    auto unroll = node->get_attribute("unroll");
+    if (unroll && !unroll->args.empty()) {
+        const std::string &count = unroll->args[0];
+        if (count.empty() || count.size() > 9 ||
+            count.find_first_not_of("0123456789") != std::string::npos ||
+            std::stoi(count) <= 0) {
+            report_error(unroll->token, "unroll count must be a positive integer");
+        }
+    }
+}
+
+void ResolverVisitor::validate_buffer_attributes(const std::shared_ptr<ast::Node> &node,
+                                                 const std::shared_ptr<ast::ty::Type> &type)
+{
+    validate_attributes(node, {{"soa", 0}});
+    auto soa = node->get_attribute("soa");
+    if (!soa) {
+        return;
+    }
+    auto buffer = std::dynamic_pointer_cast<ast::ty::Buffer>(type);
+    auto struct_type =
+        buffer ? std::dynamic_pointer_cast<ast::ty::Struct>(buffer->template_parameters[0])
+               : nullptr;
+    if (!struct_type) {
+        report_error(soa->token, "soa can only be applied to buffers of structs");
+        return;
+    }
+    if (buffer->access != ast::ty::Access::READ_ONLY) {
+        report_error(soa->token, "soa can only be applied to read only buffers");
+    }
+    auto fnd = resolved->struct_type.find(struct_type);
+    if (fnd == resolved->struct_type.end()) {
+        return;
+    }
+    for (const auto &m : fnd->second->members) {
+        const auto base_type = m->get_type()->base_type;
+        if (base_type != ast::ty::BaseType::PRIMITIVE &&
+            base_type != ast::ty::BaseType::VECTOR && base_type != ast::ty::BaseType::MATRIX) {
+            report_error(soa->token,
+                         "soa can only be applied to buffers of structs with primitive, "
+                         "vector and matrix members, '" +
+                             m->get_text() + "' is a " + m->get_type()->to_string());
+        }
+    }
+}
+
+void ResolverVisitor::validate_member_attributes(
+    const std::shared_ptr<ast::decl::StructMember> &member)
+{
+    // Buffer members take attributes selecting their layout instead of an encoding
+    if (member->get_type()->base_type == ast::ty::BaseType::BUFFER) {
+        validate_buffer_attributes(member, member->get_type());
+        return;
+    }
+    validate_attributes(member, {{"bits", 1}, {"half", 0}, {"unorm", 1}, {"octahedral", 0}});
+    if (member->attributes.empty()) {
+        return;
+    }
+    auto attribute = member->attributes[0];
+    if (member->attributes.size() > 1) {
+        report_error(member->attributes[1]->token,
+                     "Struct member '" + member->get_text() +
+                         "' can only have one encoding attribute");
+        return;
+    }
+
+    const auto type = member->get_type();
+    auto vector = std::dynamic_pointer_cast<ast::ty::Vector>(type);
+    auto primitive = vector ? vector->element_type
+                            : std::dynamic_pointer_cast<ast::ty::Primitive>(type);
+    const auto element = primitive ? primitive->type_id : ast::ty::PrimitiveType::VOID;
+
+    // The number of bits is optional for unorm, defaulting to 8
+    uint32_t max_bits = 0;
+    if (attribute->name == "bits") {
+        max_bits = 32;
+        if (vector || (element != ast::ty::PrimitiveType::INT &&
+                       element != ast::ty::PrimitiveType::UINT)) {
+            report_error(attribute->token, "bits can only be applied to int or uint members");
+        } else if (attribute->args.empty()) {
+            report_error(attribute->token, "bits requires the number of bits to store");
+        }
+    } else if (attribute->name == "half" || attribute->name == "unorm") {
+        max_bits = attribute->name == "unorm" ? 16 : 0;
+        if (element != ast::ty::PrimitiveType::FLOAT) {
+            report_error(attribute->token,
+                         attribute->name + " can only be applied to float scalar or vector "
+                                           "members");
+        }
+    } else if (attribute->name == "octahedral" &&
+               (!vector || element != ast::ty::PrimitiveType::FLOAT ||
+                vector->dimensionality != 3)) {
+        report_error(attribute->token, "octahedral can only be applied to float3 members");
+    }
+
+    if (max_bits > 0 && !attribute->args.empty()) {
+        const std::string &bits = attribute->args[0];
+        if (bits.empty() || bits.size() > 2 ||
+            bits.find_first_not_of("0123456789") != std::string::npos ||
+            std::stoi(bits) <= 0 || std::stoi(bits) > int(max_bits)) {
+            report_error(attribute->token,
+                         attribute->name + " must store between 1 and " +
+                             std::to_string(max_bits) + " bits");
+        }
+    }
+}
+
 bool ResolverVisitor::resolve_type(const std::shared_ptr<ast::ty::Type> &type)
 {
+    // Buffers can hold structs, which are resolved to compute the buffer's layout
+    auto buffer = std::dynamic_pointer_cast<ast::ty::Buffer>(type);
+    if (buffer) {
+        return resolve_type(buffer->template_parameters[0]);
+    }
     if (type->base_type != ast::ty::BaseType::STRUCT) {
         return true;
     }
@@ -259,4 +532,137 @@ std::shared_ptr<ast::decl::Function> ResolverVisitor::resolve_function(
     }
     return nullptr;
 }
+
+std::shared_ptr<ast::decl::Function> ResolverVisitor::instantiate(
+    const std::shared_ptr<ast::decl::Function> &generic,
+    const std::shared_ptr<ast::expr::FunctionCall> &call)
+{
+    const std::string &name = generic->get_text();
+    if (call->args.size() != generic->parameters.size()) {
+        report_error(call->get_token(),
+                     "Generic function '" + name + "' takes " +
+                         std::to_string(generic->parameters.size()) + " arguments, but " +
+                         std::to_string(call->args.size()) + " were passed");
+        return nullptr;
+    }
+
+    // Deduce the type arguments from the arguments passed for parameters whose type is a
+    // type parameter
+    const auto &type_params = generic->type_parameters;
+    TypeArguments type_args;
+    for (size_t i = 0; i < call->args.size(); ++i) {
+        auto param_type =
+            std::dynamic_pointer_cast<ast::ty::Struct>(generic->parameters[i]->get_type());
+        if (!param_type || std::find(type_params.begin(), type_params.end(),
+                                     param_type->name) == type_params.end()) {
+            continue;
+        }
+
+        auto arg_type = infer_expression_type(call->args[i], *resolved);
+        if (!arg_type) {
+            report_error(call->get_token(),
+                         "Cannot deduce the type of argument " + std::to_string(i) +
+                             " passed to generic function '" + name + "'");
+            return nullptr;
+        }
+        auto fnd = type_args.find(param_type->name);
+        if (fnd != type_args.end() && fnd->second->to_string() != arg_type->to_string()) {
+            report_error(call->get_token(),
+                         "Conflicting types " + fnd->second->to_string() + " and " +
+                             arg_type->to_string() + " deduced for type parameter '" +
+                             param_type->name + "' of '" + name + "'");
+            return nullptr;
+        }
+        auto deduced = ast::ty::copy_type(arg_type);
+        deduced->modifiers.clear();
+        type_args[param_type->name] = deduced;
+    }
+
+    std::vector<std::shared_ptr<ast::ty::Type>> ordered_type_args;
+    std::string signature = name + "<";
+    for (const auto &t : type_params) {
+        auto fnd = type_args.find(t);
+        if (fnd == type_args.end()) {
+            report_error(call->get_token(),
+                         "Cannot deduce type parameter '" + t + "' of generic function '" +
+                             name + "' from the arguments");
+            return nullptr;
+        }
+        signature += (ordered_type_args.empty() ? "" : ", ") + fnd->second->to_string();
+        ordered_type_args.push_back(fnd->second);
+    }
+    signature += ">";
+
+    auto fnd = instantiations.find(signature);
+    if (fnd != instantiations.end()) {
+        return fnd->second;
+    }
+
+    // Copy the generic function, substituting the type arguments into the types of its
+    // parameters, variables and return type
+    CloneVisitor cloner(resolved);
+    std::vector<std::shared_ptr<ast::decl::Variable>> params;
+    for (const auto &p : generic->parameters) {
+        auto param = cloner.clone(p);
+        param->get_type() = substitute_type_argument(p->get_type(), type_args);
+        params.push_back(param);
+    }
+    auto block = cloner.clone(generic->block);
+    substitute_variable_type_arguments(block, type_args);
+
+    auto fn_ty = std::dynamic_pointer_cast<ast::ty::Function>(generic->get_type());
+    auto instance = std::make_shared<ast::decl::Function>(
+        instance_name(generic, ordered_type_args),
+        generic->get_token(),
+        params,
+        block,
+        substitute_type_argument(fn_ty->return_type, type_args));
+    instance->attributes = generic->attributes;
+
+    // The instantiation is registered before resolving it so that recursive calls find it
+    instantiations[signature] = instance;
+    resolved->generic_instances[generic].push_back(instance);
+
+    // Resolve the instantiation in the global scope of the generic function's declaration,
+    // outside the scopes of the function containing the call
+    auto instance_scope = generic_scopes[generic];
+    auto caller_scopes = std::move(scopes);
+    scopes.clear();
+    std::swap(global_scope, instance_scope);
+
+    const bool prior_error = had_error;
+    had_error = false;
+    visit_decl_function(instance);
+    if (had_error) {
+        report_error(call->get_token(), "In instantiation of '" + signature + "'");
+    }
+    had_error = had_error || prior_error;
+
+    std::swap(global_scope, instance_scope);
+    scopes = std::move(caller_scopes);
+    return instance;
+}
+
+std::string ResolverVisitor::instance_name(
+    const std::shared_ptr<ast::decl::Function> &generic,
+    const std::vector<std::shared_ptr<ast::ty::Type>> &type_args)
+{
+    // The instantiations are emitted alongside the user's functions, so they're given reserved
+    // names that can't collide with globals declared anywhere in the source
+    std::string name = COMPILER_NAME_PREFIX + generic->get_text();
+    for (const auto &t : type_args) {
+        std::string type_name = t->to_string();
+        for (auto &c : type_name) {
+            c = std::isalnum(static_cast<unsigned char>(c))
+                    ? std::tolower(static_cast<unsigned char>(c))
+                    : '_';
+        }
+        name += "_" + type_name;
+    }
+    while (global_scope.contains(name) || instance_names.contains(name)) {
+        name += "_";
+    }
+    instance_names.insert(name);
+    return name;
+}
 }
@@ -10,6 +10,7 @@ namespace crtl {
  * - every struct type used to the declaration of the struct
  * - every variable expression to the declaration of the variable
  * - every function call expression to the declaration of the function
+ * - every generic function to its instantiations
  */
 struct ResolverPassResult {
     // A map of all struct type usages found in the code to the declaration for the struct
@@ -28,6 +29,15 @@ struct ResolverPassResult {
     phmap::parallel_flat_hash_map<std::shared_ptr<ast::expr::FunctionCall>,
                                   std::shared_ptr<ast::decl::Function>>
         call_expr;
+
+    /* The instantiations of each generic function, in the order they were created. Calls to
+     * generic functions resolve to the instantiation for the deduced type arguments. The
+     * instantiations are not part of the AST until the MonomorphizationVisitor replaces the
+     * generic functions with them
+     */
+    phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Function>,
+                                  std::vector<std::shared_ptr<ast::decl::Function>>>
+        generic_instances;
 };
 
 class ResolverVisitor : public ast::Visitor {
@@ -52,6 +62,19 @@ class ResolverVisitor : public ast::Visitor {
      */
     std::vector<phmap::parallel_flat_hash_map<std::string, SymbolStatus>> scopes;
 
+    /* The global scope at the declaration of each generic function. Instantiations are
+     * resolved in this scope, as they're placed where the generic function was declared
+     */
+    phmap::flat_hash_map<std::shared_ptr<ast::decl::Function>,
+                         phmap::parallel_flat_hash_map<std::string, SymbolStatus>>
+        generic_scopes;
+
+    // The instantiations of the generic functions by their signature, e.g. "lerp3<FLOAT3>"
+    phmap::flat_hash_map<std::string, std::shared_ptr<ast::decl::Function>> instantiations;
+
+    // The names given to the instantiations
+    phmap::flat_hash_set<std::string> instance_names;
+
 public:
     std::shared_ptr<ResolverPassResult> resolved = std::make_shared<ResolverPassResult>();
 
@@ -70,6 +93,8 @@ public:
     std::any visit_decl_variable(const std::shared_ptr<ast::decl::Variable> &d) override;
 
     std::any visit_stmt_block(const std::shared_ptr<ast::stmt::Block> &s) override;
+    std::any visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s) override;
+    std::any visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s) override;
     std::any visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s) override;
 
     std::any visit_expr_variable(const std::shared_ptr<ast::expr::Variable> &e) override;
@@ -85,9 +110,35 @@ private:
 
     void define(const std::shared_ptr<ast::decl::Declaration> &decl);
 
+    /* Check that the attributes on the node are ones supported for this kind of node and
+     * are passed a valid number of arguments. supported maps the name of each supported
+     * attribute to the max number of arguments it takes. Reports an error for any invalid
+     * attribute
+     */
+    void validate_attributes(const std::shared_ptr<ast::Node> &node,
+                             const phmap::flat_hash_map<std::string, size_t> &supported);
+
+    // Validate the [unroll(N)], [loop] and [allow_uav_condition] attributes on a loop
+    // statement
+    void validate_loop_attributes(const std::shared_ptr<ast::Node> &node);
+
+    /* Validate the attributes selecting the layout of a global parameter or struct member
+     * holding a buffer: [soa] on read only buffers of structs with primitive, vector and
+     * matrix members
+     */
+    void validate_buffer_attributes(const std::shared_ptr<ast::Node> &node,
+                                    const std::shared_ptr<ast::ty::Type> &type);
+
+    /* Validate the attributes selecting how a struct member is encoded when the struct is
+     * packed: [bits(N)] on int and uint members, [half] and [unorm(N)] on float scalars and
+     * vectors and [octahedral] on float3 unit vectors
+     */
+    void validate_member_attributes(const std::shared_ptr<ast::decl::StructMember> &member);
+
     /* Resolve the struct type to the corresponding struct declaration, if the type passed is a
-     * struct. Returns true if the struct declaration was resolved or the type is not a struct
-     * (and thus requires no resolution). Returns false if the struct declaration was not found
+     * struct or a buffer of structs. Returns true if the struct declaration was resolved or
+     * the type is not a struct (and thus requires no resolution). Returns false if the struct
+     * declaration was not found
      */
     bool resolve_type(const std::shared_ptr<ast::ty::Type> &type);
 
@@ -110,5 +161,18 @@ private:
      */
     std::shared_ptr<ast::decl::Function> resolve_function(
         const std::shared_ptr<ast::expr::FunctionCall> &node);
+
+    /* Get the instantiation of the generic function for the type arguments deduced from the
+     * call's arguments, creating and resolving it if it hasn't been instantiated for these
+     * types yet. Returns null and reports an error if the type arguments can't be deduced
+     */
+    std::shared_ptr<ast::decl::Function> instantiate(
+        const std::shared_ptr<ast::decl::Function> &generic,
+        const std::shared_ptr<ast::expr::FunctionCall> &call);
+
+    // Make a unique name for the instantiation of the generic function
+    std::string instance_name(
+        const std::shared_ptr<ast::decl::Function> &generic,
+        const std::vector<std::shared_ptr<ast::ty::Type>> &type_args);
 };
 }
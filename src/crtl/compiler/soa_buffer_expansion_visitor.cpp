@@ -0,0 +1,222 @@
+#include "soa_buffer_expansion_visitor.h"
+#include "ast_utils.h"
+#include "expression_type.h"
+
+namespace crtl {
+using namespace ast;
+
+bool SoaBuffers::empty() const
+{
+    return global_params.empty() && struct_members.empty();
+}
+
+SoaBufferExpansionVisitor::SoaBufferExpansionVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result)
+    : resolver_result(resolver_result)
+{
+}
+
+std::any SoaBufferExpansionVisitor::visit_ast(const std::shared_ptr<AST> &ast)
+{
+    for (const auto &n : ast->top_level_decls) {
+        auto param = std::dynamic_pointer_cast<decl::GlobalParam>(n);
+        auto element = param ? soa_element(param, param->get_type()) : nullptr;
+        if (element) {
+            SoaBuffer soa_buffer{element, {}};
+            for (const auto &f : element->members) {
+                auto split = std::make_shared<decl::GlobalParam>(
+                    COMPILER_NAME_PREFIX + param->get_text() + "_" + f->get_text(),
+                    nullptr,
+                    std::make_shared<ty::Buffer>(f->get_type(), ty::Access::READ_ONLY));
+                split_params[param][f->get_text()] = split;
+                soa_buffer.fields.emplace_back(f->get_text(), split->get_text());
+            }
+            soa_buffers.global_params[param->get_text()] = soa_buffer;
+            continue;
+        }
+
+        auto struct_decl = std::dynamic_pointer_cast<decl::Struct>(n);
+        if (!struct_decl) {
+            continue;
+        }
+        for (const auto &m : struct_decl->members) {
+            element = soa_element(m, m->get_type());
+            if (!element) {
+                continue;
+            }
+            SoaBuffer soa_buffer{element, {}};
+            for (const auto &f : element->members) {
+                const std::string split_name = m->get_text() + "_" + f->get_text();
+                if (struct_decl->get_member(split_name)) {
+                    report_error(m->get_token(),
+                                 "Splitting [soa] buffer '" + m->get_text() +
+                                     "' into its fields conflicts with member '" +
+                                     split_name + "'");
+                }
+                soa_buffer.fields.emplace_back(f->get_text(), split_name);
+            }
+            soa_buffers.struct_members[struct_decl][m->get_text()] = soa_buffer;
+        }
+    }
+
+    auto ast_out = ModifyingVisitor::visit_ast(ast);
+    for (const auto &s : soa_buffers.struct_members) {
+        split_struct_members(s.first);
+    }
+    return ast_out;
+}
+
+std::any SoaBufferExpansionVisitor::visit_decl_global_param(
+    const std::shared_ptr<decl::GlobalParam> &d)
+{
+    auto fnd = split_params.find(d);
+    if (fnd == split_params.end()) {
+        return std::dynamic_pointer_cast<decl::Declaration>(d);
+    }
+    std::vector<std::shared_ptr<decl::Declaration>> split_decls;
+    for (const auto &f : soa_buffers.global_params[d->get_text()].fields) {
+        split_decls.push_back(fnd->second[f.first]);
+    }
+    return split_decls;
+}
+
+std::any SoaBufferExpansionVisitor::visit_expr_variable(
+    const std::shared_ptr<expr::Variable> &e)
+{
+    auto fnd = resolver_result->var_expr.find(e);
+    auto param = fnd != resolver_result->var_expr.end()
+                     ? std::dynamic_pointer_cast<decl::GlobalParam>(fnd->second)
+                     : nullptr;
+    if (param && split_params.contains(param)) {
+        report_error(e->get_token(),
+                     "[soa] buffer '" + param->get_text() +
+                         "' can only be accessed through the fields of its elements");
+    }
+    return std::dynamic_pointer_cast<expr::Expression>(e);
+}
+
+std::any SoaBufferExpansionVisitor::visit_struct_array_access(
+    const std::shared_ptr<expr::StructArrayAccess> &e)
+{
+    // Visit the index expressions first, which may access [soa] buffers themselves
+    ModifyingVisitor::visit_struct_array_access(e);
+
+    // Accesses to [soa] global parameters start by indexing the buffer, the variable is
+    // replaced with the field's buffer and the field access is removed
+    auto fnd = resolver_result->var_expr.find(e->variable);
+    auto param = fnd != resolver_result->var_expr.end()
+                     ? std::dynamic_pointer_cast<decl::GlobalParam>(fnd->second)
+                     : nullptr;
+    auto split = param ? split_params.find(param) : split_params.end();
+    if (split != split_params.end()) {
+        const std::string field = accessed_field(e, 0, param->get_text());
+        if (field.empty()) {
+            return std::dynamic_pointer_cast<expr::Expression>(e);
+        }
+        auto field_param = split->second[field];
+        auto var_expr = std::make_shared<expr::Variable>(field_param->get_text());
+        resolver_result->var_expr[var_expr] = field_param;
+        resolver_result->var_expr.erase(e->variable);
+        e->variable = var_expr;
+        e->struct_array_access.erase(e->struct_array_access.begin() + 1);
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+
+    // Accesses to [soa] struct members replace the member with the field's buffer member
+    // and remove the field access, following the type of the access to find the struct
+    // whose member is accessed
+    auto type = infer_expression_type(e->variable, *resolver_result);
+    for (size_t i = 0; type && i < e->struct_array_access.size(); ++i) {
+        const auto &fragment = e->struct_array_access[i];
+        auto member = std::dynamic_pointer_cast<expr::StructMemberAccessFragment>(fragment);
+        const SoaBuffer *soa_buffer = member ? soa_member(type, member->name()) : nullptr;
+        if (soa_buffer) {
+            const std::string field = accessed_field(e, i + 1, member->name());
+            for (const auto &f : soa_buffer->fields) {
+                if (f.first == field) {
+                    e->struct_array_access[i] =
+                        std::make_shared<expr::StructMemberAccessFragment>(f.second);
+                    e->struct_array_access.erase(e->struct_array_access.begin() + i + 2);
+                    break;
+                }
+            }
+            break;
+        }
+        type = struct_array_access_type(type, {fragment}, *resolver_result);
+    }
+    return std::dynamic_pointer_cast<expr::Expression>(e);
+}
+
+std::shared_ptr<decl::Struct> SoaBufferExpansionVisitor::soa_element(
+    const std::shared_ptr<Node> &node, const std::shared_ptr<ty::Type> &type)
+{
+    auto buffer = std::dynamic_pointer_cast<ty::Buffer>(type);
+    if (!buffer || !node->has_attribute("soa")) {
+        return nullptr;
+    }
+    // The resolver checked that [soa] is only applied to buffers of structs
+    auto struct_type = std::dynamic_pointer_cast<ty::Struct>(buffer->template_parameters[0]);
+    auto fnd = struct_type ? resolver_result->struct_type.find(struct_type)
+                           : resolver_result->struct_type.end();
+    return fnd != resolver_result->struct_type.end() ? fnd->second : nullptr;
+}
+
+const SoaBuffer *SoaBufferExpansionVisitor::soa_member(const std::shared_ptr<ty::Type> &type,
+                                                       const std::string &member)
+{
+    auto struct_type = std::dynamic_pointer_cast<ty::Struct>(type);
+    auto struct_decl = struct_type ? resolver_result->struct_type.find(struct_type)
+                                   : resolver_result->struct_type.end();
+    if (struct_decl == resolver_result->struct_type.end()) {
+        return nullptr;
+    }
+    auto soa_members = soa_buffers.struct_members.find(struct_decl->second);
+    if (soa_members == soa_buffers.struct_members.end()) {
+        return nullptr;
+    }
+    auto fnd = soa_members->second.find(member);
+    return fnd != soa_members->second.end() ? &fnd->second : nullptr;
+}
+
+void SoaBufferExpansionVisitor::split_struct_members(const std::shared_ptr<decl::Struct> &decl)
+{
+    const auto &soa_members = soa_buffers.struct_members[decl];
+    std::vector<std::shared_ptr<decl::StructMember>> members;
+    for (const auto &m : decl->members) {
+        auto fnd = soa_members.find(m->get_text());
+        if (fnd == soa_members.end()) {
+            members.push_back(m);
+            continue;
+        }
+        for (const auto &f : fnd->second.fields) {
+            auto field_type = fnd->second.element->get_member(f.first)->get_type();
+            members.push_back(std::make_shared<decl::StructMember>(
+                f.second,
+                m->get_token(),
+                std::make_shared<ty::Buffer>(field_type, ty::Access::READ_ONLY)));
+        }
+    }
+    decl->members = members;
+}
+
+std::string SoaBufferExpansionVisitor::accessed_field(
+    const std::shared_ptr<expr::StructArrayAccess> &e,
+    const size_t i,
+    const std::string &buffer_name)
+{
+    const auto &fragments = e->struct_array_access;
+    std::shared_ptr<expr::ArrayAccessFragment> array_access;
+    std::shared_ptr<expr::StructMemberAccessFragment> member;
+    if (i + 1 < fragments.size()) {
+        array_access = std::dynamic_pointer_cast<expr::ArrayAccessFragment>(fragments[i]);
+        member = std::dynamic_pointer_cast<expr::StructMemberAccessFragment>(fragments[i + 1]);
+    }
+    if (!array_access || !member) {
+        report_error(e->get_token(),
+                     "[soa] buffer '" + buffer_name +
+                         "' can only be accessed through the fields of its elements");
+        return "";
+    }
+    return member->name();
+}
+}
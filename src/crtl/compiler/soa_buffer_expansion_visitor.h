@@ -0,0 +1,96 @@
+#pragma once
+
+#include "ast/modifying_visitor.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+// A buffer of structs split into one buffer per field of the struct
+struct SoaBuffer {
+    // The struct stored in the original buffer
+    std::shared_ptr<ast::decl::Struct> element;
+
+    // The name of each field of the struct and the global parameter or struct member holding
+    // the buffer of its values, in the struct's member order
+    std::vector<std::pair<std::string, std::string>> fields;
+};
+
+// The [soa] buffers split by the SoA buffer expansion pass
+struct SoaBuffers {
+    // The global parameters that were split, by the original parameter name
+    phmap::parallel_flat_hash_map<std::string, SoaBuffer> global_params;
+
+    // The struct members that were split, by the struct and original member name
+    phmap::parallel_flat_hash_map<std::shared_ptr<ast::decl::Struct>,
+                                  phmap::parallel_flat_hash_map<std::string, SoaBuffer>>
+        struct_members;
+
+    bool empty() const;
+};
+
+/* The SoaBufferExpansionVisitor lowers buffers of structs marked [soa] from an array of
+ * structs into a struct of arrays: the buffer is replaced by one read only buffer per field
+ * of the struct, named <buffer>_<field>, and accesses to a field of an element are rewritten
+ * to index the field's buffer. E.g., materials[i].roughness becomes materials_roughness[i],
+ * so shaders only load the fields they read instead of the whole struct. The buffers split
+ * from global parameters also start with the reserved name prefix, since they share the
+ * global scope with the user's declarations. [soa] buffers can be global parameters or
+ * members of the parameter structs, and can only be accessed through the fields of their
+ * elements, reading a whole element or passing the buffer to a function that isn't inlined
+ * is an error.
+ *
+ * The splits are recorded in soa_buffers for the parameter metadata, so the runtime can
+ * scatter the array of structs set by the application into the field buffers. The pass runs
+ * after the global struct parameters are expanded, which carry the attributes of the struct
+ * members they replace, so that [soa] members of global struct parameters are split as
+ * global parameters.
+ */
+class SoaBufferExpansionVisitor : public ast::ModifyingVisitor {
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+    // The split global parameters replacing each field of the [soa] global parameters
+    phmap::parallel_flat_hash_map<
+        std::shared_ptr<ast::decl::GlobalParam>,
+        phmap::parallel_flat_hash_map<std::string, std::shared_ptr<ast::decl::GlobalParam>>>
+        split_params;
+
+public:
+    SoaBuffers soa_buffers;
+
+    SoaBufferExpansionVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result);
+
+    /* Find the [soa] buffers to split before visiting the AST, so that the accesses are
+     * rewritten against the original struct members, which are replaced after
+     */
+    std::any visit_ast(const std::shared_ptr<ast::AST> &ast) override;
+
+    std::any visit_decl_global_param(
+        const std::shared_ptr<ast::decl::GlobalParam> &d) override;
+
+    // Direct uses of a split global parameter, e.g., passing it to a function, are errors
+    std::any visit_expr_variable(const std::shared_ptr<ast::expr::Variable> &e) override;
+
+    std::any visit_struct_array_access(
+        const std::shared_ptr<ast::expr::StructArrayAccess> &e) override;
+
+private:
+    // Get the struct stored in the [soa] buffer, or nullptr if it's not a buffer of structs
+    std::shared_ptr<ast::decl::Struct> soa_element(const std::shared_ptr<ast::Node> &node,
+                                                   const std::shared_ptr<ast::ty::Type> &type);
+
+    // Get the split [soa] member of the struct type, or nullptr if the member isn't split
+    const SoaBuffer *soa_member(const std::shared_ptr<ast::ty::Type> &type,
+                                const std::string &member);
+
+    // Replace the [soa] members of the struct with the buffers of their fields
+    void split_struct_members(const std::shared_ptr<ast::decl::Struct> &decl);
+
+    /* Get the field of the element accessed by the fragments starting at index i, which
+     * index the [soa] buffer. Reports an error and returns an empty string if the buffer
+     * isn't accessed through a field of an element
+     */
+    std::string accessed_field(const std::shared_ptr<ast::expr::StructArrayAccess> &e,
+                               const size_t i,
+                               const std::string &buffer_name);
+};
+}
@@ -0,0 +1,179 @@
+#include "specialization_visitor.h"
+#include <stdexcept>
+#include "ast_utils.h"
+#include "constant_folding_visitor.h"
+
+namespace crtl {
+
+using namespace ast;
+
+SpecializationVisitor::SpecializationVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result,
+    const std::map<std::string, std::string> &specialization_values)
+    : resolver_result(resolver_result), specialization_values(specialization_values)
+{
+}
+
+std::any SpecializationVisitor::visit_ast(const std::shared_ptr<ast::AST> &ast)
+{
+    phmap::flat_hash_set<std::string> specialization_names;
+    for (const auto &n : ast->top_level_decls) {
+        auto var_decl = std::dynamic_pointer_cast<stmt::VariableDeclaration>(n);
+        if (!var_decl || !is_specialization_constant(var_decl->var_decl)) {
+            continue;
+        }
+
+        const auto &var = var_decl->var_decl;
+        specialization_names.insert(var->get_text());
+        for (const auto &d : ast->top_level_decls) {
+            if (is_variable_written(d, var, *resolver_result)) {
+                report_error(var->get_token(),
+                             "Specialization constant '" + var->get_text() +
+                                 "' can't be assigned to or passed as an out argument");
+                break;
+            }
+        }
+
+        auto value = specialized_value(var);
+        if (value) {
+            specialized_constants[var] = value;
+        }
+    }
+
+    for (const auto &v : specialization_values) {
+        if (!specialization_names.contains(v.first)) {
+            report_error(nullptr,
+                         "A value was given for '" + v.first +
+                             "', which is not a specialization constant of the shader");
+        }
+    }
+
+    return ModifyingVisitor::visit_ast(ast);
+}
+
+std::any SpecializationVisitor::visit_stmt_variable_declaration(
+    const std::shared_ptr<stmt::VariableDeclaration> &s)
+{
+    // The declarations are removed since all their reads are replaced
+    if (is_specialization_constant(s->var_decl)) {
+        return std::any();
+    }
+    return ModifyingVisitor::visit_stmt_variable_declaration(s);
+}
+
+std::any SpecializationVisitor::visit_expr_variable(const std::shared_ptr<expr::Variable> &e)
+{
+    auto fnd = resolver_result->var_expr.find(e);
+    if (fnd == resolver_result->var_expr.end()) {
+        return ModifyingVisitor::visit_expr_variable(e);
+    }
+
+    auto constant = specialized_constants.find(fnd->second);
+    if (constant == specialized_constants.end()) {
+        return ModifyingVisitor::visit_expr_variable(e);
+    }
+
+    // Each read gets its own constant node, passes may modify the nodes in place
+    ++num_substituted;
+    return std::dynamic_pointer_cast<expr::Expression>(make_constant(
+        e->get_token(), constant->second->constant_type, constant->second->value));
+}
+
+std::shared_ptr<expr::Constant> SpecializationVisitor::specialized_value(
+    const std::shared_ptr<decl::Variable> &var)
+{
+    auto type = std::dynamic_pointer_cast<ty::Primitive>(var->get_type());
+    if (!type || (type->type_id != ty::PrimitiveType::BOOL &&
+                  type->type_id != ty::PrimitiveType::INT &&
+                  type->type_id != ty::PrimitiveType::FLOAT)) {
+        report_error(var->get_token(),
+                     "Specialization constant '" + var->get_text() +
+                         "' must be a bool, int or float");
+        return nullptr;
+    }
+
+    auto fnd = specialization_values.find(var->get_text());
+    if (fnd != specialization_values.end()) {
+        return parse_value(var, type->type_id, fnd->second);
+    }
+
+    if (!var->expression) {
+        report_error(var->get_token(),
+                     "No value was given for specialization constant '" + var->get_text() +
+                         "', and it doesn't have a default value");
+        return nullptr;
+    }
+    return default_value(var, type->type_id);
+}
+
+std::shared_ptr<expr::Constant> SpecializationVisitor::parse_value(
+    const std::shared_ptr<decl::Variable> &var,
+    const ty::PrimitiveType type,
+    const std::string &value)
+{
+    std::any parsed;
+    try {
+        size_t end = value.size();
+        if (type == ty::PrimitiveType::BOOL) {
+            if (value == "true" || value == "1") {
+                parsed = true;
+            } else if (value == "false" || value == "0") {
+                parsed = false;
+            }
+        } else if (type == ty::PrimitiveType::INT) {
+            parsed = std::stoi(value, &end);
+        } else {
+            parsed = std::stof(value, &end);
+            // Accept the f suffix of float literals
+            if (end + 1 == value.size() && (value[end] == 'f' || value[end] == 'F')) {
+                ++end;
+            }
+        }
+        if (end != value.size()) {
+            parsed.reset();
+        }
+    } catch (const std::logic_error &) {
+        parsed.reset();
+    }
+
+    if (!parsed.has_value()) {
+        report_error(var->get_token(),
+                     "Invalid value '" + value + "' given for specialization constant '" +
+                         var->get_text() + "' of type " + var->get_type()->to_string());
+        return nullptr;
+    }
+    return make_constant(var->get_token(), type, parsed);
+}
+
+std::shared_ptr<expr::Constant> SpecializationVisitor::default_value(
+    const std::shared_ptr<decl::Variable> &var, const ty::PrimitiveType type)
+{
+    auto constant = std::dynamic_pointer_cast<expr::Constant>(var->expression);
+    bool negate = false;
+    if (!constant && var->expression->get_node_type() == NodeType::EXPR_NEGATE) {
+        auto unary = std::dynamic_pointer_cast<expr::Unary>(var->expression);
+        constant = std::dynamic_pointer_cast<expr::Constant>(unary->expr);
+        negate = true;
+    }
+
+    std::any value;
+    if (constant && constant->constant_type == type) {
+        value = constant->value;
+    } else if (constant && constant->constant_type == ty::PrimitiveType::INT &&
+               type == ty::PrimitiveType::FLOAT) {
+        // Integer literals are accepted as the default value of float constants
+        value = float(std::any_cast<int>(constant->value));
+    }
+    if (value.has_value() && negate) {
+        value = fold_scalar_operation(NodeType::EXPR_NEGATE, type, {value});
+    }
+
+    if (!value.has_value()) {
+        report_error(var->expression->get_token(),
+                     "The default value of specialization constant '" + var->get_text() +
+                         "' must be a literal of type " + var->get_type()->to_string());
+        return nullptr;
+    }
+    return make_constant(var->get_token(), type, value);
+}
+}
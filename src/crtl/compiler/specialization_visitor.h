@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include "ast/modifying_visitor.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* The SpecializationVisitor replaces the reads of specialization constants with their
+ * specialized value, and removes their declarations. Values are supplied by name when the
+ * shader library is created, written as they would be in the shader source. Specialization
+ * constants without a supplied value use their default value, it's an error if they don't
+ * have one, or if a value is supplied for a name which isn't a specialization constant.
+ *
+ * Specialization constants must be bool, int or float scalars, and their default values
+ * must be literals. The substituted constants are folded through the shader by the
+ * ConstantFoldingVisitor, removing the branches they disable.
+ */
+class SpecializationVisitor : public ast::ModifyingVisitor {
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+    std::map<std::string, std::string> specialization_values;
+
+    // The value of each specialization constant
+    phmap::flat_hash_map<std::shared_ptr<ast::decl::Variable>,
+                         std::shared_ptr<ast::expr::Constant>>
+        specialized_constants;
+
+public:
+    // The number of specialization constant reads replaced with their value
+    size_t num_substituted = 0;
+
+    SpecializationVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result,
+                          const std::map<std::string, std::string> &specialization_values);
+
+    // Compute the value of each specialization constant before replacing their reads
+    std::any visit_ast(const std::shared_ptr<ast::AST> &ast) override;
+
+    std::any visit_stmt_variable_declaration(
+        const std::shared_ptr<ast::stmt::VariableDeclaration> &s) override;
+
+    std::any visit_expr_variable(const std::shared_ptr<ast::expr::Variable> &e) override;
+
+private:
+    // Get the value of the specialization constant, or nullptr if it doesn't have a valid one
+    std::shared_ptr<ast::expr::Constant> specialized_value(
+        const std::shared_ptr<ast::decl::Variable> &var);
+
+    // Parse the value supplied for the specialization constant as its type
+    std::shared_ptr<ast::expr::Constant> parse_value(
+        const std::shared_ptr<ast::decl::Variable> &var,
+        const ast::ty::PrimitiveType type,
+        const std::string &value);
+
+    // Get the constant value of the specialization constant's default value
+    std::shared_ptr<ast::expr::Constant> default_value(
+        const std::shared_ptr<ast::decl::Variable> &var, const ast::ty::PrimitiveType type);
+};
+}
@@ -0,0 +1,643 @@
+#include "value_numbering_visitor.h"
+#include <algorithm>
+#include <bit>
+#include "ast_utils.h"
+#include "builtins.h"
+#include "expression_type.h"
+
+namespace crtl {
+
+using namespace ast;
+
+// Erase the entries of the map matching the predicate
+template <typename Map, typename Pred>
+void erase_where(Map &map, const Pred &pred)
+{
+    for (auto it = map.begin(); it != map.end();) {
+        if (pred(*it)) {
+            map.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool is_commutative(const NodeType nt)
+{
+    switch (nt) {
+    case NodeType::EXPR_MULT:
+    case NodeType::EXPR_ADD:
+    case NodeType::EXPR_CMP_NOT_EQUAL:
+    case NodeType::EXPR_CMP_EQUAL:
+        return true;
+    default:
+        return false;
+    }
+}
+
+ValueNumberingVisitor::ValueNumberingVisitor(
+    const std::shared_ptr<ResolverPassResult> &resolver_result)
+    : resolver_result(resolver_result)
+{
+}
+
+std::any ValueNumberingVisitor::visit_stmt_block(const std::shared_ptr<ast::stmt::Block> &s)
+{
+    // The block's statements are each evaluated once in order, even if the block is nested in
+    // a loop's condition or advance expression
+    const size_t parent_opaque_depth = opaque_depth;
+    opaque_depth = 0;
+
+    blocks.emplace_back();
+    for (auto &st : s->statements) {
+        blocks.back().current = st;
+        blocks.back().current_invalidated = false;
+        auto result = visit(st);
+        // Note: the block state must be looked up again after visiting the statement, since
+        // visiting nested blocks may reallocate the block stack
+        collect_results(result, blocks.back().statements);
+
+        // Values computed in control flow are not available after it, and anything written
+        // within it is no longer available
+        switch (st->get_node_type()) {
+        case NodeType::STMT_BLOCK:
+        case NodeType::STMT_IF_ELSE:
+        case NodeType::STMT_WHILE:
+        case NodeType::STMT_FOR:
+            invalidate_writes(st);
+            break;
+        default:
+            break;
+        }
+    }
+    s->statements = std::move(blocks.back().statements);
+    blocks.pop_back();
+
+    opaque_depth = parent_opaque_depth;
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any ValueNumberingVisitor::visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s)
+{
+    // The condition is evaluated once before the branch, so it's numbered as part of the
+    // enclosing block
+    s->condition = std::any_cast<std::shared_ptr<expr::Expression>>(visit(s->condition));
+    s->if_branch = visit_nested_statement(s->if_branch);
+    if (s->else_branch) {
+        s->else_branch = visit_nested_statement(s->else_branch);
+    }
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any ValueNumberingVisitor::visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s)
+{
+    ++opaque_depth;
+    s->condition = std::any_cast<std::shared_ptr<expr::Expression>>(visit(s->condition));
+    --opaque_depth;
+
+    if (s->body) {
+        s->body = visit_nested_statement(s->body);
+    }
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any ValueNumberingVisitor::visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s)
+{
+    // Variables declared in the init statement are scoped to the loop, so we don't number
+    // the init statement as part of the enclosing block either
+    ++opaque_depth;
+    if (s->init) {
+        s->init = result_or_nullptr<stmt::Statement>(visit(s->init));
+    }
+    if (s->condition) {
+        s->condition = result_or_nullptr<expr::Expression>(visit(s->condition));
+    }
+    if (s->advance) {
+        s->advance = result_or_nullptr<expr::Expression>(visit(s->advance));
+    }
+    --opaque_depth;
+
+    if (s->body) {
+        s->body = visit_nested_statement(s->body);
+    }
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any ValueNumberingVisitor::visit_stmt_variable_declaration(
+    const std::shared_ptr<ast::stmt::VariableDeclaration> &s)
+{
+    ModifyingVisitor::visit_stmt_variable_declaration(s);
+
+    const auto &var = s->var_decl;
+    if (!numbering_enabled() || !var->expression) {
+        return std::dynamic_pointer_cast<stmt::Statement>(s);
+    }
+
+    // Only track variables initialized without an implicit conversion, since the variable
+    // would hold a different value than the expression otherwise
+    auto init_type = infer_expression_type(var->expression, *resolver_result);
+    if (!init_type || init_type->to_string() != var->get_type()->to_string()) {
+        return std::dynamic_pointer_cast<stmt::Statement>(s);
+    }
+
+    auto source = var->expression->get_node_type() == NodeType::EXPR_LITERAL_VAR
+                      ? accessed_variable(var->expression, *resolver_result)
+                      : nullptr;
+    if (source) {
+        blocks.back().copies[var] = source;
+    } else {
+        set_holder(var, var->expression);
+    }
+    return std::dynamic_pointer_cast<stmt::Statement>(s);
+}
+
+std::any ValueNumberingVisitor::visit_expr_unary(const std::shared_ptr<ast::expr::Unary> &e)
+{
+    ModifyingVisitor::visit_expr_unary(e);
+    return number_value(e);
+}
+
+std::any ValueNumberingVisitor::visit_expr_binary(const std::shared_ptr<ast::expr::Binary> &e)
+{
+    if (e->get_node_type() != NodeType::EXPR_LOGIC_AND &&
+        e->get_node_type() != NodeType::EXPR_LOGIC_OR) {
+        ModifyingVisitor::visit_expr_binary(e);
+        return number_value(e);
+    }
+
+    // The right hand side of && and || is only conditionally evaluated, so values in it
+    // can't be numbered and computed before the statement
+    e->left = std::any_cast<std::shared_ptr<expr::Expression>>(visit(e->left));
+    ++opaque_depth;
+    e->right = std::any_cast<std::shared_ptr<expr::Expression>>(visit(e->right));
+    --opaque_depth;
+    if (numbering_enabled()) {
+        invalidate_writes(e->right);
+    }
+    return number_value(e);
+}
+
+std::any ValueNumberingVisitor::visit_expr_variable(
+    const std::shared_ptr<ast::expr::Variable> &e)
+{
+    // Note: this is only called for variables being read, writes are handled by
+    // visit_write_target
+    if (!numbering_enabled()) {
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+
+    auto var = accessed_variable(e, *resolver_result);
+    const auto &copies = blocks.back().copies;
+    auto fnd = var ? copies.find(var) : copies.end();
+    if (fnd == copies.end()) {
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+    ++num_copies_propagated;
+    return std::dynamic_pointer_cast<expr::Expression>(make_variable(fnd->second));
+}
+
+std::any ValueNumberingVisitor::visit_expr_function_call(
+    const std::shared_ptr<ast::expr::FunctionCall> &e)
+{
+    std::shared_ptr<decl::Function> fn;
+    auto fnd = resolver_result->call_expr.find(e);
+    if (fnd != resolver_result->call_expr.end()) {
+        fn = fnd->second;
+    }
+
+    std::vector<std::shared_ptr<expr::Expression>> output_args;
+    for (size_t i = 0; i < e->args.size(); ++i) {
+        if (fn && i < fn->parameters.size() && is_output_param(fn->parameters[i])) {
+            visit_write_target(e->args[i]);
+            output_args.push_back(e->args[i]);
+        } else {
+            e->args[i] = std::any_cast<std::shared_ptr<expr::Expression>>(visit(e->args[i]));
+        }
+    }
+
+    if (!numbering_enabled()) {
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+
+    for (const auto &a : output_args) {
+        auto var = accessed_variable(a, *resolver_result);
+        if (var) {
+            invalidate(var);
+        }
+    }
+    // User functions may write to any read-write resource
+    if (!fn || !fn->is_builtin()) {
+        invalidate_rw_resources();
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+    if (!output_args.empty()) {
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+    return number_value(e);
+}
+
+std::any ValueNumberingVisitor::visit_struct_array_access(
+    const std::shared_ptr<ast::expr::StructArrayAccess> &e)
+{
+    // Note: this is only called for struct array accesses being read, writes are handled by
+    // visit_write_target
+    ModifyingVisitor::visit_struct_array_access(e);
+
+    auto var = std::any_cast<std::shared_ptr<expr::Expression>>(visit(e->variable));
+    e->variable = std::dynamic_pointer_cast<expr::Variable>(var);
+    return number_value(e);
+}
+
+std::any ValueNumberingVisitor::visit_expr_assignment(
+    const std::shared_ptr<ast::expr::Assignment> &e)
+{
+    visit_write_target(e->lhs);
+    e->value = std::any_cast<std::shared_ptr<expr::Expression>>(visit(e->value));
+
+    auto var = accessed_variable(e->lhs, *resolver_result);
+    if (!numbering_enabled() || !var) {
+        return std::dynamic_pointer_cast<expr::Expression>(e);
+    }
+
+    invalidate(var);
+
+    // If the whole variable is assigned it now holds the value assigned to it
+    auto value_type = infer_expression_type(e->value, *resolver_result);
+    if (e->lhs->get_node_type() == NodeType::EXPR_LITERAL_VAR && value_type &&
+        value_type->to_string() == var->get_type()->to_string()) {
+        auto source = e->value->get_node_type() == NodeType::EXPR_LITERAL_VAR
+                          ? accessed_variable(e->value, *resolver_result)
+                          : nullptr;
+        if (source && source != var) {
+            blocks.back().copies[var] = source;
+        } else if (!source) {
+            set_holder(var, e->value);
+        }
+    }
+    return std::dynamic_pointer_cast<expr::Expression>(e);
+}
+
+bool ValueNumberingVisitor::numbering_enabled() const
+{
+    return !blocks.empty() && opaque_depth == 0;
+}
+
+std::shared_ptr<ast::stmt::Statement> ValueNumberingVisitor::visit_nested_statement(
+    const std::shared_ptr<ast::stmt::Statement> &s)
+{
+    if (s->get_node_type() == NodeType::STMT_BLOCK) {
+        return std::any_cast<std::shared_ptr<stmt::Statement>>(visit(s));
+    }
+
+    std::vector<std::shared_ptr<stmt::Statement>> statements = {s};
+    auto block = std::make_shared<stmt::Block>(nullptr, statements);
+    visit(block);
+    if (block->statements.size() == 1) {
+        return block->statements[0];
+    }
+    return block;
+}
+
+void ValueNumberingVisitor::visit_write_target(const std::shared_ptr<ast::expr::Expression> &e)
+{
+    if (e->get_node_type() != NodeType::EXPR_STRUCT_ARRAY_ACCESS) {
+        return;
+    }
+    // The indices of the accessed elements are read
+    auto access = std::dynamic_pointer_cast<expr::StructArrayAccess>(e);
+    ModifyingVisitor::visit_struct_array_access(access);
+}
+
+std::string ValueNumberingVisitor::value_key(const std::shared_ptr<ast::expr::Expression> &e)
+{
+    auto fragments_key =
+        [&](const std::vector<std::shared_ptr<expr::StructArrayAccessFragment>> &fragments) {
+            std::string key;
+            for (const auto &f : fragments) {
+                auto member = std::dynamic_pointer_cast<expr::StructMemberAccessFragment>(f);
+                if (member) {
+                    key += "." + member->name();
+                    continue;
+                }
+                auto array_access = std::dynamic_pointer_cast<expr::ArrayAccessFragment>(f);
+                const std::string index = value_key(array_access->index);
+                if (index.empty()) {
+                    return std::string();
+                }
+                key += "[" + index + "]";
+            }
+            return key;
+        };
+
+    switch (e->get_node_type()) {
+    case NodeType::EXPR_NEGATE:
+    case NodeType::EXPR_LOGIC_NOT: {
+        const std::string operand = value_key(std::dynamic_pointer_cast<expr::Unary>(e)->expr);
+        if (operand.empty()) {
+            return "";
+        }
+        return "(" + expr::operator_to_string(e->get_node_type()) + operand + ")";
+    }
+    case NodeType::EXPR_MULT:
+    case NodeType::EXPR_DIV:
+    case NodeType::EXPR_ADD:
+    case NodeType::EXPR_SUB:
+    case NodeType::EXPR_SHIFT_LEFT:
+    case NodeType::EXPR_SHIFT_RIGHT:
+    case NodeType::EXPR_CMP_LESS:
+    case NodeType::EXPR_CMP_LESS_EQUAL:
+    case NodeType::EXPR_CMP_GREATER:
+    case NodeType::EXPR_CMP_GREATER_EQUAL:
+    case NodeType::EXPR_CMP_NOT_EQUAL:
+    case NodeType::EXPR_CMP_EQUAL:
+    case NodeType::EXPR_LOGIC_AND:
+    case NodeType::EXPR_LOGIC_OR: {
+        auto binary = std::dynamic_pointer_cast<expr::Binary>(e);
+        std::string left = value_key(binary->left);
+        std::string right = value_key(binary->right);
+        if (left.empty() || right.empty()) {
+            return "";
+        }
+        if (is_commutative(e->get_node_type()) && right < left) {
+            std::swap(left, right);
+        }
+        return "(" + left + expr::operator_to_string(e->get_node_type()) + right + ")";
+    }
+    case NodeType::EXPR_LITERAL_VAR: {
+        auto var = accessed_variable(e, *resolver_result);
+        if (!var) {
+            return "";
+        }
+        // Variables holding an available value have the key of that value
+        const auto &holder_keys = blocks.back().holder_keys;
+        auto fnd = holder_keys.find(var);
+        if (fnd != holder_keys.end()) {
+            return fnd->second;
+        }
+        return "v" + std::to_string(reinterpret_cast<uintptr_t>(var.get()));
+    }
+    case NodeType::EXPR_LITERAL_CONSTANT: {
+        auto constant = std::dynamic_pointer_cast<expr::Constant>(e);
+        const std::string type = ty::to_string(constant->constant_type);
+        switch (constant->constant_type) {
+        case ty::PrimitiveType::BOOL:
+            return type + std::to_string(std::any_cast<bool>(constant->value));
+        case ty::PrimitiveType::INT:
+            return type + std::to_string(std::any_cast<int>(constant->value));
+        case ty::PrimitiveType::FLOAT: {
+            // Use the bits of the float so that nearby values are not merged
+            const float value = std::any_cast<float>(constant->value);
+            return type + std::to_string(std::bit_cast<uint32_t>(value));
+        }
+        default:
+            return "";
+        }
+    }
+    case NodeType::EXPR_FCN_CALL: {
+        auto call = std::dynamic_pointer_cast<expr::FunctionCall>(e);
+        auto fnd = resolver_result->call_expr.find(call);
+        // Wave builtins depend on the active lanes, calls computing the same expression
+        // may differ
+        if (fnd == resolver_result->call_expr.end() || !fnd->second->is_builtin() ||
+            is_wave_builtin(fnd->second->get_text())) {
+            return "";
+        }
+        std::string key = fnd->second->get_text() + "(";
+        for (const auto &a : call->args) {
+            const std::string arg = value_key(a);
+            if (arg.empty()) {
+                return "";
+            }
+            key += arg + ",";
+        }
+        key += ")";
+
+        if (!call->struct_array_access.empty()) {
+            const std::string access = fragments_key(call->struct_array_access);
+            if (access.empty()) {
+                return "";
+            }
+            key += access;
+        }
+        return key;
+    }
+    case NodeType::EXPR_STRUCT_ARRAY_ACCESS: {
+        auto access = std::dynamic_pointer_cast<expr::StructArrayAccess>(e);
+        const std::string var = value_key(access->variable);
+        const std::string fragments = fragments_key(access->struct_array_access);
+        if (var.empty() || fragments.empty()) {
+            return "";
+        }
+        return var + fragments;
+    }
+    default:
+        return "";
+    }
+}
+
+void ValueNumberingVisitor::collect_reads(
+    const std::shared_ptr<ast::Node> &n,
+    phmap::flat_hash_set<std::shared_ptr<ast::decl::Variable>> &reads)
+{
+    if (n->get_node_type() == NodeType::EXPR_LITERAL_VAR) {
+        auto var = accessed_variable(std::dynamic_pointer_cast<expr::Variable>(n),
+                                     *resolver_result);
+        if (var) {
+            reads.insert(var);
+            // Reading a variable holding a value also depends on what the value read
+            const auto &holder_reads = blocks.back().holder_reads;
+            auto fnd = holder_reads.find(var);
+            if (fnd != holder_reads.end()) {
+                reads.insert(fnd->second.begin(), fnd->second.end());
+            }
+        }
+    }
+    for (const auto &c : n->get_children()) {
+        collect_reads(c, reads);
+    }
+}
+
+std::any ValueNumberingVisitor::number_value(const std::shared_ptr<ast::expr::Expression> &e)
+{
+    if (!numbering_enabled()) {
+        return e;
+    }
+
+    // Struct member accesses without an array access don't load from memory, and aren't
+    // worth storing in a temporary
+    if (e->get_node_type() == NodeType::EXPR_STRUCT_ARRAY_ACCESS &&
+        !has_array_access(
+            std::dynamic_pointer_cast<expr::StructArrayAccess>(e)->struct_array_access)) {
+        return e;
+    }
+
+    const std::string key = value_key(e);
+    if (key.empty()) {
+        return e;
+    }
+
+    auto &values = blocks.back().values;
+    auto fnd = values.find(key);
+    if (fnd == values.end()) {
+        // If the statement wrote something before this expression, storing the value in a
+        // temporary declared before the statement could compute it from the old values
+        if (blocks.back().current_invalidated) {
+            return e;
+        }
+        AvailableValue value;
+        value.expr = e;
+        collect_reads(e, value.reads);
+        values[key] = value;
+        return e;
+    }
+
+    auto &value = fnd->second;
+    if (!value.holder && !store_in_temporary(key, value)) {
+        return e;
+    }
+    ++num_eliminated;
+    report_remark(RemarkKind::APPLIED,
+                  e->get_token(),
+                  "Redundant expression replaced by the value already computed");
+    return std::dynamic_pointer_cast<expr::Expression>(make_variable(value.holder));
+}
+
+bool ValueNumberingVisitor::store_in_temporary(const std::string &key, AvailableValue &value)
+{
+    auto type = infer_expression_type(value.expr, *resolver_result);
+    if (!type || is_void_type(type)) {
+        return false;
+    }
+
+    auto &block = blocks.back();
+    auto temp = std::make_shared<decl::Variable>(
+        COMPILER_NAME_PREFIX + "cse" + std::to_string(temp_counter++), nullptr, type, nullptr);
+
+    // Insert the temporary before the statement containing the first expression computing
+    // the value. If it's not in a statement already visited, it's in the statement currently
+    // being visited
+    auto insert_pos = std::find_if(
+        block.statements.begin(), block.statements.end(), [&](const auto &s) {
+            return contains_node(s, value.expr);
+        });
+    if (insert_pos != block.statements.end()) {
+        replace_expression(*insert_pos, value.expr, make_variable(temp));
+    } else {
+        // The current statement is still being visited, but the parents of the first
+        // occurrence have already been updated with their visited children so we can replace
+        // it in the tree
+        replace_expression(block.current, value.expr, make_variable(temp));
+    }
+    temp->expression = value.expr;
+    block.statements.insert(insert_pos,
+                            std::make_shared<stmt::VariableDeclaration>(nullptr, temp));
+
+    value.holder = temp;
+    block.holder_keys[temp] = key;
+    block.holder_reads[temp] = value.reads;
+    return true;
+}
+
+void ValueNumberingVisitor::set_holder(
+    const std::shared_ptr<ast::decl::Variable> &var,
+    const std::shared_ptr<ast::expr::Expression> &value_expr)
+{
+    const std::string key = value_key(value_expr);
+    if (key.empty()) {
+        return;
+    }
+    auto &block = blocks.back();
+    auto fnd = block.values.find(key);
+    if (fnd == block.values.end()) {
+        AvailableValue value;
+        value.expr = value_expr;
+        collect_reads(value_expr, value.reads);
+        // If the value read the variable's previous value it's no longer available
+        if (value.reads.contains(var)) {
+            return;
+        }
+        fnd = block.values.emplace(key, value).first;
+    }
+    if (fnd->second.holder) {
+        return;
+    }
+    fnd->second.holder = var;
+    block.holder_keys[var] = key;
+    block.holder_reads[var] = fnd->second.reads;
+}
+
+void ValueNumberingVisitor::invalidate(const std::shared_ptr<ast::decl::Variable> &var)
+{
+    auto &block = blocks.back();
+    block.current_invalidated = true;
+    erase_where(block.values, [&](const auto &v) {
+        return v.second.holder == var || v.second.reads.contains(var);
+    });
+    // Variables holding a value read from the written variable still hold the old value, and
+    // no longer match expressions computing the value
+    block.holder_keys.erase(var);
+    block.holder_reads.erase(var);
+    erase_where(block.holder_reads, [&](const auto &h) {
+        if (h.second.contains(var)) {
+            block.holder_keys.erase(h.first);
+            return true;
+        }
+        return false;
+    });
+    erase_where(block.copies,
+                    [&](const auto &c) { return c.first == var || c.second == var; });
+}
+
+void ValueNumberingVisitor::invalidate_rw_resources()
+{
+    blocks.back().current_invalidated = true;
+    std::vector<std::shared_ptr<decl::Variable>> resources;
+    for (const auto &v : blocks.back().values) {
+        for (const auto &r : v.second.reads) {
+            if (is_rw_resource(r->get_type())) {
+                resources.push_back(r);
+            }
+        }
+    }
+    for (const auto &r : resources) {
+        invalidate(r);
+    }
+}
+
+void ValueNumberingVisitor::invalidate_writes(const std::shared_ptr<ast::Node> &n)
+{
+    if (n->get_node_type() == NodeType::EXPR_ASSIGN) {
+        auto assign = std::dynamic_pointer_cast<expr::Assignment>(n);
+        auto var = accessed_variable(assign->lhs, *resolver_result);
+        if (var) {
+            invalidate(var);
+        }
+    } else if (n->get_node_type() == NodeType::EXPR_FCN_CALL) {
+        auto call = std::dynamic_pointer_cast<expr::FunctionCall>(n);
+        auto fnd = resolver_result->call_expr.find(call);
+        if (fnd == resolver_result->call_expr.end() || !fnd->second->is_builtin()) {
+            invalidate_rw_resources();
+        }
+        if (fnd != resolver_result->call_expr.end()) {
+            const auto &params = fnd->second->parameters;
+            for (size_t i = 0; i < call->args.size() && i < params.size(); ++i) {
+                auto var = accessed_variable(call->args[i], *resolver_result);
+                if (is_output_param(params[i]) && var) {
+                    invalidate(var);
+                }
+            }
+        }
+    }
+    for (const auto &c : n->get_children()) {
+        invalidate_writes(c);
+    }
+}
+
+std::shared_ptr<ast::expr::Variable> ValueNumberingVisitor::make_variable(
+    const std::shared_ptr<ast::decl::Variable> &var)
+{
+    auto var_expr = std::make_shared<expr::Variable>(var->get_text());
+    resolver_result->var_expr[var_expr] = var;
+    return var_expr;
+}
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "ast/modifying_visitor.h"
+#include "resolver_visitor.h"
+
+namespace crtl {
+
+/* The ValueNumberingVisitor performs local value numbering within each block to eliminate
+ * repeated computation of the same value, along with copy propagation:
+ *
+ * - Pure expressions (arithmetic, comparisons, struct member and buffer/texture loads, and
+ *   builtin calls without out parameters, other than the wave builtins) are numbered by
+ *   their structure and the values of their operands. When an expression is computed again
+ *   while its value is still available the first occurrence is moved into a temporary
+ *   variable and both are replaced by it. If the value was already stored in a variable
+ *   that variable is used instead.
+ * - Reads of variables that hold a copy of another variable are replaced by the original
+ *   variable, while neither has been written since the copy.
+ *
+ * Values are invalidated when any variable they read is written. Loads from a buffer or
+ * texture are invalidated by stores to it, and loads from any read-write resource are
+ * invalidated by calls to user functions. Values are only reused within the block that
+ * computed them; statements nested in control flow are numbered independently and
+ * invalidate any values they may write after the statement.
+ */
+class ValueNumberingVisitor : public ast::ModifyingVisitor {
+    // A value computed in the current block
+    struct AvailableValue {
+        // The first expression computing the value
+        std::shared_ptr<ast::expr::Expression> expr;
+        // The variable holding the value, if the value has been stored in one
+        std::shared_ptr<ast::decl::Variable> holder;
+        // The variables read to compute the value
+        phmap::flat_hash_set<std::shared_ptr<ast::decl::Variable>> reads;
+    };
+
+    struct BlockState {
+        // The statements of the block that have been visited so far
+        std::vector<std::shared_ptr<ast::stmt::Statement>> statements;
+        // The statement currently being visited
+        std::shared_ptr<ast::stmt::Statement> current;
+        // Set when the statement currently being visited has invalidated values. Values
+        // computed after this can't be moved into a temporary before the statement
+        bool current_invalidated = false;
+        // Values available, by the key identifying the value
+        phmap::flat_hash_map<std::string, AvailableValue> values;
+        // Variables holding an available value map to the key of the value they hold and the
+        // variables read to compute it
+        phmap::flat_hash_map<std::shared_ptr<ast::decl::Variable>, std::string> holder_keys;
+        phmap::flat_hash_map<std::shared_ptr<ast::decl::Variable>,
+                             phmap::flat_hash_set<std::shared_ptr<ast::decl::Variable>>>
+            holder_reads;
+        // Variables holding a copy of another variable, mapped to the variable copied
+        phmap::flat_hash_map<std::shared_ptr<ast::decl::Variable>,
+                             std::shared_ptr<ast::decl::Variable>>
+            copies;
+    };
+
+    std::shared_ptr<ResolverPassResult> resolver_result;
+
+    std::vector<BlockState> blocks;
+
+    // When > 0 we're visiting expressions that aren't evaluated once at their position in
+    // the block (loop conditions and advance expressions, and the right hand side of && and
+    // ||), and values can't be numbered
+    size_t opaque_depth = 0;
+
+    // Counter used to generate unique names for the temporary variables
+    size_t temp_counter = 0;
+
+public:
+    // The number of expressions replaced by a previously computed value
+    size_t num_eliminated = 0;
+
+    // The number of variable reads replaced by copy propagation
+    size_t num_copies_propagated = 0;
+
+    ValueNumberingVisitor(const std::shared_ptr<ResolverPassResult> &resolver_result);
+
+    std::any visit_stmt_block(const std::shared_ptr<ast::stmt::Block> &s) override;
+    std::any visit_stmt_if_else(const std::shared_ptr<ast::stmt::IfElse> &s) override;
+    std::any visit_stmt_while(const std::shared_ptr<ast::stmt::While> &s) override;
+    std::any visit_stmt_for(const std::shared_ptr<ast::stmt::For> &s) override;
+    std::any visit_stmt_variable_declaration(
+        const std::shared_ptr<ast::stmt::VariableDeclaration> &s) override;
+
+    std::any visit_expr_unary(const std::shared_ptr<ast::expr::Unary> &e) override;
+    std::any visit_expr_binary(const std::shared_ptr<ast::expr::Binary> &e) override;
+    std::any visit_expr_variable(const std::shared_ptr<ast::expr::Variable> &e) override;
+    std::any visit_expr_function_call(
+        const std::shared_ptr<ast::expr::FunctionCall> &e) override;
+    std::any visit_struct_array_access(
+        const std::shared_ptr<ast::expr::StructArrayAccess> &e) override;
+    std::any visit_expr_assignment(const std::shared_ptr<ast::expr::Assignment> &e) override;
+
+private:
+    bool numbering_enabled() const;
+
+    /* Visit a statement nested in another statement, e.g. an if branch or loop body. The
+     * statement is numbered as its own block, and is wrapped in a block if temporaries were
+     * introduced in it
+     */
+    std::shared_ptr<ast::stmt::Statement> visit_nested_statement(
+        const std::shared_ptr<ast::stmt::Statement> &s);
+
+    // Visit the index expressions of an expression being written to or passed as an out
+    // parameter. The written variable itself is not a read and is left as is
+    void visit_write_target(const std::shared_ptr<ast::expr::Expression> &e);
+
+    /* Get the key identifying the value computed by the expression. Expressions computing
+     * the same value in the current block have the same key. Returns an empty string for
+     * expressions that are not pure
+     */
+    std::string value_key(const std::shared_ptr<ast::expr::Expression> &e);
+
+    // Collect the variables read to compute the expression
+    void collect_reads(const std::shared_ptr<ast::Node> &n,
+                       phmap::flat_hash_set<std::shared_ptr<ast::decl::Variable>> &reads);
+
+    /* Number the pure expression, returning the expression to replace it with. If the value
+     * is available the expression is replaced with the variable holding it, otherwise the
+     * expression is recorded as computing the value
+     */
+    std::any number_value(const std::shared_ptr<ast::expr::Expression> &e);
+
+    // Store the available value in a new temporary, inserted before the first expression
+    // computing it which is replaced by the temporary. Returns false if the type of the value
+    // can't be determined
+    bool store_in_temporary(const std::string &key, AvailableValue &value);
+
+    // Record that the value of the expression is now held by the variable
+    void set_holder(const std::shared_ptr<ast::decl::Variable> &var,
+                    const std::shared_ptr<ast::expr::Expression> &value_expr);
+
+    // Invalidate any values and copies depending on the variable
+    void invalidate(const std::shared_ptr<ast::decl::Variable> &var);
+
+    // Invalidate any loads from read-write resources
+    void invalidate_rw_resources();
+
+    // Invalidate everything that may be written by the subtree
+    void invalidate_writes(const std::shared_ptr<ast::Node> &n);
+
+    std::shared_ptr<ast::expr::Variable> make_variable(
+        const std::shared_ptr<ast::decl::Variable> &var);
+};
+}
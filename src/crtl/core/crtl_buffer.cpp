@@ -1,5 +1,6 @@
 #include "crtl/crtl_buffer.h"
 #include "device.h"
+#include "util.h"
 
 extern "C" CRTL_EXPORT CRTL_ERROR crtl_new_buffer(CRTLDevice device,
                                                   CRTL_MEMORY_SPACE memory_space,
@@ -25,8 +26,29 @@ extern "C" CRTL_EXPORT CRTL_ERROR crtl_new_buffer_view(CRTLDevice device,
                                                        size_t n_elements,
                                                        CRTLBufferView *view)
 {
+    // Struct views have no fixed size, their stride must be passed explicitly
+    if (type == CRTL_DATA_TYPE_STRUCT) {
+        return CRTL_ERROR_INVALID_BUFFER_VIEW_STRIDE;
+    }
+    crtl::Device *d = reinterpret_cast<crtl::Device *>(device);
+    return d->new_buffer_view(
+        buffer, type, crtl::data_type_size(type), offset_bytes, n_elements, view);
+}
+
+extern "C" CRTL_EXPORT CRTL_ERROR crtl_new_struct_buffer_view(CRTLDevice device,
+                                                              CRTLBuffer buffer,
+                                                              size_t stride,
+                                                              size_t offset_bytes,
+                                                              size_t n_elements,
+                                                              CRTLBufferView *view)
+{
+    // Struct members are at least 4 byte scalars, so the stride must be a multiple of 4
+    if (stride == 0 || stride % 4 != 0) {
+        return CRTL_ERROR_INVALID_BUFFER_VIEW_STRIDE;
+    }
     crtl::Device *d = reinterpret_cast<crtl::Device *>(device);
-    return d->new_buffer_view(buffer, type, offset_bytes, n_elements, view);
+    return d->new_buffer_view(
+        buffer, CRTL_DATA_TYPE_STRUCT, stride, offset_bytes, n_elements, view);
 }
 
 extern "C" CRTL_EXPORT CRTL_ERROR crtl_map_buffer_view(CRTLDevice device,
@@ -5,7 +5,42 @@ extern "C" CRTL_EXPORT CRTL_ERROR crtl_new_shader_library(
     CRTLDevice device, const char *library_src, CRTLShaderLibrary *shader_library)
 {
     crtl::Device *d = reinterpret_cast<crtl::Device *>(device);
-    return d->new_shader_library(library_src, shader_library);
+    return d->new_shader_library(library_src, nullptr, 0, shader_library);
+}
+
+extern "C" CRTL_EXPORT CRTL_ERROR
+crtl_new_specialized_shader_library(CRTLDevice device,
+                                    const char *library_src,
+                                    const CRTLSpecializationConstant *specialization_constants,
+                                    uint32_t num_specialization_constants,
+                                    CRTLShaderLibrary *shader_library)
+{
+    crtl::Device *d = reinterpret_cast<crtl::Device *>(device);
+    return d->new_shader_library(
+        library_src, specialization_constants, num_specialization_constants, shader_library);
+}
+
+extern "C" CRTL_EXPORT CRTL_ERROR crtl_set_shader_profile_options(
+    CRTLDevice device, uint32_t instrument, const char *profile_use_file_optional)
+{
+    crtl::Device *d = reinterpret_cast<crtl::Device *>(device);
+    return d->set_shader_profile_options(instrument, profile_use_file_optional);
+}
+
+extern "C" CRTL_EXPORT CRTL_ERROR crtl_get_shader_profile_counter_count(
+    CRTLDevice device, CRTLShaderLibrary shader_library, uint32_t *count)
+{
+    crtl::Device *d = reinterpret_cast<crtl::Device *>(device);
+    return d->get_shader_profile_counter_count(shader_library, count);
+}
+
+extern "C" CRTL_EXPORT CRTL_ERROR crtl_save_shader_profile(CRTLDevice device,
+                                                           CRTLShaderLibrary shader_library,
+                                                           const uint32_t *counters,
+                                                           const char *profile_file)
+{
+    crtl::Device *d = reinterpret_cast<crtl::Device *>(device);
+    return d->save_shader_profile(shader_library, counters, profile_file);
 }
 
 extern "C" CRTL_EXPORT CRTL_ERROR
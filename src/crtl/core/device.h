@@ -30,8 +30,10 @@ public:
                                   size_t size_bytes,
                                   CRTLBuffer *buffer) = 0;
 
+    // The stride is the size of the view's elements, computed by the API for typed views
     virtual CRTL_ERROR new_buffer_view(CRTLBuffer buffer,
                                        CRTL_DATA_TYPE type,
+                                       size_t stride,
                                        size_t offset_bytes,
                                        size_t n_elements,
                                        CRTLBufferView *view) = 0;
@@ -197,8 +199,21 @@ public:
 
     // Shader APIs ====
 
-    virtual CRTL_ERROR new_shader_library(const char *library_src,
-                                          CRTLShaderLibrary *shader_library) = 0;
+    virtual CRTL_ERROR new_shader_library(
+        const char *library_src,
+        const CRTLSpecializationConstant *specialization_constants,
+        uint32_t num_specialization_constants,
+        CRTLShaderLibrary *shader_library) = 0;
+
+    virtual CRTL_ERROR set_shader_profile_options(uint32_t instrument,
+                                                  const char *profile_use_file_optional) = 0;
+
+    virtual CRTL_ERROR get_shader_profile_counter_count(CRTLShaderLibrary shader_library,
+                                                        uint32_t *count) = 0;
+
+    virtual CRTL_ERROR save_shader_profile(CRTLShaderLibrary shader_library,
+                                           const uint32_t *counters,
+                                           const char *profile_file) = 0;
 
     virtual CRTL_ERROR new_global_parameter_block(
         CRTLShaderLibrary shader_library, CRTLGlobalParameterBlock *parameter_block) = 0;
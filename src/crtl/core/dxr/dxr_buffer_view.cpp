@@ -7,10 +7,12 @@ namespace dxr {
 
 BufferView::BufferView(std::shared_ptr<Buffer> buffer,
                        CRTL_DATA_TYPE data_type,
+                       size_t stride,
                        size_t offset_bytes,
                        size_t size)
     : buffer(buffer),
       data_type(data_type),
+      stride(stride),
       offset_bytes(offset_bytes),
       size(size),
       mapping(nullptr),
@@ -64,7 +66,17 @@ void BufferView::unmap()
 
 size_t BufferView::size_bytes()
 {
-    return size * crtl::data_type_size(data_type);
+    return size * stride;
+}
+
+size_t BufferView::element_size() const
+{
+    return stride;
+}
+
+bool BufferView::is_host_visible() const
+{
+    return buffer->heap() != D3D12_HEAP_TYPE_DEFAULT;
 }
 
 D3D12_GPU_VIRTUAL_ADDRESS BufferView::gpu_virtual_address()
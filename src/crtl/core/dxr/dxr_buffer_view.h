@@ -10,6 +10,8 @@ namespace dxr {
 class CRTL_DXR_EXPORT BufferView : public crtl::APIObject {
     std::shared_ptr<Buffer> buffer;
     CRTL_DATA_TYPE data_type;
+    // The size of each element, the struct's stride for views of structs
+    size_t stride;
 
     size_t offset_bytes;
     size_t size;
@@ -20,6 +22,7 @@ class CRTL_DXR_EXPORT BufferView : public crtl::APIObject {
 public:
     BufferView(std::shared_ptr<Buffer> buffer,
                CRTL_DATA_TYPE data_type,
+               size_t stride,
                size_t offset_bytes,
                size_t size);
 
@@ -29,6 +32,12 @@ public:
 
     size_t size_bytes();
 
+    // The size of the view's elements in bytes
+    size_t element_size() const;
+
+    // If the view's buffer can be mapped to read its contents on the host
+    bool is_host_visible() const;
+
     D3D12_GPU_VIRTUAL_ADDRESS gpu_virtual_address();
 };
 }
@@ -1,5 +1,6 @@
 #include "dxr_device.h"
 #include "error.h"
+#include "profile.h"
 
 #include "dxr_buffer.h"
 #include "dxr_buffer_view.h"
@@ -101,6 +102,7 @@ CRTL_ERROR DXRDevice::new_buffer(CRTL_MEMORY_SPACE memory_space,
 
 CRTL_ERROR DXRDevice::new_buffer_view(CRTLBuffer buffer,
                                       CRTL_DATA_TYPE type,
+                                      size_t stride,
                                       size_t offset_bytes,
                                       size_t n_elements,
                                       CRTLBufferView *view)
@@ -112,7 +114,7 @@ CRTL_ERROR DXRDevice::new_buffer_view(CRTLBuffer buffer,
         return CRTL_ERROR_INVALID_OBJECT;
     }
     return wrap_try_catch([&]() {
-        auto v = make_api_object<BufferView>(buf, type, offset_bytes, n_elements);
+        auto v = make_api_object<BufferView>(buf, type, stride, offset_bytes, n_elements);
         *view = reinterpret_cast<CRTLBufferView>(v.get());
         return CRTL_ERROR_NONE;
     });
@@ -315,6 +317,63 @@ CRTL_ERROR DXRDevice::set_parameter(CRTLParameterBlock parameter_block,
         case CRTL_DATA_TYPE_DOUBLE2X4:
         case CRTL_DATA_TYPE_DOUBLE3X4:
         case CRTL_DATA_TYPE_DOUBLE4X4:
+        case CRTL_DATA_TYPE_HALF:
+        case CRTL_DATA_TYPE_HALF2:
+        case CRTL_DATA_TYPE_HALF3:
+        case CRTL_DATA_TYPE_HALF4:
+        case CRTL_DATA_TYPE_HALF2X1:
+        case CRTL_DATA_TYPE_HALF3X1:
+        case CRTL_DATA_TYPE_HALF4X1:
+        case CRTL_DATA_TYPE_HALF1X2:
+        case CRTL_DATA_TYPE_HALF2X2:
+        case CRTL_DATA_TYPE_HALF3X2:
+        case CRTL_DATA_TYPE_HALF4X2:
+        case CRTL_DATA_TYPE_HALF1X3:
+        case CRTL_DATA_TYPE_HALF2X3:
+        case CRTL_DATA_TYPE_HALF3X3:
+        case CRTL_DATA_TYPE_HALF4X3:
+        case CRTL_DATA_TYPE_HALF1X4:
+        case CRTL_DATA_TYPE_HALF2X4:
+        case CRTL_DATA_TYPE_HALF3X4:
+        case CRTL_DATA_TYPE_HALF4X4:
+        case CRTL_DATA_TYPE_INT16:
+        case CRTL_DATA_TYPE_INT16_2:
+        case CRTL_DATA_TYPE_INT16_3:
+        case CRTL_DATA_TYPE_INT16_4:
+        case CRTL_DATA_TYPE_INT16_2X1:
+        case CRTL_DATA_TYPE_INT16_3X1:
+        case CRTL_DATA_TYPE_INT16_4X1:
+        case CRTL_DATA_TYPE_INT16_1X2:
+        case CRTL_DATA_TYPE_INT16_2X2:
+        case CRTL_DATA_TYPE_INT16_3X2:
+        case CRTL_DATA_TYPE_INT16_4X2:
+        case CRTL_DATA_TYPE_INT16_1X3:
+        case CRTL_DATA_TYPE_INT16_2X3:
+        case CRTL_DATA_TYPE_INT16_3X3:
+        case CRTL_DATA_TYPE_INT16_4X3:
+        case CRTL_DATA_TYPE_INT16_1X4:
+        case CRTL_DATA_TYPE_INT16_2X4:
+        case CRTL_DATA_TYPE_INT16_3X4:
+        case CRTL_DATA_TYPE_INT16_4X4:
+        case CRTL_DATA_TYPE_UINT16:
+        case CRTL_DATA_TYPE_UINT16_2:
+        case CRTL_DATA_TYPE_UINT16_3:
+        case CRTL_DATA_TYPE_UINT16_4:
+        case CRTL_DATA_TYPE_UINT16_2X1:
+        case CRTL_DATA_TYPE_UINT16_3X1:
+        case CRTL_DATA_TYPE_UINT16_4X1:
+        case CRTL_DATA_TYPE_UINT16_1X2:
+        case CRTL_DATA_TYPE_UINT16_2X2:
+        case CRTL_DATA_TYPE_UINT16_3X2:
+        case CRTL_DATA_TYPE_UINT16_4X2:
+        case CRTL_DATA_TYPE_UINT16_1X3:
+        case CRTL_DATA_TYPE_UINT16_2X3:
+        case CRTL_DATA_TYPE_UINT16_3X3:
+        case CRTL_DATA_TYPE_UINT16_4X3:
+        case CRTL_DATA_TYPE_UINT16_1X4:
+        case CRTL_DATA_TYPE_UINT16_2X4:
+        case CRTL_DATA_TYPE_UINT16_3X4:
+        case CRTL_DATA_TYPE_UINT16_4X4:
             pb->set_parameter(name, data_type, parameter);
             break;
         case CRTL_DATA_TYPE_BUFFER_VIEW:
@@ -518,16 +577,75 @@ CRTL_ERROR DXRDevice::build_shader_table(CRTLRTPipeline pipeline)
 
 // Shader APIs ====
 
-CRTL_ERROR DXRDevice::new_shader_library(const char *library_src,
-                                         CRTLShaderLibrary *shader_library)
+CRTL_ERROR DXRDevice::new_shader_library(
+    const char *library_src,
+    const CRTLSpecializationConstant *specialization_constants,
+    uint32_t num_specialization_constants,
+    CRTLShaderLibrary *shader_library)
 {
     return wrap_try_catch([&]() {
-        auto lib = make_api_object<ShaderLibrary>(library_src);
+        CompileOptions options;
+        options.profile_instrument = profile_instrument;
+        options.profile_use = profile_use;
+        for (uint32_t i = 0; i < num_specialization_constants; ++i) {
+            options.specialization_values[specialization_constants[i].name] =
+                specialization_constants[i].value;
+        }
+
+        // TODO: CRTL Compiler library needs some way for us to get errors and report them
+        // back up to the application
+        auto compilation_result = shader_permutations.compile(library_src, options);
+
+        // Identical permutations share the same compilation result, so the DXIL is only
+        // compiled once for them
+        auto &dxil = shader_dxil[compilation_result];
+        if (!dxil) {
+            std::cout << "----\nInput CRTL shader:\n" << library_src << "\n";
+            std::cout << "Compiled HLSL src:\n" << compilation_result->hlsl_src << "\n----\n";
+            dxil = ShaderLibrary::compile_dxil(compilation_result->hlsl_src);
+        }
+
+        auto lib = make_api_object<ShaderLibrary>(compilation_result, dxil);
         *shader_library = reinterpret_cast<CRTLShaderLibrary>(lib.get());
         return CRTL_ERROR_NONE;
     });
 }
 
+CRTL_ERROR DXRDevice::set_shader_profile_options(uint32_t instrument,
+                                                 const char *profile_use_file_optional)
+{
+    profile_instrument = instrument != 0;
+    profile_use = profile_use_file_optional ? profile_use_file_optional : "";
+    return CRTL_ERROR_NONE;
+}
+
+CRTL_ERROR DXRDevice::get_shader_profile_counter_count(CRTLShaderLibrary shader_library,
+                                                       uint32_t *count)
+{
+    return wrap_try_catch([&]() {
+        auto slib = lookup_api_object<ShaderLibrary>(
+            reinterpret_cast<crtl::APIObject *>(shader_library));
+        *count = slib->get_profile_counters().size();
+        return CRTL_ERROR_NONE;
+    });
+}
+
+CRTL_ERROR DXRDevice::save_shader_profile(CRTLShaderLibrary shader_library,
+                                          const uint32_t *counters,
+                                          const char *profile_file)
+{
+    return wrap_try_catch([&]() {
+        auto slib = lookup_api_object<ShaderLibrary>(
+            reinterpret_cast<crtl::APIObject *>(shader_library));
+        try {
+            Profile::from_counters(slib->get_profile_counters(), counters).save(profile_file);
+        } catch (const std::runtime_error &e) {
+            throw Error(e.what(), CRTL_ERROR_PROFILE_IO_FAILED);
+        }
+        return CRTL_ERROR_NONE;
+    });
+}
+
 CRTL_ERROR DXRDevice::new_global_parameter_block(
     CRTLShaderLibrary shader_library, CRTLGlobalParameterBlock *parameter_block)
 {
@@ -602,7 +720,7 @@ CRTL_ERROR DXRDevice::new_shader_record_parameter_block(
     return wrap_try_catch([&]() {
         auto sr = lookup_api_object<ShaderRecord>(
             reinterpret_cast<crtl::APIObject *>(shader_record));
-        auto pb = make_api_object<ShaderRecordParameterBlock>(sr);
+        auto pb = make_api_object<ShaderRecordParameterBlock>(this, sr);
         *parameter_block = reinterpret_cast<CRTLShaderRecordParameterBlock>(pb.get());
         return CRTL_ERROR_NONE;
     });
@@ -4,8 +4,11 @@
 #include "crtl_dxr_export.h"
 #include "device.h"
 #include "dxr_utils.h"
+#include "hlsl/shader_permutation_cache.h"
 #include "parallel_hashmap/phmap.h"
 
+#include <dxcapi.h>
+
 namespace crtl {
 namespace dxr {
 class CRTL_DXR_EXPORT DXRDevice : public Device {
@@ -21,6 +24,17 @@ class CRTL_DXR_EXPORT DXRDevice : public Device {
     Microsoft::WRL::ComPtr<IDXGIFactory2> dxgi_factory;
     Microsoft::WRL::ComPtr<ID3D12Device5> d3d12_device;
 
+    // The compiled permutations of the shader libraries created on the device, and the DXIL
+    // compiled for each distinct permutation
+    hlsl::ShaderPermutationCache shader_permutations;
+    phmap::flat_hash_map<std::shared_ptr<hlsl::ShaderCompilationResult>,
+                         Microsoft::WRL::ComPtr<IDxcBlob>>
+        shader_dxil;
+
+    // The profiling options applied to the shader libraries created on the device
+    bool profile_instrument = false;
+    std::string profile_use;
+
 public:
     int app_ref_count = 0;
 
@@ -48,6 +62,7 @@ public:
 
     CRTL_ERROR new_buffer_view(CRTLBuffer buffer,
                                CRTL_DATA_TYPE type,
+                               size_t stride,
                                size_t offset_bytes,
                                size_t n_elements,
                                CRTLBufferView *view) override;
@@ -214,8 +229,20 @@ public:
     // Shader APIs ====
 
     CRTL_ERROR new_shader_library(const char *library_src,
+                                  const CRTLSpecializationConstant *specialization_constants,
+                                  uint32_t num_specialization_constants,
                                   CRTLShaderLibrary *shader_library) override;
 
+    CRTL_ERROR set_shader_profile_options(uint32_t instrument,
+                                          const char *profile_use_file_optional) override;
+
+    CRTL_ERROR get_shader_profile_counter_count(CRTLShaderLibrary shader_library,
+                                                uint32_t *count) override;
+
+    CRTL_ERROR save_shader_profile(CRTLShaderLibrary shader_library,
+                                   const uint32_t *counters,
+                                   const char *profile_file) override;
+
     CRTL_ERROR new_global_parameter_block(
         CRTLShaderLibrary shader_library,
         CRTLGlobalParameterBlock *parameter_block) override;
@@ -8,7 +8,8 @@ namespace dxr {
 
 class CRTL_DXR_EXPORT GlobalParameterBlock : public ParameterBlock {
 public:
-    // TODO
+    // TODO: The "soa_buffers" listed in the metadata must be scattered into the buffers of
+    // their fields when set, as done for the shader record parameters
 
     void set_parameter(const std::string &name,
                        CRTL_DATA_TYPE data_type,
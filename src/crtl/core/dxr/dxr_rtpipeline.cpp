@@ -49,6 +49,16 @@ RTPipelineBuilder &RTPipelineBuilder::configure_shader_payload(
     return *this;
 }
 
+RTPipelineBuilder &RTPipelineBuilder::configure_shader_payload(
+    const std::vector<std::wstring> &functions, const ShaderLibrary &library)
+{
+    // Hit groups using the built in triangle intersection receive its float2 barycentrics
+    // even if the shaders don't read them
+    const uint32_t attrib_size =
+        std::max(library.max_attribute_size(), uint32_t(2 * sizeof(float)));
+    return configure_shader_payload(functions, library.max_payload_size(), attrib_size);
+}
+
 RTPipelineBuilder &RTPipelineBuilder::set_max_recursion(uint32_t depth)
 {
     recursion_depth = depth;
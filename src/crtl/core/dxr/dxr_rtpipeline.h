@@ -53,6 +53,12 @@ public:
         uint32_t max_payload_size,
         uint32_t max_attrib_size);
 
+    /* Configure the payload of the functions with the largest ray payload and hit attributes
+     * used by the shader library, as inferred by the compiler
+     */
+    RTPipelineBuilder &configure_shader_payload(const std::vector<std::wstring> &functions,
+                                                const ShaderLibrary &library);
+
     RTPipelineBuilder &set_max_recursion(uint32_t depth);
 
     RTPipelineBuilder &set_shader_root_sig(const std::vector<std::wstring> &functions,
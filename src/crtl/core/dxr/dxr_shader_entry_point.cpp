@@ -54,6 +54,11 @@ const RootSignature *ShaderEntryPoint::get_root_signature() const
     return root_signature.get();
 }
 
+size_t ShaderEntryPoint::get_spill_buffer_size() const
+{
+    return spill_buffer_size;
+}
+
 void ShaderEntryPoint::build_root_signature(DXRDevice *device)
 {
     auto builder = RootSignatureBuilder::local();
@@ -72,7 +77,8 @@ void ShaderEntryPoint::build_root_signature(DXRDevice *device)
         const uint32_t constants_slot = inline_constants["slot"].get<int>();
         const uint32_t constants_space = inline_constants["space"].get<int>();
 
-        uint32_t num_constants = 0;
+        // The compiler lays out the constants with HLSL's packing rules, so the offsets and
+        // size it computed are used directly
         for (auto &c : constants_arr) {
             auto ty = ty::parse_type(c["type"]);
             // TODO: Compiler I think should be making sure all these names are unique at
@@ -85,10 +91,9 @@ void ShaderEntryPoint::build_root_signature(DXRDevice *device)
                                     ty,
                                     constants_slot,
                                     constants_space,
-                                    num_constants * 4);
-
-            num_constants += ty->size() / 4;
+                                    c["offset"].get<uint32_t>());
         }
+        const uint32_t num_constants = (inline_constants["size"].get<uint32_t>() + 3) / 4;
         std::cout << "sbt constants:\n  - slot: " << constants_slot << "\n"
                   << "  - # of constants = " << num_constants << "\n"
                   << "  - space: " << constants_space << "\n";
@@ -96,6 +101,24 @@ void ShaderEntryPoint::build_root_signature(DXRDevice *device)
             "sbt_constants", constants_slot, num_constants, constants_space);
     }
 
+    // Constants moved out of the shader record to fit the compiler's shader record budget
+    // are read from a constant buffer whose address is passed in the record instead
+    auto &spilled_constants = entry_point_info["parameters"]["params"]["spill_buffer"];
+    if (!spilled_constants.is_null()) {
+        const uint32_t spill_slot = spilled_constants["slot"].get<int>();
+        const uint32_t spill_space = spilled_constants["space"].get<int>();
+        for (auto &c : spilled_constants["contents"]) {
+            parameter_info[c["name"].get<std::string>()] =
+                ShaderParameterDesc(ShaderParameterType::SPILLED_CONSTANT,
+                                    ty::parse_type(c["type"]),
+                                    spill_slot,
+                                    spill_space,
+                                    c["offset"].get<uint32_t>());
+        }
+        spill_buffer_size = spilled_constants["size"].get<size_t>();
+        builder.add_cbv("sbt_spill_buffer", spill_slot, spill_space);
+    }
+
     auto &members = entry_point_info["parameters"]["params"]["members"];
     for (auto &m : members.items()) {
         std::cout << "member: " << m << "\n";
@@ -114,6 +137,17 @@ void ShaderEntryPoint::build_root_signature(DXRDevice *device)
                     ShaderParameterType::UNORDERED_ACCESS_VIEW, ty, slot, space);
                 builder.add_uav(m.key(), slot, space);
             }
+            // Structured and byte address buffers are both bound as root descriptors, the
+            // views just need to use the element stride the shader reads them with
+            if (m.value().contains("stride")) {
+                parameter_info[m.key()].buffer_stride = m.value()["stride"].get<uint32_t>();
+            }
+            // The stride of struct elements is only known from the compiler's layout
+            auto element_struct =
+                std::dynamic_pointer_cast<ty::Struct>(buf_view->element_type);
+            if (element_struct) {
+                element_struct->stride = parameter_info[m.key()].buffer_stride;
+            }
         } else if (ty->base_type == ty::BaseType::TEXTURE) {
             auto texture = std::dynamic_pointer_cast<ty::Texture>(ty);
             if (texture->access == ty::Access::READ_ONLY) {
@@ -132,6 +166,22 @@ void ShaderEntryPoint::build_root_signature(DXRDevice *device)
         }
     }
 
+    // Buffers of structs split into a buffer per field are set as a whole by the app and
+    // scattered into the field buffers
+    auto &soa_buffers = entry_point_info["parameters"]["params"]["soa_buffers"];
+    for (auto &b : soa_buffers.items()) {
+        ShaderParameterDesc desc;
+        desc.param_type = ShaderParameterType::SOA_BUFFER;
+        desc.type = ty::parse_type(b.value()["type"]);
+        desc.buffer_stride = b.value()["stride"].get<uint32_t>();
+        for (const auto &f : b.value()["fields"]) {
+            desc.soa_fields.push_back(SoaField{f["parameter"].get<std::string>(),
+                                               f["offset"].get<uint32_t>(),
+                                               f["size"].get<uint32_t>()});
+        }
+        parameter_info[b.key()] = desc;
+    }
+
     root_signature = builder.build(device->get_d3d12_device().Get());
 }
 
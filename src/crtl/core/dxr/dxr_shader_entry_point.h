@@ -47,6 +47,10 @@ class CRTL_DXR_EXPORT ShaderEntryPoint : public APIObject {
 
     std::shared_ptr<RootSignature> root_signature;
 
+    // The size of the constant buffer holding the constants the compiler moved out of the
+    // shader record, 0 if none were moved
+    size_t spill_buffer_size = 0;
+
 public:
     ShaderEntryPoint(DXRDevice *dxrdevice,
                      const std::string &entry_point_name,
@@ -61,6 +65,8 @@ public:
 
     const RootSignature *get_root_signature() const;
 
+    size_t get_spill_buffer_size() const;
+
 private:
     // Builds the root signature and the parameter info
     void build_root_signature(DXRDevice *device);
@@ -10,18 +10,11 @@ namespace dxr {
 
 using Microsoft::WRL::ComPtr;
 
-ShaderLibrary::ShaderLibrary(const std::string &crtl_src)
-    // TODO: CRTL Compiler library needs some way for us to get errors and report them
-    // back up to the application
-    : crtl_compilation_result(hlsl::compile_crtl(crtl_src))
+ShaderLibrary::ShaderLibrary(
+    const std::shared_ptr<hlsl::ShaderCompilationResult> &crtl_compilation_result,
+    const ComPtr<IDxcBlob> &shader_dxil)
+    : crtl_compilation_result(crtl_compilation_result), shader_dxil(shader_dxil)
 {
-    std::cout << "----\nInput CRTL shader:\n" << crtl_src << "\n";
-    std::cout << "Compiled HLSL src:\n"
-              << crtl_compilation_result->hlsl_src << "\n----\n";
-
-    // Now compile the HLSL to DXIL
-    compile_dxil();
-
     bytecode.pShaderBytecode = shader_dxil->GetBufferPointer();
     bytecode.BytecodeLength = shader_dxil->GetBufferSize();
 
@@ -44,16 +37,18 @@ const D3D12_DXIL_LIBRARY_DESC *ShaderLibrary::library_desc() const
     return &dxil_library_desc;
 }
 
-void ShaderLibrary::compile_dxil()
+ComPtr<IDxcBlob> ShaderLibrary::compile_dxil(const std::string &hlsl_src)
 {
     ComPtr<IDxcCompiler3> dxc;
     DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxc));
 
-    std::array<LPCWSTR, 3> dxc_args = {L"-T", L"lib_6_3", L"-O3"};
+    // The 16-bit types are output as HLSL's native 16-bit types, which must be enabled. It
+    // doesn't affect shaders that don't use them
+    std::array<LPCWSTR, 4> dxc_args = {L"-T", L"lib_6_3", L"-O3", L"-enable-16bit-types"};
 
     DxcBuffer hlsl_src_buf = {};
-    hlsl_src_buf.Ptr = crtl_compilation_result->hlsl_src.c_str();
-    hlsl_src_buf.Size = crtl_compilation_result->hlsl_src.size();
+    hlsl_src_buf.Ptr = hlsl_src.c_str();
+    hlsl_src_buf.Size = hlsl_src.size();
     hlsl_src_buf.Encoding = DXC_CP_UTF8;
 
     ComPtr<IDxcResult> dxc_results;
@@ -82,11 +77,13 @@ void ShaderLibrary::compile_dxil()
     }
 
     // Get the shader binary
+    ComPtr<IDxcBlob> shader_dxil;
     dxc_results->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&shader_dxil), nullptr);
     if (!shader_dxil) {
         std::cout << "Somehow didn't get shader dxil!?";
         throw Error("Didn't get DXIL?", CRTL_ERROR_NATIVE_SHADER_COMPILATION_FAILED);
     }
+    return shader_dxil;
 }
 
 nlohmann::json ShaderLibrary::get_entry_point_info(const std::string &entry_point) const
@@ -100,6 +97,26 @@ nlohmann::json ShaderLibrary::get_entry_point_info(const std::string &entry_poin
     return *fnd;
 }
 
+nlohmann::json ShaderLibrary::get_profile_counters() const
+{
+    const auto &shader_info = crtl_compilation_result->shader_info;
+    const auto fnd = shader_info.find("profile_counters");
+    if (fnd == shader_info.end()) {
+        return nlohmann::json::array();
+    }
+    return *fnd;
+}
+
+uint32_t ShaderLibrary::max_payload_size() const
+{
+    return crtl_compilation_result->shader_info.value("max_payload_size", 0u);
+}
+
+uint32_t ShaderLibrary::max_attribute_size() const
+{
+    return crtl_compilation_result->shader_info.value("max_attribute_size", 0u);
+}
+
 void ShaderLibrary::build_library_desc()
 {
     for (const auto &fn : exported_functions) {
@@ -27,7 +27,12 @@ class CRTL_DXR_EXPORT ShaderLibrary : public APIObject {
     std::vector<D3D12_EXPORT_DESC> exports;
 
 public:
-    ShaderLibrary(const std::string &crtl_src);
+    /* Create the library for the compiled shader, its DXIL is shared by all the libraries
+     * created for the same shader permutation
+     */
+    ShaderLibrary(
+        const std::shared_ptr<hlsl::ShaderCompilationResult> &crtl_compilation_result,
+        const Microsoft::WRL::ComPtr<IDxcBlob> &shader_dxil);
 
     ShaderLibrary(const ShaderLibrary &) = delete;
     ShaderLibrary &operator=(const ShaderLibrary &) = delete;
@@ -37,8 +42,17 @@ public:
 
     const D3D12_DXIL_LIBRARY_DESC *library_desc() const;
 
+    // Get the site IDs of the profile counters, empty if the shader isn't instrumented
+    nlohmann::json get_profile_counters() const;
+
+    // Get the size in bytes of the largest ray payload and hit attributes used by the library
+    uint32_t max_payload_size() const;
+    uint32_t max_attribute_size() const;
+
+    // Compile the HLSL source of the shader library to DXIL
+    static Microsoft::WRL::ComPtr<IDxcBlob> compile_dxil(const std::string &hlsl_src);
+
 private:
-    void compile_dxil();
 
     void build_library_desc();
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+#include <vector>
 #include "api_object.h"
 #include "crtl_dxr_export.h"
 #include "dxr_utils.h"
@@ -11,14 +13,28 @@ namespace dxr {
 enum class ShaderParameterType {
     INVALID,
     INLINE_CONSTANT,
+    // A constant moved out of the shader record into the record's spill constant buffer,
+    // at constant_offset_bytes in the buffer
+    SPILLED_CONSTANT,
     SHADER_RESOURCE_VIEW,
     UNORDERED_ACCESS_VIEW,
+    // A buffer of structs the compiler split into a buffer per field, listed in soa_fields.
+    // The array of structs set for it is scattered into the field buffers
+    SOA_BUFFER,
     // TODO: samplers, tables
 };
 
+// A field of a split SoA buffer: the parameter holding its buffer, and its offset and size
+// in the struct
+struct SoaField {
+    std::string parameter;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+
 /* Describes a shader record parameter, which register type it maps too,
- * the slot/space for that register. Inline constants also specify their offset
- * within the inline constant buffer in bytes
+ * the slot/space for that register. Inline and spilled constants also specify their offset
+ * within the inline constant buffer or spill buffer in bytes
  */
 struct CRTL_DXR_EXPORT ShaderParameterDesc {
     ShaderParameterType param_type = ShaderParameterType::INVALID;
@@ -27,6 +43,11 @@ struct CRTL_DXR_EXPORT ShaderParameterDesc {
     uint32_t slot = -1;
     uint32_t space = -1;
     uint32_t constant_offset_bytes = -1;
+    // The stride of the elements of buffer parameters in the layout the compiler selected,
+    // which the buffer views bound to the parameter must match. 0 if not a buffer
+    uint32_t buffer_stride = 0;
+    // The fields of SoA buffer parameters, empty if not an SoA buffer
+    std::vector<SoaField> soa_fields;
 
     ShaderParameterDesc() = default;
 
@@ -64,6 +64,16 @@ HitGroupRecord::HitGroupRecord(const std::shared_ptr<ShaderEntryPoint> &closest_
         }
         shader_record_name += "_" + any_hit->name();
     }
+
+    // Hit group records don't have a local root signature to hold a spill buffer address,
+    // the compiler doesn't spill constants of hit group entry points
+    for (const auto &ep : {closest_hit, intersection, any_hit}) {
+        if (ep && ep->get_spill_buffer_size() > 0) {
+            throw Error("HitGroupRecord: Entry point " + ep->name() +
+                            " has spilled constants, which hit group records don't support",
+                        CRTL_ERROR_INVALID_SHADER_ENTRY_POINT);
+        }
+    }
 }
 
 const phmap::flat_hash_map<std::string, ShaderParameterDesc>
@@ -78,6 +88,12 @@ const RootSignature *HitGroupRecord::get_root_signature() const
     return nullptr;
 }
 
+size_t HitGroupRecord::get_spill_buffer_size() const
+{
+    // Entry points with spilled constants are rejected when creating the record
+    return 0;
+}
+
 MissRecord::MissRecord(const std::shared_ptr<ShaderEntryPoint> &entry_point)
     : entry_point(entry_point)
 {
@@ -100,6 +116,11 @@ const RootSignature *MissRecord::get_root_signature() const
     return entry_point->get_root_signature();
 }
 
+size_t MissRecord::get_spill_buffer_size() const
+{
+    return entry_point->get_spill_buffer_size();
+}
+
 RaygenRecord::RaygenRecord(const std::shared_ptr<ShaderEntryPoint> &entry_point)
     : entry_point(entry_point)
 {
@@ -122,5 +143,10 @@ const RootSignature *RaygenRecord::get_root_signature() const
 {
     return entry_point->get_root_signature();
 }
+
+size_t RaygenRecord::get_spill_buffer_size() const
+{
+    return entry_point->get_spill_buffer_size();
+}
 }
 }
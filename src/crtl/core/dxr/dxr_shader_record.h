@@ -39,6 +39,9 @@ public:
 
     virtual const RootSignature *get_root_signature() const = 0;
 
+    // The size of the constant buffer holding the constants moved out of the shader record
+    virtual size_t get_spill_buffer_size() const = 0;
+
     size_t get_parameter_block_size() const;
 
     void set_parameter_block(
@@ -68,6 +71,8 @@ public:
         &get_parameter_info() const override;
 
     virtual const RootSignature *get_root_signature() const override;
+
+    virtual size_t get_spill_buffer_size() const override;
 };
 
 class CRTL_DXR_EXPORT MissRecord : public ShaderRecord {
@@ -82,6 +87,8 @@ public:
         &get_parameter_info() const override;
 
     virtual const RootSignature *get_root_signature() const override;
+
+    virtual size_t get_spill_buffer_size() const override;
 };
 
 class CRTL_DXR_EXPORT RaygenRecord : public ShaderRecord {
@@ -96,6 +103,8 @@ public:
         &get_parameter_info() const override;
 
     virtual const RootSignature *get_root_signature() const override;
+
+    virtual size_t get_spill_buffer_size() const override;
 };
 }
 }
@@ -1,14 +1,63 @@
 #include "dxr_shader_record_parameter_block.h"
+#include <algorithm>
 #include "util.h"
 
 namespace crtl {
 namespace dxr {
+/* Write the constant to its location in a constant buffer. Matrices are set as tightly packed
+ * column major data, while in a constant buffer each column starts a new 16 byte register
+ */
+void write_constant(uint8_t *dest,
+                    const std::shared_ptr<ty::Type> &type,
+                    CRTL_DATA_TYPE data_type,
+                    const void *parameter)
+{
+    auto matrix = std::dynamic_pointer_cast<ty::Matrix>(type);
+    if (!matrix) {
+        std::memcpy(dest, parameter, crtl::data_type_size(data_type));
+        return;
+    }
+    const size_t column_size = matrix->element_type.size() * matrix->dim_0;
+    const size_t column_stride = align_to(column_size, 16);
+    const uint8_t *columns = reinterpret_cast<const uint8_t *>(parameter);
+    for (uint32_t i = 0; i < matrix->dim_1; ++i) {
+        std::memcpy(dest + i * column_stride, columns + i * column_size, column_size);
+    }
+}
+
 ShaderRecordParameterBlock::ShaderRecordParameterBlock(
-    const std::shared_ptr<ShaderRecord> &shader_record)
-    : shader_record(shader_record)
+    DXRDevice *device, const std::shared_ptr<ShaderRecord> &shader_record)
+    : device(device), shader_record(shader_record)
 {
     parameter_block.resize(shader_record->get_parameter_block_size());
     std::cout << "Parameter block size: " << parameter_block.size() << "\n";
+
+    const size_t spill_size = shader_record->get_spill_buffer_size();
+    if (spill_size > 0 && !shader_record->get_root_signature()) {
+        throw Error("Shader record has spilled constants but no root signature to pass them",
+                    CRTL_ERROR_INVALID_SHADER_ENTRY_POINT);
+    }
+    if (spill_size > 0) {
+        // Constant buffer views must be a multiple of 256 bytes in size
+        spill_buffer = std::make_shared<Buffer>(
+            device,
+            CRTL_MEMORY_SPACE_UPLOAD,
+            CRTL_BUFFER_USAGE(CRTL_BUFFER_USAGE_SHADER_READ | CRTL_BUFFER_USAGE_MAP_WRITE),
+            align_to(spill_size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT));
+        const D3D12_RANGE read_range = {0, 0};
+        CHECK_ERR(spill_buffer->get()->Map(
+            0, &read_range, reinterpret_cast<void **>(&spill_mapping)));
+
+        const size_t spill_offset =
+            shader_record->get_root_signature()->offset("sbt_spill_buffer") -
+            D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
+        const D3D12_GPU_VIRTUAL_ADDRESS gpu_virtual_addr = spill_buffer->gpu_virtual_address();
+        std::cout << "Spilled constants buffer of size " << spill_size << " at offset "
+                  << spill_offset << " in SBT\n";
+        std::memcpy(parameter_block.data() + spill_offset,
+                    &gpu_virtual_addr,
+                    sizeof(D3D12_GPU_VIRTUAL_ADDRESS));
+    }
 }
 
 void ShaderRecordParameterBlock::set_parameter(const std::string &name,
@@ -22,6 +71,15 @@ void ShaderRecordParameterBlock::set_parameter(const std::string &name,
                     CRTL_ERROR_INVALID_PARAMETER_NAME);
     }
 
+    // Constants moved out of the shader record are written to the spill buffer instead
+    if (param_info->second.param_type == ShaderParameterType::SPILLED_CONSTANT) {
+        write_constant(spill_mapping + param_info->second.constant_offset_bytes,
+                       param_info->second.type,
+                       data_type,
+                       parameter);
+        return;
+    }
+
     try {
         // offset will throw if there's no sbt_constants. The root signature offsets
         // include the shader identifier size, which we don't need to account for when
@@ -35,9 +93,10 @@ void ShaderRecordParameterBlock::set_parameter(const std::string &name,
             sbt_constants_offset + param_info->second.constant_offset_bytes;
         std::cout << "Write param of size " << crtl::data_type_size(data_type) << " "
                   << name << " at offset " << param_offset << " in SBT\n";
-        std::memcpy(parameter_block.data() + param_offset,
-                    parameter,
-                    crtl::data_type_size(data_type));
+        write_constant(parameter_block.data() + param_offset,
+                       param_info->second.type,
+                       data_type,
+                       parameter);
     } catch (const std::runtime_error &e) {
         throw Error("Parameter " + name + " does not exist in the parameter block.",
                     CRTL_ERROR_INVALID_PARAMETER_NAME);
@@ -49,6 +108,22 @@ void ShaderRecordParameterBlock::set_parameter(
     CRTL_DATA_TYPE data_type,
     const std::shared_ptr<BufferView> &parameter)
 {
+    const auto &parameter_info = shader_record->get_parameter_info();
+    auto param_info = parameter_info.find(name);
+    if (param_info != parameter_info.end() &&
+        param_info->second.param_type == ShaderParameterType::SOA_BUFFER) {
+        set_soa_buffer(name, param_info->second, parameter);
+        return;
+    }
+    if (param_info != parameter_info.end() && param_info->second.buffer_stride != 0 &&
+        parameter->element_size() != param_info->second.buffer_stride) {
+        throw Error("Buffer view bound to parameter " + name + " has elements of size " +
+                        std::to_string(parameter->element_size()) +
+                        ", but the shader reads elements of size " +
+                        std::to_string(param_info->second.buffer_stride),
+                    CRTL_ERROR_INVALID_PARAMETER_TYPE);
+    }
+
     try {
         // offset will throw if the parameter doesn't exist. The root signature offsets
         // include the shader identifier size, which we don't need to account for when
@@ -76,5 +151,56 @@ const ShaderRecord *ShaderRecordParameterBlock::get_shader_record() const
 {
     return shader_record.get();
 }
+
+void ShaderRecordParameterBlock::set_soa_buffer(const std::string &name,
+                                                const ShaderParameterDesc &desc,
+                                                const std::shared_ptr<BufferView> &parameter)
+{
+    if (parameter->element_size() != desc.buffer_stride) {
+        throw Error("Buffer view bound to SoA buffer parameter " + name +
+                        " has elements of size " + std::to_string(parameter->element_size()) +
+                        ", but the shader's struct has size " +
+                        std::to_string(desc.buffer_stride),
+                    CRTL_ERROR_INVALID_PARAMETER_TYPE);
+    }
+    // The structs are scattered on the host, so they must be readable from it
+    if (!parameter->is_host_visible()) {
+        throw Error("Buffer view bound to SoA buffer parameter " + name +
+                        " must be in a host visible memory space to be split into its fields",
+                    CRTL_ERROR_INVALID_PARAMETER_TYPE);
+    }
+
+    const auto &parameter_info = shader_record->get_parameter_info();
+    const size_t n_elements = parameter->size_bytes() / desc.buffer_stride;
+    const uint8_t *structs =
+        reinterpret_cast<const uint8_t *>(parameter->map(CRTL_BUFFER_MAP_MODE_READ));
+
+    std::vector<std::shared_ptr<BufferView>> field_views;
+    for (const auto &f : desc.soa_fields) {
+        // Buffers can't be empty, so empty arrays still get a single element buffer
+        auto buffer = std::make_shared<Buffer>(
+            device,
+            CRTL_MEMORY_SPACE_UPLOAD,
+            CRTL_BUFFER_USAGE(CRTL_BUFFER_USAGE_SHADER_READ | CRTL_BUFFER_USAGE_MAP_WRITE),
+            std::max(n_elements, size_t(1)) * f.size);
+        auto field_type =
+            std::dynamic_pointer_cast<ty::BufferView>(parameter_info.at(f.parameter).type);
+        const CRTL_DATA_TYPE field_data_type = field_type->element_type->data_type();
+        auto view =
+            std::make_shared<BufferView>(buffer, field_data_type, f.size, 0, n_elements);
+
+        uint8_t *fields = reinterpret_cast<uint8_t *>(view->map(CRTL_BUFFER_MAP_MODE_WRITE));
+        for (size_t i = 0; i < n_elements; ++i) {
+            std::memcpy(
+                fields + i * f.size, structs + i * desc.buffer_stride + f.offset, f.size);
+        }
+        view->unmap();
+
+        set_parameter(f.parameter, field_data_type, view);
+        field_views.push_back(view);
+    }
+    parameter->unmap();
+    soa_field_views[name] = field_views;
+}
 }
 }
@@ -5,27 +5,43 @@
 #include <vector>
 #include "crtl_dxr_export.h"
 #include "dxr_blas.h"
+#include "dxr_buffer.h"
 #include "dxr_buffer_view.h"
 #include "dxr_parameter_block.h"
 #include "dxr_shader_record.h"
 #include "dxr_texture.h"
 #include "dxr_tlas.h"
 #include "error.h"
+#include "parallel_hashmap/phmap.h"
 
 namespace crtl {
 namespace dxr {
 
 class CRTL_DXR_EXPORT ShaderRecordParameterBlock : public ParameterBlock {
+    DXRDevice *device = nullptr;
+
     std::shared_ptr<ShaderRecord> shader_record;
 
     // The parameter block data is populated here and just memcpy'd into the SBT
     std::vector<uint8_t> parameter_block;
 
+    // The constant buffer holding the constants moved out of the shader record by the
+    // compiler, whose address is written in the parameter block. It's kept mapped so the
+    // spilled constants can be written directly when set
+    std::shared_ptr<Buffer> spill_buffer;
+    uint8_t *spill_mapping = nullptr;
+
+    // The field buffers the SoA buffer parameters were scattered into, kept alive while
+    // they're referenced by the parameter block
+    phmap::flat_hash_map<std::string, std::vector<std::shared_ptr<BufferView>>>
+        soa_field_views;
+
 public:
     // TODO: This will basically just provide a way to set values for the elements in
     // the shader entry point's phmap::flat_hash_map<std::string, ShaderParameterDesc>
     // parameter_info;
-    ShaderRecordParameterBlock(const std::shared_ptr<ShaderRecord> &shader_record);
+    ShaderRecordParameterBlock(DXRDevice *device,
+                               const std::shared_ptr<ShaderRecord> &shader_record);
 
     void set_parameter(const std::string &name,
                        CRTL_DATA_TYPE data_type,
@@ -41,6 +57,14 @@ public:
     size_t size() const;
 
     const ShaderRecord *get_shader_record() const;
+
+private:
+    /* Scatter the array of structs in the view into a buffer per field of the struct and
+     * set the field buffer parameters the compiler split the SoA buffer parameter into
+     */
+    void set_soa_buffer(const std::string &name,
+                        const ShaderParameterDesc &desc,
+                        const std::shared_ptr<BufferView> &parameter);
 };
 }
 }
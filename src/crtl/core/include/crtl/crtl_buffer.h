@@ -30,16 +30,8 @@ CRTL_EXPORT CRTL_ERROR crtl_new_buffer(CRTLDevice device,
 
 /* Create a typed view of the specified buffer. The view can be created at a desired
  * offset in bytes from the start of the buffer, and will contain n_elements elements of
- * the specified type. Strides of views must always be compact
- *
- * TODO: struct views should also be supported but the backend needs to dictate the struct
- * size and stride in the view, because it may have to be padded or aligned in some way
- * for the target API? What needs to be avoided is making a buffer with some stride
- * between the primitive types, because that would need additional handling in the shader
- * to support accessing it. If all backends can be made to use a C struct layout that
- * would be best Vulkan can (scalar layout extension) ISPC: maybe if can use pragma pack?
- * Or just avoid using the builtin short vector types. DX12: probably? CUDA: I think it is
- * by default Metal: Also might be by default?
+ * the specified type. Strides of views must always be compact. Views of structs must be
+ * created with crtl_new_struct_buffer_view instead
  */
 CRTL_EXPORT CRTL_ERROR crtl_new_buffer_view(CRTLDevice device,
                                             CRTLBuffer buffer,
@@ -48,6 +40,24 @@ CRTL_EXPORT CRTL_ERROR crtl_new_buffer_view(CRTLDevice device,
                                             size_t n_elements,
                                             CRTLBufferView *view);
 
+/* Create a view of the specified buffer holding n_elements user defined structs, with
+ * elements of type CRTL_DATA_TYPE_STRUCT. The struct layout is dictated by the backend's
+ * target language and computed by the compiler, which outputs the offsets of the struct's
+ * fields and its stride in the shader parameter metadata. The stride passed must be the one
+ * computed by the compiler, binding the view to a parameter whose struct has a different
+ * stride is an error.
+ *
+ * Views bound to [soa] buffer parameters must be in a host visible memory space. They are
+ * split into a buffer per field of the struct when the parameter is set, so the shaders read
+ * the structs as they were at that point. Set the parameter again to see later writes.
+ */
+CRTL_EXPORT CRTL_ERROR crtl_new_struct_buffer_view(CRTLDevice device,
+                                                   CRTLBuffer buffer,
+                                                   size_t stride,
+                                                   size_t offset_bytes,
+                                                   size_t n_elements,
+                                                   CRTLBufferView *view);
+
 /* Map the view to read or write data on the host. Only buffers created in the upload
  * or readback memory space can be mapped
  */
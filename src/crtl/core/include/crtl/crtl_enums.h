@@ -87,6 +87,72 @@ enum CRTL_DATA_TYPE {
     CRTL_DATA_TYPE_ACCELERATION_STRUCTURE,
     CRTL_DATA_TYPE_RAY,
     CRTL_DATA_TYPE_STRUCT,
+    // The 16-bit types, the int vector and matrix types separate the dimensions with an
+    // underscore
+    CRTL_DATA_TYPE_HALF,
+    CRTL_DATA_TYPE_HALF2,
+    CRTL_DATA_TYPE_HALF3,
+    CRTL_DATA_TYPE_HALF4,
+    CRTL_DATA_TYPE_HALF2X1,
+    CRTL_DATA_TYPE_HALF3X1,
+    CRTL_DATA_TYPE_HALF4X1,
+    CRTL_DATA_TYPE_HALF1X2,
+    CRTL_DATA_TYPE_HALF2X2,
+    CRTL_DATA_TYPE_HALF3X2,
+    CRTL_DATA_TYPE_HALF4X2,
+    CRTL_DATA_TYPE_HALF1X3,
+    CRTL_DATA_TYPE_HALF2X3,
+    CRTL_DATA_TYPE_HALF3X3,
+    CRTL_DATA_TYPE_HALF4X3,
+    CRTL_DATA_TYPE_HALF1X4,
+    CRTL_DATA_TYPE_HALF2X4,
+    CRTL_DATA_TYPE_HALF3X4,
+    CRTL_DATA_TYPE_HALF4X4,
+    CRTL_DATA_TYPE_INT16,
+    CRTL_DATA_TYPE_INT16_2,
+    CRTL_DATA_TYPE_INT16_3,
+    CRTL_DATA_TYPE_INT16_4,
+    CRTL_DATA_TYPE_INT16_2X1,
+    CRTL_DATA_TYPE_INT16_3X1,
+    CRTL_DATA_TYPE_INT16_4X1,
+    CRTL_DATA_TYPE_INT16_1X2,
+    CRTL_DATA_TYPE_INT16_2X2,
+    CRTL_DATA_TYPE_INT16_3X2,
+    CRTL_DATA_TYPE_INT16_4X2,
+    CRTL_DATA_TYPE_INT16_1X3,
+    CRTL_DATA_TYPE_INT16_2X3,
+    CRTL_DATA_TYPE_INT16_3X3,
+    CRTL_DATA_TYPE_INT16_4X3,
+    CRTL_DATA_TYPE_INT16_1X4,
+    CRTL_DATA_TYPE_INT16_2X4,
+    CRTL_DATA_TYPE_INT16_3X4,
+    CRTL_DATA_TYPE_INT16_4X4,
+    CRTL_DATA_TYPE_UINT16,
+    CRTL_DATA_TYPE_UINT16_2,
+    CRTL_DATA_TYPE_UINT16_3,
+    CRTL_DATA_TYPE_UINT16_4,
+    CRTL_DATA_TYPE_UINT16_2X1,
+    CRTL_DATA_TYPE_UINT16_3X1,
+    CRTL_DATA_TYPE_UINT16_4X1,
+    CRTL_DATA_TYPE_UINT16_1X2,
+    CRTL_DATA_TYPE_UINT16_2X2,
+    CRTL_DATA_TYPE_UINT16_3X2,
+    CRTL_DATA_TYPE_UINT16_4X2,
+    CRTL_DATA_TYPE_UINT16_1X3,
+    CRTL_DATA_TYPE_UINT16_2X3,
+    CRTL_DATA_TYPE_UINT16_3X3,
+    CRTL_DATA_TYPE_UINT16_4X3,
+    CRTL_DATA_TYPE_UINT16_1X4,
+    CRTL_DATA_TYPE_UINT16_2X4,
+    CRTL_DATA_TYPE_UINT16_3X4,
+    CRTL_DATA_TYPE_UINT16_4X4,
+    // The quantized vertex attribute formats, which are decoded when read by the shader:
+    // octahedral encoded unit vectors in 32 bits, two 16-bit unorms and three 16-bit snorms.
+    // Buffers of SNORM16_3 start with the float3 scale and bias of their values, taking the
+    // space of 4 elements
+    CRTL_DATA_TYPE_OCT32,
+    CRTL_DATA_TYPE_UNORM16_2,
+    CRTL_DATA_TYPE_SNORM16_3,
 };
 
 enum CRTL_DEVICE_API {
@@ -208,5 +274,7 @@ enum CRTL_ERROR {
     CRTL_ERROR_INVALID_PARAMETER_NAME,
     CRTL_ERROR_INCOMPATIBLE_SHADER_RECORD_PARAMETER_BLOCK,
     CRTL_ERROR_INVALID_PARAMETER_TYPE,
+    CRTL_ERROR_PROFILE_IO_FAILED,
+    CRTL_ERROR_INVALID_BUFFER_VIEW_STRIDE,
     CRTL_ERROR_UNKNOWN = 0xffffffff
 };
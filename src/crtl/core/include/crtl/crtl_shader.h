@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include "crtl_core.h"
 #include "crtl_device.h"
 #include "crtl_parameter_block.h"
@@ -28,6 +29,13 @@ typedef CRTLShaderRecord CRTLMissRecord;
 typedef CRTLShaderRecord CRTLRaygenRecord;
 #endif
 
+// The value of a specialization constant declared in a shader library
+typedef struct {
+    const char *name;
+    // The value written as it would be in the shader source, e.g., "true", "4" or "0.5"
+    const char *value;
+} CRTLSpecializationConstant;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -36,6 +44,41 @@ CRTL_EXPORT CRTL_ERROR crtl_new_shader_library(CRTLDevice device,
                                                const char *library_src,
                                                CRTLShaderLibrary *shader_library);
 
+/* Create a shader library with its specialization constants set to the values passed,
+ * specialization constants not in the list use their default value. Libraries created from
+ * the same source and values share the compiled shader, as do libraries whose values
+ * produce the same shader after specialization
+ */
+CRTL_EXPORT CRTL_ERROR
+crtl_new_specialized_shader_library(CRTLDevice device,
+                                    const char *library_src,
+                                    const CRTLSpecializationConstant *specialization_constants,
+                                    uint32_t num_specialization_constants,
+                                    CRTLShaderLibrary *shader_library);
+
+/* Set the profiling options used when compiling the shader libraries subsequently created on
+ * the device. If instrument is set the shaders count how many times each of their functions,
+ * branches and loops run in the uint buffer _crtl_profile_counters, which must be bound
+ * zero-initialized with one counter per site and read back to save the profile. If a
+ * .crtlprof file is passed, the profile it holds guides the shader optimizations
+ */
+CRTL_EXPORT CRTL_ERROR crtl_set_shader_profile_options(CRTLDevice device,
+                                                       uint32_t instrument,
+                                                       const char *profile_use_file_optional);
+
+// Get the number of profile counters in an instrumented shader library
+CRTL_EXPORT CRTL_ERROR crtl_get_shader_profile_counter_count(CRTLDevice device,
+                                                             CRTLShaderLibrary shader_library,
+                                                             uint32_t *count);
+
+/* Save the profile counters read back from an instrumented shader library to a .crtlprof
+ * file. The counters array holds the contents of the _crtl_profile_counters buffer
+ */
+CRTL_EXPORT CRTL_ERROR crtl_save_shader_profile(CRTLDevice device,
+                                                CRTLShaderLibrary shader_library,
+                                                const uint32_t *counters,
+                                                const char *profile_file);
+
 CRTL_EXPORT CRTL_ERROR
 crtl_new_global_parameter_block(CRTLDevice device,
                                 CRTLShaderLibrary shader_library,
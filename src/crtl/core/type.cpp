@@ -1,4 +1,5 @@
 #include "type.h"
+#include <cctype>
 #include <cstring>
 #include <stdexcept>
 
@@ -19,28 +20,87 @@ std::shared_ptr<Type> parse_template_element_type(const std::string &type_str)
     return parse_type(elem_str);
 }
 
-void parse_vector_matrix_dimensionality(const std::string &type_str,
+void parse_vector_matrix_dimensionality(const std::string &dims_str,
                                         uint32_t &dim_0,
                                         uint32_t &dim_1)
 {
-    const size_t len = type_str.size();
-    if (!std::isdigit(type_str[len - 1])) {
+    const size_t len = dims_str.size();
+    if (len == 0 || !std::isdigit(dims_str[len - 1])) {
         dim_0 = 0;
         dim_1 = 0;
         return;
     }
 
     // Matrices
-    if (type_str[len - 2] == 'X') {
-        dim_0 = type_str[len - 3] - '0';
-        dim_1 = type_str[len - 1] - '0';
+    if (len >= 3 && dims_str[len - 2] == 'X') {
+        dim_0 = dims_str[len - 3] - '0';
+        dim_1 = dims_str[len - 1] - '0';
     } else {
         // Vectors
-        dim_0 = type_str[len - 1] - '0';
+        dim_0 = dims_str[len - 1] - '0';
         dim_1 = 0;
     }
 }
 
+/* Split the type string into the primitive type name and the vector or matrix dimensions
+ * following it, e.g. FLOAT3X4 into FLOAT and 3X4. The 16-bit int type names end in a digit,
+ * so their dimensions are separated by an underscore, e.g. INT16_3X4
+ */
+void split_type_name(const std::string &type_str, std::string &name, std::string &dims_str)
+{
+    size_t name_end = type_str.find_first_of("0123456789");
+    if (type_str.compare(0, 5, "INT16") == 0) {
+        name_end = 5;
+    } else if (type_str.compare(0, 6, "UINT16") == 0) {
+        name_end = 6;
+    }
+    name = type_str.substr(0, name_end);
+    dims_str = name_end < type_str.size() ? type_str.substr(name_end) : "";
+    if ((name == "INT16" || name == "UINT16") && !dims_str.empty()) {
+        // Drop the separator, leaving the dimensions invalid if it's missing
+        dims_str = dims_str[0] == '_' ? dims_str.substr(1) : "?";
+    }
+}
+
+// Check if the dimensions following a primitive type name are empty, a vector's or a matrix's
+bool valid_dimensions(const std::string &dims_str)
+{
+    return dims_str.empty() || (dims_str.size() == 1 && std::isdigit(dims_str[0])) ||
+           (dims_str.size() == 3 && std::isdigit(dims_str[0]) && dims_str[1] == 'X' &&
+            std::isdigit(dims_str[2]));
+}
+
+// Get the primitive type with the name, or INVALID if it's not a primitive type name
+PrimitiveType parse_primitive_type(const std::string &name)
+{
+    if (name == "INT") {
+        return PrimitiveType::INT;
+    } else if (name == "UINT") {
+        return PrimitiveType::UINT;
+    } else if (name == "FLOAT") {
+        return PrimitiveType::FLOAT;
+    } else if (name == "DOUBLE") {
+        return PrimitiveType::DOUBLE;
+    } else if (name == "HALF") {
+        return PrimitiveType::HALF;
+    } else if (name == "INT16") {
+        return PrimitiveType::INT16;
+    } else if (name == "UINT16") {
+        return PrimitiveType::UINT16;
+    }
+    return PrimitiveType::INVALID;
+}
+
+// Check if the type string names a primitive, vector or matrix type, or a user defined struct
+bool is_builtin_type_name(const std::string &type_str)
+{
+    std::string name;
+    std::string dims_str;
+    split_type_name(type_str, name, dims_str);
+    return valid_dimensions(dims_str) &&
+           (name == "BOOL" || parse_primitive_type(name) != PrimitiveType::INVALID);
+}
+
 std::shared_ptr<Type> parse_type(const std::string &type_str)
 {
     if (type_str == "ACCELERATION_STRUCTURE") {
@@ -54,59 +114,38 @@ std::shared_ptr<Type> parse_type(const std::string &type_str)
         auto element_type = parse_template_element_type(type_str);
         uint32_t dimensionality = type_str[access == Access::READ_WRITE ? 9 : 7] - '0';
         return std::make_shared<Texture>(element_type, access, dimensionality);
+    } else if (type_str == "OCT32") {
+        return std::make_shared<Quantized>(CRTL_DATA_TYPE_OCT32);
+    } else if (type_str == "UNORM16_2") {
+        return std::make_shared<Quantized>(CRTL_DATA_TYPE_UNORM16_2);
+    } else if (type_str == "SNORM16_3") {
+        return std::make_shared<Quantized>(CRTL_DATA_TYPE_SNORM16_3);
+    } else if (!is_builtin_type_name(type_str)) {
+        return std::make_shared<Struct>(type_str);
     }
 
     // It's either a matrix, vector or primitive type, so now try to read its
     // dimensionality to figure out which one
+    std::string name;
+    std::string dims_str;
+    split_type_name(type_str, name, dims_str);
+    const PrimitiveType primitive_type = parse_primitive_type(name);
+    if (primitive_type == PrimitiveType::INVALID) {
+        return nullptr;
+    }
+
     uint32_t dim_0 = 0;
     uint32_t dim_1 = 0;
-    parse_vector_matrix_dimensionality(type_str, dim_0, dim_1);
-    if (type_str[0] == 'U') {
-        // If both are non-zero it's a matrix
-        if (dim_0 != 0 && dim_1 != 0) {
-            return std::make_shared<Matrix>(PrimitiveType::UINT, dim_0, dim_1);
-        } else if (dim_0 != 0) {
-            // dim_0 != 0, it's a vector
-            return std::make_shared<Vector>(PrimitiveType::UINT, dim_0);
-        } else {
-            // it's a single primitive
-            return std::make_shared<Primitive>(PrimitiveType::UINT);
-        }
-    } else if (type_str[0] == 'I') {
-        // If both are non-zero it's a matrix
-        if (dim_0 != 0 && dim_1 != 0) {
-            return std::make_shared<Matrix>(PrimitiveType::INT, dim_0, dim_1);
-        } else if (dim_0 != 0) {
-            // dim_0 != 0, it's a vector
-            return std::make_shared<Vector>(PrimitiveType::INT, dim_0);
-        } else {
-            // it's a single primitive
-            return std::make_shared<Primitive>(PrimitiveType::INT);
-        }
-    } else if (type_str[0] == 'F') {
-        // If both are non-zero it's a matrix
-        if (dim_0 != 0 && dim_1 != 0) {
-            return std::make_shared<Matrix>(PrimitiveType::FLOAT, dim_0, dim_1);
-        } else if (dim_0 != 0) {
-            // dim_0 != 0, it's a vector
-            return std::make_shared<Vector>(PrimitiveType::FLOAT, dim_0);
-        } else {
-            // it's a single primitive
-            return std::make_shared<Primitive>(PrimitiveType::FLOAT);
-        }
-    } else if (type_str[0] == 'D') {
-        // If both are non-zero it's a matrix
-        if (dim_0 != 0 && dim_1 != 0) {
-            return std::make_shared<Matrix>(PrimitiveType::DOUBLE, dim_0, dim_1);
-        } else if (dim_0 != 0) {
-            // dim_0 != 0, it's a vector
-            return std::make_shared<Vector>(PrimitiveType::DOUBLE, dim_0);
-        } else {
-            // it's a single primitive
-            return std::make_shared<Primitive>(PrimitiveType::DOUBLE);
-        }
+    parse_vector_matrix_dimensionality(dims_str, dim_0, dim_1);
+    // If both are non-zero it's a matrix
+    if (dim_0 != 0 && dim_1 != 0) {
+        return std::make_shared<Matrix>(primitive_type, dim_0, dim_1);
+    } else if (dim_0 != 0) {
+        // dim_0 != 0, it's a vector
+        return std::make_shared<Vector>(primitive_type, dim_0);
     }
-    return nullptr;
+    // it's a single primitive
+    return std::make_shared<Primitive>(primitive_type);
 }
 
 Primitive::Primitive(const PrimitiveType primitive_type)
@@ -125,6 +164,12 @@ CRTL_DATA_TYPE Primitive::data_type() const
         return CRTL_DATA_TYPE_FLOAT;
     case PrimitiveType::DOUBLE:
         return CRTL_DATA_TYPE_DOUBLE;
+    case PrimitiveType::HALF:
+        return CRTL_DATA_TYPE_HALF;
+    case PrimitiveType::INT16:
+        return CRTL_DATA_TYPE_INT16;
+    case PrimitiveType::UINT16:
+        return CRTL_DATA_TYPE_UINT16;
     default:
         return CRTL_DATA_TYPE_UNKNOWN;
     }
@@ -139,6 +184,10 @@ size_t Primitive::size() const
         return 4;
     case PrimitiveType::DOUBLE:
         return 8;
+    case PrimitiveType::HALF:
+    case PrimitiveType::INT16:
+    case PrimitiveType::UINT16:
+        return 2;
     default:
         return 0;
     }
@@ -196,6 +245,39 @@ CRTL_DATA_TYPE Vector::data_type() const
         default:
             return CRTL_DATA_TYPE_UNKNOWN;
         }
+    case PrimitiveType::HALF:
+        switch (dimensionality) {
+        case 2:
+            return CRTL_DATA_TYPE_HALF2;
+        case 3:
+            return CRTL_DATA_TYPE_HALF3;
+        case 4:
+            return CRTL_DATA_TYPE_HALF4;
+        default:
+            return CRTL_DATA_TYPE_UNKNOWN;
+        }
+    case PrimitiveType::INT16:
+        switch (dimensionality) {
+        case 2:
+            return CRTL_DATA_TYPE_INT16_2;
+        case 3:
+            return CRTL_DATA_TYPE_INT16_3;
+        case 4:
+            return CRTL_DATA_TYPE_INT16_4;
+        default:
+            return CRTL_DATA_TYPE_UNKNOWN;
+        }
+    case PrimitiveType::UINT16:
+        switch (dimensionality) {
+        case 2:
+            return CRTL_DATA_TYPE_UINT16_2;
+        case 3:
+            return CRTL_DATA_TYPE_UINT16_3;
+        case 4:
+            return CRTL_DATA_TYPE_UINT16_4;
+        default:
+            return CRTL_DATA_TYPE_UNKNOWN;
+        }
     }
     return CRTL_DATA_TYPE_UNKNOWN;
 }
@@ -433,6 +515,171 @@ CRTL_DATA_TYPE Matrix::data_type() const
         default:
             return CRTL_DATA_TYPE_UNKNOWN;
         }
+    case PrimitiveType::HALF:
+        switch (dim_0) {
+        case 1:
+            switch (dim_1) {
+            case 2:
+                return CRTL_DATA_TYPE_HALF1X2;
+            case 3:
+                return CRTL_DATA_TYPE_HALF1X3;
+            case 4:
+                return CRTL_DATA_TYPE_HALF1X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        case 2:
+            switch (dim_1) {
+            case 1:
+                return CRTL_DATA_TYPE_HALF2X1;
+            case 2:
+                return CRTL_DATA_TYPE_HALF2X2;
+            case 3:
+                return CRTL_DATA_TYPE_HALF2X3;
+            case 4:
+                return CRTL_DATA_TYPE_HALF2X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        case 3:
+            switch (dim_1) {
+            case 1:
+                return CRTL_DATA_TYPE_HALF3X1;
+            case 2:
+                return CRTL_DATA_TYPE_HALF3X2;
+            case 3:
+                return CRTL_DATA_TYPE_HALF3X3;
+            case 4:
+                return CRTL_DATA_TYPE_HALF3X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        case 4:
+            switch (dim_1) {
+            case 1:
+                return CRTL_DATA_TYPE_HALF4X1;
+            case 2:
+                return CRTL_DATA_TYPE_HALF4X2;
+            case 3:
+                return CRTL_DATA_TYPE_HALF4X3;
+            case 4:
+                return CRTL_DATA_TYPE_HALF4X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        default:
+            return CRTL_DATA_TYPE_UNKNOWN;
+        }
+    case PrimitiveType::INT16:
+        switch (dim_0) {
+        case 1:
+            switch (dim_1) {
+            case 2:
+                return CRTL_DATA_TYPE_INT16_1X2;
+            case 3:
+                return CRTL_DATA_TYPE_INT16_1X3;
+            case 4:
+                return CRTL_DATA_TYPE_INT16_1X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        case 2:
+            switch (dim_1) {
+            case 1:
+                return CRTL_DATA_TYPE_INT16_2X1;
+            case 2:
+                return CRTL_DATA_TYPE_INT16_2X2;
+            case 3:
+                return CRTL_DATA_TYPE_INT16_2X3;
+            case 4:
+                return CRTL_DATA_TYPE_INT16_2X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        case 3:
+            switch (dim_1) {
+            case 1:
+                return CRTL_DATA_TYPE_INT16_3X1;
+            case 2:
+                return CRTL_DATA_TYPE_INT16_3X2;
+            case 3:
+                return CRTL_DATA_TYPE_INT16_3X3;
+            case 4:
+                return CRTL_DATA_TYPE_INT16_3X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        case 4:
+            switch (dim_1) {
+            case 1:
+                return CRTL_DATA_TYPE_INT16_4X1;
+            case 2:
+                return CRTL_DATA_TYPE_INT16_4X2;
+            case 3:
+                return CRTL_DATA_TYPE_INT16_4X3;
+            case 4:
+                return CRTL_DATA_TYPE_INT16_4X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        default:
+            return CRTL_DATA_TYPE_UNKNOWN;
+        }
+    case PrimitiveType::UINT16:
+        switch (dim_0) {
+        case 1:
+            switch (dim_1) {
+            case 2:
+                return CRTL_DATA_TYPE_UINT16_1X2;
+            case 3:
+                return CRTL_DATA_TYPE_UINT16_1X3;
+            case 4:
+                return CRTL_DATA_TYPE_UINT16_1X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        case 2:
+            switch (dim_1) {
+            case 1:
+                return CRTL_DATA_TYPE_UINT16_2X1;
+            case 2:
+                return CRTL_DATA_TYPE_UINT16_2X2;
+            case 3:
+                return CRTL_DATA_TYPE_UINT16_2X3;
+            case 4:
+                return CRTL_DATA_TYPE_UINT16_2X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        case 3:
+            switch (dim_1) {
+            case 1:
+                return CRTL_DATA_TYPE_UINT16_3X1;
+            case 2:
+                return CRTL_DATA_TYPE_UINT16_3X2;
+            case 3:
+                return CRTL_DATA_TYPE_UINT16_3X3;
+            case 4:
+                return CRTL_DATA_TYPE_UINT16_3X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        case 4:
+            switch (dim_1) {
+            case 1:
+                return CRTL_DATA_TYPE_UINT16_4X1;
+            case 2:
+                return CRTL_DATA_TYPE_UINT16_4X2;
+            case 3:
+                return CRTL_DATA_TYPE_UINT16_4X3;
+            case 4:
+                return CRTL_DATA_TYPE_UINT16_4X4;
+            default:
+                return CRTL_DATA_TYPE_UNKNOWN;
+            }
+        default:
+            return CRTL_DATA_TYPE_UNKNOWN;
+        }
     default:
         return CRTL_DATA_TYPE_UNKNOWN;
     }
@@ -443,6 +690,32 @@ size_t Matrix::size() const
     return dim_0 * dim_1 * element_type.size();
 }
 
+Struct::Struct(const std::string &name) : Type(BaseType::STRUCT), name(name) {}
+
+CRTL_DATA_TYPE Struct::data_type() const
+{
+    return CRTL_DATA_TYPE_STRUCT;
+}
+
+size_t Struct::size() const
+{
+    return stride;
+}
+
+Quantized::Quantized(const CRTL_DATA_TYPE format) : Type(BaseType::QUANTIZED), format(format)
+{
+}
+
+CRTL_DATA_TYPE Quantized::data_type() const
+{
+    return format;
+}
+
+size_t Quantized::size() const
+{
+    return format == CRTL_DATA_TYPE_SNORM16_3 ? 6 : 4;
+}
+
 BufferView::BufferView(const std::shared_ptr<Type> &element_type, const Access &access)
     : Type(BaseType::BUFFER_VIEW), element_type(element_type), access(access)
 {
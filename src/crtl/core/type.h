@@ -16,8 +16,10 @@ enum class BaseType {
     PRIMITIVE,
     VECTOR,
     MATRIX,
-    // TODO: struct is more challenging to handle b/c of alignment differences..
-    // STRUCT,
+    // Structs can only be used as buffer elements, with the layout computed by the compiler
+    STRUCT,
+    // Quantized formats can only be used as buffer elements, they're decoded by the shader
+    QUANTIZED,
     BUFFER_VIEW,
     TEXTURE,
     ACCELERATION_STRUCTURE,
@@ -33,6 +35,9 @@ enum class PrimitiveType {
     UINT,
     FLOAT,
     DOUBLE,
+    HALF,
+    INT16,
+    UINT16,
 };
 
 enum class Access {
@@ -93,10 +98,36 @@ public:
     size_t size() const override;
 };
 
+/* A user defined struct stored in a buffer. The type string only names the struct, its
+ * stride is filled in from the layout the compiler computed for the target and output in the
+ * parameter metadata
+ */
+class CRTL_EXPORT Struct : public Type {
+public:
+    std::string name;
+    size_t stride = 0;
+
+    Struct(const std::string &name);
+
+    CRTL_DATA_TYPE data_type() const override;
+
+    size_t size() const override;
+};
+
+// A quantized buffer element format, the type string is the format's name, e.g. OCT32
+class CRTL_EXPORT Quantized : public Type {
+public:
+    CRTL_DATA_TYPE format;
+
+    Quantized(const CRTL_DATA_TYPE format);
+
+    CRTL_DATA_TYPE data_type() const override;
+
+    size_t size() const override;
+};
+
 class CRTL_EXPORT BufferView : public Type {
 public:
-    // TODO: Maybe some struct in buffer support? Handling the alignment may be tricky,
-    // could use the scalar buffer in Vulkan and maybe byte address buffer in DXR?
     std::shared_ptr<Type> element_type;
     Access access;
 
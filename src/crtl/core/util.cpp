@@ -1,12 +1,32 @@
 #include <algorithm>
 #include <array>
+#include <cfloat>
+#include <cmath>
 #include <codecvt>
 #include <locale>
+#include <cstring>
 #ifdef _WIN32
 #include <intrin.h>
 #elif not defined(__aarch64__)
 #include <cpuid.h>
 #endif
+#if defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CRTL_NEON
+#define CRTL_NEON_F16
+#elif defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+// SSE2 is part of x86-64, so the quantization encoders use it without checking for it
+#define CRTL_X86_SSE2
+#define CRTL_X86_F16C
+// F16C is checked for at runtime, so the conversion functions are compiled for it without
+// requiring it for the rest of the library
+#ifdef _MSC_VER
+#define CRTL_F16C_TARGET
+#else
+#define CRTL_F16C_TARGET __attribute__((target("avx,f16c")))
+#endif
+#endif
 #include <glm/ext.hpp>
 #include "util.h"
 
@@ -256,6 +276,106 @@ CRTL_EXPORT size_t data_type_size(CRTL_DATA_TYPE type)
     case CRTL_DATA_TYPE_DOUBLE4X4:
         return 128;
 
+    // 16-bit types
+    case CRTL_DATA_TYPE_HALF:
+    case CRTL_DATA_TYPE_INT16:
+    case CRTL_DATA_TYPE_UINT16:
+        return 2;
+
+    case CRTL_DATA_TYPE_HALF2:
+    case CRTL_DATA_TYPE_HALF2X1:
+    case CRTL_DATA_TYPE_HALF1X2:
+
+    case CRTL_DATA_TYPE_INT16_2:
+    case CRTL_DATA_TYPE_INT16_2X1:
+    case CRTL_DATA_TYPE_INT16_1X2:
+
+    case CRTL_DATA_TYPE_UINT16_2:
+    case CRTL_DATA_TYPE_UINT16_2X1:
+    case CRTL_DATA_TYPE_UINT16_1X2:
+        return 4;
+
+    case CRTL_DATA_TYPE_HALF3:
+    case CRTL_DATA_TYPE_HALF3X1:
+    case CRTL_DATA_TYPE_HALF1X3:
+
+    case CRTL_DATA_TYPE_INT16_3:
+    case CRTL_DATA_TYPE_INT16_3X1:
+    case CRTL_DATA_TYPE_INT16_1X3:
+
+    case CRTL_DATA_TYPE_UINT16_3:
+    case CRTL_DATA_TYPE_UINT16_3X1:
+    case CRTL_DATA_TYPE_UINT16_1X3:
+        return 6;
+
+    case CRTL_DATA_TYPE_HALF4:
+    case CRTL_DATA_TYPE_HALF4X1:
+    case CRTL_DATA_TYPE_HALF2X2:
+    case CRTL_DATA_TYPE_HALF1X4:
+
+    case CRTL_DATA_TYPE_INT16_4:
+    case CRTL_DATA_TYPE_INT16_4X1:
+    case CRTL_DATA_TYPE_INT16_2X2:
+    case CRTL_DATA_TYPE_INT16_1X4:
+
+    case CRTL_DATA_TYPE_UINT16_4:
+    case CRTL_DATA_TYPE_UINT16_4X1:
+    case CRTL_DATA_TYPE_UINT16_2X2:
+    case CRTL_DATA_TYPE_UINT16_1X4:
+        return 8;
+
+    case CRTL_DATA_TYPE_HALF3X2:
+    case CRTL_DATA_TYPE_HALF2X3:
+
+    case CRTL_DATA_TYPE_INT16_3X2:
+    case CRTL_DATA_TYPE_INT16_2X3:
+
+    case CRTL_DATA_TYPE_UINT16_3X2:
+    case CRTL_DATA_TYPE_UINT16_2X3:
+        return 12;
+
+    case CRTL_DATA_TYPE_HALF4X2:
+    case CRTL_DATA_TYPE_HALF2X4:
+
+    case CRTL_DATA_TYPE_INT16_4X2:
+    case CRTL_DATA_TYPE_INT16_2X4:
+
+    case CRTL_DATA_TYPE_UINT16_4X2:
+    case CRTL_DATA_TYPE_UINT16_2X4:
+        return 16;
+
+    case CRTL_DATA_TYPE_HALF3X3:
+
+    case CRTL_DATA_TYPE_INT16_3X3:
+
+    case CRTL_DATA_TYPE_UINT16_3X3:
+        return 18;
+
+    case CRTL_DATA_TYPE_HALF4X3:
+    case CRTL_DATA_TYPE_HALF3X4:
+
+    case CRTL_DATA_TYPE_INT16_4X3:
+    case CRTL_DATA_TYPE_INT16_3X4:
+
+    case CRTL_DATA_TYPE_UINT16_4X3:
+    case CRTL_DATA_TYPE_UINT16_3X4:
+        return 24;
+
+    case CRTL_DATA_TYPE_HALF4X4:
+
+    case CRTL_DATA_TYPE_INT16_4X4:
+
+    case CRTL_DATA_TYPE_UINT16_4X4:
+        return 32;
+
+    // Quantized types
+    case CRTL_DATA_TYPE_OCT32:
+    case CRTL_DATA_TYPE_UNORM16_2:
+        return 4;
+
+    case CRTL_DATA_TYPE_SNORM16_3:
+        return 6;
+
     case CRTL_DATA_TYPE_BUFFER:
     case CRTL_DATA_TYPE_RWBUFFER:
     case CRTL_DATA_TYPE_TEXTURE:
@@ -266,4 +386,407 @@ CRTL_EXPORT size_t data_type_size(CRTL_DATA_TYPE type)
         return 0;
     }
 }
+
+CRTL_EXPORT uint16_t f32_to_f16(const float x)
+{
+    // Based on the branchy conversion by Fabian Giesen, rounding to nearest even
+    const uint32_t f16_max = (127 + 16) << 23;
+    const uint32_t denorm_magic = ((127 - 15) + (23 - 10) + 1) << 23;
+    uint32_t bits = 0;
+    std::memcpy(&bits, &x, sizeof(float));
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t result = 0;
+    if (bits >= f16_max) {
+        // Inf or NaN, NaNs are quieted
+        result = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+    } else if (bits < (113u << 23)) {
+        // Denormals and zero, adding the magic number shifts the mantissa into place and
+        // rounds it with the float addition
+        float f = 0.f;
+        float magic = 0.f;
+        std::memcpy(&f, &bits, sizeof(float));
+        std::memcpy(&magic, &denorm_magic, sizeof(float));
+        f += magic;
+        std::memcpy(&bits, &f, sizeof(float));
+        result = bits - denorm_magic;
+    } else {
+        // Rebias the exponent and round the mantissa to nearest even
+        const uint32_t mantissa_odd = (bits >> 13) & 1;
+        bits += (uint32_t(15 - 127) << 23) + 0xfff + mantissa_odd;
+        result = bits >> 13;
+    }
+    return result | (sign >> 16);
+}
+
+CRTL_EXPORT float f16_to_f32(const uint16_t x)
+{
+    const uint32_t shifted_exp = 0x7c00u << 13;
+    uint32_t bits = (x & 0x7fffu) << 13;
+    const uint32_t exp = shifted_exp & bits;
+    // Rebias the exponent
+    bits += (127 - 15) << 23;
+    if (exp == shifted_exp) {
+        // Inf or NaN, rebias the exponent again to the max float exponent
+        bits += (128 - 16) << 23;
+    } else if (exp == 0) {
+        // Denormals and zero, renormalize with a float subtraction
+        const uint32_t magic_bits = 113u << 23;
+        float f = 0.f;
+        float magic = 0.f;
+        bits += 1 << 23;
+        std::memcpy(&f, &bits, sizeof(float));
+        std::memcpy(&magic, &magic_bits, sizeof(float));
+        f -= magic;
+        std::memcpy(&bits, &f, sizeof(float));
+    }
+    bits |= uint32_t(x & 0x8000u) << 16;
+    float result = 0.f;
+    std::memcpy(&result, &bits, sizeof(float));
+    return result;
+}
+
+#ifdef CRTL_X86_F16C
+bool has_f16c()
+{
+    static const bool f16c = []() {
+        std::array<int32_t, 4> regs;
+#ifdef _WIN32
+        __cpuid(regs.data(), 1);
+#else
+        __cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        // F16C is reported in bit 29 of ECX
+        return (regs[2] & (1 << 29)) != 0;
+    }();
+    return f16c;
+}
+
+CRTL_F16C_TARGET size_t f32_to_f16_f16c(const float *in, uint16_t *out, const size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), h);
+    }
+    return i;
+}
+
+CRTL_F16C_TARGET size_t f16_to_f32_f16c(const uint16_t *in, float *out, const size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+    }
+    return i;
+}
+#endif
+
+CRTL_EXPORT void f32_to_f16(const float *in, uint16_t *out, const size_t n)
+{
+    // The vectorized conversions handle the multiples of the vector width, and the
+    // remaining values are converted one at a time
+    size_t i = 0;
+#if defined(CRTL_NEON_F16)
+    for (; i + 4 <= n; i += 4) {
+        vst1_u16(out + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in + i))));
+    }
+#elif defined(CRTL_X86_F16C)
+    if (has_f16c()) {
+        i = f32_to_f16_f16c(in, out, n);
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = f32_to_f16(in[i]);
+    }
+}
+
+CRTL_EXPORT void f16_to_f32(const uint16_t *in, float *out, const size_t n)
+{
+    size_t i = 0;
+#if defined(CRTL_NEON_F16)
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(in + i))));
+    }
+#elif defined(CRTL_X86_F16C)
+    if (has_f16c()) {
+        i = f16_to_f32_f16c(in, out, n);
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = f16_to_f32(in[i]);
+    }
+}
+
+// Encode the unit vector in octahedral coordinates, matching the HLSL pack_octahedral builtin
+uint32_t encode_oct32(const float x, const float y, const float z)
+{
+    const float l1 = std::max(std::abs(x) + std::abs(y) + std::abs(z), FLT_MIN);
+    float px = x / l1;
+    float py = y / l1;
+    // Fold the lower hemisphere over the diagonals
+    if (z < 0.f) {
+        const float fx = (1.f - std::abs(py)) * (px >= 0.f ? 1.f : -1.f);
+        py = (1.f - std::abs(px)) * (py >= 0.f ? 1.f : -1.f);
+        px = fx;
+    }
+    const int32_t qx = int32_t(std::nearbyint(std::clamp(px, -1.f, 1.f) * 32767.f)) + 32767;
+    const int32_t qy = int32_t(std::nearbyint(std::clamp(py, -1.f, 1.f) * 32767.f)) + 32767;
+    return uint32_t(qx) | (uint32_t(qy) << 16);
+}
+
+#ifdef CRTL_X86_SSE2
+// Load 4 xyz vectors and transpose them into a register of each component
+void load_xyz4(const float *in, __m128 &x, __m128 &y, __m128 &z)
+{
+    // x0 y0 z0 x1, y1 z1 x2 y2, z2 x3 y3 z3
+    const __m128 a = _mm_loadu_ps(in);
+    const __m128 b = _mm_loadu_ps(in + 4);
+    const __m128 c = _mm_loadu_ps(in + 8);
+    x = _mm_shuffle_ps(
+        a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+                       _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+                       _MM_SHUFFLE(2, 0, 2, 0));
+    z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+                       _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+                       _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+__m128 select_ps(const __m128 mask, const __m128 a, const __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+CRTL_EXPORT void encode_oct32(const float *in, uint32_t *out, const size_t n)
+{
+    size_t i = 0;
+#if defined(CRTL_NEON)
+    const float32x4_t one = vdupq_n_f32(1.f);
+    const float32x4_t minus_one = vdupq_n_f32(-1.f);
+    const float32x4_t zero = vdupq_n_f32(0.f);
+    for (; i + 4 <= n; i += 4) {
+        const float32x4x3_t v = vld3q_f32(in + i * 3);
+        const float32x4_t sum = vaddq_f32(vabsq_f32(v.val[0]), vabsq_f32(v.val[1]));
+        const float32x4_t l1 =
+            vmaxq_f32(vaddq_f32(sum, vabsq_f32(v.val[2])), vdupq_n_f32(FLT_MIN));
+        float32x4_t px = vdivq_f32(v.val[0], l1);
+        float32x4_t py = vdivq_f32(v.val[1], l1);
+        const float32x4_t fx = vmulq_f32(vsubq_f32(one, vabsq_f32(py)),
+                                         vbslq_f32(vcgeq_f32(px, zero), one, minus_one));
+        const float32x4_t fy = vmulq_f32(vsubq_f32(one, vabsq_f32(px)),
+                                         vbslq_f32(vcgeq_f32(py, zero), one, minus_one));
+        const uint32x4_t lower = vcltq_f32(v.val[2], zero);
+        px = vminq_f32(vmaxq_f32(vbslq_f32(lower, fx, px), minus_one), one);
+        py = vminq_f32(vmaxq_f32(vbslq_f32(lower, fy, py), minus_one), one);
+        const int32x4_t bias = vdupq_n_s32(32767);
+        const uint32x4_t qx = vreinterpretq_u32_s32(
+            vaddq_s32(vcvtnq_s32_f32(vmulq_n_f32(px, 32767.f)), bias));
+        const uint32x4_t qy = vreinterpretq_u32_s32(
+            vaddq_s32(vcvtnq_s32_f32(vmulq_n_f32(py, 32767.f)), bias));
+        vst1q_u32(out + i, vorrq_u32(qx, vshlq_n_u32(qy, 16)));
+    }
+#elif defined(CRTL_X86_SSE2)
+    const __m128 sign_mask = _mm_set1_ps(-0.f);
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 minus_one = _mm_set1_ps(-1.f);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        __m128 x, y, z;
+        load_xyz4(in + i * 3, x, y, z);
+        const __m128 l1 = _mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_andnot_ps(sign_mask, x),
+                                                           _mm_andnot_ps(sign_mask, y)),
+                                                _mm_andnot_ps(sign_mask, z)),
+                                     _mm_set1_ps(FLT_MIN));
+        __m128 px = _mm_div_ps(x, l1);
+        __m128 py = _mm_div_ps(y, l1);
+        const __m128 fx = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, py)),
+                                     select_ps(_mm_cmpge_ps(px, zero), one, minus_one));
+        const __m128 fy = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, px)),
+                                     select_ps(_mm_cmpge_ps(py, zero), one, minus_one));
+        const __m128 lower = _mm_cmplt_ps(z, zero);
+        px = _mm_min_ps(_mm_max_ps(select_ps(lower, fx, px), minus_one), one);
+        py = _mm_min_ps(_mm_max_ps(select_ps(lower, fy, py), minus_one), one);
+        const __m128i bias = _mm_set1_epi32(32767);
+        const __m128i qx =
+            _mm_add_epi32(_mm_cvtps_epi32(_mm_mul_ps(px, _mm_set1_ps(32767.f))), bias);
+        const __m128i qy =
+            _mm_add_epi32(_mm_cvtps_epi32(_mm_mul_ps(py, _mm_set1_ps(32767.f))), bias);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                         _mm_or_si128(qx, _mm_slli_epi32(qy, 16)));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = encode_oct32(in[i * 3], in[i * 3 + 1], in[i * 3 + 2]);
+    }
+}
+
+CRTL_EXPORT void encode_unorm16_2(const float *in, uint16_t *out, const size_t n)
+{
+    // The uvs are encoded as a flat array of 2n values, 8 at a time
+    size_t i = 0;
+#if defined(CRTL_NEON)
+    for (; i + 8 <= n * 2; i += 8) {
+        const float32x4_t a = vminq_f32(vmaxq_f32(vld1q_f32(in + i), vdupq_n_f32(0.f)),
+                                        vdupq_n_f32(1.f));
+        const float32x4_t b = vminq_f32(vmaxq_f32(vld1q_f32(in + i + 4), vdupq_n_f32(0.f)),
+                                        vdupq_n_f32(1.f));
+        const uint16x4_t qa = vqmovn_u32(vcvtnq_u32_f32(vmulq_n_f32(a, 65535.f)));
+        const uint16x4_t qb = vqmovn_u32(vcvtnq_u32_f32(vmulq_n_f32(b, 65535.f)));
+        vst1q_u16(out + i, vcombine_u16(qa, qb));
+    }
+#elif defined(CRTL_X86_SSE2)
+    // SSE2 only has a signed saturating pack, so the values are offset into the int16 range
+    // before packing and back after
+    const __m128i offset_32 = _mm_set1_epi32(32768);
+    const __m128i offset_16 = _mm_set1_epi16(-32768);
+    for (; i + 8 <= n * 2; i += 8) {
+        const __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), _mm_setzero_ps()),
+                                    _mm_set1_ps(1.f));
+        const __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), _mm_setzero_ps()),
+                                    _mm_set1_ps(1.f));
+        const __m128i qa =
+            _mm_sub_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, _mm_set1_ps(65535.f))), offset_32);
+        const __m128i qb =
+            _mm_sub_epi32(_mm_cvtps_epi32(_mm_mul_ps(b, _mm_set1_ps(65535.f))), offset_32);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                         _mm_xor_si128(_mm_packs_epi32(qa, qb), offset_16));
+    }
+#endif
+    for (; i < n * 2; ++i) {
+        // NaNs are encoded as 0, matching the vectorized encoders
+        out[i] = uint16_t(std::nearbyint(std::min(std::max(0.f, in[i]), 1.f) * 65535.f));
+    }
+}
+
+CRTL_EXPORT size_t snorm16_3_elements(const size_t n)
+{
+    // The float3 scale and bias take 24 bytes, or 4 elements
+    return n + 4;
+}
+
+// Compute the bounds of the n xyz positions
+void position_bounds(const float *in, const size_t n, float *lower, float *upper)
+{
+    // The vectorized loops read 4 positions at a time, so each lane of the 3 registers
+    // holds the same component of every block: x y z x, y z x y, z x y z
+    std::array<float, 12> block_lower;
+    std::array<float, 12> block_upper;
+    block_lower.fill(FLT_MAX);
+    block_upper.fill(-FLT_MAX);
+    size_t i = 0;
+#if defined(CRTL_NEON)
+    float32x4_t lo[3] = {vdupq_n_f32(FLT_MAX), vdupq_n_f32(FLT_MAX), vdupq_n_f32(FLT_MAX)};
+    float32x4_t hi[3] = {vdupq_n_f32(-FLT_MAX), vdupq_n_f32(-FLT_MAX), vdupq_n_f32(-FLT_MAX)};
+    for (; i + 12 <= n * 3; i += 12) {
+        for (size_t j = 0; j < 3; ++j) {
+            const float32x4_t v = vld1q_f32(in + i + j * 4);
+            lo[j] = vminq_f32(lo[j], v);
+            hi[j] = vmaxq_f32(hi[j], v);
+        }
+    }
+    for (size_t j = 0; j < 3; ++j) {
+        vst1q_f32(block_lower.data() + j * 4, lo[j]);
+        vst1q_f32(block_upper.data() + j * 4, hi[j]);
+    }
+#elif defined(CRTL_X86_SSE2)
+    __m128 lo[3] = {_mm_set1_ps(FLT_MAX), _mm_set1_ps(FLT_MAX), _mm_set1_ps(FLT_MAX)};
+    __m128 hi[3] = {_mm_set1_ps(-FLT_MAX), _mm_set1_ps(-FLT_MAX), _mm_set1_ps(-FLT_MAX)};
+    for (; i + 12 <= n * 3; i += 12) {
+        for (size_t j = 0; j < 3; ++j) {
+            const __m128 v = _mm_loadu_ps(in + i + j * 4);
+            lo[j] = _mm_min_ps(lo[j], v);
+            hi[j] = _mm_max_ps(hi[j], v);
+        }
+    }
+    for (size_t j = 0; j < 3; ++j) {
+        _mm_storeu_ps(block_lower.data() + j * 4, lo[j]);
+        _mm_storeu_ps(block_upper.data() + j * 4, hi[j]);
+    }
+#endif
+    for (size_t c = 0; c < 3; ++c) {
+        lower[c] = FLT_MAX;
+        upper[c] = -FLT_MAX;
+    }
+    for (size_t j = 0; j < block_lower.size(); ++j) {
+        lower[j % 3] = std::min(lower[j % 3], block_lower[j]);
+        upper[j % 3] = std::max(upper[j % 3], block_upper[j]);
+    }
+    for (; i < n * 3; ++i) {
+        lower[i % 3] = std::min(lower[i % 3], in[i]);
+        upper[i % 3] = std::max(upper[i % 3], in[i]);
+    }
+}
+
+CRTL_EXPORT void encode_snorm16_3(const float *in, int16_t *out, const size_t n)
+{
+    // The snorms are decoded as snorm * scale + bias, mapping [-1, 1] to the bounds
+    std::array<float, 3> scale = {0.f, 0.f, 0.f};
+    std::array<float, 3> bias = {0.f, 0.f, 0.f};
+    std::array<float, 3> inv_scale = {0.f, 0.f, 0.f};
+    if (n > 0) {
+        std::array<float, 3> lower;
+        std::array<float, 3> upper;
+        position_bounds(in, n, lower.data(), upper.data());
+        for (size_t c = 0; c < 3; ++c) {
+            scale[c] = (upper[c] - lower[c]) * 0.5f;
+            bias[c] = (upper[c] + lower[c]) * 0.5f;
+            // Flat axes encode every position as 0, which decodes to the bias
+            inv_scale[c] = scale[c] > 0.f ? 1.f / scale[c] : 0.f;
+        }
+    }
+    std::memcpy(out, scale.data(), sizeof(scale));
+    std::memcpy(out + 6, bias.data(), sizeof(bias));
+    out += 12;
+
+    // The positions are encoded as a flat array of 3n values, 12 at a time with the
+    // registers holding the components x y z x, y z x y, z x y z
+    size_t i = 0;
+#if defined(CRTL_NEON)
+    float32x4_t block_bias[3];
+    float32x4_t block_inv_scale[3];
+    for (size_t j = 0; j < 3; ++j) {
+        const float b[4] = {bias[j], bias[(j + 1) % 3], bias[(j + 2) % 3], bias[j]};
+        const float s[4] = {
+            inv_scale[j], inv_scale[(j + 1) % 3], inv_scale[(j + 2) % 3], inv_scale[j]};
+        block_bias[j] = vld1q_f32(b);
+        block_inv_scale[j] = vld1q_f32(s);
+    }
+    for (; i + 12 <= n * 3; i += 12) {
+        for (size_t j = 0; j < 3; ++j) {
+            const float32x4_t v = vmulq_f32(
+                vsubq_f32(vld1q_f32(in + i + j * 4), block_bias[j]), block_inv_scale[j]);
+            const float32x4_t t = vminq_f32(vmaxq_f32(v, vdupq_n_f32(-1.f)), vdupq_n_f32(1.f));
+            vst1_s16(out + i + j * 4, vqmovn_s32(vcvtnq_s32_f32(vmulq_n_f32(t, 32767.f))));
+        }
+    }
+#elif defined(CRTL_X86_SSE2)
+    __m128 block_bias[3];
+    __m128 block_inv_scale[3];
+    for (size_t j = 0; j < 3; ++j) {
+        block_bias[j] = _mm_setr_ps(bias[j], bias[(j + 1) % 3], bias[(j + 2) % 3], bias[j]);
+        block_inv_scale[j] = _mm_setr_ps(
+            inv_scale[j], inv_scale[(j + 1) % 3], inv_scale[(j + 2) % 3], inv_scale[j]);
+    }
+    for (; i + 12 <= n * 3; i += 12) {
+        __m128i q[3];
+        for (size_t j = 0; j < 3; ++j) {
+            const __m128 p = _mm_loadu_ps(in + i + j * 4);
+            const __m128 v = _mm_mul_ps(_mm_sub_ps(p, block_bias[j]), block_inv_scale[j]);
+            const __m128 t = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-1.f)), _mm_set1_ps(1.f));
+            q[j] = _mm_cvtps_epi32(_mm_mul_ps(t, _mm_set1_ps(32767.f)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(q[0], q[1]));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i + 8),
+                         _mm_packs_epi32(q[2], q[2]));
+    }
+#endif
+    for (; i < n * 3; ++i) {
+        const float t = (in[i] - bias[i % 3]) * inv_scale[i % 3];
+        out[i] = int16_t(std::nearbyint(std::clamp(t, -1.f, 1.f) * 32767.f));
+    }
+}
 }
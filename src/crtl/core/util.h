@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <glm/glm.hpp>
 #include "crtl/crtl_enums.h"
@@ -31,4 +32,38 @@ CRTL_EXPORT std::wstring utf8_to_utf16(const std::string &utf8);
 CRTL_EXPORT std::string utf16_to_utf8(const std::wstring &utf16);
 
 CRTL_EXPORT size_t data_type_size(CRTL_DATA_TYPE type);
+
+// Convert a float to an IEEE 754 half precision float, rounding to nearest even
+CRTL_EXPORT uint16_t f32_to_f16(const float x);
+
+CRTL_EXPORT float f16_to_f32(const uint16_t x);
+
+/* Convert the array of n floats to half precision floats, e.g., to upload data to 16-bit
+ * buffer parameters. Uses F16C on x86 CPUs that support it and NEON on ARM
+ */
+CRTL_EXPORT void f32_to_f16(const float *in, uint16_t *out, const size_t n);
+
+// Convert the array of n half precision floats to floats
+CRTL_EXPORT void f16_to_f32(const uint16_t *in, float *out, const size_t n);
+
+/* Encode the n unit vectors stored as xyz floats in octahedral coordinates for buffers of
+ * CRTL_DATA_TYPE_OCT32, e.g., to upload normals. The encoders for the quantized formats use
+ * SSE2 on x86 and NEON on ARM
+ */
+CRTL_EXPORT void encode_oct32(const float *in, uint32_t *out, const size_t n);
+
+// Encode the n uv pairs as 16-bit unorms for buffers of CRTL_DATA_TYPE_UNORM16_2
+CRTL_EXPORT void encode_unorm16_2(const float *in, uint16_t *out, const size_t n);
+
+/* Get the number of elements in a buffer of CRTL_DATA_TYPE_SNORM16_3 holding n positions,
+ * which includes the header storing their scale and bias
+ */
+CRTL_EXPORT size_t snorm16_3_elements(const size_t n);
+
+/* Encode the n positions stored as xyz floats as 16-bit snorms relative to their bounds for
+ * buffers of CRTL_DATA_TYPE_SNORM16_3. out must hold snorm16_3_elements(n) elements, the
+ * float3 scale and bias mapping the snorms back to the bounds are written first followed by
+ * the encoded positions
+ */
+CRTL_EXPORT void encode_snorm16_3(const float *in, int16_t *out, const size_t n);
 }
@@ -140,6 +140,15 @@ DOUBLE2X4: 'double2x4';
 DOUBLE3X4: 'double3x4';
 DOUBLE4X4: 'double4x4';
 
+// The 16-bit types are each a single token covering their vector and matrix forms. The int
+// types separate the dimensions with an underscore, e.g. int16_3 or uint16_2x2
+HALF: 'half' ([2-4] | [2-4] 'x' [1-4] | '1x' [2-4])?;
+INT16: 'int16' ('_' ([2-4] | [2-4] 'x' [1-4] | '1x' [2-4]))?;
+UINT16: 'uint16' ('_' ([2-4] | [2-4] 'x' [1-4] | '1x' [2-4]))?;
+
+// The quantized formats read only buffers can store their elements in
+QUANTIZED_FORMAT: 'oct32' | 'unorm16_2' | 'snorm16_3';
+
 BUFFER: 'Buffer';
 RWBUFFER: 'RWBuffer';
 
@@ -166,6 +175,8 @@ MISS: 'miss';
 COMPUTE: 'compute';
 
 CONST: 'const';
+PRECISE: 'precise';
+SPECIALIZE: 'specialize';
 OUT: 'out';
 IN: 'in';
 IN_OUT: 'inout';
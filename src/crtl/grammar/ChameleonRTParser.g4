@@ -10,13 +10,33 @@ topLevelDeclaration: functionDecl
                    | structDecl
                    | varDeclStmt
                    | globalParamDecl
+                   | specializationConstantDecl
                    ;
 
-functionDecl: (entryPointType | typeName) IDENTIFIER LEFT_PAREN parameterList? RIGHT_PAREN block;
+functionDecl: attribute* (entryPointType | typeName) IDENTIFIER typeParameters? LEFT_PAREN parameterList? RIGHT_PAREN block;
+
+// Generic functions take type parameters, which are deduced from the arguments at each call.
+// The function is instantiated for each distinct set of type arguments
+typeParameters: LESS IDENTIFIER (COMMA IDENTIFIER)* GREATER;
+
+// Attributes provide hints to the compiler, e.g. [inline] or [unroll(4)]
+attribute: LEFT_BRACKET attributeName (LEFT_PAREN attributeArg (COMMA attributeArg)* RIGHT_PAREN)? RIGHT_BRACKET;
+
+// half is also a type name, but is used as the [half] payload member encoding
+attributeName: IDENTIFIER
+             | HALF
+             ;
+
+attributeArg: INTEGER_LITERAL
+            | FLOAT_LITERAL
+            | IDENTIFIER
+            ;
 
 structDecl: STRUCT IDENTIFIER LEFT_BRACE structMember* RIGHT_BRACE SEMICOLON;
 
-structMember: typeName IDENTIFIER SEMICOLON;
+// Struct members can have attributes selecting how they're encoded, e.g. [half] or [unorm(8)],
+// or the layout of buffer members, e.g. [soa]
+structMember: attribute* typeName IDENTIFIER SEMICOLON;
 
 parameterList: parameter (COMMA parameter)*;
 
@@ -26,12 +46,18 @@ block: LEFT_BRACE statement* RIGHT_BRACE;
 
 // NOTE: need to make sure vardecl type is not void
 // TODO: Array type declaration
-varDecl: CONST? typeName IDENTIFIER (EQUAL expr)?;
+// Expressions computing the value of precise variables are not rewritten by fast math
+varDecl: PRECISE? CONST? typeName IDENTIFIER (EQUAL expr)?;
 
 varDeclStmt: varDecl SEMICOLON;
 
 // TODO: Array type declaration, cannot be void
-globalParamDecl: IN CONST? typeName IDENTIFIER SEMICOLON;
+// Global parameters can have attributes selecting their layout, e.g. [soa] on struct buffers
+globalParamDecl: attribute* IN CONST? typeName IDENTIFIER SEMICOLON;
+
+// Specialization constants are replaced by the value supplied when the shader library is
+// created, or the default value if none is given
+specializationConstantDecl: SPECIALIZE CONST typeName IDENTIFIER (EQUAL expr)? SEMICOLON;
 
 statement: ifStmt
          | whileStmt
@@ -42,11 +68,13 @@ statement: ifStmt
          | exprStmt
          ;
 
-ifStmt: IF LEFT_PAREN expr RIGHT_PAREN statement (ELSE statement)?;
+// If statements and loops can have attributes hinting how they're compiled, e.g. [branch] or
+// [unroll(4)]
+ifStmt: attribute* IF LEFT_PAREN expr RIGHT_PAREN statement (ELSE statement)?;
 
-whileStmt: WHILE LEFT_PAREN expr RIGHT_PAREN (statement | SEMICOLON);
+whileStmt: attribute* WHILE LEFT_PAREN expr RIGHT_PAREN (statement | SEMICOLON);
 
-forStmt: FOR LEFT_PAREN (varDecl | forInit)? SEMICOLON forCond? SEMICOLON forAdvance? RIGHT_PAREN (statement | SEMICOLON);
+forStmt: attribute* FOR LEFT_PAREN (varDecl | forInit)? SEMICOLON forCond? SEMICOLON forAdvance? RIGHT_PAREN (statement | SEMICOLON);
 
 forInit: expr;
 
@@ -201,6 +229,10 @@ typeName: IDENTIFIER templateParameters?
         | DOUBLE2X4
         | DOUBLE3X4
         | DOUBLE4X4
+        | HALF
+        | INT16
+        | UINT16
+        | QUANTIZED_FORMAT
         | VOID
         ;
 
@@ -470,6 +470,8 @@ const char *error_to_string(CRTL_ERROR err)
         return "CRTL_ERROR_INCOMPATIBLE_SHADER_RECORD_PARAMETER_BLOCK";
     case CRTL_ERROR_INVALID_PARAMETER_TYPE:
         return "CRTL_ERROR_INVALID_PARAMETER_TYPE";
+    case CRTL_ERROR_PROFILE_IO_FAILED:
+        return "CRTL_ERROR_PROFILE_IO_FAILED";
     case CRTL_ERROR_UNKNOWN:
     default:
         return "CRTL_ERROR_UNKNOWN";